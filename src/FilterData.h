@@ -6,10 +6,18 @@
 #include <atomic>
 #include <memory>
 
+#include "consts.h"
 #include "models/Model.h"
 #include "ort-utils/ORTModelData.h"
 #include "ort-utils/gpu-info.h"
 #include "ort-utils/cuda-preprocess.h"
+#include "ort-utils/cuda-gl-interop.h"
+#include "ort-utils/input-frame.h"
+#include "ort-utils/inference-scheduler.h"
+#include "ort-utils/pipeline-stats.h"
+#include "ort-utils/session-builder.h"
+#include "ort-utils/triple-buffer.h"
+#include "obs-utils/stage-surface-ring.h"
 
 /**
   * @brief The filter_data struct
@@ -25,23 +33,115 @@ struct filter_data : public ORTModelData, public std::enable_shared_from_this<fi
 
 	obs_source_t *source;
 	gs_texrender_t *texrender;
-	gs_stagesurf_t *stagesurface;
+	// Asynchronous readback of texrender: frames are mapped a render after staging
+	StageSurfaceRing stageRing;
 
-	cv::Mat inputBGRA;
+	// Captured source frames: video_render (producer) → video_tick (consumer).
+	// Lock-free, so tick never skips a frame because render holds a lock.
+	TripleBuffer<InputFrame> inputFrames;
 
 	std::atomic<bool> isDisabled{false};
 	std::atomic<bool> trtInferenceFailed{false};
 
-	std::mutex inputBGRALock;
-	std::mutex outputLock;
-
 	std::string modelFilepath;
 
-	// GPU architecture info (detected once at startup)
+	// Measured stage latencies and the adaptive inference interval
+	InferenceScheduler scheduler;
+
+	// Per-stage latency histograms and frame counters (properties + periodic log)
+	PipelineStats stats;
+
+	// GPU architecture info (detected at startup, and again for a session on another GPU)
 	GpuInfo gpuInfo;
 
+	// The gpu_device setting the session was requested with: a CUDA device index
+	// or GPU_DEVICE_AUTO, resolved into deviceId by SessionSettings::resolveDevice()
+	int gpuDevice = 0;
+
+	// CUDA device the session, its buffers and the inference threads run on (the
+	// resolved gpu_device setting). Changes only while the async queue is stopped.
+	int deviceId = 0;
+
+	// Priority of the session's CUDA stream (and cudaPreprocessor's), against
+	// the process's other CUDA work. Changes with the session.
+	SchedulingPriority schedulingPriority = SchedulingPriority::NORMAL;
+
 	// CUDA-accelerated preprocessor (reusable GPU buffers)
 	CudaPreprocessor cudaPreprocessor;
+
+	// Bind inputs/outputs to pre-allocated CUDA tensors (ORT IoBinding) instead of
+	// host tensors that ORT copies H2D/D2H on every Run. Read by createOrtSession.
+	bool useIoBinding = true;
+
+	// Graph mode (requires IoBinding): ORT captures inference as CUDA graphs
+	// (enable_cuda_graph) and our preprocessing/mask kernels are replayed from
+	// captured graphs. Set cudaGraphFailed when a run fails so the session is
+	// rebuilt without graphs.
+	bool useCudaGraph = false;
+	std::atomic<bool> cudaGraphFailed{false};
+
+	// Share the session with other instances using the same model and execution
+	// provider (not in graph mode). Read by createOrtSession.
+	bool useSharedEngine = true;
+
+	// Inference precision: PRECISION_AUTO (the GPU's default precision), FP32,
+	// FP16 (TensorRT FP16 build, or the model's FP16 variant with half-precision
+	// tensors on CUDA) or INT8 (TensorRT only). Read by createOrtSession through
+	// sessionPrecision().
+	std::string precision = PRECISION_AUTO;
+
+	// TensorRT builder workspace limit, sized into the free GPU memory by the
+	// session builder's VRAM budget. Read by createOrtSession.
+	size_t trtWorkspaceBytes = (size_t)2048 << 20;
+
+	// Inference resolution of models with dynamic input shapes (RVM, dynamic-size
+	// descriptors): a percentage of the source or a short edge, INFERENCE_RESOLUTIONS.
+	// Passed to Model::setSourceSize() by the session builder.
+	int inferenceResolution = INFERENCE_RESOLUTION_SOURCE;
+
+	// Split frames larger than the model input into overlapping tiles at the
+	// input size, run them as one batch where the model allows and blend the
+	// seams (models with supportsTiling()). Read by runFilterModelInference.
+	bool useTiledInference = false;
+
+	// Zero-copy input path: when enabled, getRGBAFromStageSurface() copies the
+	// texrender texture device-to-device into a device InputFrame via CUDA-GL
+	// interop. Falls back to the stage surface on failure.
+	std::atomic<bool> enableGpuInterop{false};
+	CudaGLTexture inputInterop;
+
+	// Let the render thread skip the readback of frames the scheduler won't
+	// infer (set by tick), and the count of those for InferenceScheduler::skipFrame()
+	std::atomic<bool> gateReadback{false};
+	std::atomic<int> readbackSkips{0};
+
+	// The filter renders with a mask another filter computes (mask sharing):
+	// the frame is drawn into texrender but not captured (set by tick)
+	std::atomic<bool> skipCapture{false};
+
+	// Frames captured by video_render so far: the sequence of the latest FrameTag
+	std::atomic<uint64_t> captureSequence{0};
+
+	// Device frames captured on the render GPU, copied to deviceId by video_tick
+	// when the filter runs on another GPU (see localInputFrame)
+	InputFrame peerInput;
+
+	// Settings the user asked for (update thread), and the background build of
+	// the session for them. Declared last: the builder joins its thread before
+	// the stream it builds on is destroyed.
+	SessionSettings requestedSession;
+	SessionBuilder sessionBuilder;
+
+	filter_data() { scheduler.setStats(&stats); }
+
+	~filter_data()
+	{
+		// A private ORT session runs on cudaPreprocessor's stream: release it
+		// before the stream is destroyed with the members below
+		ioBinding.reset();
+		session.reset();
+		sharedEngine.reset();
+	}
 };
 
 #endif /* FILTERDATA_H */
@@ -6,6 +6,11 @@
 
 #include "ort-utils/profiler.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
 #include <numeric>
 #include <memory>
 #include <exception>
@@ -13,24 +18,42 @@
 #include <new>
 #include <mutex>
 #include <regex>
+#include <sstream>
 #include <thread>
 
+#include <sched.h>
+
+#include <util/platform.h>
 #include <plugin-support.h>
-#include "models/ModelSINET.h"
-#include "models/ModelMediapipe.h"
-#include "models/ModelSelfie.h"
-#include "models/ModelSelfieMulticlass.h"
-#include "models/ModelRVM.h"
-#include "models/ModelPPHumanSeg.h"
-#include "models/ModelTCMonoDepth.h"
-#include "models/ModelRMBG.h"
+#include "models/ModelFactory.h"
 #include "FilterData.h"
 #include "ort-utils/ort-session-utils.h"
 #include "ort-utils/async-inference-queue.h"
+#include "ort-utils/inference-pipeline.h"
+#include "ort-utils/cuda-mask-postprocess.h"
+#include "ort-utils/depth-stage.h"
+#include "ort-utils/enhance-stage.h"
+#include "ort-utils/scratch-arena.h"
+#include "ort-utils/session-cache.h"
+#include "ort-utils/trace-recorder.h"
+#include "obs-utils/mask-share.h"
 #include "obs-utils/obs-utils.h"
 #include "consts.h"
 #include "update-checker/update-checker.h"
 
+// Per-frame host buffers of the background filter (ScratchArena), by the thread using them
+enum ScratchBuffer {
+	SCRATCH_MODEL_OUTPUT,     // model output as CV_8U (under modelMutex: queue worker or sync path)
+	SCRATCH_PIPELINE_OUTPUT,  // model output as CV_8U (postprocess stage of the pipelined queue)
+	SCRATCH_ROI_MASK,         // mask of the inferred region before the paste (final queue stage)
+	SCRATCH_MATTE_MASK,       // alpha-matte mask of the sync path (video_tick)
+	SCRATCH_FRAME_MASK,       // CPU-refined mask at frame resolution (video_tick)
+	SCRATCH_SIMILARITY_THUMB, // image similarity thumbnail (video_tick)
+	SCRATCH_MOTION_THUMB,     // motion detection thumbnail of host frames (video_tick)
+	SCRATCH_FLOW_THUMB,       // mask flow thumbnail of host frames (video_tick)
+	SCRATCH_FLOW_RAW,         // block vectors before the median (video_tick)
+};
+
 struct background_removal_filter : public filter_data, public std::enable_shared_from_this<background_removal_filter> {
 	bool enableThreshold = true;
 	bool stopWhenSourceIsInactive = true;
@@ -43,36 +66,196 @@ struct background_removal_filter : public filter_data, public std::enable_shared
 
 	bool isAlphaMatteModel = false;
 
-	cv::Mat backgroundMask;
+	// Settings that reset tick-thread state or reconfigure the queue. update()
+	// hands them over under settingsMutex, video_tick applies them.
+	struct TickSettings {
+		bool roiInference = false;
+		bool motionAware = false;
+		bool tiledInference = false;
+		bool adaptiveScheduler = true;
+		int maskEveryXFrames = 1;
+		bool fusedEnhance = false;
+		bool focalDepth = false;
+		int gpuBudget = 0; // max inference ms per second, 0 = no cap
+		AsyncInferenceQueue::WorkerPolicy workerPolicy;
+		std::string maskShareKey; // mask sharing group on the source, empty = not sharing
+
+		bool operator!=(const TickSettings &other) const
+		{
+			return roiInference != other.roiInference || motionAware != other.motionAware ||
+			       tiledInference != other.tiledInference || adaptiveScheduler != other.adaptiveScheduler ||
+			       maskEveryXFrames != other.maskEveryXFrames || fusedEnhance != other.fusedEnhance ||
+			       focalDepth != other.focalDepth || gpuBudget != other.gpuBudget ||
+			       workerPolicy != other.workerPolicy || maskShareKey != other.maskShareKey;
+		}
+	};
+	std::mutex settingsMutex;
+	TickSettings pendingSettings;
+	bool settingsPending = true;
+	TickSettings appliedSettings; // video_tick only
+	cv::Size sessionSourceSize;   // source size the session was checked against (video_tick only)
+
+	// A session is set up (video_tick swaps sessions in); render passes the source through until then
+	std::atomic<bool> sessionActive{false};
+
+	// Suspend: suspendAfter seconds after the source went inactive, video_tick
+	// stops the workers, frees the device buffers and parks the sessions in the
+	// SuspendedSessionCache. The first tick after activation sets them up again.
+	std::atomic<uint64_t> inactiveSince{0}; // os_gettime_ns() of the deactivation, 0 = active
+	std::atomic<int> suspendAfter{10};      // seconds, 0 = never (update thread)
+	bool suspended = false;                 // video_tick only
+	bool suspendedSession = false;          // the filter had a session to park (video_tick only)
+	bool suspendedEnhancer = false;
+	bool suspendedDepth = false;
+
+	// Trace capture: the filter keeps the TraceRecorder recording while the
+	// setting is on, and Save Trace writes the last traceSeconds of it
+	bool traceCapture = false; // update thread
+	std::atomic<int> traceSeconds{10};
+
+	// ROI mode: infer on a box around the person from the previous masks instead
+	// of the whole frame (segmentation models on the async path only)
+	bool roiInference = false;
+	cv::Rect2f roi;        // smoothed region in frame pixels, empty = whole frame (video_tick only)
+	cv::Size roiFrameSize; // frame size roi refers to
+
+	// Motion-aware updates: static frames keep the mask, local motion refreshes
+	// only the changed region (segmentation models on the async path only)
+	bool motionAware = false;
+	CudaMotionDetector motionDetector; // video_tick only
+	int motionPartialUpdates = 0;      // partial pushes since the last full one (video_tick only)
+	cv::Mat lastRoiMask;               // last pasted full mask, base of partial updates (final queue stage)
+
+	// Mask interpolation: in between inferences, video_render warps the last mask
+	// with the block motion from the frame it was inferred on to the current frame
+	// (GPU block matching in video_tick, one warp pass in video_render)
+	std::atomic<bool> maskInterpolation{false};
+	bool maskFlowActive = false;             // video_tick only
+	CudaMaskFlow maskFlow;                   // video_tick only
+	cv::Mat flowPlanes[2];                   // x/y planes for the median (video_tick only)
+	cv::Mat flowFiltered[2];                 // video_tick only
+	TripleBuffer<cv::Mat> maskFlows;         // CV_32FC2 block vectors: video_tick → video_render
+	gs_texture_t *flowTexture = nullptr;     // GS_RG32F block vectors (render thread)
+	gs_texrender_t *warpTexrender = nullptr; // warped mask (render thread)
+
+	// Aligned frame delay (async path): video_render shows the frame captured
+	// frameDelay renders ago from a ring of frame copies, and video_tick holds
+	// every mask from the queue until its frame is shown. Masks then meet their
+	// own frames at a fixed latency the audio sync offset can absorb.
+	static constexpr int kMaxFrameDelay = 6;
+	std::atomic<int> alignedFrameDelay{0}; // the setting (update thread)
+	std::atomic<int> frameDelay{0};        // in effect: set by video_tick, 0 on the sync path
+	gs_texture_t *delayedFrames[kMaxFrameDelay + 1] = {}; // render thread
+	uint64_t delayedSequences[kMaxFrameDelay + 1] = {};   // capture sequence of each copy
+	struct PendingMask {
+		cv::Mat mask;
+		FrameTag tag;
+	};
+	PendingMask pendingMasks[kMaxFrameDelay + 1]; // masks waiting for their frame, oldest first (video_tick only)
+	int pendingMaskCount = 0;
+
+	// Queue overruns already counted into stats (video_tick only)
+	uint64_t framesDroppedSeen = 0;
+
+	// Per-frame temporaries (ScratchBuffer), allocated once per size. queueMask
+	// swaps with the queue's results so their buffers circulate instead of being
+	// freed each tick; contours keeps the contour filter's vectors.
+	ScratchArena scratch;
+	uint64_t scratchAllocationsSeen = 0; // video_tick only
+	cv::Mat queueMask;                   // latest mask taken from the async queue (video_tick only)
+	std::vector<std::vector<cv::Point>> contours; // video_tick only
+
+	// Host background masks: video_tick (producer) → video_render (consumer)
+	TripleBuffer<cv::Mat> backgroundMasks;
+	bool backgroundMaskPublished = false; // video_tick only
 	cv::Mat lastBackgroundMask;
 	cv::Mat lastImageBGRA;
 	float temporalSmoothFactor = 0.0f;
 	float imageSimilarityThreshold = 35.0f;
 	bool enableImageSimilarity = true;
 	int maskEveryXFrames = 1;
-	int maskEveryXFramesCount = 0;
 	int64_t blurBackground = 0;
+	bool dualKawaseBlur = false;
 	bool enableFocalBlur = false;
 	float blurFocusPoint = 0.1f;
 	float blurFocusDepth = 0.1f;
 
 	gs_effect_t *effect;
 	gs_effect_t *kawaseBlurEffect;
+	gs_effect_t *dualKawaseBlurEffect = nullptr;
+
+	// Blur passes ping-pong between these render targets (render thread). The
+	// texrenders keep their textures and only reallocate on a size change.
+	gs_texrender_t *blurTexrender[2] = {nullptr, nullptr};
+
+	// Dual Kawase pyramid: blurDown[k] holds level k + 1 (half size per level),
+	// blurUp[k] the upsampled result at level k
+	static constexpr int kMaxBlurLevels = 6;
+	gs_texrender_t *blurDown[kMaxBlurLevels] = {};
+	gs_texrender_t *blurUp[kMaxBlurLevels] = {};
 
 	std::mutex modelMutex;
 
 	// Async inference queue — decouples inference from video pipeline
 	AsyncInferenceQueue asyncQueue;
 
+	// Per-slot tensors and streams for the pipelined queue stages (IoBinding)
+	InferencePipeline inferencePipeline;
+
+	// GPU mask pipeline: refinement runs in CUDA and the result is copied
+	// device-to-device into maskTexture. Published lock-free by video_tick.
+	std::atomic<bool> enableGpuMaskPipeline{false};
+	CudaMaskPostprocessor maskPostprocessor;
+
+	// Guided upsampling of the segmentation masks with the frame as guide (GPU
+	// mask pipeline, async path), instead of the bilinear resize
+	std::atomic<bool> guidedUpsample{false};
+
+	// Fused Enhance Portrait ("remove background + enhance"): the enhancement
+	// model runs in the same worker (or the sync path) right before the
+	// segmentation, on the same device frame, and video_render composites the
+	// enhanced person in the final pass. enhancer holds the enhancement session;
+	// it is used under modelMutex like the segmentation session.
+	filter_data enhancer;
+	EnhanceStage enhanceStage;
+	DeviceFrame fusedFrame;                      // host frames uploaded once for both models (modelMutex)
+	std::atomic<bool> fusedEnhanceActive{false}; // an enhancement session is set up (video_tick)
+	float enhanceBlend = 1.0f;
+
+	// Focal blur depth: the depth model runs on its own session, stream and
+	// worker at depthRate updates per second, and the focal blur reads the
+	// cached depth map instead of the segmentation mask. depthEstimator holds
+	// the depth session; video_tick stops the worker to swap it.
+	filter_data depthEstimator;
+	DepthStage depthStage;
+	std::atomic<bool> focalDepthActive{false}; // a depth session is set up (video_tick)
+	std::atomic<int> depthRate{5};             // updates per second
+
+	// Persistent GS_R8 alpha mask texture, reallocated only on size change (render thread)
+	gs_texture_t *maskTexture = nullptr;
+	CudaGLTexture maskInterop;
+	bool maskTextureFromGpu = false;
+
 	~background_removal_filter()
 	{
 		asyncQueue.stop();
+		depthStage.stop();
+		freeDeviceFrame(fusedFrame);
+		// Parked private sessions run on the streams of the filter_data destructors
+		SuspendedSessionCache::instance().drop(static_cast<filter_data *>(this));
+		SuspendedSessionCache::instance().drop(&enhancer);
+		SuspendedSessionCache::instance().drop(&depthEstimator);
 		obs_log(LOG_INFO, "Background removal filter destructor called");
 	}
 };
 
-static void processImageForBackground(struct background_removal_filter *tf, const cv::Mat &imageBGRA,
+template<typename Frame>
+static bool processImageForBackground(struct background_removal_filter *tf, const Frame &imageBGRA,
 				      cv::Mat &backgroundMask);
+static void outputToBackgroundMask(struct background_removal_filter *tf, const cv::Mat &outputImage,
+				   cv::Mat &backgroundMask);
+static void pasteRoiMask(struct background_removal_filter *tf, const InputFrame &input, const cv::Mat &roiMask,
+			 cv::Mat &backgroundMask);
 
 const char *background_filter_getname(void *unused)
 {
@@ -108,6 +291,40 @@ static bool enable_image_similarity(obs_properties_t *ppts, obs_property_t *p, o
 	return visible_on_bool(ppts, settings, "enable_image_similarity", "image_similarity_threshold");
 }
 
+// Save Trace: write the last trace_seconds of the trace to the plugin cache
+// directory (traces/trace-<time>.json, opened in ui.perfetto.dev)
+static bool save_trace_clicked(obs_properties_t *props, obs_property_t *property, void *data)
+{
+	UNUSED_PARAMETER(props);
+	UNUSED_PARAMETER(property);
+	auto *ptr = static_cast<std::shared_ptr<background_removal_filter> *>(data);
+	if (!ptr || !*ptr) {
+		return false;
+	}
+
+	std::error_code error;
+	const std::filesystem::path directory = std::filesystem::path(getPluginCachePath()) / "traces";
+	std::filesystem::create_directories(directory, error);
+	char name[64];
+	const time_t now = time(nullptr);
+	struct tm local = {};
+	localtime_r(&now, &local);
+	strftime(name, sizeof(name), "trace-%Y%m%d-%H%M%S.json", &local);
+	const std::string path = (directory / name).string();
+
+	const int events = TraceRecorder::instance().write(path, (*ptr)->traceSeconds);
+	if (events < 0) {
+		obs_log(LOG_ERROR, "Failed to write the trace to %s", path.c_str());
+	} else if (events == 0) {
+		obs_log(LOG_WARNING, "No trace events recorded (turn on trace recording first), wrote %s",
+			path.c_str());
+	} else {
+		obs_log(LOG_INFO, "Wrote %d trace events of the last %d s to %s", events, (int)(*ptr)->traceSeconds,
+			path.c_str());
+	}
+	return false;
+}
+
 static bool enable_advanced_settings(obs_properties_t *ppts, obs_property_t *p, obs_data_t *settings)
 {
 	const bool enabled = obs_data_get_bool(settings, "advanced");
@@ -115,9 +332,13 @@ static bool enable_advanced_settings(obs_properties_t *ppts, obs_property_t *p,
 	obs_property_set_visible(p, true);
 
 	for (const char *prop_name :
-	     {"model_select", "useGPU", "mask_every_x_frames", "numThreads", "enable_focal_blur", "enable_threshold",
-	      "threshold_group", "focal_blur_group", "temporal_smooth_factor", "image_similarity_threshold",
-	      "enable_image_similarity", "mask_expansion"}) {
+	     {"model_select", "useGPU", "precision", "gpu_device", "inference_resolution", "mask_every_x_frames",
+	      "numThreads", "enable_focal_blur", "enable_threshold", "threshold_group", "focal_blur_group",
+	      "temporal_smooth_factor", "image_similarity_threshold", "enable_image_similarity", "mask_expansion",
+	      "zero_copy_input", "gpu_mask_pipeline", "guided_upsample", "io_binding", "cuda_graph", "shared_engine",
+	      "blur_mode", "roi_inference", "tiled_inference", "adaptive_scheduler", "motion_aware",
+	      "mask_interpolation", "aligned_frame_delay", "share_mask", "scheduling_priority", "inference_cpus",
+	      "max_gpu_ms", "suspend_after", "trace_capture", "trace_seconds", "save_trace", "pipeline_stats"}) {
 		p = obs_properties_get(ppts, prop_name);
 		obs_property_set_visible(p, enabled);
 	}
@@ -175,7 +396,82 @@ obs_properties_t *background_filter_properties(void *data)
 	obs_property_list_add_string(p_use_gpu, obs_module_text("GPUCUDA"), USEGPU_CUDA);
 	obs_property_list_add_string(p_use_gpu, obs_module_text("TENSORRT"), USEGPU_TENSORRT);
 
+	/* Inference precision (FP16 on CUDA uses the model's FP16 variant, INT8 is TensorRT only) */
+	obs_property_t *p_precision = obs_properties_add_list(props, "precision", obs_module_text("Precision"),
+							      OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_STRING);
+	obs_property_list_add_string(p_precision, obs_module_text("PrecisionAuto"), PRECISION_AUTO);
+	obs_property_list_add_string(p_precision, obs_module_text("PrecisionFP32"), PRECISION_FP32);
+	obs_property_list_add_string(p_precision, obs_module_text("PrecisionFP16"), PRECISION_FP16);
+	obs_property_list_add_string(p_precision, obs_module_text("PrecisionINT8"), PRECISION_INT8);
+
+	/* CUDA device the filter runs on */
+	addGpuDeviceProperty(props);
+
+	/* Input size of models with dynamic input shapes, relative to the source */
+	obs_property_t *p_resolution = obs_properties_add_list(props, "inference_resolution",
+							       obs_module_text("InferenceResolution"),
+							       OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	for (int resolution : INFERENCE_RESOLUTIONS) {
+		const std::string key = "InferenceResolution" + std::to_string(resolution);
+		obs_property_list_add_int(p_resolution, obs_module_text(key.c_str()), resolution);
+	}
+
+	/* Zero-copy input: CUDA-GL interop instead of stage surface readback */
+	obs_properties_add_bool(props, "zero_copy_input", obs_module_text("ZeroCopyGpuInput"));
+
+	/* GPU mask postprocessing with direct upload into the alpha texture */
+	obs_properties_add_bool(props, "gpu_mask_pipeline", obs_module_text("GpuMaskPipeline"));
+
+	/* Edge-aware mask upsampling guided by the frame (GPU mask pipeline) */
+	obs_properties_add_bool(props, "guided_upsample", obs_module_text("GuidedUpsample"));
+
+	/* Crop the model input to the tracked person (segmentation models) */
+	obs_properties_add_bool(props, "roi_inference", obs_module_text("RoiInference"));
+
+	/* Split large frames into overlapping model-size tiles (heavy matting models, e.g. RMBG) */
+	obs_properties_add_bool(props, "tiled_inference", obs_module_text("TiledInference"));
+
+	/* Skip static frames and re-infer only the moving region (GPU frame differencing) */
+	obs_properties_add_bool(props, "motion_aware", obs_module_text("MotionAware"));
+
+	/* Warp the last mask with the frame's motion in between inferences (GPU block matching) */
+	obs_properties_add_bool(props, "mask_interpolation", obs_module_text("MaskInterpolation"));
+
+	/* Filters on one source with the same mask settings infer the mask once */
+	obs_properties_add_bool(props, "share_mask", obs_module_text("ShareMask"));
+
+	/* Delay the video so that every mask is applied to the frame it was inferred on */
+	obs_properties_add_int(props, "aligned_frame_delay", obs_module_text("AlignedFrameDelay"), 0,
+			       background_removal_filter::kMaxFrameDelay, 1);
+
+	/* ORT IoBinding: pre-bound CUDA tensors instead of per-run host copies */
+	obs_properties_add_bool(props, "io_binding", obs_module_text("IoBinding"));
+
+	/* CUDA graph replay of the per-frame GPU work (fixed-shape models, needs IoBinding) */
+	obs_properties_add_bool(props, "cuda_graph", obs_module_text("CudaGraphMode"));
+
+	/* One session per model/provider shared by all instances, batched where the model allows */
+	obs_properties_add_bool(props, "shared_engine", obs_module_text("SharedEngine"));
+
 	obs_properties_add_int(props, "mask_every_x_frames", obs_module_text("CalculateMaskEveryXFrame"), 1, 300, 1);
+
+	/* Skip inference on some frames when the measured latency doesn't fit the frame budget */
+	obs_properties_add_bool(props, "adaptive_scheduler", obs_module_text("AdaptiveScheduler"));
+
+	/* Coexistence with NVENC and games: stream and worker thread priority, CPU pinning, duty-cycle cap */
+	obs_property_t *p_priority = obs_properties_add_list(props, "scheduling_priority",
+							     obs_module_text("SchedulingPriority"), OBS_COMBO_TYPE_LIST,
+							     OBS_COMBO_FORMAT_STRING);
+	obs_property_list_add_string(p_priority, obs_module_text("SchedulingPriorityHigh"), SCHEDULING_PRIORITY_HIGH);
+	obs_property_list_add_string(p_priority, obs_module_text("SchedulingPriorityNormal"),
+				     SCHEDULING_PRIORITY_NORMAL);
+	obs_property_list_add_string(p_priority, obs_module_text("SchedulingPriorityLow"), SCHEDULING_PRIORITY_LOW);
+	obs_properties_add_text(props, "inference_cpus", obs_module_text("InferenceCpus"), OBS_TEXT_DEFAULT);
+	obs_properties_add_int(props, "max_gpu_ms", obs_module_text("MaxGpuMs"), 0, 1000, 10);
+	obs_properties_add_int(props, "suspend_after", obs_module_text("SuspendAfter"), 0, 3600, 1);
+	obs_properties_add_bool(props, "trace_capture", obs_module_text("TraceCapture"));
+	obs_properties_add_int(props, "trace_seconds", obs_module_text("TraceSeconds"), 1, 60, 1);
+	obs_properties_add_button(props, "save_trace", obs_module_text("SaveTrace"), save_trace_clicked);
 	obs_properties_add_int_slider(props, "numThreads", obs_module_text("NumThreads"), 0, 8, 1);
 
 	/* Model selection Props */
@@ -206,6 +502,12 @@ obs_properties_t *background_filter_properties(void *data)
 	obs_properties_add_int_slider(props, "blur_background", obs_module_text("BlurBackgroundFactor0NoBlurUseColor"),
 				      0, 20, 1);
 
+	/* Full-resolution Kawase iterations, or a downsample/upsample pyramid whose cost barely grows with the blur */
+	obs_property_t *p_blur_mode = obs_properties_add_list(props, "blur_mode", obs_module_text("BlurMode"),
+							      OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_STRING);
+	obs_property_list_add_string(p_blur_mode, obs_module_text("BlurModeKawase"), BLUR_MODE_KAWASE);
+	obs_property_list_add_string(p_blur_mode, obs_module_text("BlurModeDualKawase"), BLUR_MODE_DUAL_KAWASE);
+
 	obs_property_t *p_enable_focal_blur =
 		obs_properties_add_bool(props, "enable_focal_blur", obs_module_text("EnableFocalBlur"));
 	obs_property_set_modified_callback(p_enable_focal_blur, enable_focal_blur);
@@ -216,10 +518,26 @@ obs_properties_t *background_filter_properties(void *data)
 					1.0, 0.05);
 	obs_properties_add_float_slider(focal_blur_props, "blur_focus_depth", obs_module_text("BlurFocusDepth"), 0.0,
 					0.3, 0.02);
+	/* Depth of field from a depth model at a few updates per second, instead of the person mask */
+	obs_properties_add_bool(focal_blur_props, "focal_depth", obs_module_text("FocalDepthModel"));
+	obs_properties_add_int_slider(focal_blur_props, "depth_rate", obs_module_text("DepthRate"), 1, 15, 1);
 
 	obs_properties_add_group(props, "focal_blur_group", obs_module_text("FocalBlurGroup"), OBS_GROUP_NORMAL,
 				 focal_blur_props);
 
+	/* Fused Enhance Portrait: one capture and upload for both models, composited in one pass */
+	obs_property_t *p_enhance_model = obs_properties_add_list(props, "enhance_model",
+								  obs_module_text("FusedEnhanceModel"),
+								  OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_STRING);
+	obs_property_list_add_string(p_enhance_model, obs_module_text("FusedEnhanceOff"), "");
+	obs_property_list_add_string(p_enhance_model, obs_module_text("TBEFN"), MODEL_ENHANCE_TBEFN);
+	obs_property_list_add_string(p_enhance_model, obs_module_text("URETINEX"), MODEL_ENHANCE_URETINEX);
+	obs_property_list_add_string(p_enhance_model, obs_module_text("SGLLIE"), MODEL_ENHANCE_SGLLIE);
+	obs_property_list_add_string(p_enhance_model, obs_module_text("ZERODCE"), MODEL_ENHANCE_ZERODCE);
+
+	obs_properties_add_float_slider(props, "enhance_blend", obs_module_text("FusedEnhanceStrength"), 0.0, 1.0,
+					0.05);
+
 	// Add a informative text about the plugin
 	// replace the placeholder with the current version
 	// use std::regex_replace instead of QString::arg because the latter doesn't work on Linux
@@ -231,7 +549,19 @@ obs_properties_t *background_filter_properties(void *data)
 	}
 	obs_properties_add_text(props, "info", basic_info.c_str(), OBS_TEXT_INFO);
 
-	UNUSED_PARAMETER(data);
+	/* Per-stage latencies and frame counters of the running filter (read-only) */
+	auto *ptr = static_cast<std::shared_ptr<background_removal_filter> *>(data);
+	if (ptr && *ptr) {
+		const std::string stats = (*ptr)->stats.summary();
+		obs_properties_add_text(props, "pipeline_stats", stats.c_str(), OBS_TEXT_INFO);
+		/* The session was stepped down or its TensorRT workspace shrunk to fit the free VRAM */
+		const std::string budget = (*ptr)->sessionBuilder.budgetDecision();
+		if (!budget.empty()) {
+			const std::string text = std::string(obs_module_text("VramBudget")) + ": " + budget;
+			obs_properties_add_text(props, "vram_budget", text.c_str(), OBS_TEXT_INFO);
+		}
+	}
+
 	return props;
 }
 
@@ -246,9 +576,32 @@ void background_filter_defaults(obs_data_t *settings)
 	obs_data_set_default_double(settings, "mask_expansion", 0);
 	obs_data_set_default_double(settings, "feather", 0.0);
 	obs_data_set_default_string(settings, "useGPU", USEGPU_CUDA);
+	obs_data_set_default_string(settings, "precision", PRECISION_AUTO);
+	obs_data_set_default_int(settings, "gpu_device", 0);
+	obs_data_set_default_int(settings, "inference_resolution", INFERENCE_RESOLUTION_SOURCE);
+	obs_data_set_default_bool(settings, "zero_copy_input", true);
+	obs_data_set_default_bool(settings, "gpu_mask_pipeline", true);
+	obs_data_set_default_bool(settings, "guided_upsample", false);
+	obs_data_set_default_bool(settings, "roi_inference", false);
+	obs_data_set_default_bool(settings, "tiled_inference", false);
+	obs_data_set_default_bool(settings, "motion_aware", false);
+	obs_data_set_default_bool(settings, "mask_interpolation", false);
+	obs_data_set_default_int(settings, "aligned_frame_delay", 0);
+	obs_data_set_default_bool(settings, "share_mask", false);
+	obs_data_set_default_bool(settings, "io_binding", true);
+	obs_data_set_default_bool(settings, "cuda_graph", false);
+	obs_data_set_default_bool(settings, "shared_engine", true);
 	obs_data_set_default_string(settings, "model_select", MODEL_RVM);
 	obs_data_set_default_int(settings, "mask_every_x_frames", 1);
+	obs_data_set_default_bool(settings, "adaptive_scheduler", true);
+	obs_data_set_default_string(settings, "scheduling_priority", SCHEDULING_PRIORITY_NORMAL);
+	obs_data_set_default_string(settings, "inference_cpus", "");
+	obs_data_set_default_int(settings, "max_gpu_ms", 0);
+	obs_data_set_default_int(settings, "suspend_after", 10);
+	obs_data_set_default_bool(settings, "trace_capture", false);
+	obs_data_set_default_int(settings, "trace_seconds", 10);
 	obs_data_set_default_int(settings, "blur_background", 0);
+	obs_data_set_default_string(settings, "blur_mode", BLUR_MODE_KAWASE);
 	obs_data_set_default_int(settings, "numThreads", 1);
 	obs_data_set_default_bool(settings, "enable_focal_blur", false);
 	obs_data_set_default_double(settings, "temporal_smooth_factor", 0.7);
@@ -256,6 +609,74 @@ void background_filter_defaults(obs_data_t *settings)
 	obs_data_set_default_bool(settings, "enable_image_similarity", false);
 	obs_data_set_default_double(settings, "blur_focus_point", 0.1);
 	obs_data_set_default_double(settings, "blur_focus_depth", 0.0);
+	obs_data_set_default_bool(settings, "focal_depth", false);
+	obs_data_set_default_int(settings, "depth_rate", 5);
+	obs_data_set_default_string(settings, "enhance_model", "");
+	obs_data_set_default_double(settings, "enhance_blend", 1.0);
+}
+
+// Parse a CPU list such as "4-7,10" (the inference_cpus setting). Returns false
+// on a syntax error; empty text is no list.
+static bool parseCpuList(const std::string &text, std::vector<int> &cpus)
+{
+	cpus.clear();
+	std::stringstream items(text);
+	std::string item;
+	while (std::getline(items, item, ',')) {
+		int first = 0;
+		int last = 0;
+		char dash = 0;
+		char rest = 0;
+		const int fields = sscanf(item.c_str(), " %d %c %d %c", &first, &dash, &last, &rest);
+		if (fields == 1) {
+			last = first;
+		} else if (fields != 3 || dash != '-') {
+			return false;
+		}
+		if (first < 0 || last < first || last >= CPU_SETSIZE) {
+			return false;
+		}
+		for (int cpu = first; cpu <= last; cpu++) {
+			cpus.push_back(cpu);
+		}
+	}
+	return true;
+}
+
+// Mask sharing group of the settings: the settings that decide the mask a
+// filter renders with, so another filter on the source with the same key
+// would compute the same mask. Empty when the filter can't share: it doesn't
+// want to, or its enhancement, depth map or frame delay need frames of its own.
+static std::string maskShareKey(obs_data_t *settings)
+{
+	if (!obs_data_get_bool(settings, "share_mask") || *obs_data_get_string(settings, "enhance_model") ||
+	    (obs_data_get_bool(settings, "enable_focal_blur") && obs_data_get_bool(settings, "focal_depth")) ||
+	    obs_data_get_int(settings, "aligned_frame_delay") > 0) {
+		return std::string();
+	}
+	std::string key;
+	for (const char *name : {"model_select", "useGPU", "precision"}) {
+		key += std::string(obs_data_get_string(settings, name)) + "|";
+	}
+	for (const char *name : {"inference_resolution", "threshold", "contour_filter", "smooth_contour", "feather",
+				 "mask_expansion", "temporal_smooth_factor", "mask_every_x_frames"}) {
+		key += std::to_string(obs_data_get_double(settings, name)) + "|";
+	}
+	for (const char *name : {"enable_threshold", "gpu_mask_pipeline", "guided_upsample", "roi_inference",
+				 "tiled_inference", "motion_aware", "mask_interpolation"}) {
+		key += obs_data_get_bool(settings, name) ? "1" : "0";
+	}
+	return key;
+}
+
+// OBS output frame interval in milliseconds (0 if video isn't initialized)
+static double obsFramePeriodMs()
+{
+	struct obs_video_info ovi;
+	if (!obs_get_video_info(&ovi) || ovi.fps_num == 0) {
+		return 0.0;
+	}
+	return 1000.0 * ovi.fps_den / ovi.fps_num;
 }
 
 void background_filter_update(void *data, obs_data_t *settings)
@@ -273,12 +694,19 @@ void background_filter_update(void *data, obs_data_t *settings)
 		return;
 	}
 
-	tf->isDisabled = true;
-
-	// Stop async queue before any model changes to avoid deadlock with modelMutex
-	tf->asyncQueue.stop();
-
+	// Per-frame parameters: applied as they are, the queue keeps running
 	tf->stopWhenSourceIsInactive = obs_data_get_bool(settings, "stop_when_source_is_inactive");
+	tf->suspendAfter = (int)obs_data_get_int(settings, "suspend_after");
+	const bool traceCapture = obs_data_get_bool(settings, "trace_capture");
+	if (traceCapture != tf->traceCapture) {
+		tf->traceCapture = traceCapture;
+		if (traceCapture) {
+			TraceRecorder::instance().acquire();
+		} else {
+			TraceRecorder::instance().release();
+		}
+	}
+	tf->traceSeconds = (int)obs_data_get_int(settings, "trace_seconds");
 	tf->enableThreshold = (float)obs_data_get_bool(settings, "enable_threshold");
 	tf->threshold = (float)obs_data_get_double(settings, "threshold");
 
@@ -286,78 +714,143 @@ void background_filter_update(void *data, obs_data_t *settings)
 	tf->smoothContour = (float)obs_data_get_double(settings, "smooth_contour");
 	tf->maskExpansion = (int)obs_data_get_double(settings, "mask_expansion");
 	tf->feather = (float)obs_data_get_double(settings, "feather");
-	tf->maskEveryXFrames = (int)obs_data_get_int(settings, "mask_every_x_frames");
-	tf->maskEveryXFramesCount = (int)(0);
 	tf->blurBackground = obs_data_get_int(settings, "blur_background");
+	tf->dualKawaseBlur = std::string(obs_data_get_string(settings, "blur_mode")) == BLUR_MODE_DUAL_KAWASE;
 	tf->enableFocalBlur = (float)obs_data_get_bool(settings, "enable_focal_blur");
 	tf->blurFocusPoint = (float)obs_data_get_double(settings, "blur_focus_point");
 	tf->blurFocusDepth = (float)obs_data_get_double(settings, "blur_focus_depth");
+	tf->depthRate = (int)obs_data_get_int(settings, "depth_rate");
 	tf->temporalSmoothFactor = (float)obs_data_get_double(settings, "temporal_smooth_factor");
 	tf->imageSimilarityThreshold = (float)obs_data_get_double(settings, "image_similarity_threshold");
 	tf->enableImageSimilarity = (float)obs_data_get_bool(settings, "enable_image_similarity");
+	tf->enhanceBlend = (float)obs_data_get_double(settings, "enhance_blend");
+
+	// The similarity check compares host thumbnails, so it needs the stage surface path
+	tf->enableGpuInterop = obs_data_get_bool(settings, "zero_copy_input") && !tf->enableImageSimilarity;
+	tf->enableGpuMaskPipeline = obs_data_get_bool(settings, "gpu_mask_pipeline");
+	tf->guidedUpsample = obs_data_get_bool(settings, "guided_upsample");
+	tf->maskInterpolation = obs_data_get_bool(settings, "mask_interpolation");
+	tf->alignedFrameDelay = (int)obs_data_get_int(settings, "aligned_frame_delay");
+
+	// Settings that reset tick state or reconfigure the queue: handed to video_tick
+	background_removal_filter::TickSettings tickSettings;
+	tickSettings.roiInference = obs_data_get_bool(settings, "roi_inference");
+	tickSettings.motionAware = obs_data_get_bool(settings, "motion_aware");
+	tickSettings.tiledInference = obs_data_get_bool(settings, "tiled_inference");
+	tickSettings.adaptiveScheduler = obs_data_get_bool(settings, "adaptive_scheduler");
+	tickSettings.maskEveryXFrames = (int)obs_data_get_int(settings, "mask_every_x_frames");
+	const std::string enhanceModel = obs_data_get_string(settings, "enhance_model");
+	tickSettings.fusedEnhance = !enhanceModel.empty();
+	tickSettings.focalDepth = tf->enableFocalBlur && obs_data_get_bool(settings, "focal_depth");
+	tickSettings.gpuBudget = (int)obs_data_get_int(settings, "max_gpu_ms");
+	tickSettings.maskShareKey = maskShareKey(settings);
+	if (!parseSchedulingPriority(obs_data_get_string(settings, "scheduling_priority"),
+				     tickSettings.workerPolicy.priority)) {
+		tickSettings.workerPolicy.priority = SchedulingPriority::NORMAL;
+	}
+	const std::string inferenceCpus = obs_data_get_string(settings, "inference_cpus");
+	if (!parseCpuList(inferenceCpus, tickSettings.workerPolicy.cpus)) {
+		obs_log(LOG_WARNING, "Invalid inference CPU list '%s', the workers run on any CPU",
+			inferenceCpus.c_str());
+		tickSettings.workerPolicy.cpus.clear();
+	}
+	{
+		std::lock_guard<std::mutex> lock(tf->settingsMutex);
+		if (tickSettings != tf->pendingSettings) {
+			tf->pendingSettings = tickSettings;
+			tf->settingsPending = true;
+		}
+	}
 
-	const std::string newUseGpu = obs_data_get_string(settings, "useGPU");
-	const std::string newModel = obs_data_get_string(settings, "model_select");
-	const uint32_t newNumThreads = (uint32_t)obs_data_get_int(settings, "numThreads");
-
-	if (tf->modelSelection.empty() || tf->modelSelection != newModel || tf->useGPU != newUseGpu ||
-	    tf->numThreads != newNumThreads || !tf->model || !tf->session) {
-		// lock modelMutex — safe because async queue is stopped
-		std::unique_lock<std::mutex> lock(tf->modelMutex);
-
-		// Re-initialize model if it's not already the selected one or switching inference device
-		tf->modelSelection = newModel;
-		tf->useGPU = newUseGpu;
-		tf->numThreads = newNumThreads;
+	// Model and execution provider: the session is built in the background while
+	// the current one keeps serving frames, and video_tick swaps it in when ready
+	SessionSettings session;
+	session.modelSelection = obs_data_get_string(settings, "model_select");
+	session.useGPU = obs_data_get_string(settings, "useGPU");
+	session.numThreads = (uint32_t)obs_data_get_int(settings, "numThreads");
+	session.useIoBinding = obs_data_get_bool(settings, "io_binding");
+	session.useCudaGraph = session.useIoBinding && obs_data_get_bool(settings, "cuda_graph");
+	session.useSharedEngine = obs_data_get_bool(settings, "shared_engine");
+	session.precision = obs_data_get_string(settings, "precision");
+	session.inferenceResolution = (int)obs_data_get_int(settings, "inference_resolution");
+	session.gpuDevice = (int)obs_data_get_int(settings, "gpu_device");
+	session.schedulingPriority = tickSettings.workerPolicy.priority;
+	session.resolveDevice(tf->requestedSession);
+
+	// A failed build is requested again, or switching back and forth wouldn't retry it
+	if (session != tf->requestedSession || tf->sessionBuilder.failed()) {
+		tf->requestedSession = session;
+		// Size the model input for the source up front, so the first frame doesn't rebuild the session
+		obs_source_t *target = obs_filter_get_target(tf->source);
+		const int sourceWidth = target ? (int)obs_source_get_base_width(target) : 0;
+		const int sourceHeight = target ? (int)obs_source_get_base_height(target) : 0;
+		obs_log(LOG_INFO, "Building the %s session (%s, GPU %d) in the background",
+			session.modelSelection.c_str(), session.useGPU.c_str(), session.deviceId);
+		tf->sessionBuilder.request(tf.get(), session, sourceWidth, sourceHeight);
+	}
 
-		if (tf->modelSelection == MODEL_SINET) {
-			tf->model.reset(new ModelSINET);
-		}
-		if (tf->modelSelection == MODEL_SELFIE) {
-			tf->model.reset(new ModelSelfie);
-		}
-		if (tf->modelSelection == MODEL_SELFIE_MULTICLASS) {
-			tf->model.reset(new ModelSelfieMulticlass);
-		}
-		if (tf->modelSelection == MODEL_MEDIAPIPE) {
-			tf->model.reset(new ModelMediaPipe);
-		}
-		if (tf->modelSelection == MODEL_RVM) {
-			tf->model.reset(new ModelRVM);
-		}
-		if (tf->modelSelection == MODEL_PPHUMANSEG) {
-			tf->model.reset(new ModelPPHumanSeg);
-		}
-		if (tf->modelSelection == MODEL_DEPTH_TCMONODEPTH) {
-			tf->model.reset(new ModelTCMonoDepth);
-		}
-		if (tf->modelSelection == MODEL_RMBG) {
-			tf->model.reset(new ModelRMBG);
+	// Fused enhancement: built in the background the same way, on the same device
+	SessionSettings enhanceSession;
+	if (tickSettings.fusedEnhance) {
+		enhanceSession.modelSelection = enhanceModel;
+		enhanceSession.useGPU = session.useGPU;
+		enhanceSession.numThreads = session.numThreads;
+		enhanceSession.useIoBinding = session.useIoBinding;
+		enhanceSession.useSharedEngine = session.useSharedEngine;
+		enhanceSession.precision = session.precision;
+		enhanceSession.gpuDevice = session.gpuDevice;
+		enhanceSession.deviceId = session.deviceId;
+		enhanceSession.schedulingPriority = session.schedulingPriority;
+	}
+	if (enhanceSession != tf->enhancer.requestedSession || tf->enhancer.sessionBuilder.failed()) {
+		tf->enhancer.requestedSession = enhanceSession;
+		if (tickSettings.fusedEnhance) {
+			obs_log(LOG_INFO, "Building the %s enhancement session in the background",
+				enhanceModel.c_str());
+			tf->enhancer.sessionBuilder.request(&tf->enhancer, enhanceSession, 0, 0);
 		}
+	}
 
-		tf->isAlphaMatteModel = tf->model && tf->model->outputsAlphaMatte();
-
-		int ortSessionResult = createOrtSession(tf.get());
-		if (ortSessionResult != OBS_BGREMOVAL_ORT_SESSION_SUCCESS) {
-			obs_log(LOG_ERROR, "Failed to create ONNXRuntime session. Error code: %d", ortSessionResult);
-			// disable filter
-			tf->isDisabled = true;
-			tf->model.reset();
-			return;
+	// Focal blur depth: the same way, on the same device
+	SessionSettings depthSession;
+	if (tickSettings.focalDepth) {
+		depthSession.modelSelection = MODEL_DEPTH_TCMONODEPTH;
+		depthSession.useGPU = session.useGPU;
+		depthSession.numThreads = session.numThreads;
+		depthSession.useIoBinding = session.useIoBinding;
+		depthSession.useSharedEngine = session.useSharedEngine;
+		depthSession.precision = session.precision;
+		depthSession.gpuDevice = session.gpuDevice;
+		depthSession.deviceId = session.deviceId;
+		depthSession.schedulingPriority = session.schedulingPriority;
+	}
+	if (depthSession != tf->depthEstimator.requestedSession || tf->depthEstimator.sessionBuilder.failed()) {
+		tf->depthEstimator.requestedSession = depthSession;
+		if (tickSettings.focalDepth) {
+			obs_log(LOG_INFO, "Building the focal blur depth session in the background");
+			tf->depthEstimator.sessionBuilder.request(&tf->depthEstimator, depthSession, 0, 0);
 		}
 	}
 
 	obs_enter_graphics();
 
-	char *effect_path = obs_module_file(EFFECT_PATH);
-	gs_effect_destroy(tf->effect);
-	tf->effect = gs_effect_create_from_file(effect_path, NULL);
-	bfree(effect_path);
+	if (!tf->effect) {
+		char *effect_path = obs_module_file(EFFECT_PATH);
+		tf->effect = gs_effect_create_from_file(effect_path, NULL);
+		bfree(effect_path);
+	}
 
-	char *kawaseBlurEffectPath = obs_module_file(KAWASE_BLUR_EFFECT_PATH);
-	gs_effect_destroy(tf->kawaseBlurEffect);
-	tf->kawaseBlurEffect = gs_effect_create_from_file(kawaseBlurEffectPath, NULL);
-	bfree(kawaseBlurEffectPath);
+	if (!tf->kawaseBlurEffect) {
+		char *kawaseBlurEffectPath = obs_module_file(KAWASE_BLUR_EFFECT_PATH);
+		tf->kawaseBlurEffect = gs_effect_create_from_file(kawaseBlurEffectPath, NULL);
+		bfree(kawaseBlurEffectPath);
+	}
+
+	if (!tf->dualKawaseBlurEffect) {
+		char *dualKawaseBlurEffectPath = obs_module_file(DUAL_KAWASE_BLUR_EFFECT_PATH);
+		tf->dualKawaseBlurEffect = gs_effect_create_from_file(dualKawaseBlurEffectPath, NULL);
+		bfree(dualKawaseBlurEffectPath);
+	}
 
 	obs_leave_graphics();
 
@@ -365,46 +858,412 @@ void background_filter_update(void *data, obs_data_t *settings)
 	obs_log(LOG_INFO, "Background Removal Filter Options:");
 	// name of the source that the filter is attached to
 	obs_log(LOG_INFO, "  Source: %s", obs_source_get_name(tf->source));
-	obs_log(LOG_INFO, "  Model: %s", tf->modelSelection.c_str());
-	obs_log(LOG_INFO, "  Inference Device: %s", tf->useGPU.c_str());
-	obs_log(LOG_INFO, "  Num Threads: %d", tf->numThreads);
+	obs_log(LOG_INFO, "  Model: %s", session.modelSelection.c_str());
+	obs_log(LOG_INFO, "  Inference Device: %s", session.useGPU.c_str());
+	obs_log(LOG_INFO, "  Precision: %s", session.precision.c_str());
+	obs_log(LOG_INFO, "  GPU Device: %d", session.gpuDevice);
+	obs_log(LOG_INFO, "  Inference Resolution: %d", session.inferenceResolution);
+	obs_log(LOG_INFO, "  Num Threads: %d", session.numThreads);
+	obs_log(LOG_INFO, "  Zero-Copy GPU Input: %s", tf->enableGpuInterop ? "true" : "false");
+	obs_log(LOG_INFO, "  GPU Mask Pipeline: %s", tf->enableGpuMaskPipeline ? "true" : "false");
+	obs_log(LOG_INFO, "  Guided Upsampling: %s", tf->guidedUpsample ? "true" : "false");
+	obs_log(LOG_INFO, "  ROI Inference: %s", tickSettings.roiInference ? "true" : "false");
+	obs_log(LOG_INFO, "  Tiled Inference: %s", tickSettings.tiledInference ? "true" : "false");
+	obs_log(LOG_INFO, "  Motion-Aware Updates: %s", tickSettings.motionAware ? "true" : "false");
+	obs_log(LOG_INFO, "  Mask Interpolation: %s", tf->maskInterpolation ? "true" : "false");
+	obs_log(LOG_INFO, "  Share Mask: %s", tickSettings.maskShareKey.empty() ? "false" : "true");
+	if (tf->alignedFrameDelay > 0) {
+		// The video is late by the delay: the audio has to be delayed as much
+		obs_log(LOG_INFO, "  Aligned Frame Delay: %d frames (%.1f ms of audio sync offset)",
+			(int)tf->alignedFrameDelay, tf->alignedFrameDelay * obsFramePeriodMs());
+	} else {
+		obs_log(LOG_INFO, "  Aligned Frame Delay: off");
+	}
+	obs_log(LOG_INFO, "  IoBinding: %s", session.useIoBinding ? "true" : "false");
+	obs_log(LOG_INFO, "  CUDA Graph Mode: %s", session.useCudaGraph ? "true" : "false");
+	obs_log(LOG_INFO, "  Shared Engine: %s", session.useSharedEngine ? "true" : "false");
 	obs_log(LOG_INFO, "  Enable Threshold: %s", tf->enableThreshold ? "true" : "false");
 	obs_log(LOG_INFO, "  Threshold: %f", tf->threshold);
 	obs_log(LOG_INFO, "  Contour Filter: %f", tf->contourFilter);
 	obs_log(LOG_INFO, "  Smooth Contour: %f", tf->smoothContour);
 	obs_log(LOG_INFO, "  Mask Expansion: %f", tf->maskExpansion);
 	obs_log(LOG_INFO, "  Feather: %f", tf->feather);
-	obs_log(LOG_INFO, "  Mask Every X Frames: %d", tf->maskEveryXFrames);
+	obs_log(LOG_INFO, "  Mask Every X Frames: %d", tickSettings.maskEveryXFrames);
+	obs_log(LOG_INFO, "  Adaptive Scheduler: %s", tickSettings.adaptiveScheduler ? "true" : "false");
+	obs_log(LOG_INFO, "  Scheduling Priority: %s", schedulingPriorityName(tickSettings.workerPolicy.priority));
+	obs_log(LOG_INFO, "  Inference CPUs: %s", inferenceCpus.empty() ? "any" : inferenceCpus.c_str());
+	if (tickSettings.gpuBudget > 0) {
+		obs_log(LOG_INFO, "  Max Inference Time: %d ms/s", tickSettings.gpuBudget);
+	} else {
+		obs_log(LOG_INFO, "  Max Inference Time: no cap");
+	}
 	obs_log(LOG_INFO, "  Enable Image Similarity: %s", tf->enableImageSimilarity ? "true" : "false");
 	obs_log(LOG_INFO, "  Image Similarity Threshold: %f", tf->imageSimilarityThreshold);
 	obs_log(LOG_INFO, "  Blur Background: %d", tf->blurBackground);
+	obs_log(LOG_INFO, "  Blur Mode: %s", tf->dualKawaseBlur ? BLUR_MODE_DUAL_KAWASE : BLUR_MODE_KAWASE);
 	obs_log(LOG_INFO, "  Enable Focal Blur: %s", tf->enableFocalBlur ? "true" : "false");
 	obs_log(LOG_INFO, "  Blur Focus Point: %f", tf->blurFocusPoint);
 	obs_log(LOG_INFO, "  Blur Focus Depth: %f", tf->blurFocusDepth);
+	if (tickSettings.focalDepth) {
+		obs_log(LOG_INFO, "  Focal Blur Depth Model: %d updates/s", (int)tf->depthRate);
+	} else {
+		obs_log(LOG_INFO, "  Focal Blur Depth Model: false");
+	}
+	obs_log(LOG_INFO, "  Fused Enhance: %s", tickSettings.fusedEnhance ? enhanceModel.c_str() : "false");
+	obs_log(LOG_INFO, "  Fused Enhance Strength: %f", tf->enhanceBlend);
 	obs_log(LOG_INFO, "  Disabled: %s", tf->isDisabled ? "true" : "false");
-	obs_log(LOG_INFO, "  Model file path: %s", tf->modelFilepath.c_str());
-
-	// Start async inference queue for non-alpha-matte models.
-	// Alpha-matte models (e.g. RVM) use synchronous inference in video_tick
-	// to eliminate the 2-3 frame async pipeline latency.
-	if (!tf->isAlphaMatteModel) {
-		auto *raw_tf = tf.get();
-		tf->asyncQueue.start(
-			[raw_tf](const cv::Mat &inputBGRA, cv::Mat &outputMask) -> bool {
+}
+
+// Fused enhancement: run the enhancement model on the input frame. Host frames
+// are uploaded once into fusedFrame, which the segmentation then reads as well
+// (a zero-copy input frame already is on the device). Returns true when frame
+// is that upload, false when the segmentation keeps the input frame (fused
+// mode off, device input, failed upload). Caller holds modelMutex.
+static bool enhanceFusedFrame(struct background_removal_filter *tf, const InputFrame &input, DeviceFrame &frame)
+{
+	// After a device change the enhancement waits for its session on the new device
+	if (!tf->enhancer.session || tf->enhancer.deviceId != tf->deviceId) {
+		return false;
+	}
+	bool uploaded = false;
+	if (!input.onDevice) {
+		uploaded = uploadDeviceFrame(input.bgra.data, input.bgra.cols, input.bgra.rows, input.bgra.step[0],
+					     tf->fusedFrame, tf->cudaPreprocessor.stream());
+		frame = tf->fusedFrame;
+	}
+	try {
+		NVTX_RANGE_COLOR("fused_enhance", NVTX_COLOR_INFERENCE);
+		if (input.onDevice) {
+			tf->enhanceStage.process(&tf->enhancer, input.device);
+		} else if (uploaded) {
+			tf->enhanceStage.process(&tf->enhancer, frame);
+		} else {
+			tf->enhanceStage.process(&tf->enhancer, input.bgra);
+		}
+	} catch (const std::exception &e) {
+		obs_log(LOG_ERROR, "Fused enhancement error: %s", e.what());
+	}
+	return uploaded;
+}
+
+// Start the async inference queue for non-alpha-matte models (tick thread, queue stopped).
+// Alpha-matte models (e.g. RVM) use synchronous inference in video_tick
+// to eliminate the 2-3 frame async pipeline latency. With the adaptive
+// scheduler they get a queue too, used while inference blocks tick for too long.
+static void startInferenceQueue(struct background_removal_filter *tf)
+{
+	if (!tf->isAlphaMatteModel || tf->scheduler.enabled()) {
+		auto *raw_tf = tf;
+		const BufferingMode buffering = tf->gpuInfo.defaultBuffering;
+		// Tiled inference runs several tiles per frame and the fused enhancement a second
+		// model, so they use the single-function worker
+		if (!tf->isAlphaMatteModel && !tf->useTiledInference && !tf->appliedSettings.fusedEnhance &&
+		    tf->inferencePipeline.init(raw_tf, AsyncInferenceQueue::slotCount(buffering))) {
+			// IoBinding: upload, inference and download of consecutive frames overlap
+			AsyncInferenceQueue::PipelineStages stages;
+			stages.preprocess = [raw_tf](const InputFrame &input, int slot) -> bool {
+				return raw_tf->inferencePipeline.preprocess(raw_tf, input, slot);
+			};
+			stages.infer = [raw_tf](int slot) -> bool {
 				std::unique_lock<std::mutex> lock(raw_tf->modelMutex);
-				if (!raw_tf->model || !raw_tf->session) {
+				return raw_tf->inferencePipeline.infer(raw_tf, slot);
+			};
+			stages.postprocess = [raw_tf](const InputFrame &input, int slot, cv::Mat &outputMask) -> bool {
+				cv::Mat &outputImage = raw_tf->scratch.get(SCRATCH_PIPELINE_OUTPUT);
+				if (!raw_tf->inferencePipeline.download(raw_tf, slot, outputImage)) {
 					return false;
 				}
-				processImageForBackground(raw_tf, inputBGRA, outputMask);
+				cv::Mat &mask = input.roi.empty() ? outputMask
+								  : raw_tf->scratch.get(SCRATCH_ROI_MASK);
+				outputToBackgroundMask(raw_tf, outputImage, mask);
+				pasteRoiMask(raw_tf, input, mask, outputMask);
 				return !outputMask.empty();
-			},
-			tf->gpuInfo.defaultBuffering);
-	} else {
-		obs_log(LOG_INFO, "Alpha-matte model: using synchronous inference (no async queue)");
+			};
+			tf->asyncQueue.start(std::move(stages), buffering, tf->deviceId);
+		} else {
+			tf->inferencePipeline.release();
+			tf->asyncQueue.start(
+				[raw_tf](const InputFrame &input, cv::Mat &outputMask) -> bool {
+					std::unique_lock<std::mutex> lock(raw_tf->modelMutex);
+					if (!raw_tf->model || !raw_tf->session) {
+						return false;
+					}
+					cv::Mat &mask = input.roi.empty() ? outputMask
+									  : raw_tf->scratch.get(SCRATCH_ROI_MASK);
+					bool processed;
+					DeviceFrame fused;
+					if (enhanceFusedFrame(raw_tf, input, fused)) {
+						const cv::Rect &roi = input.roi;
+						if (!roi.empty()) {
+							fused = cropDeviceFrame(fused, roi.x, roi.y, roi.width,
+										roi.height);
+						}
+						processed = processImageForBackground(raw_tf, fused, mask);
+					} else if (input.onDevice) {
+						processed = processImageForBackground(raw_tf, input.roiDevice(), mask);
+					} else {
+						processed = processImageForBackground(raw_tf, input.roiBGRA(), mask);
+					}
+					if (!processed) {
+						return false;
+					}
+					pasteRoiMask(raw_tf, input, mask, outputMask);
+					return !outputMask.empty();
+				},
+				buffering, tf->deviceId);
+		}
 	}
+	if (tf->isAlphaMatteModel) {
+		obs_log(LOG_INFO, "Alpha-matte model: using synchronous inference%s",
+			tf->scheduler.enabled() ? " (async queue while overloaded)" : " (no async queue)");
+	}
+}
 
-	// enable
-	tf->isDisabled = false;
+// Rebuild the current session in the background with changed settings (runtime
+// fallbacks, source size changes). Returns false while another build is pending:
+// the session it brings replaces the current one anyway.
+static bool requestSessionRebuild(struct background_removal_filter *tf, const SessionSettings &settings, int width,
+				  int height)
+{
+	if (!tf->model || tf->sessionBuilder.busy()) {
+		return false;
+	}
+	tf->sessionBuilder.request(tf, settings, width, height);
+	return true;
+}
+
+// Whether the model input follows the source (RVM, dynamic-size descriptors) and
+// frameSize needs another session
+static bool inputSizeChanges(struct background_removal_filter *tf, const cv::Size &frameSize)
+{
+	std::unique_ptr<Model> probe(createModel(tf->modelSelection));
+	probe->setSourceSize(frameSize.width, frameSize.height, tf->inferenceResolution);
+	return probe->dynamicInputSize() != tf->model->dynamicInputSize();
+}
+
+// video_tick: apply the settings handed over by update and swap in a session
+// the builder finished. Only a swap or a queue setting stops the queue.
+static void applyPendingSettings(struct background_removal_filter *tf)
+{
+	const bool swap = tf->sessionBuilder.ready();
+	const bool enhanceSwap = tf->enhancer.sessionBuilder.ready();
+	const bool depthSwap = tf->depthEstimator.sessionBuilder.ready();
+	background_removal_filter::TickSettings settings;
+	bool changed;
+	{
+		std::lock_guard<std::mutex> lock(tf->settingsMutex);
+		changed = tf->settingsPending;
+		tf->settingsPending = false;
+		settings = tf->pendingSettings;
+	}
+	if (!swap && !changed && !enhanceSwap && !depthSwap) {
+		return;
+	}
+
+	// The worker policy applies as the worker threads start
+	const bool policyChanged = settings.workerPolicy != tf->appliedSettings.workerPolicy;
+	const bool restartQueue = swap || settings.tiledInference != tf->appliedSettings.tiledInference ||
+				  settings.adaptiveScheduler != tf->appliedSettings.adaptiveScheduler ||
+				  settings.fusedEnhance != tf->appliedSettings.fusedEnhance || policyChanged;
+	tf->appliedSettings = settings;
+	tf->asyncQueue.setWorkerPolicy(settings.workerPolicy);
+	tf->depthStage.setWorkerPolicy(settings.workerPolicy);
+
+	if (restartQueue) {
+		// Stop async queue before any model changes to avoid deadlock with modelMutex
+		tf->asyncQueue.stop();
+		tf->lastRoiMask.release();
+	}
+
+	if (swap) {
+		std::unique_lock<std::mutex> lock(tf->modelMutex);
+		const bool hadSession = tf->session != nullptr;
+		const int previousDevice = tf->deviceId;
+		if (tf->sessionBuilder.adopt(tf) == OBS_BGREMOVAL_ORT_SESSION_SUCCESS) {
+			// The streams below belong to the session's device
+			CudaDeviceScope device(tf->deviceId);
+			if (tf->deviceId != previousDevice) {
+				logDevicePlacement(tf);
+			}
+			tf->isAlphaMatteModel = tf->model->outputsAlphaMatte();
+			tf->cudaPreprocessor.setGraphMode(tf->useCudaGraph);
+			tf->maskPostprocessor.setGraphMode(tf->useCudaGraph);
+			// The sync alpha-matte path postprocesses the device-resident model output,
+			// so it shares the inference stream. The async path keeps its own stream to
+			// avoid waiting on the worker's queued inference.
+			tf->maskPostprocessor.setStream(tf->isAlphaMatteModel ? tf->cudaPreprocessor.stream()
+									      : nullptr);
+			tf->maskPostprocessor.resetHistory();
+			// The build may be sized for another source size: check the next frame
+			tf->sessionSourceSize = cv::Size();
+			obs_log(LOG_INFO, "Session ready: %s (%s), IoBinding: %s, shared engine: %s, file %s",
+				tf->modelSelection.c_str(), tf->useGPU.c_str(), tf->useIoBinding ? "true" : "false",
+				tf->sharedEngine ? "true" : "false", tf->modelFilepath.c_str());
+		} else if (!hadSession || !tf->session) {
+			obs_log(LOG_ERROR, "Failed to create ONNXRuntime session, the filter is disabled");
+		}
+		tf->sessionActive = tf->session != nullptr;
+	}
+
+	// The fused enhancement only runs under modelMutex, so its session swaps without a queue restart
+	{
+		std::unique_lock<std::mutex> lock(tf->modelMutex);
+		if (enhanceSwap &&
+		    tf->enhancer.sessionBuilder.adopt(&tf->enhancer) == OBS_BGREMOVAL_ORT_SESSION_SUCCESS) {
+			obs_log(LOG_INFO, "Fused enhancement session ready: %s (%s), IoBinding: %s",
+				tf->enhancer.modelSelection.c_str(), tf->enhancer.useGPU.c_str(),
+				tf->enhancer.useIoBinding ? "true" : "false");
+		}
+		if (!settings.fusedEnhance) {
+			tf->enhancer.ioBinding.reset();
+			tf->enhancer.session.reset();
+			tf->enhancer.sharedEngine.reset();
+			tf->enhancer.model.reset();
+		}
+		tf->fusedEnhanceActive = tf->enhancer.session != nullptr;
+	}
+
+	// The depth worker runs its session without a lock: stopped to swap or drop it
+	if (depthSwap || !settings.focalDepth || policyChanged) {
+		tf->depthStage.stop();
+	}
+	if (depthSwap &&
+	    tf->depthEstimator.sessionBuilder.adopt(&tf->depthEstimator) == OBS_BGREMOVAL_ORT_SESSION_SUCCESS) {
+		obs_log(LOG_INFO, "Focal blur depth session ready: %s (%s), IoBinding: %s",
+			tf->depthEstimator.modelSelection.c_str(), tf->depthEstimator.useGPU.c_str(),
+			tf->depthEstimator.useIoBinding ? "true" : "false");
+	}
+	if (!settings.focalDepth) {
+		tf->depthEstimator.ioBinding.reset();
+		tf->depthEstimator.session.reset();
+		tf->depthEstimator.sharedEngine.reset();
+		tf->depthEstimator.model.reset();
+	}
+	if (tf->depthEstimator.session && !tf->depthStage.running()) {
+		tf->depthStage.start(&tf->depthEstimator);
+	}
+	tf->focalDepthActive = tf->depthEstimator.session != nullptr;
+
+	// Depth output has no person box, and graph mode would re-capture on every roi change
+	tf->roiInference = settings.roiInference && !tf->isAlphaMatteModel &&
+			   tf->modelSelection != MODEL_DEPTH_TCMONODEPTH && !tf->useCudaGraph;
+	tf->roi = cv::Rect2f();
+
+	// Sync-path models infer whole frames, and graph mode would re-capture on every region change
+	tf->motionAware = settings.motionAware && !tf->isAlphaMatteModel && !tf->useCudaGraph;
+	tf->motionDetector.reset();
+	tf->motionPartialUpdates = 0;
+
+	tf->maskEveryXFrames = settings.maskEveryXFrames;
+	tf->scheduler.setEnabled(settings.adaptiveScheduler);
+	tf->scheduler.setMinInterval(tf->maskEveryXFrames);
+	tf->scheduler.setGpuBudget(settings.gpuBudget);
+	tf->scheduler.setSyncPath(tf->isAlphaMatteModel);
+	tf->scheduler.reset();
+	tf->stats.reset();
+
+	if (restartQueue) {
+		// Tiles are preprocessed at moving addresses, which graph mode would re-capture
+		tf->useTiledInference = settings.tiledInference && tf->model && tf->model->supportsTiling() &&
+					!tf->useCudaGraph;
+		if (tf->session) {
+			startInferenceQueue(tf);
+		}
+	}
+}
+
+// video_tick of an inactive source: suspend once it has been inactive for
+// suspendAfter seconds, unless a session build is on its way
+static void suspendIfDue(struct background_removal_filter *tf)
+{
+	const uint64_t since = tf->inactiveSince;
+	const int after = tf->suspendAfter;
+	if (tf->suspended || since == 0 || after <= 0 || os_gettime_ns() - since < (uint64_t)after * 1000000000ULL ||
+	    tf->sessionBuilder.busy() || tf->enhancer.sessionBuilder.busy() ||
+	    tf->depthEstimator.sessionBuilder.busy()) {
+		return;
+	}
+
+	// Stop the workers before any model changes to avoid deadlock with modelMutex
+	tf->asyncQueue.stop();
+	tf->depthStage.stop();
+	tf->inferencePipeline.release();
+	tf->sessionActive = false;
+	tf->fusedEnhanceActive = false;
+	tf->focalDepthActive = false;
+	{
+		std::unique_lock<std::mutex> lock(tf->modelMutex);
+		tf->suspendedSession = suspendOrtSession(tf);
+		tf->suspendedEnhancer = suspendOrtSession(&tf->enhancer);
+		tf->suspendedDepth = suspendOrtSession(&tf->depthEstimator);
+		freeDeviceFrame(tf->fusedFrame);
+	}
+	CudaDeviceScope device(tf->deviceId);
+	tf->cudaPreprocessor.freeBuffers();
+	tf->enhancer.cudaPreprocessor.freeBuffers();
+	tf->depthEstimator.cudaPreprocessor.freeBuffers();
+	tf->maskPostprocessor.freeBuffers();
+	tf->motionDetector.freeBuffers();
+	tf->maskFlow.freeBuffers();
+	tf->lastRoiMask.release();
+	tf->queueMask.release();
+	for (auto &pending : tf->pendingMasks) {
+		pending.mask.release();
+	}
+	tf->pendingMaskCount = 0;
+	tf->suspended = true;
+	obs_log(LOG_INFO, "[%s] Inactive for %d s: inference suspended, device buffers released",
+		obs_source_get_name(tf->source), after);
+}
+
+// First video_tick after activation: set the parked sessions up again and
+// restart the workers. Sessions the cache released meanwhile are rebuilt.
+static void resumeInference(struct background_removal_filter *tf)
+{
+	tf->suspended = false;
+	CudaDeviceScope device(tf->deviceId);
+	std::vector<const char *> rebuilt;
+	{
+		std::unique_lock<std::mutex> lock(tf->modelMutex);
+		if (tf->suspendedSession && resumeOrtSession(tf) != OBS_BGREMOVAL_ORT_SESSION_SUCCESS) {
+			requestSessionRebuild(tf, SessionSettings::of(tf), tf->sessionBuilder.sourceWidth(),
+					      tf->sessionBuilder.sourceHeight());
+			rebuilt.push_back(tf->modelSelection.c_str());
+		}
+		if (tf->suspendedEnhancer && resumeOrtSession(&tf->enhancer) != OBS_BGREMOVAL_ORT_SESSION_SUCCESS) {
+			tf->enhancer.sessionBuilder.request(&tf->enhancer, SessionSettings::of(&tf->enhancer), 0, 0);
+			rebuilt.push_back(tf->enhancer.modelSelection.c_str());
+		}
+		if (tf->suspendedDepth &&
+		    resumeOrtSession(&tf->depthEstimator) != OBS_BGREMOVAL_ORT_SESSION_SUCCESS) {
+			tf->depthEstimator.sessionBuilder.request(&tf->depthEstimator,
+								  SessionSettings::of(&tf->depthEstimator), 0, 0);
+			rebuilt.push_back(tf->depthEstimator.modelSelection.c_str());
+		}
+		tf->fusedEnhanceActive = tf->enhancer.session != nullptr;
+	}
+	tf->suspendedSession = tf->suspendedEnhancer = tf->suspendedDepth = false;
+
+	tf->maskPostprocessor.resetHistory();
+	tf->motionDetector.reset();
+	tf->motionPartialUpdates = 0;
+	tf->roi = cv::Rect2f();
+	tf->scheduler.reset();
+	tf->stats.reset();
+	tf->sessionActive = tf->session != nullptr;
+	if (tf->session) {
+		startInferenceQueue(tf);
+	}
+	if (tf->depthEstimator.session) {
+		tf->depthStage.start(&tf->depthEstimator);
+	}
+	tf->focalDepthActive = tf->depthEstimator.session != nullptr;
+
+	obs_log(LOG_INFO, "[%s] Inference resumed", obs_source_get_name(tf->source));
+	for (const char *model : rebuilt) {
+		obs_log(LOG_INFO, "[%s] The suspended %s session was released, rebuilding it",
+			obs_source_get_name(tf->source), model);
+	}
 }
 
 void background_filter_activate(void *data)
@@ -417,6 +1276,7 @@ void background_filter_activate(void *data)
 	std::shared_ptr<background_removal_filter> tf = *ptr;
 	if (tf && tf->stopWhenSourceIsInactive) {
 		obs_log(LOG_INFO, "Background filter activated");
+		tf->inactiveSince = 0;
 		tf->isDisabled = false;
 	}
 }
@@ -431,6 +1291,7 @@ void background_filter_deactivate(void *data)
 	std::shared_ptr<background_removal_filter> tf = *ptr;
 	if (tf && tf->stopWhenSourceIsInactive) {
 		obs_log(LOG_INFO, "Background filter deactivated");
+		tf->inactiveSince = os_gettime_ns();
 		tf->isDisabled = true;
 	}
 }
@@ -446,12 +1307,21 @@ void *background_filter_create(obs_data_t *settings, obs_source_t *source)
 
 		instance->source = source;
 		instance->texrender = gs_texrender_create(GS_BGRA, GS_ZS_NONE);
-
-		std::string instanceName{"background-removal-inference"};
-		instance->env.reset(new Ort::Env(OrtLoggingLevel::ORT_LOGGING_LEVEL_ERROR, instanceName.c_str()));
+		instance->blurTexrender[0] = gs_texrender_create(GS_BGRA, GS_ZS_NONE);
+		instance->blurTexrender[1] = gs_texrender_create(GS_BGRA, GS_ZS_NONE);
+		for (int i = 0; i < background_removal_filter::kMaxBlurLevels; i++) {
+			instance->blurDown[i] = gs_texrender_create(GS_BGRA, GS_ZS_NONE);
+			instance->blurUp[i] = gs_texrender_create(GS_BGRA, GS_ZS_NONE);
+		}
+		instance->warpTexrender = gs_texrender_create(GS_R8, GS_ZS_NONE);
 
 		instance->modelSelection = MODEL_RVM;
 
+		// The render GPU, from the graphics thread (frames are captured there)
+		obs_enter_graphics();
+		renderCudaDevice();
+		obs_leave_graphics();
+
 		// Detect GPU once at startup for adaptive defaults
 		if (detectGpu(instance->gpuInfo)) {
 			obs_log(LOG_INFO, "GPU: %s (%s), VRAM: %zu MB, default buffering: %s",
@@ -462,6 +1332,14 @@ void *background_filter_create(obs_data_t *settings, obs_source_t *source)
 			obs_log(LOG_WARNING, "GPU detection failed, using defaults");
 		}
 
+		// The fused enhancement session never renders, it only shares the GPU info
+		instance->enhancer.source = nullptr;
+		instance->enhancer.texrender = nullptr;
+		instance->enhancer.gpuInfo = instance->gpuInfo;
+		instance->depthEstimator.source = nullptr;
+		instance->depthEstimator.texrender = nullptr;
+		instance->depthEstimator.gpuInfo = instance->gpuInfo;
+
 		// Create pointer to shared_ptr for the update call
 		auto ptr = new std::shared_ptr<background_removal_filter>(instance);
 		background_filter_update(ptr, settings);
@@ -483,20 +1361,43 @@ void background_filter_destroy(void *data)
 	auto *ptr = static_cast<std::shared_ptr<background_removal_filter> *>(data);
 	if (ptr) {
 		if (*ptr) {
-			// Mark as disabled to prevent further processing
+			// Mark as disabled to prevent further processing (and suspending)
+			(*ptr)->inactiveSince = 0;
 			(*ptr)->isDisabled = true;
 
 			// Stop async queue first — joins worker thread before any cleanup
 			(*ptr)->asyncQueue.stop();
+			(*ptr)->depthStage.stop();
+
+			// Consumers stop reading the mask texture before the render they may be in ends
+			MaskShare::instance().leave(ptr->get());
+			if ((*ptr)->traceCapture) {
+				TraceRecorder::instance().release();
+			}
 
 			// Perform cleanup
 			obs_enter_graphics();
+			(*ptr)->inputInterop.unregister();
+			(*ptr)->maskInterop.unregister();
+			(*ptr)->enhanceStage.releaseTexture();
+			(*ptr)->depthStage.releaseTexture();
+			gs_texture_destroy((*ptr)->maskTexture);
+			gs_texture_destroy((*ptr)->flowTexture);
+			for (gs_texture_t *frame : (*ptr)->delayedFrames) {
+				gs_texture_destroy(frame);
+			}
+			gs_texrender_destroy((*ptr)->warpTexrender);
 			gs_texrender_destroy((*ptr)->texrender);
-			if ((*ptr)->stagesurface) {
-				gs_stagesurface_destroy((*ptr)->stagesurface);
+			gs_texrender_destroy((*ptr)->blurTexrender[0]);
+			gs_texrender_destroy((*ptr)->blurTexrender[1]);
+			for (int i = 0; i < background_removal_filter::kMaxBlurLevels; i++) {
+				gs_texrender_destroy((*ptr)->blurDown[i]);
+				gs_texrender_destroy((*ptr)->blurUp[i]);
 			}
+			(*ptr)->stageRing.release();
 			gs_effect_destroy((*ptr)->effect);
 			gs_effect_destroy((*ptr)->kawaseBlurEffect);
+			gs_effect_destroy((*ptr)->dualKawaseBlurEffect);
 			obs_leave_graphics();
 		}
 		// Delete the pointer to shared_ptr
@@ -505,13 +1406,22 @@ void background_filter_destroy(void *data)
 	}
 }
 
-static void processImageForBackground(struct background_removal_filter *tf, const cv::Mat &imageBGRA,
+// Caller holds modelMutex
+template<typename Frame>
+static bool processImageForBackground(struct background_removal_filter *tf, const Frame &imageBGRA,
 				      cv::Mat &backgroundMask)
 {
-	cv::Mat outputImage;
+	cv::Mat &outputImage = tf->scratch.get(SCRATCH_MODEL_OUTPUT);
 	if (!runFilterModelInference(tf, imageBGRA, outputImage)) {
-		return;
+		return false;
 	}
+	outputToBackgroundMask(tf, outputImage, backgroundMask);
+	return true;
+}
+
+static void outputToBackgroundMask(struct background_removal_filter *tf, const cv::Mat &outputImage,
+				   cv::Mat &backgroundMask)
+{
 	// Assume outputImage is now a single channel, uint8 image with values between 0 and 255
 
 	if (tf->model->outputsAlphaMatte()) {
@@ -527,6 +1437,459 @@ static void processImageForBackground(struct background_removal_filter *tf, cons
 	}
 }
 
+// ROI mode: the region never shrinks below this fraction of the frame. It also
+// fixes the resolution of the pasted-back mask, where the smallest region maps
+// 1:1 to the model output.
+static constexpr float kRoiMinFraction = 1.0f / 3.0f;
+static constexpr float kRoiMargin = 0.2f;     // added per side, relative to the person box
+static constexpr float kRoiShrinkRate = 0.1f; // per mask, when the box gets smaller (growing is immediate)
+
+// Paste the mask inferred on input.roi into a background-filled mask of the
+// whole frame, or into the previous full mask for a partial (motion) update,
+// and copy the result into backgroundMask. The full mask size depends only on
+// the frame and mask sizes, so temporal smoothing keeps working while the
+// region moves. Without a roi, roiMask already is backgroundMask.
+static void pasteRoiMask(struct background_removal_filter *tf, const InputFrame &input, const cv::Mat &roiMask,
+			 cv::Mat &backgroundMask)
+{
+	if (input.roi.empty() || roiMask.empty()) {
+		return;
+	}
+	const cv::Size frameSize = input.size();
+	const int fullWidth = std::min(frameSize.width, (int)std::lround(roiMask.cols / kRoiMinFraction));
+	const int fullHeight =
+		std::max(1, (int)std::lround((double)fullWidth * frameSize.height / frameSize.width));
+	const double scaleX = (double)fullWidth / frameSize.width;
+	const double scaleY = (double)fullHeight / frameSize.height;
+
+	cv::Rect target((int)std::lround(input.roi.x * scaleX), (int)std::lround(input.roi.y * scaleY),
+			(int)std::lround(input.roi.width * scaleX), (int)std::lround(input.roi.height * scaleY));
+	target &= cv::Rect(0, 0, fullWidth, fullHeight);
+
+	cv::Mat &fullMask = tf->lastRoiMask;
+	if (!input.partialRoi || fullMask.size() != cv::Size(fullWidth, fullHeight)) {
+		fullMask.create(fullHeight, fullWidth, CV_8UC1);
+		fullMask.setTo(255);
+	}
+	if (!target.empty()) {
+		cv::Mat region = fullMask(target);
+		cv::resize(roiMask, region, target.size(), 0, 0, cv::INTER_LINEAR);
+	}
+	// Into the slot's own buffer, which keeps its size from frame to frame
+	fullMask.copyTo(backgroundMask);
+}
+
+// Region around a box in frame pixels: margin, frame aspect ratio and minimum size
+static cv::Rect2f fitRoi(const cv::Rect2f &box, const cv::Size &frameSize)
+{
+	const float frameWidth = (float)frameSize.width;
+	const float frameHeight = (float)frameSize.height;
+	const float aspect = frameWidth / frameHeight;
+
+	const float boxWidth = box.width * (1.0f + 2.0f * kRoiMargin);
+	const float boxHeight = box.height * (1.0f + 2.0f * kRoiMargin);
+	const float width =
+		std::min(frameWidth, std::max({boxWidth, boxHeight * aspect, frameWidth * kRoiMinFraction}));
+	const float height = width / aspect;
+	const float centerX = box.x + box.width * 0.5f;
+	const float centerY = box.y + box.height * 0.5f;
+	return cv::Rect2f(std::clamp(centerX - width * 0.5f, 0.0f, frameWidth - width),
+			  std::clamp(centerY - height * 0.5f, 0.0f, frameHeight - height), width, height);
+}
+
+// Track the person box in a full-frame background mask with fitRoi, smoothed
+// over time (grow at once, shrink slowly).
+static void updateRoi(struct background_removal_filter *tf, const cv::Mat &backgroundMask, const cv::Size &frameSize)
+{
+	if (tf->roiFrameSize != frameSize) {
+		tf->roi = cv::Rect2f();
+		tf->roiFrameSize = frameSize;
+	}
+
+	const cv::Rect box = cv::boundingRect(backgroundMask < 128);
+	if (box.empty()) {
+		// Nobody in view: go back to the whole frame
+		tf->roi = cv::Rect2f();
+		return;
+	}
+
+	const float scaleX = (float)frameSize.width / backgroundMask.cols;
+	const float scaleY = (float)frameSize.height / backgroundMask.rows;
+	const cv::Rect2f target =
+		fitRoi(cv::Rect2f(box.x * scaleX, box.y * scaleY, box.width * scaleX, box.height * scaleY), frameSize);
+
+	if (tf->roi.empty()) {
+		tf->roi = target;
+		return;
+	}
+
+	const float left = target.x < tf->roi.x ? target.x : tf->roi.x + (target.x - tf->roi.x) * kRoiShrinkRate;
+	const float top = target.y < tf->roi.y ? target.y : tf->roi.y + (target.y - tf->roi.y) * kRoiShrinkRate;
+	const float right = target.br().x > tf->roi.br().x
+				    ? target.br().x
+				    : tf->roi.br().x + (target.br().x - tf->roi.br().x) * kRoiShrinkRate;
+	const float bottom = target.br().y > tf->roi.br().y
+				     ? target.br().y
+				     : tf->roi.br().y + (target.br().y - tf->roi.br().y) * kRoiShrinkRate;
+	tf->roi = cv::Rect2f(left, top, right - left, bottom - top);
+}
+
+// The region the next queued frame is inferred on (empty without ROI mode). In ROI
+// mode whole-frame inferences are pasted as well, so every mask has the pasted size
+// and temporal smoothing and the GPU mask history survive the region resetting.
+static cv::Rect roiInferenceRect(const struct background_removal_filter *tf, const cv::Size &frameSize)
+{
+	if (!tf->roiInference) {
+		return cv::Rect();
+	}
+	const cv::Rect frame(0, 0, frameSize.width, frameSize.height);
+	if (tf->roi.empty() || tf->roiFrameSize != frameSize) {
+		return frame;
+	}
+	const cv::Rect roi = cv::Rect(cvRound(tf->roi.x), cvRound(tf->roi.y), cvRound(tf->roi.width),
+				      cvRound(tf->roi.height)) &
+			     frame;
+	return roi.empty() ? frame : roi;
+}
+
+// Motion-aware updates: at most this many partial updates in a row, so changes
+// the detector missed (or partial results lost to ring overruns) don't linger
+static constexpr int kMaxPartialUpdates = 30;
+
+// Classify the frame against the last pushed one on the GPU. Returns false for
+// a static frame (the previous mask stays). Local motion narrows roi to the
+// changed region and marks the push partial; other frames get a full update.
+static bool motionUpdateRegion(struct background_removal_filter *tf, const InputFrame &input, cv::Rect &roi,
+			       bool &partial)
+{
+	const cv::Size frameSize = input.size();
+	MotionResult motion;
+	bool detected;
+	if (input.onDevice) {
+		detected = tf->motionDetector.detect(input.device, motion);
+	} else {
+		// Host frames: only a thumbnail at the motion grid resolution is uploaded
+		const cv::Size thumbnailSize(CudaMotionDetector::kSamplesX, CudaMotionDetector::kSamplesY);
+		cv::Mat &thumbnail = tf->scratch.get(SCRATCH_MOTION_THUMB, thumbnailSize, input.bgra.type());
+		cv::resize(input.bgra, thumbnail, thumbnailSize, 0, 0, cv::INTER_AREA);
+		detected = tf->motionDetector.detect(thumbnail.data, thumbnail.cols, thumbnail.rows,
+						     (int)thumbnail.step[0], frameSize.width, frameSize.height,
+						     motion);
+	}
+	if (!detected) {
+		obs_log(LOG_WARNING, "Motion detection failed, disabling motion-aware updates");
+		tf->motionAware = false;
+		return true;
+	}
+
+	if (motion.motion == MotionClass::STATIC) {
+		return false;
+	}
+	// Depth output changes everywhere with the camera, not only where the image moved
+	if (motion.motion == MotionClass::LOCAL && tf->modelSelection != MODEL_DEPTH_TCMONODEPTH &&
+	    tf->motionPartialUpdates < kMaxPartialUpdates) {
+		const cv::Rect2f region =
+			fitRoi(cv::Rect2f((float)motion.x, (float)motion.y, (float)motion.width, (float)motion.height),
+			       frameSize);
+		roi = cv::Rect(cvRound(region.x), cvRound(region.y), cvRound(region.width), cvRound(region.height)) &
+		      cv::Rect(0, 0, frameSize.width, frameSize.height);
+		partial = true;
+		tf->motionPartialUpdates++;
+	} else {
+		// Full updates are pasted too, so every mask has the size partial updates paste into
+		if (roi.empty()) {
+			roi = cv::Rect(0, 0, frameSize.width, frameSize.height);
+		}
+		tf->motionPartialUpdates = 0;
+	}
+	tf->motionDetector.commit();
+	return true;
+}
+
+// Mask interpolation: sample a new frame for the mask flow. The caller then marks
+// the mask events of the tick (CudaMaskFlow::maskArrived/markInferred) and
+// publishes the flow. Returns false while interpolation is off.
+static bool sampleMaskFlow(struct background_removal_filter *tf, const InputFrame &input)
+{
+	if (!tf->maskInterpolation) {
+		tf->maskFlowActive = false;
+		return false;
+	}
+	if (!tf->maskFlowActive) {
+		// No reference yet: video_render warps with a zero flow until there is one
+		tf->maskFlow.reset();
+		tf->maskFlows.back() = cv::Mat::zeros(CudaMaskFlow::kBlocksY, CudaMaskFlow::kBlocksX, CV_32FC2);
+		tf->maskFlows.publish();
+		tf->maskFlowActive = true;
+	}
+
+	bool sampled;
+	if (input.onDevice) {
+		sampled = tf->maskFlow.sample(input.device);
+	} else {
+		// Host frames: only a thumbnail at the flow grid resolution is uploaded
+		cv::Mat &thumbnail = tf->scratch.get(SCRATCH_FLOW_THUMB,
+						     cv::Size(CudaMaskFlow::kSamplesX, CudaMaskFlow::kSamplesY),
+						     input.bgra.type());
+		cv::resize(input.bgra, thumbnail, thumbnail.size(), 0, 0, cv::INTER_AREA);
+		sampled = tf->maskFlow.sample(thumbnail.data, thumbnail.cols, thumbnail.rows, (int)thumbnail.step);
+	}
+	if (!sampled) {
+		obs_log(LOG_WARNING, "Mask flow estimation failed, disabling mask interpolation");
+		tf->maskInterpolation = false;
+		tf->maskFlowActive = false;
+	}
+	return sampled;
+}
+
+// Estimate the flow of the sampled frame against the reference and publish it
+// for video_render, after a 3x3 median: single blocks matched on repeated
+// texture would tear the mask
+static void publishMaskFlow(struct background_removal_filter *tf)
+{
+	cv::Mat &raw =
+		tf->scratch.get(SCRATCH_FLOW_RAW, cv::Size(CudaMaskFlow::kBlocksX, CudaMaskFlow::kBlocksY), CV_32FC2);
+	if (!tf->maskFlow.estimate(raw.ptr<float>())) {
+		return;
+	}
+	cv::split(raw, tf->flowPlanes);
+	for (int i = 0; i < 2; i++) {
+		cv::medianBlur(tf->flowPlanes[i], tf->flowFiltered[i], 3);
+	}
+	cv::merge(tf->flowFiltered, 2, tf->maskFlows.back());
+	tf->maskFlows.publish();
+}
+
+// Age of a mask when video_tick takes it, in ms: from the capture of its frame to this tick
+static void recordMaskAge(struct background_removal_filter *tf, const FrameTag &tag)
+{
+	if (tag.sequence == 0) {
+		return;
+	}
+	const uint64_t now = obs_get_video_frame_time();
+	tf->stats.record(PipelineStats::STAGE_MASK_AGE, now > tag.timestamp ? (double)(now - tag.timestamp) / 1e6 : 0.0);
+}
+
+// Next mask for video_tick from the async queue. Without a frame delay that is the
+// latest result. With one, every result waits in pendingMasks (keyed by its frame's
+// sequence) until video_render shows its frame: the next render captures frame
+// captureSequence + 1 and shows the one frameDelay before. The newest due mask is
+// taken and the older ones are dropped; their buffers stay in the ring.
+static bool takeDueMask(struct background_removal_filter *tf, cv::Mat &mask, FrameTag &tag)
+{
+	auto *pending = tf->pendingMasks;
+	constexpr int kPending = background_removal_filter::kMaxFrameDelay + 1;
+	if (tf->frameDelay == 0) {
+		tf->pendingMaskCount = 0;
+		return tf->asyncQueue.getLatestMask(mask, &tag);
+	}
+
+	// Results arrive in capture order; a full ring gives up its oldest mask
+	if (tf->pendingMaskCount == kPending) {
+		std::rotate(pending, pending + 1, pending + kPending);
+		tf->pendingMaskCount--;
+	}
+	auto &arrived = pending[tf->pendingMaskCount];
+	if (tf->asyncQueue.getLatestMask(arrived.mask, &arrived.tag)) {
+		tf->pendingMaskCount++;
+	}
+
+	const uint64_t next = tf->captureSequence + 1;
+	const uint64_t shown = next > (uint64_t)tf->frameDelay ? next - (uint64_t)tf->frameDelay : 0;
+	int due = -1;
+	for (int i = 0; i < tf->pendingMaskCount && pending[i].tag.sequence <= shown; i++) {
+		due = i;
+	}
+	if (due < 0) {
+		return false;
+	}
+	cv::swap(pending[due].mask, mask);
+	tag = pending[due].tag;
+	std::rotate(pending, pending + due + 1, pending + tf->pendingMaskCount);
+	tf->pendingMaskCount -= due + 1;
+	return true;
+}
+
+// Focal blur depth: hand a new frame to the depth worker when an update is due.
+// Device frames only when the depth session is on the frame's GPU (a device change
+// waits for the depth session on the new device).
+static void pushDepthFrame(struct background_removal_filter *tf, const InputFrame &input)
+{
+	if (!tf->depthStage.running() || (input.onDevice && tf->depthEstimator.deviceId != tf->deviceId)) {
+		return;
+	}
+	tf->depthStage.pushIfDue(input, tf->depthRate, obsFramePeriodMs());
+}
+
+// Remove small blobs: keep only contours larger than contourFilter of the image area.
+// The contour vectors are reused between frames; kept contours are drawn by index.
+static void filterContours(struct background_removal_filter *tf, cv::Mat &backgroundMask)
+{
+	std::vector<std::vector<cv::Point>> &contours = tf->contours;
+	findContours(backgroundMask, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+	const double contourSizeThreshold = (double)(backgroundMask.total()) * tf->contourFilter;
+	backgroundMask.setTo(0);
+	for (int i = 0; i < (int)contours.size(); i++) {
+		if (cv::contourArea(contours[i]) > contourSizeThreshold) {
+			drawContours(backgroundMask, contours, i, cv::Scalar(255), -1);
+		}
+	}
+}
+
+// Guided upsampling window radius at mask resolution (e.g. 5x5 of a 256x256 mask)
+static constexpr int kGuidedRadius = 2;
+
+// Hand the latest frame to the mask postprocessor as the guide of its guided
+// upsampling. The mask is from a frame the queue took a little earlier, which
+// only shows on fast motion.
+static void setMaskGuide(struct background_removal_filter *tf, const InputFrame &frame)
+{
+	if (frame.onDevice) {
+		tf->maskPostprocessor.setGuide(&frame.device);
+	} else {
+		tf->maskPostprocessor.uploadGuide(frame.bgra.data, frame.bgra.cols, frame.bgra.rows,
+						  frame.bgra.step[0]);
+	}
+}
+
+// GPU equivalent of the CPU mask postprocessing parameters in video_tick
+static MaskPostprocessParams gpuMaskParams(const struct background_removal_filter *tf)
+{
+	MaskPostprocessParams params;
+	params.temporalSmoothFactor = tf->temporalSmoothFactor;
+	if (tf->enableThreshold) {
+		params.contourFilter = tf->contourFilter;
+		params.temporalSmoothFactor = std::max(params.temporalSmoothFactor, tf->threshold);
+
+		if (tf->smoothContour > 0.0) {
+			int k_size = (int)(3 + 11 * tf->smoothContour);
+			params.smoothKernel = k_size + (k_size % 2 == 0 ? 1 : 0);
+		}
+		params.expansion = tf->maskExpansion;
+		if (tf->guidedUpsample) {
+			params.guidedRadius = kGuidedRadius;
+		}
+		if (tf->feather > 0.0) {
+			int k_size = (int)(40 * tf->feather);
+			params.featherKernel = k_size + (k_size % 2 == 0 ? 1 : 0);
+		}
+	}
+	return params;
+}
+
+// Run the mask refinement on the GPU and publish it for video_render.
+// Returns false (and disables the GPU pipeline) if CUDA postprocessing fails.
+static bool publishGpuMask(struct background_removal_filter *tf, const cv::Mat &mask, const cv::Size &frameSize,
+			   const MaskPostprocessParams &params)
+{
+	TRACE_GPU_RANGE("postprocess_mask_gpu", NVTX_COLOR_POSTPROCESS, tf->maskPostprocessor.stream());
+	StageTimer timer(tf->scheduler, InferenceScheduler::STAGE_MASK);
+	if (!tf->maskPostprocessor.process(mask.data, mask.cols, mask.rows, mask.step[0], frameSize.width,
+					   frameSize.height, params)) {
+		obs_log(LOG_WARNING, "GPU mask postprocessing failed, falling back to CPU");
+		tf->enableGpuMaskPipeline = false;
+		return false;
+	}
+	tf->maskPostprocessor.publish();
+	return true;
+}
+
+// IoBinding + GPU mask pipeline: the alpha matte goes from the ORT output buffer
+// into the mask postprocessor without leaving the device. Caller holds modelMutex.
+template<typename Frame>
+static bool publishDeviceMatte(struct background_removal_filter *tf, const Frame &imageBGRA,
+			       const cv::Size &frameSize)
+{
+	DeviceTensorView alpha;
+	if (!runFilterModelInferenceOnDevice(tf, imageBGRA, alpha)) {
+		return false;
+	}
+
+	TRACE_GPU_RANGE("postprocess_mask_gpu", NVTX_COLOR_POSTPROCESS, tf->maskPostprocessor.stream());
+	StageTimer timer(tf->scheduler, InferenceScheduler::STAGE_MASK);
+	if (!tf->maskPostprocessor.processAlpha(alpha.data, alpha.width, alpha.height, frameSize.width,
+						frameSize.height, MaskPostprocessParams{})) {
+		obs_log(LOG_WARNING, "GPU mask postprocessing failed, falling back to CPU");
+		tf->enableGpuMaskPipeline = false;
+		return false;
+	}
+	tf->maskPostprocessor.publish();
+	return true;
+}
+
+// Publish a host alpha-matte mask (sync path, or the async queue while the
+// scheduler runs the model there): resized on the GPU or the CPU, without the
+// segmentation mask postprocessing
+static void publishMatteMask(struct background_removal_filter *tf, const cv::Mat &rawMask,
+			     const cv::Size &frameSize)
+{
+	// GPU pipeline: resize on the device and copy straight into the mask texture
+	if (tf->enableGpuMaskPipeline && publishGpuMask(tf, rawMask, frameSize, MaskPostprocessParams{})) {
+		return;
+	}
+
+	// With DGF refiner, output is already at source resolution.
+	// Only resize if dimensions don't match (e.g. different source size).
+	// Written into the recycled back buffer, which keeps its allocation.
+	StageTimer timer(tf->scheduler, InferenceScheduler::STAGE_MASK);
+	cv::Mat &finalMask = tf->backgroundMasks.back();
+	if (rawMask.size() == frameSize) {
+		rawMask.copyTo(finalMask);
+	} else {
+		cv::resize(rawMask, finalMask, frameSize, 0, 0, cv::INTER_LINEAR);
+	}
+
+	// Publish for video_render
+	tf->backgroundMasks.publish();
+}
+
+// Frames a mask sharing producer may go without publishing before a rendering
+// consumer takes over
+static constexpr int kMaskShareStaleFrames = 3;
+
+// Oldest frame time a shared mask may have at frameTime
+static uint64_t maskShareNotBefore(uint64_t frameTime)
+{
+	const uint64_t maxAge = (uint64_t)(kMaskShareStaleFrames * obsFramePeriodMs() * 1e6);
+	return frameTime > maxAge ? frameTime - maxAge : 0;
+}
+
+// Position of filter in the filter chain of parent, 0 = applied to the source first
+static int filterChainPosition(obs_source_t *parent, obs_source_t *filter)
+{
+	struct Search {
+		obs_source_t *filter;
+		int index;
+		int position;
+	} search{filter, 0, 0};
+	obs_source_enum_filters(
+		parent,
+		[](obs_source_t *, obs_source_t *child, void *param) {
+			auto *s = static_cast<Search *>(param);
+			if (child == s->filter) {
+				s->position = s->index;
+			}
+			s->index++;
+		},
+		&search);
+	return search.position;
+}
+
+// video_tick: join the mask sharing group of the applied settings. Returns
+// whether the filter infers its own mask; a consumer renders with the
+// producer's and captures nothing.
+static bool updateMaskShare(struct background_removal_filter *tf)
+{
+	MaskShare &share = MaskShare::instance();
+	obs_source_t *parent = obs_filter_get_parent(tf->source);
+	const std::string &key = tf->appliedSettings.maskShareKey;
+	share.join(tf, parent, key, parent && !key.empty() ? filterChainPosition(parent, tf->source) : 0);
+	const uint64_t now = obs_get_video_frame_time();
+	const bool producing = share.producing(tf, now, maskShareNotBefore(now));
+	tf->skipCapture = !producing;
+	return producing;
+}
+
 void background_filter_video_tick(void *data, float seconds)
 {
 	NVTX_RANGE_COLOR("background_filter_video_tick", NVTX_COLOR_TICK);
@@ -543,75 +1906,181 @@ void background_filter_video_tick(void *data, float seconds)
 	// even if filter_destroy is called on the main thread
 	std::shared_ptr<background_removal_filter> tf = *ptr;
 
-	if (!tf || tf->isDisabled) {
+	if (!tf) {
 		return;
 	}
+	if (tf->isDisabled) {
+		suspendIfDue(tf.get());
+		return;
+	}
+	if (tf->suspended) {
+		resumeInference(tf.get());
+	}
 
 	if (!obs_source_enabled(tf->source)) {
+		// A disabled producer hands the mask over
+		MaskShare::instance().leave(tf.get());
 		return;
 	}
 
-	// Runtime TRT→CUDA fallback: if TRT inference failed, recreate session with CUDA
+	// Telemetry: queue overruns since the last tick (the queue restarts its
+	// counters on start()) and the periodic stats log
+	const uint64_t framesDropped = tf->asyncQueue.framesDropped();
+	tf->stats.countDropped(framesDropped >= tf->framesDroppedSeen ? framesDropped - tf->framesDroppedSeen
+								      : framesDropped);
+	tf->framesDroppedSeen = framesDropped;
+	tf->stats.logIfDue(obs_source_get_name(tf->source));
+
+	// Scratch allocations stop after warmup; later ones point at a size change
+	// or a temporary that escaped the arena
+	const uint64_t scratchAllocations = tf->scratch.allocations();
+	if (scratchAllocations != tf->scratchAllocationsSeen) {
+		obs_log(LOG_DEBUG, "[%s] %llu scratch buffer allocations (%llu new)", obs_source_get_name(tf->source),
+			(unsigned long long)scratchAllocations,
+			(unsigned long long)(scratchAllocations - tf->scratchAllocationsSeen));
+		tf->scratchAllocationsSeen = scratchAllocations;
+	}
+
+	// Swap in a session built in the background and apply queue settings
+	applyPendingSettings(tf.get());
+
+	// Inference and postprocessing of this tick run on the filter's GPU
+	CudaDeviceScope device(tf->deviceId);
+
+	// Runtime TRT→CUDA fallback: if TRT inference failed, rebuild the session with CUDA
+	// in the background (the frames until then pass through the failing session)
 	if (tf->trtInferenceFailed.exchange(false)) {
-		obs_log(LOG_WARNING, "TensorRT inference failed at runtime. Recreating session with CUDA.");
-		std::unique_lock<std::mutex> modelLock(tf->modelMutex);
-		try {
-			Ort::SessionOptions cudaOptions;
-			cudaOptions.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
-			cudaOptions.DisableMemPattern();
-			cudaOptions.SetExecutionMode(ExecutionMode::ORT_SEQUENTIAL);
-			Ort::ThrowOnError(OrtSessionOptionsAppendExecutionProvider_CUDA(cudaOptions, 0));
-			tf->session.reset(new Ort::Session(*tf->env, tf->modelFilepath.c_str(), cudaOptions));
-			obs_log(LOG_INFO, "CUDA fallback session created successfully (runtime)");
-		} catch (const std::exception &e) {
-			obs_log(LOG_ERROR, "CUDA fallback session failed: %s", e.what());
-			tf->isDisabled = true;
-			return;
+		SessionSettings fallback = SessionSettings::of(tf.get());
+		fallback.useGPU = USEGPU_CUDA;
+		if (requestSessionRebuild(tf.get(), fallback, tf->sessionBuilder.sourceWidth(),
+					  tf->sessionBuilder.sourceHeight())) {
+			obs_log(LOG_WARNING, "TensorRT inference failed at runtime. Rebuilding the session with CUDA.");
 		}
 	}
 
-	if (tf->isAlphaMatteModel) {
+	// Graph capture/replay failed: rebuild the session without CUDA graphs
+	if (tf->cudaGraphFailed.exchange(false)) {
+		SessionSettings fallback = SessionSettings::of(tf.get());
+		fallback.useCudaGraph = false;
+		if (requestSessionRebuild(tf.get(), fallback, tf->sessionBuilder.sourceWidth(),
+					  tf->sessionBuilder.sourceHeight())) {
+			obs_log(LOG_WARNING, "CUDA graph mode failed. Rebuilding the session without graphs.");
+		}
+	}
+
+	// Mask sharing: a consumer keeps its session for a takeover, but infers nothing
+	if (!updateMaskShare(tf.get())) {
+		return;
+	}
+
+	// Frames the render thread didn't read back still count for the scheduler.
+	// It may skip them whenever the scheduler decides which frames run.
+	for (int skipped = tf->readbackSkips.exchange(0); skipped > 0; skipped--) {
+		tf->scheduler.skipFrame(obsFramePeriodMs(), obs_get_lagged_frames());
+	}
+	const bool syncInference = tf->isAlphaMatteModel && !(tf->scheduler.preferAsync() && tf->asyncQueue.isRunning());
+	// The sync path infers the newest frame in place: nothing to align
+	tf->frameDelay = syncInference ? 0 : (int)tf->alignedFrameDelay;
+	// Mask interpolation estimates motion on every frame, inferred or not
+	tf->gateReadback = !tf->maskInterpolation &&
+			   (syncInference ? tf->scheduler.enabled() : tf->asyncQueue.isRunning());
+
+	// Focal blur depth: the next step of the cached map toward the latest depth map
+	if (tf->depthStage.running()) {
+		tf->depthStage.update(tf->depthRate, obsFramePeriodMs());
+	}
+
+	if (syncInference) {
 		// Synchronous inference path for alpha-matte models (e.g. RVM).
 		// Runs inference directly in video_tick to eliminate async pipeline
 		// latency (2-3 frames → 0 frames). With ~10ms inference time,
-		// fits comfortably in the 33ms frame budget at 30fps.
+		// fits comfortably in the 33ms frame budget at 30fps. When it doesn't,
+		// the scheduler skips frames or moves the model to the async queue.
 		try {
 			NVTX_RANGE_COLOR("sync_inference_tick", NVTX_COLOR_INFERENCE);
 
-			std::unique_lock<std::mutex> inputLock(tf->inputBGRALock, std::try_to_lock);
-			if (!inputLock.owns_lock() || tf->inputBGRA.empty()) {
+			// Only new frames are inferred; the acquired frame stays owned by
+			// this thread until the next acquire, so it is read without a lock
+			if (!tf->inputFrames.acquire()) {
+				return;
+			}
+			const InputFrame &input = localInputFrame(tf.get(), tf->inputFrames.front());
+			if (input.empty()) {
 				return;
 			}
-			cv::Size frameSize = tf->inputBGRA.size();
+			const cv::Size frameSize = input.size();
+			const bool flowSampled = sampleMaskFlow(tf.get(), input);
+			pushDepthFrame(tf.get(), input);
+
+			if (tf->scheduler.enabled() || tf->scheduler.gpuBudget() > 0) {
+				// Drop a result the queue finished after the switch back to this path
+				tf->asyncQueue.getLatestMask(tf->queueMask);
+				tf->pendingMaskCount = 0;
+				tf->maskPostprocessor.setStream(tf->cudaPreprocessor.stream());
+				if (!tf->scheduler.shouldRun(obsFramePeriodMs(), obs_get_lagged_frames())) {
+					// Not inferred: the last mask is warped to this frame
+					if (flowSampled) {
+						publishMaskFlow(tf.get());
+					}
+					return;
+				}
+			}
 
-			cv::Mat rawMask;
+			cv::Mat &rawMask = tf->scratch.get(SCRATCH_MATTE_MASK);
+			bool processed = false;
+			bool publishedOnDevice = false;
 			{
 				std::unique_lock<std::mutex> modelLock(tf->modelMutex);
 				if (!tf->model || !tf->session) {
 					return;
 				}
-				processImageForBackground(tf.get(), tf->inputBGRA, rawMask);
-			}
-			inputLock.unlock();
-
-			if (rawMask.empty()) {
-				return;
+				// The model input follows the source (RVM): rebuild the session in the
+				// background on a size change, the current one keeps serving until then
+				if (frameSize != tf->sessionSourceSize && !tf->sessionBuilder.busy()) {
+					if (inputSizeChanges(tf.get(), frameSize)) {
+						obs_log(LOG_INFO, "Source size changed to %dx%d, rebuilding the session",
+							frameSize.width, frameSize.height);
+						requestSessionRebuild(tf.get(), SessionSettings::of(tf.get()),
+								      frameSize.width, frameSize.height);
+					}
+					tf->sessionSourceSize = frameSize;
+				}
+				// Fused enhancement first; a host frame it uploaded serves both models
+				DeviceFrame fused;
+				const bool fusedUpload = enhanceFusedFrame(tf.get(), input, fused);
+				const bool onDevice = input.onDevice || fusedUpload;
+				const DeviceFrame &device = fusedUpload ? fused : input.device;
+				if (tf->enableGpuMaskPipeline && tf->ioBinding) {
+					if (onDevice) {
+						publishedOnDevice = publishDeviceMatte(tf.get(), device, frameSize);
+					} else {
+						publishedOnDevice =
+							publishDeviceMatte(tf.get(), input.bgra, frameSize);
+					}
+				}
+				if (!publishedOnDevice) {
+					if (onDevice) {
+						processed = processImageForBackground(tf.get(), device, rawMask);
+					} else {
+						processed = processImageForBackground(tf.get(), input.bgra, rawMask);
+					}
+				}
 			}
 
-			// With DGF refiner, output is already at source resolution.
-			// Only resize if dimensions don't match (e.g. different source size).
-			cv::Mat finalMask;
-			if (rawMask.size() == frameSize) {
-				finalMask = rawMask;
-			} else {
-				cv::resize(rawMask, finalMask, frameSize, 0, 0, cv::INTER_LINEAR);
+			if (publishedOnDevice || processed) {
+				tf->stats.countFrame();
+				recordMaskAge(tf.get(), input.tag);
+				// The new mask is this frame's
+				if (flowSampled) {
+					tf->maskFlow.markInferred(input.tag.sequence);
+					tf->maskFlow.maskArrived(input.tag.sequence);
+					publishMaskFlow(tf.get());
+				}
 			}
-
-			// Publish for video_render
-			{
-				std::lock_guard<std::mutex> lock(tf->outputLock);
-				cv::swap(finalMask, tf->backgroundMask);
+			if (publishedOnDevice || !processed || rawMask.empty()) {
+				return;
 			}
+			publishMatteMask(tf.get(), rawMask, frameSize);
 		} catch (const Ort::Exception &e) {
 			obs_log(LOG_ERROR, "Sync inference ONNXRuntime error: %s", e.what());
 			if (tf->useGPU == USEGPU_TENSORRT) {
@@ -632,23 +2101,36 @@ void background_filter_video_tick(void *data, float seconds)
 		return;
 	}
 
-	// Process input frame: similarity check + push to async queue
-	// All done within the lock to avoid cloning the full BGRA frame
+	// Process input frame: similarity check + push to async queue.
+	// The acquired frame is owned by this thread until the next acquire, so it is
+	// read without a lock or a clone; the queue copies it into a ring slot.
 	cv::Size frameSize;
+	const InputFrame *latestFrame = nullptr; // guide of the guided mask upsampling
+	bool flowSampled = false;
+	uint64_t pushedSequence = 0;
 	{
-		std::unique_lock<std::mutex> lock(tf->inputBGRALock, std::try_to_lock);
-		if (!lock.owns_lock() || tf->inputBGRA.empty()) {
+		const bool newFrame = tf->inputFrames.acquire();
+		// Only a new frame is pushed, so only a new frame moves to the filter's GPU
+		const InputFrame &input = newFrame ? localInputFrame(tf.get(), tf->inputFrames.front())
+						   : tf->inputFrames.front();
+		if (input.empty()) {
 			return;
 		}
-		frameSize = tf->inputBGRA.size();
+		frameSize = input.size();
+		latestFrame = &input;
+		flowSampled = newFrame && sampleMaskFlow(tf.get(), input);
+		if (newFrame) {
+			pushDepthFrame(tf.get(), input);
+		}
 
-		bool shouldPush = true;
+		bool shouldPush = newFrame;
 
 		// Image similarity check — skip pushing if the frame hasn't changed much
 		// Uses downscaled comparison (160x90) to avoid 8MB PSNR on full-res
-		if (tf->enableImageSimilarity) {
-			cv::Mat small;
-			cv::resize(tf->inputBGRA, small, cv::Size(160, 90), 0, 0, cv::INTER_NEAREST);
+		// (motion-aware mode makes the same decision on the GPU, per region)
+		if (shouldPush && tf->enableImageSimilarity && !tf->motionAware && !input.onDevice) {
+			cv::Mat &small = tf->scratch.get(SCRATCH_SIMILARITY_THUMB, cv::Size(160, 90), input.bgra.type());
+			cv::resize(input.bgra, small, small.size(), 0, 0, cv::INTER_NEAREST);
 			if (!tf->lastImageBGRA.empty() && tf->lastImageBGRA.size() == small.size()) {
 				double psnr = cv::PSNR(tf->lastImageBGRA, small);
 				if (psnr > tf->imageSimilarityThreshold) {
@@ -660,37 +2142,89 @@ void background_filter_video_tick(void *data, float seconds)
 			}
 		}
 
-		// Frame skip — reduce push frequency
-		tf->maskEveryXFramesCount++;
-		tf->maskEveryXFramesCount %= tf->maskEveryXFrames;
-		if (tf->maskEveryXFramesCount != 0) {
+		// Frame skip — every mask_every_x_frames frames, more while the measured
+		// latency doesn't fit the frame budget (adaptive scheduler)
+		if (newFrame && !tf->scheduler.shouldRun(obsFramePeriodMs(), obs_get_lagged_frames())) {
 			shouldPush = false;
 		}
 
-		// Push directly to async queue (avoids extra clone)
+		// Push to the async queue (host frames into the slot's pinned buffer, device frames D2D)
 		if (shouldPush) {
-			tf->asyncQueue.pushFrame(tf->inputBGRA);
+			cv::Rect roi = roiInferenceRect(tf.get(), frameSize);
+			bool partial = false;
+			if (!tf->motionAware || motionUpdateRegion(tf.get(), input, roi, partial)) {
+				tf->asyncQueue.pushFrame(input, roi, partial);
+				pushedSequence = input.tag.sequence;
+			}
 		}
 	}
 
-	// Initialize background mask if empty (first frame, before any inference completes)
-	{
-		std::lock_guard<std::mutex> lock(tf->outputLock);
-		if (tf->backgroundMask.empty()) {
-			tf->backgroundMask = cv::Mat(frameSize, CV_8UC1, cv::Scalar(255));
-		}
+	// Initialize background mask (first frame, before any inference completes)
+	if (!tf->backgroundMaskPublished) {
+		tf->backgroundMasks.back() = cv::Mat(frameSize, CV_8UC1, cv::Scalar(255));
+		tf->backgroundMasks.publish();
+		tf->backgroundMaskPublished = true;
 	}
 
 	// Pull latest completed mask from worker thread
-	cv::Mat rawMask;
-	if (!tf->asyncQueue.getLatestMask(rawMask)) {
-		// No new inference result yet — video_render uses previous backgroundMask
+	// (with an aligned frame delay, the newest one whose frame video_render shows)
+	cv::Mat &rawMask = tf->queueMask;
+	FrameTag maskTag;
+	const bool maskArrived = takeDueMask(tf.get(), rawMask, maskTag);
+	if (maskArrived) {
+		recordMaskAge(tf.get(), maskTag);
+	}
+	if (flowSampled) {
+		// The arrived mask is of an earlier push than this tick's
+		if (maskArrived) {
+			tf->maskFlow.maskArrived(maskTag.sequence);
+		}
+		if (pushedSequence) {
+			tf->maskFlow.markInferred(pushedSequence);
+		}
+		publishMaskFlow(tf.get());
+	}
+	if (!maskArrived) {
+		// No new inference result yet — video_render keeps (and interpolation warps) the previous mask
+		return;
+	}
+	tf->stats.countFrame();
+
+	if (tf->isAlphaMatteModel) {
+		// Host mask: don't queue behind the worker's next inference on the model stream
+		tf->maskPostprocessor.setStream(nullptr);
+		try {
+			publishMatteMask(tf.get(), rawMask, frameSize);
+		} catch (const std::exception &e) {
+			obs_log(LOG_ERROR, "%s", e.what());
+		}
 		return;
 	}
 
+	if (tf->roiInference) {
+		updateRoi(tf.get(), rawMask, frameSize);
+	}
+
+	// GPU pipeline: the thresholded mask is uploaded at mask resolution and the whole
+	// refinement, contour filtering included, runs in CUDA
+	if (tf->enableGpuMaskPipeline) {
+		try {
+			if (tf->guidedUpsample) {
+				setMaskGuide(tf.get(), *latestFrame);
+			}
+			if (publishGpuMask(tf.get(), rawMask, frameSize, gpuMaskParams(tf.get()))) {
+				return;
+			}
+		} catch (const std::exception &e) {
+			obs_log(LOG_ERROR, "%s", e.what());
+			return;
+		}
+	}
+
 	// Apply postprocessing to the raw mask (cheap CPU operations)
 	try {
 		NVTX_RANGE_COLOR("postprocess_mask", NVTX_COLOR_POSTPROCESS);
+		StageTimer timer(tf->scheduler, InferenceScheduler::STAGE_MASK);
 		cv::Mat backgroundMask = rawMask;
 
 		// Temporal smoothing
@@ -711,18 +2245,7 @@ void background_filter_video_tick(void *data, float seconds)
 		if (tf->enableThreshold) {
 			// Binary mask: contour/smooth/feather postprocessing
 			if (tf->contourFilter > 0.0 && tf->contourFilter < 1.0) {
-				std::vector<std::vector<cv::Point>> contours;
-				findContours(backgroundMask, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
-				std::vector<std::vector<cv::Point>> filteredContours;
-				const double contourSizeThreshold =
-					(double)(backgroundMask.total()) * tf->contourFilter;
-				for (auto &contour : contours) {
-					if (cv::contourArea(contour) > contourSizeThreshold) {
-						filteredContours.push_back(contour);
-					}
-				}
-				backgroundMask.setTo(0);
-				drawContours(backgroundMask, filteredContours, -1, cv::Scalar(255), -1);
+				filterContours(tf.get(), backgroundMask);
 			}
 
 			if (tf->smoothContour > 0.0) {
@@ -732,10 +2255,12 @@ void background_filter_video_tick(void *data, float seconds)
 			}
 
 			// Resize mask to current frame size
-			cv::resize(backgroundMask, backgroundMask, frameSize);
+			cv::Mat &frameMask = tf->scratch.get(SCRATCH_FRAME_MASK, frameSize, CV_8UC1);
+			cv::resize(backgroundMask, frameMask, frameSize);
+			backgroundMask = frameMask;
 
 			if (tf->smoothContour > 0.0) {
-				backgroundMask = backgroundMask > 128;
+				cv::compare(backgroundMask, 128, backgroundMask, cv::CMP_GT);
 			}
 
 			// Expand or shrink the mask
@@ -756,11 +2281,9 @@ void background_filter_video_tick(void *data, float seconds)
 			}
 		}
 
-		// Publish final mask for video_render
-		{
-			std::lock_guard<std::mutex> lock(tf->outputLock);
-			backgroundMask.copyTo(tf->backgroundMask);
-		}
+		// Publish final mask for video_render (copyTo reuses the recycled buffer)
+		backgroundMask.copyTo(tf->backgroundMasks.back());
+		tf->backgroundMasks.publish();
 	} catch (const Ort::Exception &e) {
 		obs_log(LOG_ERROR, "ONNXRuntime Exception: %s", e.what());
 	} catch (const std::exception &e) {
@@ -768,14 +2291,217 @@ void background_filter_video_tick(void *data, float seconds)
 	}
 }
 
+/**
+  * @brief Upload the latest background mask into the persistent GS_R8 mask texture
+  *
+  * The texture is only reallocated when the mask size changes. With the GPU mask
+  * pipeline the device mask is copied in via CUDA-GL interop; otherwise the host
+  * mask is uploaded with gs_texture_set_image when it changed.
+  *
+  * @return the mask texture, or nullptr if no mask is available yet
+*/
+static gs_texture_t *updateMaskTexture(struct background_removal_filter *tf)
+{
+	// Take the latest published masks; the acquired buffers stay owned by this thread
+	const bool newGpuMask = tf->maskPostprocessor.acquire();
+	const bool newHostMask = tf->backgroundMasks.acquire();
+	const DeviceMask &gpuMask = tf->maskPostprocessor.front();
+	const cv::Mat &hostMask = tf->backgroundMasks.front();
+
+	const bool useGpuMask = tf->enableGpuMaskPipeline && !gpuMask.empty();
+	if (!useGpuMask && hostMask.empty()) {
+		return nullptr;
+	}
+
+	const uint32_t width = useGpuMask ? (uint32_t)gpuMask.width : (uint32_t)hostMask.cols;
+	const uint32_t height = useGpuMask ? (uint32_t)gpuMask.height : (uint32_t)hostMask.rows;
+
+	bool created = false;
+	if (tf->maskTexture &&
+	    (gs_texture_get_width(tf->maskTexture) != width || gs_texture_get_height(tf->maskTexture) != height)) {
+		tf->maskInterop.unregister();
+		gs_texture_destroy(tf->maskTexture);
+		tf->maskTexture = nullptr;
+	}
+	if (!tf->maskTexture) {
+		tf->maskTexture = gs_texture_create(width, height, GS_R8, 1, nullptr, GS_DYNAMIC);
+		if (!tf->maskTexture) {
+			obs_log(LOG_ERROR, "Failed to create alpha texture");
+			return nullptr;
+		}
+		created = true;
+	}
+
+	// Re-upload when switching between the GPU and the CPU mask pipeline
+	const bool refresh = created || useGpuMask != tf->maskTextureFromGpu;
+	tf->maskTextureFromGpu = useGpuMask;
+
+	if (useGpuMask) {
+		if (newGpuMask || refresh) {
+			if (!tf->maskInterop.registerTexture(tf->maskTexture, width, height,
+							     CudaGLTexture::Access::WRITE_DISCARD) ||
+			    !tf->maskInterop.copyFromDevice(gpuMask.data, gpuMask.pitch, width, height,
+							    gpuMask.device)) {
+				obs_log(LOG_WARNING, "CUDA-GL mask upload failed, falling back to CPU mask pipeline");
+				tf->enableGpuMaskPipeline = false;
+				tf->maskInterop.unregister();
+			}
+		}
+	} else if (newHostMask || refresh) {
+		gs_texture_set_image(tf->maskTexture, hostMask.data, (uint32_t)hostMask.step[0], false);
+	}
+
+	return tf->maskTexture;
+}
+
+// Draw input through the effect's technique into target at width x height
+static bool renderBlurPass(gs_texrender_t *target, gs_effect_t *effect, const char *technique, gs_texture_t *input,
+			   uint32_t width, uint32_t height)
+{
+	gs_texrender_reset(target);
+	if (!gs_texrender_begin(target, width, height)) {
+		obs_log(LOG_INFO, "Could not open background blur texrender!");
+		return false;
+	}
+
+	struct vec4 background;
+	vec4_zero(&background);
+	gs_clear(GS_CLEAR_COLOR, &background, 0.0f, 0);
+	gs_ortho(0.0f, static_cast<float>(width), 0.0f, static_cast<float>(height), -100.0f, 100.0f);
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+
+	while (gs_effect_loop(effect, technique)) {
+		gs_draw_sprite(input, 0, width, height);
+	}
+	gs_blend_state_pop();
+	gs_texrender_end(target);
+	return true;
+}
+
+/**
+  * @brief Mask interpolation: warp the mask with the latest block flow
+  *
+  * The flow is uploaded into the small GS_RG32F flow texture when video_tick
+  * published a new one; its bilinear sample is the displacement of each pixel
+  * back to the frame the mask was inferred on (WarpMask technique).
+  *
+  * @return the warped mask in warpTexrender, or mask itself without a flow
+  */
+static gs_texture_t *warpMaskTexture(struct background_removal_filter *tf, gs_texture_t *mask)
+{
+	if (tf->maskFlows.acquire() && !tf->maskFlows.front().empty()) {
+		const cv::Mat &flow = tf->maskFlows.front();
+		if (!tf->flowTexture) {
+			tf->flowTexture = gs_texture_create(CudaMaskFlow::kBlocksX, CudaMaskFlow::kBlocksY, GS_RG32F, 1,
+							    nullptr, GS_DYNAMIC);
+		}
+		if (tf->flowTexture) {
+			gs_texture_set_image(tf->flowTexture, flow.data, (uint32_t)flow.step[0], false);
+		}
+	}
+	if (!tf->flowTexture || !tf->warpTexrender) {
+		return mask;
+	}
+
+	const uint32_t width = gs_texture_get_width(mask);
+	const uint32_t height = gs_texture_get_height(mask);
+	gs_effect_set_texture(gs_effect_get_param_by_name(tf->effect, "alphamask"), mask);
+	gs_effect_set_texture(gs_effect_get_param_by_name(tf->effect, "maskFlow"), tf->flowTexture);
+	if (!renderBlurPass(tf->warpTexrender, tf->effect, "WarpMask", mask, width, height)) {
+		return mask;
+	}
+	return gs_texrender_get_texture(tf->warpTexrender);
+}
+
+/**
+  * @brief Dual Kawase blur: downsample the frame through a half-resolution
+  * pyramid and upsample it back to full resolution.
+  *
+  * The blur strength picks the pyramid depth (one more level per doubling) and
+  * the sample offset within a level, so even the strongest blur costs less than
+  * two full-resolution passes. Focal blur samples the depth mask on the way up
+  * and keeps the sharper level for pixels near the focus point; focalTexture is
+  * that mask, or the alpha mask of the mask-aware passes without focal blur.
+  *
+  * @return the blurred texture, or the last completed level on failure
+  */
+static gs_texture_t *blur_background_dual(const std::shared_ptr<background_removal_filter> &tf, uint32_t width,
+					  uint32_t height, gs_texture_t *frame, gs_texture_t *focalTexture)
+{
+	gs_effect_t *effect = tf->dualKawaseBlurEffect;
+
+	int levels = 1;
+	while (levels < background_removal_filter::kMaxBlurLevels && (1 << levels) <= tf->blurBackground) {
+		levels++;
+	}
+	while (levels > 1 && ((width >> levels) < 2 || (height >> levels) < 2)) {
+		levels--;
+	}
+	const float offset = (float)(tf->blurBackground + 1) / (float)(1 << (levels - 1));
+
+	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
+	gs_eparam_t *sharpImage = gs_effect_get_param_by_name(effect, "sharpImage");
+	gs_eparam_t *focalmask = gs_effect_get_param_by_name(effect, "focalmask");
+	gs_eparam_t *xOffset = gs_effect_get_param_by_name(effect, "xOffset");
+	gs_eparam_t *yOffset = gs_effect_get_param_by_name(effect, "yOffset");
+	gs_eparam_t *blurLevel = gs_effect_get_param_by_name(effect, "blurLevel");
+	gs_eparam_t *blurLevels = gs_effect_get_param_by_name(effect, "blurLevels");
+	gs_eparam_t *blurFocusPointParam = gs_effect_get_param_by_name(effect, "blurFocusPoint");
+	gs_eparam_t *blurFocusDepthParam = gs_effect_get_param_by_name(effect, "blurFocusDepth");
+
+	gs_effect_set_int(blurLevels, levels);
+	gs_effect_set_float(blurFocusPointParam, tf->blurFocusPoint);
+	gs_effect_set_float(blurFocusDepthParam, tf->blurFocusDepth);
+
+	// levelTextures[k]: the frame downsampled k times (level 0 is the captured frame)
+	gs_texture_t *levelTextures[background_removal_filter::kMaxBlurLevels + 1] = {};
+	levelTextures[0] = frame;
+
+	const char *downTechnique = tf->enableFocalBlur ? "Down" : "DownMaskAware";
+	for (int k = 1; k <= levels; k++) {
+		gs_effect_set_texture(image, levelTextures[k - 1]);
+		gs_effect_set_texture(focalmask, focalTexture);
+		gs_effect_set_float(xOffset, offset * 0.5f / (float)(width >> (k - 1)));
+		gs_effect_set_float(yOffset, offset * 0.5f / (float)(height >> (k - 1)));
+		if (!renderBlurPass(tf->blurDown[k - 1], effect, downTechnique, levelTextures[k - 1], width >> k,
+				    height >> k)) {
+			return levelTextures[k - 1];
+		}
+		levelTextures[k] = gs_texrender_get_texture(tf->blurDown[k - 1]);
+	}
+
+	const char *upTechnique = tf->enableFocalBlur ? "UpFocal" : "UpMaskAware";
+	gs_texture_t *blurred = levelTextures[levels];
+	for (int k = levels - 1; k >= 0; k--) {
+		gs_effect_set_texture(image, blurred);
+		gs_effect_set_texture(sharpImage, levelTextures[k]);
+		gs_effect_set_texture(focalmask, focalTexture);
+		gs_effect_set_float(xOffset, offset * 0.5f / (float)(width >> (k + 1)));
+		gs_effect_set_float(yOffset, offset * 0.5f / (float)(height >> (k + 1)));
+		gs_effect_set_int(blurLevel, k);
+		if (!renderBlurPass(tf->blurUp[k], effect, upTechnique, blurred, width >> k, height >> k)) {
+			return blurred;
+		}
+		blurred = gs_texrender_get_texture(tf->blurUp[k]);
+	}
+	return blurred;
+}
+
 static gs_texture_t *blur_background(std::shared_ptr<background_removal_filter> tf, uint32_t width, uint32_t height,
-				     gs_texture_t *alphaTexture)
+				     gs_texture_t *frame, gs_texture_t *focalTexture)
 {
-	if (tf->blurBackground == 0 || !tf->kawaseBlurEffect) {
+	if (tf->blurBackground == 0) {
 		return nullptr;
 	}
-	gs_texture_t *blurredTexture = gs_texture_create(width, height, GS_BGRA, 1, nullptr, 0);
-	gs_copy_texture(blurredTexture, gs_texrender_get_texture(tf->texrender));
+	if (tf->dualKawaseBlur && tf->dualKawaseBlurEffect) {
+		return blur_background_dual(tf, width, height, frame, focalTexture);
+	}
+	if (!tf->kawaseBlurEffect || !tf->blurTexrender[0] || !tf->blurTexrender[1]) {
+		return nullptr;
+	}
+	// Pass 0 reads the captured frame, every later pass the previous target
+	gs_texture_t *blurredTexture = frame;
 	gs_eparam_t *image = gs_effect_get_param_by_name(tf->kawaseBlurEffect, "image");
 	gs_eparam_t *focalmask = gs_effect_get_param_by_name(tf->kawaseBlurEffect, "focalmask");
 	gs_eparam_t *xOffset = gs_effect_get_param_by_name(tf->kawaseBlurEffect, "xOffset");
@@ -785,15 +2511,13 @@ static gs_texture_t *blur_background(std::shared_ptr<background_removal_filter>
 	gs_eparam_t *blurFocusPointParam = gs_effect_get_param_by_name(tf->kawaseBlurEffect, "blurFocusPoint");
 	gs_eparam_t *blurFocusDepthParam = gs_effect_get_param_by_name(tf->kawaseBlurEffect, "blurFocusDepth");
 
+	const char *blur_type = (tf->enableFocalBlur) ? "DrawFocalBlur" : "Draw";
+
 	for (int i = 0; i < (int)tf->blurBackground; i++) {
-		gs_texrender_reset(tf->texrender);
-		if (!gs_texrender_begin(tf->texrender, width, height)) {
-			obs_log(LOG_INFO, "Could not open background blur texrender!");
-			return blurredTexture;
-		}
+		gs_texrender_t *target = tf->blurTexrender[i % 2];
 
 		gs_effect_set_texture(image, blurredTexture);
-		gs_effect_set_texture(focalmask, alphaTexture);
+		gs_effect_set_texture(focalmask, focalTexture);
 		gs_effect_set_float(xOffset, ((float)i + 0.5f) / (float)width);
 		gs_effect_set_float(yOffset, ((float)i + 0.5f) / (float)height);
 		gs_effect_set_int(blurIter, i);
@@ -801,23 +2525,54 @@ static gs_texture_t *blur_background(std::shared_ptr<background_removal_filter>
 		gs_effect_set_float(blurFocusPointParam, tf->blurFocusPoint);
 		gs_effect_set_float(blurFocusDepthParam, tf->blurFocusDepth);
 
-		struct vec4 background;
-		vec4_zero(&background);
-		gs_clear(GS_CLEAR_COLOR, &background, 0.0f, 0);
-		gs_ortho(0.0f, static_cast<float>(width), 0.0f, static_cast<float>(height), -100.0f, 100.0f);
-		gs_blend_state_push();
-		gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+		if (!renderBlurPass(target, tf->kawaseBlurEffect, blur_type, blurredTexture, width, height)) {
+			return blurredTexture;
+		}
+		blurredTexture = gs_texrender_get_texture(target);
+	}
+	return blurredTexture;
+}
 
-		const char *blur_type = (tf->enableFocalBlur) ? "DrawFocalBlur" : "Draw";
+/**
+  * @brief The frame to show: the captured one or, with an aligned frame delay,
+  * the copy captured frameDelay renders ago
+  *
+  * Every captured frame is copied into the ring while a delay is in effect.
+  * Until the ring holds the delayed frame (after enabling it or a size change)
+  * the captured frame is shown.
+  */
+static gs_texture_t *delayedFrameTexture(struct background_removal_filter *tf, uint32_t width, uint32_t height)
+{
+	gs_texture_t *captured = gs_texrender_get_texture(tf->texrender);
+	const int delay = tf->frameDelay;
+	if (delay <= 0 || !captured) {
+		return captured;
+	}
 
-		while (gs_effect_loop(tf->kawaseBlurEffect, blur_type)) {
-			gs_draw_sprite(blurredTexture, 0, width, height);
+	constexpr int kRing = background_removal_filter::kMaxFrameDelay + 1;
+	const uint64_t sequence = tf->captureSequence;
+	const int slot = (int)(sequence % kRing);
+	gs_texture_t *&copy = tf->delayedFrames[slot];
+	if (copy && (gs_texture_get_width(copy) != width || gs_texture_get_height(copy) != height)) {
+		gs_texture_destroy(copy);
+		copy = nullptr;
+	}
+	if (!copy) {
+		copy = gs_texture_create(width, height, GS_BGRA, 1, nullptr, 0);
+		if (!copy) {
+			return captured;
 		}
-		gs_blend_state_pop();
-		gs_texrender_end(tf->texrender);
-		gs_copy_texture(blurredTexture, gs_texrender_get_texture(tf->texrender));
 	}
-	return blurredTexture;
+	gs_copy_texture(copy, captured);
+	tf->delayedSequences[slot] = sequence;
+
+	const uint64_t shown = sequence - (uint64_t)delay;
+	gs_texture_t *delayed = tf->delayedFrames[shown % kRing];
+	if (sequence <= (uint64_t)delay || tf->delayedSequences[shown % kRing] != shown || !delayed ||
+	    gs_texture_get_width(delayed) != width || gs_texture_get_height(delayed) != height) {
+		return captured;
+	}
+	return delayed;
 }
 
 void background_filter_video_render(void *data, gs_effect_t *_effect)
@@ -834,7 +2589,7 @@ void background_filter_video_render(void *data, gs_effect_t *_effect)
 	// Create a local shared_ptr
 	std::shared_ptr<background_removal_filter> tf = *ptr;
 
-	if (!tf || tf->isDisabled) {
+	if (!tf || tf->isDisabled || !tf->sessionActive) {
 		if (tf && tf->source) {
 			obs_source_skip_video_filter(tf->source);
 		}
@@ -857,39 +2612,54 @@ void background_filter_video_render(void *data, gs_effect_t *_effect)
 		return;
 	}
 
+	// The frame the mask is applied to; a delayed one is drawn directly instead of the source
+	gs_texture_t *frame = delayedFrameTexture(tf.get(), width, height);
+	const bool delayed = frame != gs_texrender_get_texture(tf->texrender);
+
 	gs_texture_t *alphaTexture = nullptr;
 	{
-		std::lock_guard<std::mutex> lock(tf->outputLock);
-
-		if (tf->backgroundMask.empty()) {
-			obs_log(LOG_WARNING, "Background mask is empty during render, skipping frame.");
-			if (tf->source) {
-				obs_source_skip_video_filter(tf->source);
-			}
-			return;
+		StageTimer timer(tf->stats, PipelineStats::STAGE_UPLOAD);
+		// Mask sharing: a consumer draws the producer's mask, the last one of its own until there is one
+		const uint64_t frameTime = obs_get_video_frame_time();
+		MaskShare &share = MaskShare::instance();
+		if (tf->skipCapture) {
+			alphaTexture = share.latest(tf.get(), frameTime, maskShareNotBefore(frameTime), width, height);
 		}
-
-		alphaTexture = gs_texture_create(tf->backgroundMask.cols, tf->backgroundMask.rows, GS_R8, 1,
-						 (const uint8_t **)&tf->backgroundMask.data, 0);
-
 		if (!alphaTexture) {
-			obs_log(LOG_ERROR, "Failed to create alpha texture");
-			if (tf->source) {
-				obs_source_skip_video_filter(tf->source);
+			alphaTexture = updateMaskTexture(tf.get());
+			if (alphaTexture && tf->maskInterpolation) {
+				alphaTexture = warpMaskTexture(tf.get(), alphaTexture);
 			}
-			return;
+			share.publish(tf.get(), alphaTexture, frameTime, width, height);
 		}
 	}
+	if (!alphaTexture) {
+		obs_log(LOG_WARNING, "Background mask is empty during render, skipping frame.");
+		if (tf->source) {
+			obs_source_skip_video_filter(tf->source);
+		}
+		return;
+	}
 
 	// Output the masked image
-	gs_texture_t *blurredTexture = blur_background(tf, width, height, alphaTexture);
+	gs_texture_t *blurredTexture;
+	{
+		StageTimer timer(tf->stats, PipelineStats::STAGE_BLUR);
+		// Focal blur follows the depth map once the depth pipeline has one, the mask until then
+		gs_texture_t *focalTexture = alphaTexture;
+		if (tf->enableFocalBlur && tf->focalDepthActive) {
+			gs_texture_t *depthTexture = tf->depthStage.updateTexture();
+			focalTexture = depthTexture ? depthTexture : alphaTexture;
+		}
+		blurredTexture = blur_background(tf, width, height, frame, focalTexture);
+	}
+
+	gs_texture_t *enhancedTexture = tf->fusedEnhanceActive ? tf->enhanceStage.updateTexture(tf->stats) : nullptr;
 
-	if (!obs_source_process_filter_begin(tf->source, GS_RGBA, OBS_ALLOW_DIRECT_RENDERING)) {
+	if (!delayed && !obs_source_process_filter_begin(tf->source, GS_RGBA, OBS_ALLOW_DIRECT_RENDERING)) {
 		if (tf->source) {
 			obs_source_skip_video_filter(tf->source);
 		}
-		gs_texture_destroy(alphaTexture);
-		gs_texture_destroy(blurredTexture);
 		return;
 	}
 
@@ -902,11 +2672,24 @@ void background_filter_video_render(void *data, gs_effect_t *_effect)
 		gs_effect_set_texture(blurredBackground, blurredTexture);
 	}
 
+	// Fused enhancement: the enhanced person is blended in by the same pass
+	if (enhancedTexture) {
+		gs_effect_set_texture(gs_effect_get_param_by_name(tf->effect, "enhancedImage"), enhancedTexture);
+		gs_effect_set_float(gs_effect_get_param_by_name(tf->effect, "enhanceFactor"), tf->enhanceBlend);
+		gs_effect_set_float(gs_effect_get_param_by_name(tf->effect, "xOffset"), 1.0f / float(width));
+		gs_effect_set_float(gs_effect_get_param_by_name(tf->effect, "yOffset"), 1.0f / float(height));
+	}
+
 	gs_blend_state_push();
 	gs_reset_blend_state();
 
 	const char *techName;
-	if (tf->blurBackground > 0) {
+	if (enhancedTexture) {
+		if (tf->blurBackground > 0)
+			techName = tf->enableFocalBlur ? "DrawEnhancedWithFocalBlur" : "DrawEnhancedWithBlur";
+		else
+			techName = "DrawEnhancedWithoutBlur";
+	} else if (tf->blurBackground > 0) {
 		if (tf->enableFocalBlur)
 			techName = "DrawWithFocalBlur";
 		else
@@ -915,10 +2698,14 @@ void background_filter_video_render(void *data, gs_effect_t *_effect)
 		techName = "DrawWithoutBlur";
 	}
 
-	obs_source_process_filter_tech_end(tf->source, tf->effect, 0, 0, techName);
+	if (delayed) {
+		gs_effect_set_texture(gs_effect_get_param_by_name(tf->effect, "image"), frame);
+		while (gs_effect_loop(tf->effect, techName)) {
+			gs_draw_sprite(frame, 0, width, height);
+		}
+	} else {
+		obs_source_process_filter_tech_end(tf->source, tf->effect, 0, 0, techName);
+	}
 
 	gs_blend_state_pop();
-
-	gs_texture_destroy(alphaTexture);
-	gs_texture_destroy(blurredTexture);
 }
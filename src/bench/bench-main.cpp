@@ -0,0 +1,744 @@
+// bgremoval-bench: headless benchmark of the models and the CUDA pipeline.
+//
+// Replays synthetic frames (or raw BGRA frames from a file) through every
+// model in consts.h with the plugin's own session setup, preprocessing,
+// inference and GPU mask postprocessing, and reports per-stage latency,
+// throughput and peak VRAM as JSON on stdout.
+//
+//   ffmpeg -i clip.mp4 -vf scale=1920:1080 -pix_fmt bgra -f rawvideo clip.bgra
+//   bgremoval-bench --data data --sizes 1920x1080 --input clip.bgra > report.json
+//
+// --calibration-inputs writes the preprocessed input tensors of the frames as
+// .npy files for a TensorRT INT8 calibrator, e.g.
+//   polygraphy convert model.onnx --int8 --data-loader-script load.py \
+//     --calibration-cache ~/.cache/obs-backgroundremoval/calibration/<model>.cache
+// ORT can't run TensorRT calibration itself, so the table is built outside the
+// bench; INT8 sessions pick it up from that path.
+//
+// Regression checks: --budgets compares each run with the latency (p99 frame
+// time) and VRAM budgets stored for the GPU's architecture, --golden compares
+// the mask of the first measured frame with a golden mask, and the bench exits
+// with status 3 if any run is over budget or off its golden mask. With
+// --budgets only the configurations with a budget run, and a GPU architecture
+// without budgets exits with status 77 (skipped):
+//   bgremoval-bench --providers cuda --precisions fp32 --write-golden golden
+//   bgremoval-bench --record-budgets src/bench/perf-budgets.txt
+//   bgremoval-bench --budgets src/bench/perf-budgets.txt --golden golden --sizes 1280x720,1920x1080,3840x2160
+// Golden masks are written from one configuration (usually CUDA FP32) and
+// checked against all of them (FP16, TensorRT, --device, --tiled), with the
+// same --warmup: recurrent models carry state from the warmup frames.
+
+#include <cuda_runtime.h>
+
+#include <opencv2/imgproc.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <plugin-support.h>
+#include "FilterData.h"
+#include "consts.h"
+#include "models/ModelFactory.h"
+#include "ort-utils/ort-env.h"
+#include "ort-utils/ort-session-utils.h"
+#include "ort-utils/cuda-mask-postprocess.h"
+#include "obs-shim.h"
+
+struct BenchModel {
+	const char *path;
+	bool outputsMask; // segmentation/matting/depth: the output goes through mask postprocessing
+};
+
+static const BenchModel kModels[] = {
+	{MODEL_SINET, true},
+	{MODEL_MEDIAPIPE, true},
+	{MODEL_SELFIE, true},
+	{MODEL_SELFIE_MULTICLASS, true},
+	{MODEL_RVM, true},
+	{MODEL_PPHUMANSEG, true},
+	{MODEL_DEPTH_TCMONODEPTH, true},
+	{MODEL_RMBG, true},
+	{MODEL_ENHANCE_TBEFN, false},
+	{MODEL_ENHANCE_ZERODCE, false},
+	{MODEL_ENHANCE_URETINEX, false},
+	{MODEL_ENHANCE_SGLLIE, false},
+};
+
+// Raw input files are looped over at most this many frames (1080p BGRA is 8 MB a frame)
+static constexpr int kMaxLoadedFrames = 60;
+static constexpr int kSyntheticFrames = 30;
+
+// --record-budgets: headroom over the measured run, so run-to-run noise stays in budget
+static constexpr double kBudgetLatencyMargin = 1.25;
+static constexpr double kBudgetVramMargin = 1.1;
+// Golden masks: thresholded at 128, a mask must overlap its golden mask at least this much
+static constexpr double kMinGoldenIou = 0.95;
+// Exit status with --budgets and no budgets for the GPU's architecture (ctest SKIP_RETURN_CODE)
+static constexpr int kExitNoBudgets = 77;
+
+struct BenchOptions {
+	std::string dataPath = "data";
+	std::vector<std::string> models; // substrings of the model paths, empty = all
+	std::vector<std::string> providers = {USEGPU_CUDA, USEGPU_TENSORRT};
+	std::vector<std::string> precisions = {"fp32", "fp16"};
+	std::vector<cv::Size> sizes = {cv::Size(1280, 720), cv::Size(1920, 1080)};
+	std::string input; // raw BGRA frames at the first size
+	std::string calibrationInputs; // directory for the INT8 calibration inputs
+	int frames = 300;
+	int warmup = 30;
+	int gpu = 0; // CUDA device to run on
+	bool device = false;
+	bool tiled = false; // tiled inference, for the models that support it
+	bool verbose = false;
+	std::string budgets;       // budget file the runs are checked against
+	std::string recordBudgets; // budget file the measured runs are appended to
+	std::string golden;        // directory of the golden masks
+	bool writeGolden = false;  // write the golden masks instead of comparing
+	double maskTolerance = 4.0; // max mean absolute difference from the golden mask (0-255)
+};
+
+// Latency and allocation budget of one run configuration on one GPU architecture
+struct Budget {
+	double p99Ms = 0.0;
+	size_t peakVramMB = 0;
+};
+
+struct BenchChecks {
+	std::map<std::string, Budget> budgets; // of the GPU's architecture, by budgetKey()
+	int failures = 0;
+};
+
+struct BenchFilter : public filter_data {
+	CudaMaskPostprocessor maskPostprocessor;
+};
+
+struct LatencySummary {
+	double meanMs = 0.0;
+	double p50Ms = 0.0;
+	double p99Ms = 0.0;
+	double maxMs = 0.0;
+};
+
+static std::vector<std::string> splitList(const std::string &list)
+{
+	std::vector<std::string> items;
+	std::stringstream stream(list);
+	std::string item;
+	while (std::getline(stream, item, ',')) {
+		if (!item.empty()) {
+			items.push_back(item);
+		}
+	}
+	return items;
+}
+
+static void printUsage()
+{
+	fprintf(stderr, "Usage: bgremoval-bench [options]\n"
+			"  --data DIR           plugin data directory containing models/ (default: data)\n"
+			"  --models a,b         models whose path contains one of the names (default: all)\n"
+			"  --providers a,b      cuda, tensorrt (default: both)\n"
+			"  --precisions a,b     fp32, fp16, int8 (TensorRT only) (default: fp32,fp16)\n"
+			"  --sizes WxH,WxH      frame sizes (default: 1280x720,1920x1080)\n"
+			"  --input FILE         raw BGRA frames at the first size instead of synthetic frames\n"
+			"  --calibration-inputs DIR  write the preprocessed frames as .npy INT8 calibration data\n"
+			"  --frames N           measured frames per run (default: 300)\n"
+			"  --warmup N           unmeasured frames per run (default: 30)\n"
+			"  --gpu N              CUDA device to run on (default: 0)\n"
+			"  --device             feed frames from device memory (zero-copy input path)\n"
+			"  --tiled              tiled inference for the models that support it\n"
+			"  --budgets FILE       run the configurations with a budget for the GPU and check their p99\n"
+			"                       frame time and peak VRAM (exit status 77 without budgets)\n"
+			"  --record-budgets FILE  append the measured runs (with headroom) as budgets\n"
+			"  --golden DIR         compare the first measured mask with the golden masks in DIR\n"
+			"  --write-golden DIR   write the first measured masks to DIR as golden masks\n"
+			"  --mask-tolerance X   max mean absolute difference from a golden mask (default: 4)\n"
+			"  --verbose            print the plugin's info log to stderr\n");
+}
+
+static bool parseOptions(int argc, char **argv, BenchOptions &options)
+{
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+		if (arg == "--device") {
+			options.device = true;
+		} else if (arg == "--tiled") {
+			options.tiled = true;
+		} else if (arg == "--verbose") {
+			options.verbose = true;
+		} else if (!hasValue) {
+			return false;
+		} else if (arg == "--data") {
+			options.dataPath = argv[++i];
+		} else if (arg == "--models") {
+			options.models = splitList(argv[++i]);
+		} else if (arg == "--providers") {
+			options.providers = splitList(argv[++i]);
+		} else if (arg == "--precisions") {
+			options.precisions = splitList(argv[++i]);
+		} else if (arg == "--sizes") {
+			options.sizes.clear();
+			for (const std::string &size : splitList(argv[++i])) {
+				int width = 0, height = 0;
+				if (sscanf(size.c_str(), "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+					return false;
+				}
+				options.sizes.emplace_back(width, height);
+			}
+		} else if (arg == "--input") {
+			options.input = argv[++i];
+		} else if (arg == "--calibration-inputs") {
+			options.calibrationInputs = argv[++i];
+		} else if (arg == "--frames") {
+			options.frames = std::max(1, atoi(argv[++i]));
+		} else if (arg == "--warmup") {
+			options.warmup = std::max(0, atoi(argv[++i]));
+		} else if (arg == "--gpu") {
+			options.gpu = std::max(0, atoi(argv[++i]));
+		} else if (arg == "--budgets") {
+			options.budgets = argv[++i];
+		} else if (arg == "--record-budgets") {
+			options.recordBudgets = argv[++i];
+		} else if (arg == "--golden" || arg == "--write-golden") {
+			options.golden = argv[++i];
+			options.writeGolden = arg == "--write-golden";
+		} else if (arg == "--mask-tolerance") {
+			options.maskTolerance = std::max(0.0, atof(argv[++i]));
+		} else {
+			return false;
+		}
+	}
+	return !options.sizes.empty();
+}
+
+// Gradient background with a moving ellipse, so segmentation sees edges and
+// recurrent models see motion
+static std::vector<cv::Mat> syntheticFrames(const cv::Size &size)
+{
+	std::vector<cv::Mat> frames;
+	for (int i = 0; i < kSyntheticFrames; i++) {
+		cv::Mat frame(size, CV_8UC4);
+		for (int y = 0; y < size.height; y++) {
+			const double t = (double)y / size.height;
+			frame.row(y).setTo(cv::Scalar(255.0 * t, 96, 255.0 * (1.0 - t), 255));
+		}
+		const double phase = 2.0 * CV_PI * i / kSyntheticFrames;
+		const cv::Point center((int)(size.width * (0.5 + 0.2 * std::sin(phase))), size.height * 3 / 5);
+		cv::ellipse(frame, center, cv::Size(size.width / 8, size.height / 3), 0.0, 0.0, 360.0,
+			    cv::Scalar(60, 120, 200, 255), cv::FILLED);
+		cv::circle(frame, cv::Point(center.x, size.height / 4), size.height / 8, cv::Scalar(80, 150, 230, 255),
+			   cv::FILLED);
+		frames.push_back(frame);
+	}
+	return frames;
+}
+
+static bool readRawFrames(const std::string &path, const cv::Size &size, std::vector<cv::Mat> &frames)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+	const size_t frameBytes = (size_t)size.width * size.height * 4;
+	while ((int)frames.size() < kMaxLoadedFrames) {
+		cv::Mat frame(size, CV_8UC4);
+		if (!file.read(reinterpret_cast<char *>(frame.data), (std::streamsize)frameBytes)) {
+			break;
+		}
+		frames.push_back(frame);
+	}
+	return !frames.empty();
+}
+
+static LatencySummary summarize(std::vector<double> samples)
+{
+	LatencySummary summary;
+	if (samples.empty()) {
+		return summary;
+	}
+	std::sort(samples.begin(), samples.end());
+	double total = 0.0;
+	for (double sample : samples) {
+		total += sample;
+	}
+	summary.meanMs = total / samples.size();
+	summary.p50Ms = samples[(samples.size() - 1) / 2];
+	summary.p99Ms = samples[std::min(samples.size() - 1, (size_t)(0.99 * samples.size()))];
+	summary.maxMs = samples.back();
+	return summary;
+}
+
+static std::string latencyJson(double meanMs, double p50Ms, double p99Ms, double maxMs)
+{
+	char json[160];
+	snprintf(json, sizeof(json), "{\"meanMs\": %.3f, \"p50Ms\": %.3f, \"p99Ms\": %.3f, \"maxMs\": %.3f}", meanMs,
+		 p50Ms, p99Ms, maxMs);
+	return json;
+}
+
+static size_t usedDeviceMemoryMB()
+{
+	size_t freeBytes = 0, totalBytes = 0;
+	if (cudaMemGetInfo(&freeBytes, &totalBytes) != cudaSuccess) {
+		return 0;
+	}
+	return (totalBytes - freeBytes) / (1024 * 1024);
+}
+
+// NumPy .npy (format 1.0) file of a float32 tensor
+static bool writeNpy(const std::string &path, const std::vector<float> &values, const std::vector<int64_t> &dims)
+{
+	std::string shape;
+	for (int64_t dim : dims) {
+		shape += std::to_string(dim) + ", ";
+	}
+	std::string header = "{'descr': '<f4', 'fortran_order': False, 'shape': (" + shape + "), }";
+	// Magic, version and length (10 bytes) + header + '\n', padded to a multiple of 64
+	header.append((64 - (10 + header.size() + 1) % 64) % 64, ' ');
+	header += '\n';
+
+	std::ofstream file(path, std::ios::binary);
+	file.write("\x93NUMPY\x01\x00", 8);
+	file.put((char)(header.size() & 0xff));
+	file.put((char)(header.size() >> 8));
+	file << header;
+	file.write(reinterpret_cast<const char *>(values.data()), (std::streamsize)(values.size() * sizeof(float)));
+	return (bool)file;
+}
+
+// Budget file line: <architecture> <model> <provider> <precision> <WxH> <input> <p99 ms> <peak VRAM MB>,
+// the architecture as its GpuArchitecture value (75 Turing, 86 Ampere, 89 Ada Lovelace).
+// tiled: whether the run uses tiled inference (--tiled and a model that supports it).
+static std::string budgetKey(const BenchOptions &options, const BenchModel &benchModel, const std::string &provider,
+			     const std::string &precision, const cv::Size &size, bool tiled)
+{
+	return std::filesystem::path(benchModel.path).stem().string() + " " + provider + " " + precision + " " +
+	       std::to_string(size.width) + "x" + std::to_string(size.height) + " " +
+	       (options.device ? "device" : "host") + (tiled ? "+tiled" : "");
+}
+
+// Whether runs of a model use tiled inference
+static bool runsTiled(const BenchOptions &options, const BenchModel &benchModel)
+{
+	if (!options.tiled) {
+		return false;
+	}
+	std::unique_ptr<Model> model(createModel(benchModel.path));
+	return model && model->supportsTiling();
+}
+
+static bool loadBudgets(const std::string &path, GpuArchitecture architecture, std::map<std::string, Budget> &budgets)
+{
+	std::ifstream file(path);
+	if (!file) {
+		return false;
+	}
+	std::string line;
+	while (std::getline(file, line)) {
+		std::istringstream fields(line);
+		int arch = 0;
+		std::string model, provider, precision, size, input;
+		Budget budget;
+		if (line.empty() || line[0] == '#' ||
+		    !(fields >> arch >> model >> provider >> precision >> size >> input >> budget.p99Ms >>
+		      budget.peakVramMB)) {
+			continue;
+		}
+		if (arch == (int)architecture) {
+			budgets[model + " " + provider + " " + precision + " " + size + " " + input] = budget;
+		}
+	}
+	return true;
+}
+
+// Binary PGM (P5) of a CV_8UC1 mask
+static bool writePgm(const std::string &path, const cv::Mat &mask)
+{
+	std::ofstream file(path, std::ios::binary);
+	file << "P5\n" << mask.cols << " " << mask.rows << "\n255\n";
+	for (int y = 0; y < mask.rows; y++) {
+		file.write(reinterpret_cast<const char *>(mask.ptr(y)), mask.cols);
+	}
+	return (bool)file;
+}
+
+static bool readPgm(const std::string &path, cv::Mat &mask)
+{
+	std::ifstream file(path, std::ios::binary);
+	std::string magic;
+	int width = 0, height = 0, maxValue = 0;
+	if (!(file >> magic >> width >> height >> maxValue) || magic != "P5" || width <= 0 || height <= 0 ||
+	    maxValue != 255) {
+		return false;
+	}
+	file.get();
+	mask.create(height, width, CV_8UC1);
+	file.read(reinterpret_cast<char *>(mask.data), (std::streamsize)mask.total());
+	return (bool)file;
+}
+
+// The frames preprocessed exactly like the plugin does, as the input tensors a
+// TensorRT calibrator computes the INT8 activation ranges from
+static bool writeCalibrationInputs(const BenchOptions &options, const GpuInfo &gpuInfo, const BenchModel &benchModel,
+				   const std::vector<cv::Mat> &frames)
+{
+	const cv::Size size = frames.front().size();
+	auto tf = std::make_unique<BenchFilter>();
+	tf->modelSelection = benchModel.path;
+	tf->model.reset(createModel(benchModel.path));
+	tf->useGPU = USEGPU_CUDA;
+	tf->numThreads = 1;
+	tf->gpuInfo = gpuInfo;
+	tf->deviceId = gpuInfo.deviceId;
+	tf->precision = PRECISION_FP32;
+	tf->useIoBinding = false;
+	tf->useSharedEngine = false;
+	tf->model->setSourceSize(size.width, size.height);
+	if (createOrtSession(tf.get()) != OBS_BGREMOVAL_ORT_SESSION_SUCCESS) {
+		return false;
+	}
+
+	uint32_t inputWidth, inputHeight;
+	tf->model->getNetworkInputSize(tf->inputDims, inputWidth, inputHeight);
+	const std::string model = std::filesystem::path(benchModel.path).stem().string();
+	const std::filesystem::path dir = std::filesystem::path(options.calibrationInputs) /
+					  (model + "_" + std::to_string(size.width) + "x" + std::to_string(size.height));
+	std::error_code error;
+	std::filesystem::create_directories(dir, error);
+
+	std::vector<float> &tensor = tf->inputTensorValues[0];
+	for (size_t i = 0; i < frames.size(); i++) {
+		const cv::Mat &frame = frames[i];
+		tf->cudaPreprocessor.preprocess(frame.data, frame.cols, frame.rows, (int)frame.step[0], tensor.data(),
+						inputWidth, inputHeight, tf->model->getPreprocessParams());
+		char name[32];
+		snprintf(name, sizeof(name), "frame_%03zu.npy", i);
+		if (!writeNpy((dir / name).string(), tensor, tf->inputDims[0])) {
+			return false;
+		}
+	}
+	fprintf(stderr, "%s: %zu calibration inputs in %s (calibration table: %s)\n", benchModel.path, frames.size(),
+		dir.string().c_str(), int8CalibrationTablePath(benchModel.path).c_str());
+	return true;
+}
+
+// One model / provider / precision / size combination. Returns the JSON object of the run.
+static std::string runBenchmark(const BenchOptions &options, const GpuInfo &gpuInfo, const BenchModel &benchModel,
+				const std::string &provider, const std::string &precision,
+				const std::vector<cv::Mat> &frames, BenchChecks &checks)
+{
+	const cv::Size size = frames.front().size();
+	std::ostringstream json;
+	json << "{\"model\": \"" << benchModel.path << "\", \"provider\": \"" << provider << "\", \"precision\": \""
+	     << precision << "\", \"width\": " << size.width << ", \"height\": " << size.height
+	     << ", \"input\": \"" << (options.device ? "device" : "host") << "\"";
+
+	const size_t baselineMB = usedDeviceMemoryMB();
+	size_t peakMB = baselineMB;
+
+	auto tf = std::make_unique<BenchFilter>();
+	tf->modelSelection = benchModel.path;
+	tf->model.reset(createModel(benchModel.path));
+	tf->useGPU = provider;
+	tf->numThreads = 1;
+	tf->gpuInfo = gpuInfo;
+	tf->deviceId = gpuInfo.deviceId;
+	tf->precision = precision;
+	tf->useSharedEngine = false;
+	tf->useTiledInference = options.tiled && tf->model->supportsTiling();
+	tf->model->setSourceSize(size.width, size.height);
+
+	// A configuration with a budget that stops running is a regression too
+	const std::string key = budgetKey(options, benchModel, provider, precision, size, tf->useTiledInference);
+	const auto failRun = [&](const char *status) {
+		if (checks.budgets.count(key)) {
+			fprintf(stderr, "FAILED: %s: %s\n", key.c_str(), status);
+			checks.failures++;
+		}
+		json << ", \"status\": \"" << status << "\"}";
+		return json.str();
+	};
+
+	// Session creation includes the TensorRT engine build (or cache load)
+	const auto sessionStart = std::chrono::steady_clock::now();
+	if (createOrtSession(tf.get()) != OBS_BGREMOVAL_ORT_SESSION_SUCCESS) {
+		return failRun("session_failed");
+	}
+	const std::chrono::duration<double, std::milli> sessionMs = std::chrono::steady_clock::now() - sessionStart;
+	// What the session was built with: INT8 falls back without a calibration
+	// table, CUDA FP16 without an FP16 model variant (no half tensors)
+	json << ", \"builtPrecision\": \"" << precisionModeName(sessionPrecision(tf.get())) << "\", \"halfTensors\": "
+	     << (tf->halfInput ? "true" : "false");
+	tf->maskPostprocessor.setStream(tf->cudaPreprocessor.stream());
+
+	std::vector<DeviceFrame> deviceFrames;
+	if (options.device) {
+		for (const cv::Mat &frame : frames) {
+			DeviceFrame deviceFrame;
+			if (!ensureDeviceFrame(deviceFrame, frame.cols, frame.rows) ||
+			    cudaMemcpy2D(deviceFrame.data, deviceFrame.pitch, frame.data, frame.step[0],
+					 (size_t)frame.cols * 4, frame.rows, cudaMemcpyHostToDevice) != cudaSuccess) {
+				freeDeviceFrame(deviceFrame);
+				break;
+			}
+			deviceFrames.push_back(deviceFrame);
+		}
+	}
+
+	// Filter defaults: contour filter 0.05, temporal smoothing 0.7 (threshold 0.5), smooth contour 0.5
+	MaskPostprocessParams maskParams;
+	maskParams.contourFilter = 0.05f;
+	maskParams.temporalSmoothFactor = 0.7f;
+	maskParams.smoothKernel = 9;
+
+	std::vector<double> frameMs;
+	cv::Mat firstMask; // model output of the first measured frame, for the golden mask
+	bool failed = deviceFrames.size() != (options.device ? frames.size() : 0);
+	const auto runStart = std::chrono::steady_clock::now();
+	auto measuredStart = runStart;
+	for (int i = 0; i < options.warmup + options.frames && !failed; i++) {
+		if (i == options.warmup) {
+			tf->stats.reset();
+			measuredStart = std::chrono::steady_clock::now();
+		}
+		const size_t index = (size_t)i % frames.size();
+		const auto frameStart = std::chrono::steady_clock::now();
+
+		cv::Mat output;
+		try {
+			failed = options.device ? !runFilterModelInference(tf.get(), deviceFrames[index], output)
+						: !runFilterModelInference(tf.get(), frames[index], output);
+		} catch (const std::exception &e) {
+			obs_log(LOG_ERROR, "Inference failed: %s", e.what());
+			failed = true;
+		}
+		if (!failed && i == options.warmup) {
+			output.copyTo(firstMask);
+		}
+		if (!failed && benchModel.outputsMask) {
+			StageTimer timer(tf->stats, PipelineStats::STAGE_MASK);
+			const cv::Mat mask = 255 - output;
+			failed = !tf->maskPostprocessor.process(mask.data, mask.cols, mask.rows, mask.step[0],
+								size.width, size.height, maskParams) ||
+				 cudaStreamSynchronize(tf->cudaPreprocessor.stream()) != cudaSuccess;
+		}
+
+		const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - frameStart;
+		if (i >= options.warmup) {
+			frameMs.push_back(elapsed.count());
+			tf->stats.countFrame();
+		}
+		peakMB = std::max(peakMB, usedDeviceMemoryMB());
+	}
+	const std::chrono::duration<double> measuredSeconds = std::chrono::steady_clock::now() - measuredStart;
+
+	for (DeviceFrame &deviceFrame : deviceFrames) {
+		freeDeviceFrame(deviceFrame);
+	}
+	if (failed) {
+		return failRun("inference_failed");
+	}
+
+	const LatencySummary frame = summarize(frameMs);
+	json << ", \"status\": \"ok\", \"frames\": " << frameMs.size()
+	     << ", \"fps\": " << (measuredSeconds.count() > 0.0 ? frameMs.size() / measuredSeconds.count() : 0.0)
+	     << ", \"sessionMs\": " << sessionMs.count() << ", \"peakVramMB\": " << (peakMB - baselineMB)
+	     << ", \"frame\": " << latencyJson(frame.meanMs, frame.p50Ms, frame.p99Ms, frame.maxMs)
+	     << ", \"stages\": {";
+	const PipelineStats::Stage stages[] = {PipelineStats::STAGE_PREPROCESS, PipelineStats::STAGE_INFERENCE,
+					       PipelineStats::STAGE_POSTPROCESS, PipelineStats::STAGE_MASK};
+	bool first = true;
+	for (PipelineStats::Stage stage : stages) {
+		const PipelineStats::StageSummary latency = tf->stats.stageSummary(stage);
+		if (latency.count == 0) {
+			continue;
+		}
+		std::string name = PipelineStats::stageName(stage);
+		std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+		json << (first ? "" : ", ") << "\"" << name
+		     << "\": " << latencyJson(latency.meanMs, latency.p50Ms, latency.p99Ms, latency.maxMs);
+		first = false;
+	}
+	json << "}";
+
+	const size_t vramMB = peakMB - baselineMB;
+	if (!options.recordBudgets.empty()) {
+		std::ofstream file(options.recordBudgets, std::ios::app);
+		char line[64];
+		snprintf(line, sizeof(line), " %.1f %zu", frame.p99Ms * kBudgetLatencyMargin,
+			 (size_t)std::ceil(vramMB * kBudgetVramMargin));
+		file << (int)gpuInfo.architecture << " " << key << line << "\n";
+	}
+	auto budget = checks.budgets.find(key);
+	if (budget != checks.budgets.end()) {
+		const bool pass = frame.p99Ms <= budget->second.p99Ms && vramMB <= budget->second.peakVramMB;
+		json << ", \"budget\": {\"p99Ms\": " << budget->second.p99Ms
+		     << ", \"peakVramMB\": " << budget->second.peakVramMB << ", \"pass\": " << (pass ? "true" : "false")
+		     << "}";
+		if (!pass) {
+			fprintf(stderr, "OVER BUDGET: %s: p99 %.2f ms (budget %.2f), peak VRAM %zu MB (budget %zu)\n",
+				key.c_str(), frame.p99Ms, budget->second.p99Ms, vramMB, budget->second.peakVramMB);
+			checks.failures++;
+		}
+	}
+
+	if (!options.golden.empty() && benchModel.outputsMask && firstMask.type() == CV_8UC1) {
+		const std::string model = std::filesystem::path(benchModel.path).stem().string();
+		const std::string path = (std::filesystem::path(options.golden) /
+					  (model + "_" + std::to_string(size.width) + "x" +
+					   std::to_string(size.height) + ".pgm"))
+						 .string();
+		cv::Mat golden;
+		if (options.writeGolden) {
+			std::error_code error;
+			std::filesystem::create_directories(options.golden, error);
+			if (!writePgm(path, firstMask)) {
+				fprintf(stderr, "Failed to write the golden mask %s\n", path.c_str());
+			}
+		} else if (!readPgm(path, golden)) {
+			json << ", \"golden\": \"missing\"";
+			fprintf(stderr, "MISSING GOLDEN MASK: %s: %s can't be read\n", key.c_str(), path.c_str());
+			checks.failures++;
+		} else if (golden.size() != firstMask.size()) {
+			json << ", \"golden\": \"size_mismatch\"";
+			fprintf(stderr, "MASK SIZE MISMATCH: %s: %dx%d mask, %dx%d golden mask %s\n", key.c_str(),
+				firstMask.cols, firstMask.rows, golden.cols, golden.rows, path.c_str());
+			checks.failures++;
+		} else {
+			cv::Mat difference;
+			cv::absdiff(firstMask, golden, difference);
+			const double meanAbsDiff = cv::mean(difference)[0];
+			const cv::Mat mask = firstMask >= 128;
+			const cv::Mat reference = golden >= 128;
+			const int unionCount = cv::countNonZero(mask | reference);
+			const double iou =
+				unionCount > 0 ? (double)cv::countNonZero(mask & reference) / unionCount : 1.0;
+			const bool pass = meanAbsDiff <= options.maskTolerance && iou >= kMinGoldenIou;
+			char result[128];
+			snprintf(result, sizeof(result), "{\"meanAbsDiff\": %.3f, \"iou\": %.4f, \"pass\": %s}",
+				 meanAbsDiff, iou, pass ? "true" : "false");
+			json << ", \"golden\": " << result;
+			if (!pass) {
+				fprintf(stderr, "MASK MISMATCH: %s: mean difference %.2f (tolerance %.2f), IoU %.4f\n",
+					key.c_str(), meanAbsDiff, options.maskTolerance, iou);
+				checks.failures++;
+			}
+		}
+	}
+	json << "}";
+	return json.str();
+}
+
+int main(int argc, char **argv)
+{
+	BenchOptions options;
+	if (!parseOptions(argc, argv, options)) {
+		printUsage();
+		return 2;
+	}
+	benchSetDataPath(options.dataPath);
+	benchSetVerbose(options.verbose);
+
+	GpuInfo gpuInfo;
+	if (!detectGpu(gpuInfo, options.gpu)) {
+		fprintf(stderr, "No NVIDIA GPU %d found\n", options.gpu);
+		return 1;
+	}
+	cudaSetDevice(options.gpu);
+	ort_env_init();
+	if (!getOrtEnv()) {
+		fprintf(stderr, "Failed to create the ONNX Runtime environment\n");
+		return 1;
+	}
+
+	BenchChecks checks;
+	if (!options.budgets.empty()) {
+		if (!loadBudgets(options.budgets, gpuInfo.architecture, checks.budgets)) {
+			fprintf(stderr, "Failed to read the budgets from %s\n", options.budgets.c_str());
+			return 1;
+		}
+		fprintf(stderr, "%zu budgets for %s\n", checks.budgets.size(),
+			gpuArchitectureName(gpuInfo.architecture));
+		if (checks.budgets.empty()) {
+			fprintf(stderr, "No budgets for %s in %s, nothing to check\n",
+				gpuArchitectureName(gpuInfo.architecture), options.budgets.c_str());
+			return kExitNoBudgets;
+		}
+	}
+
+	printf("{\n  \"gpu\": {\"device\": %d, \"name\": \"%s\", \"architecture\": \"%s\", \"vramMB\": %zu},\n"
+	       "  \"runs\": [",
+	       gpuInfo.deviceId, gpuInfo.name.c_str(), gpuArchitectureName(gpuInfo.architecture),
+	       gpuInfo.totalMemoryMB);
+	bool firstRun = true;
+	for (size_t sizeIndex = 0; sizeIndex < options.sizes.size(); sizeIndex++) {
+		const cv::Size &size = options.sizes[sizeIndex];
+		std::vector<cv::Mat> frames;
+		if (!options.input.empty() && sizeIndex == 0) {
+			if (!readRawFrames(options.input, size, frames)) {
+				fprintf(stderr, "Failed to read %dx%d BGRA frames from %s\n", size.width, size.height,
+					options.input.c_str());
+				return 1;
+			}
+		} else {
+			frames = syntheticFrames(size);
+		}
+
+		for (const BenchModel &benchModel : kModels) {
+			const std::string path = benchModel.path;
+			const auto selected = [&path](const std::string &name) {
+				return path.find(name) != std::string::npos;
+			};
+			if (!options.models.empty() &&
+			    std::none_of(options.models.begin(), options.models.end(), selected)) {
+				continue;
+			}
+			if (!options.calibrationInputs.empty() &&
+			    !writeCalibrationInputs(options, gpuInfo, benchModel, frames)) {
+				fprintf(stderr, "%s: failed to write the calibration inputs\n", benchModel.path);
+			}
+			const bool tiled = runsTiled(options, benchModel);
+			for (const std::string &provider : options.providers) {
+				for (const std::string &precision : options.precisions) {
+					// INT8 is TensorRT only; CUDA FP16 runs the model's FP16 variant
+					if (provider != USEGPU_TENSORRT && precision == PRECISION_INT8) {
+						continue;
+					}
+					// --budgets: only the configurations it has budgets for
+					if (!options.budgets.empty() &&
+					    !checks.budgets.count(
+						    budgetKey(options, benchModel, provider, precision, size, tiled))) {
+						continue;
+					}
+					fprintf(stderr, "%s, %s %s, %dx%d\n", benchModel.path, provider.c_str(),
+						precision.c_str(), size.width, size.height);
+					const std::string run =
+						runBenchmark(options, gpuInfo, benchModel, provider, precision, frames,
+							     checks);
+					printf("%s\n    %s", firstRun ? "" : ",", run.c_str());
+					fflush(stdout);
+					firstRun = false;
+				}
+			}
+		}
+	}
+	printf("\n  ],\n  \"failures\": %d\n}\n", checks.failures);
+
+	ort_env_release();
+	if (checks.failures > 0) {
+		fprintf(stderr, "%d runs over budget or off their golden masks\n", checks.failures);
+		return 3;
+	}
+	return 0;
+}
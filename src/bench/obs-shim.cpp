@@ -0,0 +1,64 @@
+#include "obs-shim.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
+#include <obs-module.h>
+
+static std::string dataPath = "data";
+static bool verboseLog = false;
+
+void benchSetDataPath(const std::string &path)
+{
+	dataPath = path;
+}
+
+void benchSetVerbose(bool verbose)
+{
+	verboseLog = verbose;
+}
+
+// Target of obs_log() (plugin-support.c). Logs go to stderr, the report to stdout.
+void blogva(int log_level, const char *format, va_list args)
+{
+	if (log_level > LOG_WARNING && !verboseLog) {
+		return;
+	}
+	vfprintf(stderr, format, args);
+	fputc('\n', stderr);
+}
+
+obs_module_t *obs_current_module(void)
+{
+	return nullptr;
+}
+
+char *obs_find_module_file(obs_module_t *module, const char *file)
+{
+	UNUSED_PARAMETER(module);
+	const std::filesystem::path path = std::filesystem::path(dataPath) / file;
+	if (!std::filesystem::exists(path)) {
+		return nullptr;
+	}
+	return strdup(path.string().c_str());
+}
+
+void bfree(void *ptr)
+{
+	free(ptr);
+}
+
+// Not an OpenGL device: CUDA-GL interop is never registered
+int gs_get_device_type(void)
+{
+	return GS_DEVICE_DIRECT3D_11;
+}
+
+void *gs_texture_get_obj(gs_texture_t *tex)
+{
+	UNUSED_PARAMETER(tex);
+	return nullptr;
+}
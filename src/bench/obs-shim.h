@@ -0,0 +1,15 @@
+#ifndef OBS_SHIM_H
+#define OBS_SHIM_H
+
+#include <string>
+
+// Stand-ins for the libobs functions the model and CUDA pipeline sources call,
+// so the benchmark runs without OBS (see obs-shim.cpp).
+
+// Directory obs_module_file() resolves against (the plugin's data directory)
+void benchSetDataPath(const std::string &path);
+
+// Print obs_log() messages below LOG_WARNING too
+void benchSetVerbose(bool verbose);
+
+#endif /* OBS_SHIM_H */
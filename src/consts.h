@@ -17,8 +17,29 @@ const char *const MODEL_RMBG = "models/bria_rmbg_1_4_qint8.onnx";
 const char *const USEGPU_CUDA = "cuda";
 const char *const USEGPU_TENSORRT = "tensorrt";
 
+const char *const PRECISION_AUTO = "auto";
+const char *const PRECISION_FP32 = "fp32";
+const char *const PRECISION_FP16 = "fp16";
+const char *const PRECISION_INT8 = "int8";
+
+const char *const SCHEDULING_PRIORITY_HIGH = "high";
+const char *const SCHEDULING_PRIORITY_NORMAL = "normal";
+const char *const SCHEDULING_PRIORITY_LOW = "low";
+
+// gpu_device setting: a CUDA device index, or the least loaded GPU
+const int GPU_DEVICE_AUTO = -1;
+
+// inference_resolution setting of models with dynamic input shapes: a percentage
+// of the source size (at most 100), or a short edge in pixels (never above the source)
+const int INFERENCE_RESOLUTION_SOURCE = 100;
+const int INFERENCE_RESOLUTIONS[] = {100, 75, 50, 25, 1080, 720, 540, 360};
+
+const char *const BLUR_MODE_KAWASE = "kawase";
+const char *const BLUR_MODE_DUAL_KAWASE = "dual_kawase";
+
 const char *const EFFECT_PATH = "effects/mask_alpha_filter.effect";
 const char *const KAWASE_BLUR_EFFECT_PATH = "effects/kawase_blur.effect";
+const char *const DUAL_KAWASE_BLUR_EFFECT_PATH = "effects/dual_kawase_blur.effect";
 const char *const BLEND_EFFECT_PATH = "effects/blend_images.effect";
 
 const char *const PLUGIN_INFO_TEMPLATE =
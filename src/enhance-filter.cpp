@@ -16,19 +16,27 @@
 #include "consts.h"
 #include "obs-utils/obs-utils.h"
 #include "ort-utils/ort-session-utils.h"
-#include "models/ModelTBEFN.h"
-#include "models/ModelZeroDCE.h"
-#include "models/ModelURetinex.h"
+#include "ort-utils/async-inference-queue.h"
+#include "ort-utils/enhance-stage.h"
 #include "update-checker/update-checker.h"
 
 struct enhance_filter : public filter_data, public std::enable_shared_from_this<enhance_filter> {
-	cv::Mat outputBGRA;
+	// Inference runs on the queue's worker thread; video_tick only pushes frames
+	AsyncInferenceQueue asyncQueue;
+
+	// Enhancement output: the worker publishes, video_render uploads it into its texture
+	EnhanceStage enhanceStage;
+
 	gs_effect_t *blendEffect;
 	float blendFactor;
 
 	std::mutex modelMutex;
 
-	~enhance_filter() { obs_log(LOG_INFO, "Enhance filter destructor called"); }
+	~enhance_filter()
+	{
+		asyncQueue.stop();
+		obs_log(LOG_INFO, "Enhance filter destructor called");
+	}
 };
 
 const char *enhance_filter_getname(void *unused)
@@ -39,7 +47,6 @@ const char *enhance_filter_getname(void *unused)
 
 obs_properties_t *enhance_filter_properties(void *data)
 {
-	UNUSED_PARAMETER(data);
 	obs_properties_t *props = obs_properties_create();
 	obs_properties_add_float_slider(props, "blend", obs_module_text("EffectStrengh"), 0.0, 1.0, 0.05);
 	obs_properties_add_int_slider(props, "numThreads", obs_module_text("NumThreads"), 0, 8, 1);
@@ -54,6 +61,13 @@ obs_properties_t *enhance_filter_properties(void *data)
 							    OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_STRING);
 	obs_property_list_add_string(p_use_gpu, obs_module_text("GPUCUDA"), USEGPU_CUDA);
 	obs_property_list_add_string(p_use_gpu, obs_module_text("TENSORRT"), USEGPU_TENSORRT);
+	obs_property_t *p_precision = obs_properties_add_list(props, "precision", obs_module_text("Precision"),
+							      OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_STRING);
+	obs_property_list_add_string(p_precision, obs_module_text("PrecisionAuto"), PRECISION_AUTO);
+	obs_property_list_add_string(p_precision, obs_module_text("PrecisionFP32"), PRECISION_FP32);
+	obs_property_list_add_string(p_precision, obs_module_text("PrecisionFP16"), PRECISION_FP16);
+	obs_property_list_add_string(p_precision, obs_module_text("PrecisionINT8"), PRECISION_INT8);
+	addGpuDeviceProperty(props);
 
 	// Add a informative text about the plugin
 	// replace the placeholder with the current version using std::regex_replace
@@ -65,6 +79,19 @@ obs_properties_t *enhance_filter_properties(void *data)
 	}
 	obs_properties_add_text(props, "info", basic_info.c_str(), OBS_TEXT_INFO);
 
+	/* Per-stage latencies and frame counters of the running filter (read-only) */
+	auto *ptr = static_cast<std::shared_ptr<enhance_filter> *>(data);
+	if (ptr && *ptr) {
+		const std::string stats = (*ptr)->stats.summary();
+		obs_properties_add_text(props, "pipeline_stats", stats.c_str(), OBS_TEXT_INFO);
+		/* The session was stepped down or its TensorRT workspace shrunk to fit the free VRAM */
+		const std::string budget = (*ptr)->sessionBuilder.budgetDecision();
+		if (!budget.empty()) {
+			const std::string text = std::string(obs_module_text("VramBudget")) + ": " + budget;
+			obs_properties_add_text(props, "vram_budget", text.c_str(), OBS_TEXT_INFO);
+		}
+	}
+
 	return props;
 }
 
@@ -74,6 +101,8 @@ void enhance_filter_defaults(obs_data_t *settings)
 	obs_data_set_default_int(settings, "numThreads", 1);
 	obs_data_set_default_string(settings, "model_select", MODEL_ENHANCE_TBEFN);
 	obs_data_set_default_string(settings, "useGPU", USEGPU_CUDA);
+	obs_data_set_default_string(settings, "precision", PRECISION_AUTO);
+	obs_data_set_default_int(settings, "gpu_device", 0);
 }
 
 void enhance_filter_activate(void *data)
@@ -117,28 +146,19 @@ void enhance_filter_update(void *data, obs_data_t *settings)
 	}
 
 	tf->blendFactor = (float)obs_data_get_double(settings, "blend");
-	const uint32_t newNumThreads = (uint32_t)obs_data_get_int(settings, "numThreads");
-	const std::string newModel = obs_data_get_string(settings, "model_select");
-	const std::string newUseGpu = obs_data_get_string(settings, "useGPU");
-
-	if (tf->modelSelection.empty() || tf->modelSelection != newModel || tf->useGPU != newUseGpu ||
-	    tf->numThreads != newNumThreads) {
-		// Lock modelMutex to prevent race condition with video_tick
-		std::unique_lock<std::mutex> lock(tf->modelMutex);
-
-		tf->numThreads = newNumThreads;
-		tf->modelSelection = newModel;
-		if (tf->modelSelection == MODEL_ENHANCE_TBEFN) {
-			tf->model.reset(new ModelTBEFN);
-		} else if (tf->modelSelection == MODEL_ENHANCE_ZERODCE) {
-			tf->model.reset(new ModelZeroDCE);
-		} else if (tf->modelSelection == MODEL_ENHANCE_URETINEX) {
-			tf->model.reset(new ModelURetinex);
-		} else {
-			tf->model.reset(new ModelBCHW);
-		}
-		tf->useGPU = newUseGpu;
-		createOrtSession(tf.get());
+
+	// The session is built in the background while the current one keeps
+	// enhancing frames; video_tick swaps it in when ready
+	SessionSettings session;
+	session.modelSelection = obs_data_get_string(settings, "model_select");
+	session.useGPU = obs_data_get_string(settings, "useGPU");
+	session.numThreads = (uint32_t)obs_data_get_int(settings, "numThreads");
+	session.precision = obs_data_get_string(settings, "precision");
+	session.gpuDevice = (int)obs_data_get_int(settings, "gpu_device");
+	session.resolveDevice(tf->requestedSession);
+	if (session != tf->requestedSession || tf->sessionBuilder.failed()) {
+		tf->requestedSession = session;
+		tf->sessionBuilder.request(tf.get(), session, 0, 0);
 	}
 
 	if (tf->blendEffect == nullptr) {
@@ -161,8 +181,10 @@ void *enhance_filter_create(obs_data_t *settings, obs_source_t *source)
 		instance->source = source;
 		instance->texrender = gs_texrender_create(GS_BGRA, GS_ZS_NONE);
 
-		std::string instanceName{"enhance-portrait-inference"};
-		instance->env.reset(new Ort::Env(OrtLoggingLevel::ORT_LOGGING_LEVEL_ERROR, instanceName.c_str()));
+		// The render GPU, from the graphics thread (frames are captured there)
+		obs_enter_graphics();
+		renderCudaDevice();
+		obs_leave_graphics();
 
 		// Create pointer to shared_ptr for the update call
 		auto ptr = new std::shared_ptr<enhance_filter>(instance);
@@ -186,12 +208,14 @@ void enhance_filter_destroy(void *data)
 			// Mark as disabled to prevent further processing
 			(*ptr)->isDisabled = true;
 
+			// Stop async queue first — joins worker thread before any cleanup
+			(*ptr)->asyncQueue.stop();
+
 			// Perform cleanup
 			obs_enter_graphics();
+			(*ptr)->enhanceStage.releaseTexture();
 			gs_texrender_destroy((*ptr)->texrender);
-			if ((*ptr)->stagesurface) {
-				gs_stagesurface_destroy((*ptr)->stagesurface);
-			}
+			(*ptr)->stageRing.release();
 			gs_effect_destroy((*ptr)->blendEffect);
 			obs_leave_graphics();
 		}
@@ -201,6 +225,24 @@ void enhance_filter_destroy(void *data)
 	}
 }
 
+static void startInferenceQueue(struct enhance_filter *tf)
+{
+	auto *raw_tf = tf;
+	tf->asyncQueue.start(
+		[raw_tf](const InputFrame &input, cv::Mat &) -> bool {
+			std::unique_lock<std::mutex> lock(raw_tf->modelMutex);
+			// The stage publishes the enhanced frame itself, the queue has no output
+			const bool enhanced = input.onDevice ? raw_tf->enhanceStage.process(raw_tf, input.device)
+							     : raw_tf->enhanceStage.process(raw_tf, input.bgra);
+			if (!enhanced) {
+				return false;
+			}
+			raw_tf->stats.countFrame();
+			return true;
+		},
+		tf->gpuInfo.defaultBuffering, tf->deviceId);
+}
+
 void enhance_filter_video_tick(void *data, float seconds)
 {
 	UNUSED_PARAMETER(seconds);
@@ -223,42 +265,38 @@ void enhance_filter_video_tick(void *data, float seconds)
 		return;
 	}
 
-	if (tf->inputBGRA.empty()) {
-		return;
-	}
-
-	// Get input image from source rendering pipeline
-	cv::Mat imageBGRA;
-	{
-		std::unique_lock<std::mutex> lock(tf->inputBGRALock, std::try_to_lock);
-		if (!lock.owns_lock()) {
-			return;
-		}
-		imageBGRA = tf->inputBGRA.clone();
-	}
-
-	cv::Mat outputImage;
-	{
-		std::unique_lock<std::mutex> lock(tf->modelMutex);
-		try {
-			if (!runFilterModelInference(tf.get(), imageBGRA, outputImage)) {
-				return;
+	tf->stats.logIfDue(obs_source_get_name(tf->source));
+
+	// Swap in a session the builder finished; the worker is stopped meanwhile
+	if (tf->sessionBuilder.ready()) {
+		tf->asyncQueue.stop();
+		{
+			std::unique_lock<std::mutex> lock(tf->modelMutex);
+			const int previousDevice = tf->deviceId;
+			if (tf->sessionBuilder.adopt(tf.get()) == OBS_BGREMOVAL_ORT_SESSION_SUCCESS) {
+				obs_log(LOG_INFO, "Session ready: %s (%s)", tf->modelSelection.c_str(),
+					tf->useGPU.c_str());
+				if (tf->deviceId != previousDevice) {
+					logDevicePlacement(tf.get());
+				}
 			}
-		} catch (const std::exception &e) {
-			obs_log(LOG_ERROR, "Exception caught: %s", e.what());
-			return;
+		}
+		tf->stats.reset();
+		if (tf->session) {
+			startInferenceQueue(tf.get());
 		}
 	}
 
-	// Put output image back to source rendering pipeline
-	{
-		std::unique_lock<std::mutex> lock(tf->outputLock, std::try_to_lock);
-		if (!lock.owns_lock()) {
-			return;
-		}
+	if (!tf->asyncQueue.isRunning()) {
+		return;
+	}
 
-		// convert to RGBA
-		cv::cvtColor(outputImage, tf->outputBGRA, cv::COLOR_BGR2RGBA);
+	// Hand the new source frame to the worker. The acquired frame is owned by
+	// this thread until the next acquire; the queue copies it into a ring slot
+	// (on the filter's GPU).
+	CudaDeviceScope device(tf->deviceId);
+	if (tf->inputFrames.acquire() && !tf->inputFrames.front().empty()) {
+		tf->asyncQueue.pushFrame(localInputFrame(tf.get(), tf->inputFrames.front()));
 	}
 }
 
@@ -285,23 +323,17 @@ void enhance_filter_video_render(void *data, gs_effect_t *_effect)
 		return;
 	}
 
-	// Engage filter
-	if (!obs_source_process_filter_begin(tf->source, GS_RGBA, OBS_ALLOW_DIRECT_RENDERING)) {
+	// Get output from neural network into texture
+	gs_texture_t *outputTexture = tf->enhanceStage.updateTexture(tf->stats);
+	if (!outputTexture) {
 		obs_source_skip_video_filter(tf->source);
 		return;
 	}
 
-	// Get output from neural network into texture
-	gs_texture_t *outputTexture = nullptr;
-	{
-		std::lock_guard<std::mutex> lock(tf->outputLock);
-		outputTexture = gs_texture_create(tf->outputBGRA.cols, tf->outputBGRA.rows, GS_BGRA, 1,
-						  (const uint8_t **)&tf->outputBGRA.data, 0);
-		if (!outputTexture) {
-			obs_log(LOG_ERROR, "Failed to create output texture");
-			obs_source_skip_video_filter(tf->source);
-			return;
-		}
+	// Engage filter
+	if (!obs_source_process_filter_begin(tf->source, GS_RGBA, OBS_ALLOW_DIRECT_RENDERING)) {
+		obs_source_skip_video_filter(tf->source);
+		return;
 	}
 
 	gs_eparam_t *blendimage = gs_effect_get_param_by_name(tf->blendEffect, "blendimage");
@@ -321,6 +353,4 @@ void enhance_filter_video_render(void *data, gs_effect_t *_effect)
 	obs_source_process_filter_tech_end(tf->source, tf->blendEffect, 0, 0, "Draw");
 
 	gs_blend_state_pop();
-
-	gs_texture_destroy(outputTexture);
 }
@@ -2,8 +2,11 @@
 #define MODEL_H
 
 #include <onnxruntime_cxx_api.h>
+#include "consts.h"
 #include "plugin-support.h"
 #include "ort-utils/cuda-preprocess.h"
+#include "ort-utils/cuda-image-postprocess.h"
+#include "ort-utils/simd-kernels.h"
 
 #ifdef _WIN32
 #include <wchar.h>
@@ -11,6 +14,8 @@
 
 #include <opencv2/imgproc.hpp>
 #include <algorithm>
+#include <cmath>
+#include <utility>
 
 template<typename T> T vectorProduct(const std::vector<T> &v)
 {
@@ -24,8 +29,30 @@ template<typename T> T vectorProduct(const std::vector<T> &v)
 	return product;
 }
 
+// Size a dynamic-shape model infers a width x height source at, for an
+// inference_resolution setting (INFERENCE_RESOLUTIONS)
+static cv::Size inferenceInputSize(int width, int height, int resolution)
+{
+	double scale = 1.0;
+	if (resolution > INFERENCE_RESOLUTION_SOURCE) {
+		scale = std::min(1.0, (double)resolution / std::max(1, std::min(width, height)));
+	} else if (resolution > 0) {
+		scale = resolution / 100.0;
+	}
+	return cv::Size(std::max(1, (int)std::lround(width * scale)), std::max(1, (int)std::lround(height * scale)));
+}
+
 static void hwc_to_chw(cv::InputArray src, cv::OutputArray dst)
 {
+	const cv::Mat srcMat = src.getMat();
+	if (srcMat.depth() == CV_32F && srcMat.isContinuous()) {
+		// One pass into dst, reusing its allocation while the size matches
+		const int pixels = (int)srcMat.total();
+		dst.create(1, pixels * srcMat.channels(), CV_32FC1);
+		interleavedToPlanar(srcMat.ptr<float>(), dst.getMat().ptr<float>(), pixels, srcMat.channels());
+		return;
+	}
+
 	std::vector<cv::Mat> channels;
 	cv::split(src, channels);
 
@@ -52,21 +79,11 @@ static void chw_to_hwc_32f(cv::InputArray src, cv::OutputArray dst)
 	const int channels = srcMat.channels();
 	const int height = srcMat.rows;
 	const int width = srcMat.cols;
-	const int dtype = srcMat.type();
-	assert(dtype == CV_32F);
-	const int channelStride = height * width;
-
-	// Flatten to a vector of channels
-	cv::Mat flatMat = srcMat.reshape(1, 1);
-
-	std::vector<cv::Mat> channelsVec(channels);
-	// Split the vector into channels
-	for (int i = 0; i < channels; i++) {
-		channelsVec[i] =
-			cv::Mat(height, width, CV_MAKE_TYPE(dtype, 1), flatMat.ptr<float>(0) + i * channelStride);
-	}
+	assert(srcMat.depth() == CV_32F && srcMat.isContinuous());
 
-	cv::merge(channelsVec, dst);
+	// One pass into dst, reusing its allocation while the size matches
+	dst.create(height, width, CV_MAKE_TYPE(CV_32F, channels));
+	planarToInterleaved(srcMat.ptr<float>(), dst.getMat().ptr<float>(), height * width, channels);
 }
 
 /**
@@ -83,8 +100,59 @@ static void chw_to_hwc_32f(cv::InputArray src, cv::OutputArray dst)
   * with different pre-post processing behavior (like BCHW instead of BHWC or different ranges).
 */
 class Model {
-private:
-	/* data */
+protected:
+	// Source of setSourceSize(), 0 while unknown
+	int sourceWidth_ = 0;
+	int sourceHeight_ = 0;
+	int inferenceResolution_ = INFERENCE_RESOLUTION_SOURCE;
+
+	// Choose the input size for the source and inference resolution. Returns
+	// true if the tensor shapes changed. Default: the model's input size is fixed.
+	virtual bool resizeInput() { return false; }
+
+	// (input name, shape) of every input with a TensorRT profile
+	using ProfileShapes = std::vector<std::pair<std::string, std::vector<int64_t>>>;
+
+	// Profile shapes of a dynamic-shape model inferring at size. Default: none.
+	virtual ProfileShapes profileShapesAt(const cv::Size &) const { return {}; }
+
+	static std::string formatProfileShapes(const ProfileShapes &shapes)
+	{
+		std::string s;
+		for (const auto &[name, dims] : shapes) {
+			s += (s.empty() ? "" : ",") + name + ":";
+			for (size_t i = 0; i < dims.size(); i++) {
+				s += (i ? "x" : "") + std::to_string(dims[i]);
+			}
+		}
+		return s;
+	}
+
+	// Element-wise min or max of the profile shapes over every inference
+	// resolution of the source (the opt shapes while the source is unknown)
+	std::string profileShapesRange(bool max) const
+	{
+		ProfileShapes range;
+		if (sourceWidth_ > 0 && sourceHeight_ > 0) {
+			for (int resolution : INFERENCE_RESOLUTIONS) {
+				const ProfileShapes shapes =
+					profileShapesAt(inferenceInputSize(sourceWidth_, sourceHeight_, resolution));
+				if (range.empty()) {
+					range = shapes;
+					continue;
+				}
+				for (size_t i = 0; i < range.size() && i < shapes.size(); i++) {
+					auto &dims = range[i].second;
+					for (size_t d = 0; d < dims.size() && d < shapes[i].second.size(); d++) {
+						dims[d] = max ? std::max(dims[d], shapes[i].second[d])
+							      : std::min(dims[d], shapes[i].second[d]);
+					}
+				}
+			}
+		}
+		return range.empty() ? getTrtProfileShapes() : formatProfileShapes(range);
+	}
+
 public:
 	Model(/* args */) {};
 	virtual ~Model() {};
@@ -121,7 +189,7 @@ public:
 #endif
 	}
 
-	virtual void populateInputOutputNames(const std::unique_ptr<Ort::Session> &session,
+	virtual void populateInputOutputNames(const std::shared_ptr<Ort::Session> &session,
 					      std::vector<Ort::AllocatedStringPtr> &inputNames,
 					      std::vector<Ort::AllocatedStringPtr> &outputNames)
 	{
@@ -133,7 +201,7 @@ public:
 		outputNames.push_back(session->GetOutputNameAllocated(0, allocator));
 	}
 
-	virtual bool populateInputOutputShapes(const std::unique_ptr<Ort::Session> &session,
+	virtual bool populateInputOutputShapes(const std::shared_ptr<Ort::Session> &session,
 					       std::vector<std::vector<int64_t>> &inputDims,
 					       std::vector<std::vector<int64_t>> &outputDims)
 	{
@@ -228,11 +296,42 @@ public:
 	// When true, the alpha output is used directly as the mask without binarization.
 	virtual bool outputsAlphaMatte() const { return false; }
 
-	// Return TensorRT optimization profile shapes string for all inputs.
-	// Format: "name:d0xd1x...,name:d0xd1x..."  (min=opt=max since shapes are fixed).
+	// Adapt the input resolution to the source frame size, scaled by the
+	// inference_resolution setting (models with dynamic input shapes). Returns
+	// true if the tensor shapes changed: the session and its tensors must then be
+	// recreated (createOrtSession).
+	bool setSourceSize(int width, int height, int resolution = INFERENCE_RESOLUTION_SOURCE)
+	{
+		sourceWidth_ = width;
+		sourceHeight_ = height;
+		inferenceResolution_ = resolution;
+		return resizeInput();
+	}
+
+	int sourceWidth() const { return sourceWidth_; }
+	int sourceHeight() const { return sourceHeight_; }
+	int inferenceResolution() const { return inferenceResolution_; }
+
+	// Input size chosen by setSourceSize(), empty for fixed-size models
+	virtual cv::Size dynamicInputSize() const { return cv::Size(); }
+
+	// Whether frames larger than the input may be split into overlapping tiles
+	// at the input size (tiled inference). Only for single-input/output models
+	// without temporal state whose output is meaningful per image region.
+	virtual bool supportsTiling() const { return false; }
+
+	// Return TensorRT optimization profile shapes string for all inputs: the
+	// opt shapes, those of the current input size.
+	// Format: "name:d0xd1x...,name:d0xd1x..."
 	// Default returns empty string (no explicit profiles).
 	virtual std::string getTrtProfileShapes() const { return ""; }
 
+	// Range of the profile (same format): the shapes of every inference
+	// resolution of the source, so one engine serves all of them.
+	// min = opt = max for fixed shapes.
+	std::string getTrtProfileMinShapes() const { return profileShapesRange(false); }
+	std::string getTrtProfileMaxShapes() const { return profileShapesRange(true); }
+
 	// Get CUDA preprocessing parameters for this model.
 	// Default: standard /255 normalization in HWC format.
 	virtual PreprocessParams getPreprocessParams() const
@@ -240,10 +339,37 @@ public:
 		return PreprocessParams{0.0f, 0.0f, 0.0f, 255.0f, 255.0f, 255.0f, false};
 	}
 
+	// Layout and range of output 0 for image-to-image models (enhance), read by
+	// the GPU output path instead of postprocessOutput().
+	// Default: interleaved HWC in [0,1].
+	virtual ImagePostprocessParams getImagePostprocessParams() const
+	{
+		return ImagePostprocessParams{false, 255.0f};
+	}
+
 	// Set model-specific extra tensor inputs (e.g., scalars for RVM, URetinex).
 	// Called after CUDA preprocessing has written the main image tensor.
 	virtual void setExtraTensorInputs(std::vector<std::vector<float>> &) {}
 
+	// Whether input i stays in host memory in IoBinding mode. Used for the small
+	// scalar inputs written by setExtraTensorInputs(); everything else is bound
+	// to device memory.
+	virtual bool keepInputOnHost(size_t) const { return false; }
+
+	// Whether keepInputOnHost() holds for any input. CUDA graph capture needs
+	// every input in device memory, so these models run without graphs.
+	virtual bool hasHostInputs() const { return false; }
+
+	// Recurrent state as (input index, output index) pairs: the output of one
+	// frame is the input of the next. The two buffer sets are swapped between
+	// the input and output bindings after every run (no state copy). Models
+	// without pairs use assignOutputToInput().
+	virtual const std::vector<std::pair<size_t, size_t>> &recurrentStatePairs() const
+	{
+		static const std::vector<std::pair<size_t, size_t>> none;
+		return none;
+	}
+
 	virtual void prepareInputToNetwork(cv::Mat &resizedImage, cv::Mat &preprocessedImage)
 	{
 		preprocessedImage = resizedImage / 255.0;
@@ -276,7 +402,7 @@ public:
 
 	virtual void assignOutputToInput(std::vector<std::vector<float>> &, std::vector<std::vector<float>> &) {}
 
-	virtual void runNetworkInference(const std::unique_ptr<Ort::Session> &session,
+	virtual void runNetworkInference(const std::shared_ptr<Ort::Session> &session,
 					 const std::vector<Ort::AllocatedStringPtr> &inputNames,
 					 const std::vector<Ort::AllocatedStringPtr> &outputNames,
 					 const std::vector<Ort::Value> &inputTensor,
@@ -301,9 +427,19 @@ public:
 		session->Run(Ort::RunOptions{nullptr}, rawInputNames.data(), inputTensor.data(), inputNames.size(),
 			     rawOutputNames.data(), outputTensor.data(), outputNames.size());
 	}
+
+	// IoBinding variant: inputs and outputs are already bound to the session
+	virtual void runNetworkInference(const std::shared_ptr<Ort::Session> &session, Ort::IoBinding &ioBinding,
+					 const Ort::RunOptions &runOptions)
+	{
+		session->Run(runOptions, ioBinding);
+	}
 };
 
 class ModelBCHW : public Model {
+private:
+	cv::Mat outputTransposed_; // postprocessOutput scratch, reused between frames
+
 public:
 	ModelBCHW(/* args */) {}
 	~ModelBCHW() {}
@@ -313,6 +449,11 @@ public:
 		return PreprocessParams{0.0f, 0.0f, 0.0f, 255.0f, 255.0f, 255.0f, true};
 	}
 
+	virtual ImagePostprocessParams getImagePostprocessParams() const
+	{
+		return ImagePostprocessParams{true, 255.0f};
+	}
+
 	virtual void prepareInputToNetwork(cv::Mat &resizedImage, cv::Mat &preprocessedImage)
 	{
 		resizedImage = resizedImage / 255.0;
@@ -321,9 +462,8 @@ public:
 
 	virtual void postprocessOutput(cv::Mat &output)
 	{
-		cv::Mat outputTransposed;
-		chw_to_hwc_32f(output, outputTransposed);
-		outputTransposed.copyTo(output);
+		chw_to_hwc_32f(output, outputTransposed_);
+		outputTransposed_.copyTo(output);
 	}
 
 	virtual void getNetworkInputSize(const std::vector<std::vector<int64_t>> &inputDims, uint32_t &inputWidth,
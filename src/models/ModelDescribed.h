@@ -0,0 +1,329 @@
+#ifndef MODELDESCRIBED_H
+#define MODELDESCRIBED_H
+
+#include <algorithm>
+#include <string>
+
+#include "Model.h"
+#include "ModelDescriptor.h"
+
+/**
+  * @brief A model defined by its ModelDescriptor instead of a subclass
+  *
+  * All bundled models but RVM (whose input size follows the source) are
+  * described models. A new model is added with a sidecar JSON or ONNX metadata,
+  * e.g. MODNet: {"mean": 127.5, "scale": 127.5, "alpha_matte": true,
+  * "dynamic_size": true, "input_name": "input"}.
+  *
+  * Precedence: built-in descriptor < ONNX metadata < sidecar JSON, so a local
+  * sidecar can correct a model file it doesn't own.
+*/
+class ModelDescribed : public Model {
+private:
+	static constexpr const char *kMetadataPrefix = "bgremoval.";
+
+	// Input size of a dynamic-size model while the source is unknown
+	static constexpr int kDefaultDynamicSize = 512;
+
+	std::string modelSelection_;
+	ModelDescriptor d_;
+	cv::Size inputSize_{kDefaultDynamicSize, kDefaultDynamicSize}; // dynamic size only
+
+	// postprocessOutput scratch, reused between frames
+	cv::Mat mask_;
+	cv::Mat transposed_;
+
+	bool bindsAllTensors() const { return d_.allTensors || !d_.recurrent.empty() || !d_.hostInputs.empty(); }
+
+	// (height, width) dimension indices of a layout
+	static std::pair<size_t, size_t> spatialDims(TensorLayout layout)
+	{
+		switch (layout) {
+		case TensorLayout::NHWC:
+			return {1, 2};
+		case TensorLayout::HWC:
+			return {0, 1};
+		default:
+			return {2, 3};
+		}
+	}
+
+	void applyMetadata(const std::shared_ptr<Ort::Session> &session)
+	{
+		const std::string prefix = kMetadataPrefix;
+		try {
+			Ort::AllocatorWithDefaultOptions allocator;
+			Ort::ModelMetadata metadata = session->GetModelMetadata();
+			for (const auto &keyPtr : metadata.GetCustomMetadataMapKeysAllocated(allocator)) {
+				const std::string key = keyPtr.get();
+				if (key.compare(0, prefix.size(), prefix) != 0) {
+					continue;
+				}
+				const std::string name = key.substr(prefix.size());
+				const std::string value =
+					metadata.LookupCustomMetadataMapAllocated(key.c_str(), allocator).get();
+				// The engine is built before the metadata can be read
+				if (name == "trt_profile_shapes" || !applyModelDescriptorValue(d_, name, value)) {
+					obs_log(LOG_WARNING, "Model metadata: ignoring %s = %s", key.c_str(),
+						value.c_str());
+				}
+			}
+		} catch (const Ort::Exception &e) {
+			obs_log(LOG_WARNING, "Unable to read the model metadata: %s", e.what());
+		}
+	}
+
+	// Dynamic size: inference size capped at maxInputSize, rounded down to sizeMultiple
+	cv::Size dynamicSizeFor(const cv::Size &size) const
+	{
+		const double scale = std::min(1.0, (double)d_.maxInputSize / std::max(size.width, size.height));
+		const int multiple = d_.sizeMultiple;
+		return cv::Size(std::max(multiple, (int)(size.width * scale) / multiple * multiple),
+				std::max(multiple, (int)(size.height * scale) / multiple * multiple));
+	}
+
+protected:
+	virtual bool resizeInput()
+	{
+		if (!d_.dynamicSize || sourceWidth_ <= 0 || sourceHeight_ <= 0) {
+			return false;
+		}
+		const cv::Size size =
+			dynamicSizeFor(inferenceInputSize(sourceWidth_, sourceHeight_, inferenceResolution_));
+		if (size == inputSize_) {
+			return false;
+		}
+		inputSize_ = size;
+		return true;
+	}
+
+	virtual ProfileShapes profileShapesAt(const cv::Size &size) const
+	{
+		if (!d_.dynamicSize || d_.inputName.empty()) {
+			return {};
+		}
+		const cv::Size input = dynamicSizeFor(size);
+		if (d_.inputLayout == TensorLayout::NHWC) {
+			return {{d_.inputName, {1, input.height, input.width, 3}}};
+		}
+		return {{d_.inputName, {1, 3, input.height, input.width}}};
+	}
+
+public:
+	explicit ModelDescribed(const std::string &modelSelection)
+		: modelSelection_(modelSelection),
+		  d_(builtinModelDescriptor(modelSelection))
+	{
+		applyModelDescriptorSidecar(d_, modelSelection_);
+	}
+	~ModelDescribed() {}
+
+	const ModelDescriptor &descriptor() const { return d_; }
+
+	virtual void populateInputOutputNames(const std::shared_ptr<Ort::Session> &session,
+					      std::vector<Ort::AllocatedStringPtr> &inputNames,
+					      std::vector<Ort::AllocatedStringPtr> &outputNames)
+	{
+		// The metadata is readable once the session exists; the sidecar then applies again over it
+		applyMetadata(session);
+		applyModelDescriptorSidecar(d_, modelSelection_);
+		// Metadata may have made the input size dynamic
+		resizeInput();
+
+		if (!bindsAllTensors()) {
+			Model::populateInputOutputNames(session, inputNames, outputNames);
+			return;
+		}
+
+		Ort::AllocatorWithDefaultOptions allocator;
+
+		inputNames.clear();
+		outputNames.clear();
+
+		for (size_t i = 0; i < session->GetInputCount(); i++) {
+			inputNames.push_back(session->GetInputNameAllocated(i, allocator));
+		}
+		for (size_t i = 0; i < session->GetOutputCount(); i++) {
+			outputNames.push_back(session->GetOutputNameAllocated(i, allocator));
+		}
+	}
+
+	virtual bool populateInputOutputShapes(const std::shared_ptr<Ort::Session> &session,
+					       std::vector<std::vector<int64_t>> &inputDims,
+					       std::vector<std::vector<int64_t>> &outputDims)
+	{
+		if (!bindsAllTensors()) {
+			if (!Model::populateInputOutputShapes(session, inputDims, outputDims)) {
+				return false;
+			}
+		} else {
+			inputDims.clear();
+			outputDims.clear();
+
+			for (size_t i = 0; i < session->GetInputCount(); i++) {
+				const Ort::TypeInfo inputTypeInfo = session->GetInputTypeInfo(i);
+				inputDims.push_back(inputTypeInfo.GetTensorTypeAndShapeInfo().GetShape());
+			}
+			for (size_t i = 0; i < session->GetOutputCount(); i++) {
+				const Ort::TypeInfo outputTypeInfo = session->GetOutputTypeInfo(i);
+				outputDims.push_back(outputTypeInfo.GetTensorTypeAndShapeInfo().GetShape());
+			}
+			// fix any -1 values (dynamic dimensions) to 1
+			for (auto *dims : {&inputDims, &outputDims}) {
+				for (auto &shape : *dims) {
+					std::replace(shape.begin(), shape.end(), (int64_t)-1, (int64_t)1);
+				}
+			}
+		}
+
+		if (d_.dynamicSize) {
+			const auto [inputH, inputW] = spatialDims(d_.inputLayout);
+			const auto [outputH, outputW] = spatialDims(d_.outputLayout);
+			if (inputDims[0].size() <= inputW || outputDims[0].size() <= outputW) {
+				return false;
+			}
+			inputDims[0].at(inputH) = inputSize_.height;
+			inputDims[0].at(inputW) = inputSize_.width;
+			outputDims[0].at(outputH) = inputSize_.height;
+			outputDims[0].at(outputW) = inputSize_.width;
+		} else if (d_.outputSizeFromInput) {
+			// fix the output width and height to the input width and height
+			const auto [inputH, inputW] = spatialDims(d_.inputLayout);
+			const auto [outputH, outputW] = spatialDims(d_.outputLayout);
+			if (inputDims[0].size() <= inputW || outputDims[0].size() <= outputW) {
+				return false;
+			}
+			outputDims[0].at(outputH) = inputDims[0].at(inputH);
+			outputDims[0].at(outputW) = inputDims[0].at(inputW);
+		}
+
+		return true;
+	}
+
+	virtual void getNetworkInputSize(const std::vector<std::vector<int64_t>> &inputDims, uint32_t &inputWidth,
+					 uint32_t &inputHeight)
+	{
+		const auto [h, w] = spatialDims(d_.inputLayout);
+		inputWidth = (int)inputDims[0][w];
+		inputHeight = (int)inputDims[0][h];
+	}
+
+	virtual bool outputsAlphaMatte() const { return d_.alphaMatte; }
+
+	virtual bool supportsTiling() const { return d_.tiling; }
+
+	virtual cv::Size dynamicInputSize() const { return d_.dynamicSize ? inputSize_ : cv::Size(); }
+
+	virtual std::string getTrtProfileShapes() const
+	{
+		const ProfileShapes shapes = profileShapesAt(inputSize_);
+		return shapes.empty() ? d_.trtProfileShapes : formatProfileShapes(shapes);
+	}
+
+	virtual PreprocessParams getPreprocessParams() const
+	{
+		// Mean and scale are in R,G,B order (after BGRA→RGB conversion)
+		return PreprocessParams{d_.mean[0],  d_.mean[1],  d_.mean[2],
+					d_.scale[0], d_.scale[1], d_.scale[2],
+					d_.inputLayout == TensorLayout::NCHW};
+	}
+
+	virtual ImagePostprocessParams getImagePostprocessParams() const
+	{
+		return ImagePostprocessParams{d_.outputLayout == TensorLayout::NCHW, d_.imageScale};
+	}
+
+	virtual void setExtraTensorInputs(std::vector<std::vector<float>> &inputTensorValues)
+	{
+		for (const auto &[index, value] : d_.hostInputs) {
+			if (index < inputTensorValues.size() && !inputTensorValues[index].empty()) {
+				std::fill(inputTensorValues[index].begin(), inputTensorValues[index].end(), value);
+			}
+		}
+	}
+
+	virtual bool keepInputOnHost(size_t i) const
+	{
+		return std::any_of(d_.hostInputs.begin(), d_.hostInputs.end(),
+				   [i](const std::pair<size_t, float> &input) { return input.first == i; });
+	}
+
+	virtual bool hasHostInputs() const { return !d_.hostInputs.empty(); }
+
+	virtual const std::vector<std::pair<size_t, size_t>> &recurrentStatePairs() const { return d_.recurrent; }
+
+	virtual void prepareInputToNetwork(cv::Mat &resizedImage, cv::Mat &preprocessedImage)
+	{
+		resizedImage = (resizedImage - cv::Scalar(d_.mean[0], d_.mean[1], d_.mean[2])) /
+			       cv::Scalar(d_.scale[0], d_.scale[1], d_.scale[2]);
+		if (d_.inputLayout == TensorLayout::NCHW) {
+			hwc_to_chw(resizedImage, preprocessedImage);
+		} else {
+			preprocessedImage = resizedImage;
+		}
+	}
+
+	virtual void loadInputToTensor(const cv::Mat &preprocessedImage, uint32_t inputWidth, uint32_t inputHeight,
+				       std::vector<std::vector<float>> &inputTensorValues)
+	{
+		if (d_.inputLayout == TensorLayout::NCHW) {
+			inputTensorValues[0].assign(preprocessedImage.begin<float>(), preprocessedImage.end<float>());
+		} else {
+			Model::loadInputToTensor(preprocessedImage, inputWidth, inputHeight, inputTensorValues);
+		}
+		setExtraTensorInputs(inputTensorValues);
+	}
+
+	virtual cv::Mat getNetworkOutput(const std::vector<std::vector<int64_t>> &outputDims,
+					 std::vector<std::vector<float>> &outputTensorValues)
+	{
+		const auto [h, w] = spatialDims(d_.outputLayout);
+		const size_t c = d_.outputLayout == TensorLayout::NCHW ? 1 : w + 1;
+		const uint32_t outputWidth = (int)outputDims[0].at(w);
+		const uint32_t outputHeight = (int)outputDims[0].at(h);
+		const int channels = d_.outputChannels > 0 ? d_.outputChannels : (int)outputDims[0].at(c);
+
+		return cv::Mat(outputHeight, outputWidth, CV_MAKE_TYPE(CV_32F, channels), outputTensorValues[0].data());
+	}
+
+	/**
+	 * Reduce output 0 to the mask (or image) in HWC: class argmax, channel
+	 * selection or CHW → HWC, then the range (min-max normalization, scale).
+	 * The result is a header over the tensor or a scratch Mat of the model.
+	 */
+	virtual void postprocessOutput(cv::Mat &output)
+	{
+		const bool planar = d_.outputLayout == TensorLayout::NCHW;
+		if (d_.outputArgmax) {
+			if (!output.isContinuous()) {
+				output = output.clone();
+			}
+			mask_.create(output.rows, output.cols, CV_32FC1);
+			// Foreground = confidence of the winning class, background = 0
+			foregroundClassMask(output.ptr<float>(), mask_.ptr<float>(), (int)output.total(),
+					    output.channels());
+			output = mask_;
+		} else if (d_.outputChannel >= 0 && d_.outputChannel < output.channels() && output.channels() > 1) {
+			if (planar) {
+				// The plane of the channel, in place
+				float *plane = output.ptr<float>() + (size_t)d_.outputChannel * output.total();
+				output = cv::Mat(output.rows, output.cols, CV_32FC1, plane);
+			} else {
+				cv::extractChannel(output, mask_, d_.outputChannel);
+				output = mask_;
+			}
+		} else if (planar && output.channels() > 1) {
+			chw_to_hwc_32f(output, transposed_);
+			output = transposed_;
+		}
+
+		if (d_.outputMinMax) {
+			cv::normalize(output, output, 1.0, 0.0, cv::NORM_MINMAX);
+		}
+		if (d_.outputScale != 1.0f) {
+			output.convertTo(output, -1, d_.outputScale);
+		}
+	}
+};
+
+#endif /* MODELDESCRIBED_H */
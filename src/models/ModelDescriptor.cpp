@@ -0,0 +1,411 @@
+#include "ModelDescriptor.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include <obs-module.h>
+
+#include "consts.h"
+#include "plugin-support.h"
+
+ModelDescriptor builtinModelDescriptor(const std::string &modelSelection)
+{
+	ModelDescriptor d;
+	if (modelSelection == MODEL_SELFIE) {
+		d.inputLayout = TensorLayout::NHWC;
+		d.outputLayout = TensorLayout::NHWC;
+		d.outputMinMax = true;
+	} else if (modelSelection == MODEL_MEDIAPIPE) {
+		d.inputLayout = TensorLayout::NHWC;
+		d.outputLayout = TensorLayout::NHWC;
+		d.outputChannels = 2;
+		d.outputChannel = 1;
+	} else if (modelSelection == MODEL_SELFIE_MULTICLASS) {
+		// 6 classes: background, hair, body-skin, face-skin, clothes, others
+		d.inputLayout = TensorLayout::NHWC;
+		d.outputLayout = TensorLayout::NHWC;
+		d.outputArgmax = true;
+	} else if (modelSelection == MODEL_PPHUMANSEG) {
+		// (pixel / 256 - 0.5) / 0.5 = (pixel - 128) / 128
+		for (int c = 0; c < 3; c++) {
+			d.mean[c] = 128.0f;
+			d.scale[c] = 128.0f;
+		}
+		d.outputLayout = TensorLayout::NHWC;
+		d.outputChannels = 2;
+		d.outputChannel = 1;
+		d.outputMinMax = true;
+	} else if (modelSelection == MODEL_SINET) {
+		const float mean[3] = {102.890434f, 111.25247f, 126.91212f};
+		const float scale[3] = {62.93292f * 255.0f, 62.82138f * 255.0f, 66.355705f * 255.0f};
+		for (int c = 0; c < 3; c++) {
+			d.mean[c] = mean[c];
+			d.scale[c] = scale[c];
+		}
+		d.outputChannel = 1;
+	} else if (modelSelection == MODEL_DEPTH_TCMONODEPTH) {
+		// No normalization: values stay in the [0, 255] range
+		for (float &scale : d.scale) {
+			scale = 1.0f;
+		}
+		d.outputMinMax = true;
+	} else if (modelSelection == MODEL_RMBG) {
+		d.outputSizeFromInput = true;
+		// Salient object matting works on image regions, so large frames are tiled
+		d.tiling = true;
+	} else if (modelSelection == MODEL_ENHANCE_TBEFN) {
+		d.outputLayout = TensorLayout::NHWC;
+		d.outputScale = 255.0f;
+	} else if (modelSelection == MODEL_ENHANCE_ZERODCE) {
+		// Already in the [0, 255] range
+		d.outputLayout = TensorLayout::HWC;
+		d.imageScale = 1.0f;
+	} else if (modelSelection == MODEL_ENHANCE_URETINEX) {
+		// Exposure ratio (input 1) is a scalar set on the host every frame
+		d.allTensors = true;
+		d.hostInputs.emplace_back(1, 5.0f);
+	}
+	return d;
+}
+
+static bool parseLayout(const std::string &value, bool allowHWC, TensorLayout &layout)
+{
+	if (value == "nhwc") {
+		layout = TensorLayout::NHWC;
+	} else if (value == "nchw") {
+		layout = TensorLayout::NCHW;
+	} else if (value == "hwc" && allowHWC) {
+		layout = TensorLayout::HWC;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+static bool parseFloat(const std::string &value, float &result)
+{
+	char *end = nullptr;
+	const float parsed = strtof(value.c_str(), &end);
+	if (value.empty() || *end != '\0') {
+		return false;
+	}
+	result = parsed;
+	return true;
+}
+
+static bool parseInt(const std::string &value, int &result)
+{
+	char *end = nullptr;
+	const long parsed = strtol(value.c_str(), &end, 10);
+	if (value.empty() || *end != '\0') {
+		return false;
+	}
+	result = (int)parsed;
+	return true;
+}
+
+static bool parseBool(const std::string &value, bool &result)
+{
+	if (value == "true" || value == "1") {
+		result = true;
+	} else if (value == "false" || value == "0") {
+		result = false;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+static std::vector<std::string> splitList(const std::string &value)
+{
+	std::vector<std::string> items;
+	std::stringstream stream(value);
+	std::string item;
+	while (std::getline(stream, item, ',')) {
+		items.push_back(item);
+	}
+	return items;
+}
+
+// One value for all channels or one per channel
+static bool parseChannels(const std::string &value, float (&channels)[3])
+{
+	const std::vector<std::string> items = splitList(value);
+	float parsed[3];
+	if (items.size() == 1 && parseFloat(items[0], parsed[0])) {
+		channels[0] = channels[1] = channels[2] = parsed[0];
+		return true;
+	}
+	if (items.size() != 3) {
+		return false;
+	}
+	for (int c = 0; c < 3; c++) {
+		if (!parseFloat(items[c], parsed[c])) {
+			return false;
+		}
+	}
+	std::copy(parsed, parsed + 3, channels);
+	return true;
+}
+
+// "a<separator>b" items of a list
+template<typename Second>
+static bool parsePairs(const std::string &value, char separator, std::vector<std::pair<size_t, Second>> &pairs)
+{
+	std::vector<std::pair<size_t, Second>> parsed;
+	for (const std::string &item : splitList(value)) {
+		const size_t split = item.find(separator);
+		if (split == std::string::npos) {
+			return false;
+		}
+		int first = 0;
+		float second = 0.0f;
+		if (!parseInt(item.substr(0, split), first) || first < 0 ||
+		    !parseFloat(item.substr(split + 1), second)) {
+			return false;
+		}
+		parsed.emplace_back((size_t)first, (Second)second);
+	}
+	pairs = std::move(parsed);
+	return true;
+}
+
+bool applyModelDescriptorValue(ModelDescriptor &d, const std::string &key, const std::string &value)
+{
+	if (key == "input_layout") {
+		return parseLayout(value, false, d.inputLayout);
+	}
+	if (key == "input_name") {
+		d.inputName = value;
+		return true;
+	}
+	if (key == "mean") {
+		return parseChannels(value, d.mean);
+	}
+	if (key == "scale") {
+		return parseChannels(value, d.scale);
+	}
+	if (key == "dynamic_size") {
+		return parseBool(value, d.dynamicSize);
+	}
+	if (key == "size_multiple") {
+		return parseInt(value, d.sizeMultiple) && d.sizeMultiple > 0;
+	}
+	if (key == "max_input_size") {
+		return parseInt(value, d.maxInputSize) && d.maxInputSize > 0;
+	}
+	if (key == "output_layout") {
+		return parseLayout(value, true, d.outputLayout);
+	}
+	if (key == "output_channels") {
+		return parseInt(value, d.outputChannels);
+	}
+	if (key == "output_channel") {
+		return parseInt(value, d.outputChannel);
+	}
+	if (key == "output_argmax") {
+		return parseBool(value, d.outputArgmax);
+	}
+	if (key == "output_normalize") {
+		if (value != "none" && value != "minmax") {
+			return false;
+		}
+		d.outputMinMax = value == "minmax";
+		return true;
+	}
+	if (key == "output_scale") {
+		return parseFloat(value, d.outputScale);
+	}
+	if (key == "image_scale") {
+		return parseFloat(value, d.imageScale);
+	}
+	if (key == "output_size_from_input") {
+		return parseBool(value, d.outputSizeFromInput);
+	}
+	if (key == "tiling") {
+		return parseBool(value, d.tiling);
+	}
+	if (key == "alpha_matte") {
+		return parseBool(value, d.alphaMatte);
+	}
+	if (key == "all_tensors") {
+		return parseBool(value, d.allTensors);
+	}
+	if (key == "host_inputs") {
+		return parsePairs(value, '=', d.hostInputs);
+	}
+	if (key == "recurrent") {
+		return parsePairs(value, ':', d.recurrent);
+	}
+	if (key == "trt_profile_shapes") {
+		d.trtProfileShapes = value;
+		return true;
+	}
+	return false;
+}
+
+namespace {
+
+// Recursive descent over the flat subset of JSON the descriptors use
+class FlatJsonParser {
+public:
+	explicit FlatJsonParser(const std::string &text) : text_(text) {}
+
+	bool parse(std::map<std::string, std::string> &values)
+	{
+		if (!consume('{')) {
+			return false;
+		}
+		if (consume('}')) {
+			return atEnd();
+		}
+		do {
+			std::string key;
+			std::string value;
+			if (!parseString(key) || !consume(':') || !parseValue(value)) {
+				return false;
+			}
+			values[key] = value;
+		} while (consume(','));
+		return consume('}') && atEnd();
+	}
+
+private:
+	void skipSpace()
+	{
+		while (pos_ < text_.size() && isspace((unsigned char)text_[pos_])) {
+			pos_++;
+		}
+	}
+
+	bool consume(char c)
+	{
+		skipSpace();
+		if (pos_ < text_.size() && text_[pos_] == c) {
+			pos_++;
+			return true;
+		}
+		return false;
+	}
+
+	bool atEnd()
+	{
+		skipSpace();
+		return pos_ == text_.size();
+	}
+
+	bool parseString(std::string &result)
+	{
+		if (!consume('"')) {
+			return false;
+		}
+		result.clear();
+		while (pos_ < text_.size() && text_[pos_] != '"') {
+			char c = text_[pos_++];
+			if (c == '\\') {
+				if (pos_ == text_.size()) {
+					return false;
+				}
+				c = text_[pos_++];
+				if (c == 'n') {
+					c = '\n';
+				} else if (c == 't') {
+					c = '\t';
+				} else if (c != '"' && c != '\\' && c != '/') {
+					return false;
+				}
+			}
+			result += c;
+		}
+		return consume('"');
+	}
+
+	// Number, true, false or null, as written
+	bool parseLiteral(std::string &result)
+	{
+		skipSpace();
+		const size_t begin = pos_;
+		while (pos_ < text_.size() &&
+		       (isalnum((unsigned char)text_[pos_]) || text_[pos_] == '-' || text_[pos_] == '+' ||
+			text_[pos_] == '.')) {
+			pos_++;
+		}
+		result = text_.substr(begin, pos_ - begin);
+		return !result.empty();
+	}
+
+	bool parseScalar(std::string &result)
+	{
+		skipSpace();
+		if (pos_ < text_.size() && text_[pos_] == '"') {
+			return parseString(result);
+		}
+		return parseLiteral(result);
+	}
+
+	bool parseValue(std::string &result)
+	{
+		if (!consume('[')) {
+			return parseScalar(result);
+		}
+		result.clear();
+		if (consume(']')) {
+			return true;
+		}
+		do {
+			std::string item;
+			if (!parseScalar(item)) {
+				return false;
+			}
+			if (!result.empty()) {
+				result += ',';
+			}
+			result += item;
+		} while (consume(','));
+		return consume(']');
+	}
+
+	const std::string &text_;
+	size_t pos_ = 0;
+};
+
+} // namespace
+
+bool parseFlatJson(const std::string &text, std::map<std::string, std::string> &values)
+{
+	return FlatJsonParser(text).parse(values);
+}
+
+bool applyModelDescriptorSidecar(ModelDescriptor &descriptor, const std::string &modelSelection)
+{
+	const size_t extension = modelSelection.rfind('.');
+	const std::string sidecar = modelSelection.substr(0, extension) + ".json";
+	char *sidecarPath = obs_module_file(sidecar.c_str());
+	if (!sidecarPath) {
+		return false;
+	}
+	std::ifstream file(sidecarPath);
+	bfree(sidecarPath);
+	if (!file) {
+		return false;
+	}
+	std::stringstream text;
+	text << file.rdbuf();
+
+	std::map<std::string, std::string> values;
+	if (!parseFlatJson(text.str(), values)) {
+		obs_log(LOG_WARNING, "Model descriptor %s is not a flat JSON object, ignored", sidecar.c_str());
+		return false;
+	}
+	for (const auto &[key, value] : values) {
+		if (!applyModelDescriptorValue(descriptor, key, value)) {
+			obs_log(LOG_WARNING, "Model descriptor %s: ignoring %s = %s", sidecar.c_str(), key.c_str(),
+				value.c_str());
+		}
+	}
+	obs_log(LOG_INFO, "Model descriptor loaded from %s", sidecar.c_str());
+	return true;
+}
@@ -0,0 +1,88 @@
+#ifndef MODELDESCRIPTOR_H
+#define MODELDESCRIPTOR_H
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Tensor layout of a model input or output
+enum class TensorLayout {
+	NHWC, // (1, H, W, C)
+	NCHW, // (1, C, H, W)
+	HWC,  // (H, W, C), no batch dimension
+};
+
+/**
+  * @brief What a model expects and produces, as data instead of a Model subclass
+  *
+  * Read from a sidecar JSON next to the model file (models/<name>.json) or from
+  * the model's ONNX custom metadata (keys prefixed "bgremoval."), over the
+  * built-in descriptor of the bundled model. Keys and values:
+  *
+  *   input_layout           "nhwc" | "nchw"
+  *   input_name             name of input 0, for the TensorRT profiles of a dynamic size
+  *   mean, scale            per channel (R, G, B) or one value: (pixel - mean) / scale
+  *   dynamic_size           input 0 and output 0 follow the source at the inference resolution
+  *   size_multiple          dynamic size: height and width rounded down to a multiple of this
+  *   max_input_size         dynamic size: longest side at most this
+  *   output_layout          "nhwc" | "nchw" | "hwc"
+  *   output_channels        channel count of output 0 (0: from its shape)
+  *   output_channel         channel taken as the mask (-1: all)
+  *   output_argmax          class scores: the mask is the winning foreground class (class 0 = background)
+  *   output_normalize       "none" | "minmax"
+  *   output_scale           factor to the [0,1] range of the mask (or [0,255] of an image)
+  *   image_scale            factor to the [0,255] range on the GPU image output path
+  *   output_size_from_input output 0 has the input's height and width (dynamic output shape)
+  *   tiling, alpha_matte    see Model::supportsTiling() and Model::outputsAlphaMatte()
+  *   all_tensors            bind every input and output, not only the first
+  *   host_inputs            "index=value" constants of scalar inputs kept on the host
+  *   recurrent              "input:output" index pairs of recurrent state
+  *   trt_profile_shapes     TensorRT profile shapes (sidecar only: needed before the session exists)
+  *
+  * Arrays are written as JSON arrays in the sidecar and comma-separated in metadata.
+  */
+struct ModelDescriptor {
+	TensorLayout inputLayout = TensorLayout::NCHW;
+	std::string inputName;
+	float mean[3] = {0.0f, 0.0f, 0.0f};
+	float scale[3] = {255.0f, 255.0f, 255.0f};
+
+	bool dynamicSize = false;
+	int sizeMultiple = 32;
+	int maxInputSize = 1920;
+
+	TensorLayout outputLayout = TensorLayout::NCHW;
+	int outputChannels = 0;
+	int outputChannel = -1;
+	bool outputArgmax = false;
+	bool outputMinMax = false;
+	float outputScale = 1.0f;
+	float imageScale = 255.0f;
+	bool outputSizeFromInput = false;
+
+	bool tiling = false;
+	bool alphaMatte = false;
+	bool allTensors = false;
+	std::vector<std::pair<size_t, float>> hostInputs;
+	std::vector<std::pair<size_t, size_t>> recurrent;
+	std::string trtProfileShapes;
+};
+
+// Descriptor of a bundled model file from consts.h. Unknown files get the
+// generic BCHW descriptor: NCHW in and out, /255.
+ModelDescriptor builtinModelDescriptor(const std::string &modelSelection);
+
+// Set one key of the descriptor. Returns false (descriptor unchanged) for an
+// unknown key or a value that doesn't parse.
+bool applyModelDescriptorValue(ModelDescriptor &descriptor, const std::string &key, const std::string &value);
+
+// Parse a flat JSON object of strings, numbers, booleans and arrays of those.
+// Arrays are joined with ','. Returns false on malformed input.
+bool parseFlatJson(const std::string &text, std::map<std::string, std::string> &values);
+
+// Apply the sidecar JSON of the model file (models/<name>.onnx → models/<name>.json)
+// if there is one. Returns whether a sidecar was found and parsed.
+bool applyModelDescriptorSidecar(ModelDescriptor &descriptor, const std::string &modelSelection);
+
+#endif /* MODELDESCRIPTOR_H */
@@ -0,0 +1,22 @@
+#ifndef MODELFACTORY_H
+#define MODELFACTORY_H
+
+#include <string>
+
+#include "consts.h"
+#include "ModelDescribed.h"
+#include "ModelRVM.h"
+
+// The model class for a model file from consts.h, for code that creates models
+// outside the filters (engine warmup, benchmark). Every model but RVM is
+// described by data (ModelDescriptor): unknown files get the generic BCHW
+// descriptor, like the enhance filter's default, or their sidecar JSON.
+inline Model *createModel(const std::string &modelSelection)
+{
+	if (modelSelection == MODEL_RVM) {
+		return new ModelRVM;
+	}
+	return new ModelDescribed(modelSelection);
+}
+
+#endif /* MODELFACTORY_H */
@@ -1,46 +1,101 @@
 #ifndef MODELRVM_H
 #define MODELRVM_H
 
+#include <algorithm>
+#include <iterator>
+
 #include "Model.h"
 
 class ModelRVM : public ModelBCHW {
 private:
-	// Model input resolution — the ONNX model supports dynamic shapes,
-	// so the CUDA preprocessor resizes the source frame to this size.
-	// With downsample_ratio < 1, the model internally processes at a lower
-	// resolution and the Deep Guided Filter refiner upsamples the alpha
-	// matte back to this size using the full-res source for edge guidance.
-	static constexpr int INPUT_WIDTH = 1920;
-	static constexpr int INPUT_HEIGHT = 1080;
-	static constexpr float DOWNSAMPLE_RATIO = 0.25f;
+	// Model input resolution — the ONNX model supports dynamic shapes, so the
+	// input follows the source at the inference resolution (setSourceSize), at
+	// most 4K. With downsample_ratio < 1, the model internally processes at a
+	// lower resolution and the Deep Guided Filter refiner upsamples the alpha
+	// matte back to this size using the input for edge guidance.
+	static constexpr int MAX_INPUT_SIZE = 3840;   // long side
+	static constexpr int MAX_INTERNAL_SIZE = 512; // long side of the backbone resolution
+
+	// Candidate downsample ratios, largest first. Exact in binary floating
+	// point, so the internal size computed here matches the model's.
+	static constexpr float DOWNSAMPLE_RATIOS[] = {1.0f, 0.5f, 0.375f, 0.25f, 0.125f};
+
+	int inputWidth = 1920;
+	int inputHeight = 1080;
+	float downsampleRatio = 0.25f;
 
 	// Channel counts for the 4 ConvGRU recurrent states
 	static constexpr int REC_CHANNELS[4] = {16, 20, 40, 64};
 
+	// Input size (at most 4K, even) for an inference size, and the largest
+	// downsample ratio that keeps the backbone within MAX_INTERNAL_SIZE: 0.375
+	// for 720p, 0.25 for 1080p, 0.125 for 4K.
+	static float inputSizeFor(const cv::Size &size, int &w, int &h)
+	{
+		const double scale = std::min(1.0, (double)MAX_INPUT_SIZE / std::max(size.width, size.height));
+		w = std::max(2, (int)(size.width * scale) & ~1);
+		h = std::max(2, (int)(size.height * scale) & ~1);
+
+		for (float r : DOWNSAMPLE_RATIOS) {
+			if (std::max(w, h) * r <= MAX_INTERNAL_SIZE) {
+				return r;
+			}
+		}
+		return DOWNSAMPLE_RATIOS[std::size(DOWNSAMPLE_RATIOS) - 1];
+	}
+
 public:
 	ModelRVM(/* args */) {}
 	~ModelRVM() {}
 
-	virtual bool outputsAlphaMatte() const { return true; }
+protected:
+	virtual bool resizeInput()
+	{
+		if (sourceWidth_ <= 0 || sourceHeight_ <= 0) {
+			return false;
+		}
+		int w = 0, h = 0;
+		const float ratio =
+			inputSizeFor(inferenceInputSize(sourceWidth_, sourceHeight_, inferenceResolution_), w, h);
 
-	virtual std::string getTrtProfileShapes() const
+		if (w == inputWidth && h == inputHeight && ratio == downsampleRatio) {
+			return false;
+		}
+		inputWidth = w;
+		inputHeight = h;
+		downsampleRatio = ratio;
+		return true;
+	}
+
+	virtual ProfileShapes profileShapesAt(const cv::Size &size) const
 	{
-		int internal_h = (int)(INPUT_HEIGHT * DOWNSAMPLE_RATIO);
-		int internal_w = (int)(INPUT_WIDTH * DOWNSAMPLE_RATIO);
-		std::string s = "src:1x3x" + std::to_string(INPUT_HEIGHT) + "x" + std::to_string(INPUT_WIDTH);
-		int h = internal_h;
-		int w = internal_w;
+		int w = 0, h = 0;
+		const float ratio = inputSizeFor(size, w, h);
+		ProfileShapes shapes = {{"src", {1, 3, h, w}}};
+		// Recurrent states at the backbone strides of the internal resolution
+		int internal_h = (int)(h * ratio);
+		int internal_w = (int)(w * ratio);
 		for (int i = 0; i < 4; i++) {
-			h = (h + 1) / 2;
-			w = (w + 1) / 2;
-			s += ",r" + std::to_string(i + 1) + "i:1x" + std::to_string(REC_CHANNELS[i]) + "x" +
-			     std::to_string(h) + "x" + std::to_string(w);
+			internal_h = (internal_h + 1) / 2;
+			internal_w = (internal_w + 1) / 2;
+			const std::string name = "r" + std::to_string(i + 1) + "i";
+			shapes.push_back({name, {1, REC_CHANNELS[i], internal_h, internal_w}});
 		}
-		s += ",downsample_ratio:1";
-		return s;
+		shapes.push_back({"downsample_ratio", {1}});
+		return shapes;
 	}
 
-	virtual void populateInputOutputNames(const std::unique_ptr<Ort::Session> &session,
+public:
+	virtual bool outputsAlphaMatte() const { return true; }
+
+	virtual cv::Size dynamicInputSize() const { return cv::Size(inputWidth, inputHeight); }
+
+	virtual std::string getTrtProfileShapes() const
+	{
+		return formatProfileShapes(profileShapesAt(cv::Size(inputWidth, inputHeight)));
+	}
+
+	virtual void populateInputOutputNames(const std::shared_ptr<Ort::Session> &session,
 					      std::vector<Ort::AllocatedStringPtr> &inputNames,
 					      std::vector<Ort::AllocatedStringPtr> &outputNames)
 	{
@@ -58,7 +113,7 @@ public:
 		}
 	}
 
-	virtual bool populateInputOutputShapes(const std::unique_ptr<Ort::Session> &session,
+	virtual bool populateInputOutputShapes(const std::shared_ptr<Ort::Session> &session,
 					       std::vector<std::vector<int64_t>> &inputDims,
 					       std::vector<std::vector<int64_t>> &outputDims)
 	{
@@ -79,14 +134,14 @@ public:
 
 		// src input: full resolution (the DGF refiner uses this for edge guidance)
 		inputDims[0][0] = 1;
-		inputDims[0][2] = INPUT_HEIGHT;
-		inputDims[0][3] = INPUT_WIDTH;
+		inputDims[0][2] = inputHeight;
+		inputDims[0][3] = inputWidth;
 
 		// Recurrent state dimensions are at backbone stride fractions of the
 		// INTERNAL resolution (after downsample_ratio is applied by the model).
 		// MobileNetV3 backbone uses stride-2 convolutions: ceil(dim/2) per stage.
-		int internal_h = (int)(INPUT_HEIGHT * DOWNSAMPLE_RATIO);
-		int internal_w = (int)(INPUT_WIDTH * DOWNSAMPLE_RATIO);
+		int internal_h = (int)(inputHeight * downsampleRatio);
+		int internal_w = (int)(inputWidth * downsampleRatio);
 		int h = internal_h;
 		int w = internal_w;
 
@@ -103,8 +158,8 @@ public:
 
 		// pha output: full resolution (DGF refiner upsamples to match src)
 		outputDims[0][0] = 1;
-		outputDims[0][2] = INPUT_HEIGHT;
-		outputDims[0][3] = INPUT_WIDTH;
+		outputDims[0][2] = inputHeight;
+		outputDims[0][3] = inputWidth;
 
 		// Recurrent state outputs (same dims as inputs)
 		h = internal_h;
@@ -122,22 +177,25 @@ public:
 
 	virtual void setExtraTensorInputs(std::vector<std::vector<float>> &inputTensorValues)
 	{
-		inputTensorValues[5][0] = DOWNSAMPLE_RATIO;
+		inputTensorValues[5][0] = downsampleRatio;
 	}
 
-	virtual void loadInputToTensor(const cv::Mat &preprocessedImage, uint32_t, uint32_t,
-				       std::vector<std::vector<float>> &inputTensorValues)
+	// downsample_ratio (index 5) is a scalar set on the host every frame
+	virtual bool keepInputOnHost(size_t i) const { return i == 5; }
+	virtual bool hasHostInputs() const { return true; }
+
+	// r1i..r4i (inputs 1..4) are fed from r1o..r4o (outputs 1..4, fgr is skipped)
+	virtual const std::vector<std::pair<size_t, size_t>> &recurrentStatePairs() const
 	{
-		inputTensorValues[0].assign(preprocessedImage.begin<float>(), preprocessedImage.end<float>());
-		inputTensorValues[5][0] = DOWNSAMPLE_RATIO;
+		static const std::vector<std::pair<size_t, size_t>> pairs = {{1, 1}, {2, 2}, {3, 3}, {4, 4}};
+		return pairs;
 	}
 
-	virtual void assignOutputToInput(std::vector<std::vector<float>> &outputTensorValues,
-					 std::vector<std::vector<float>> &inputTensorValues)
+	virtual void loadInputToTensor(const cv::Mat &preprocessedImage, uint32_t, uint32_t,
+				       std::vector<std::vector<float>> &inputTensorValues)
 	{
-		for (size_t i = 1; i < 5; i++) {
-			inputTensorValues[i].assign(outputTensorValues[i].begin(), outputTensorValues[i].end());
-		}
+		inputTensorValues[0].assign(preprocessedImage.begin<float>(), preprocessedImage.end<float>());
+		inputTensorValues[5][0] = downsampleRatio;
 	}
 };
 
@@ -0,0 +1,130 @@
+#include "mask-share.h"
+
+#include "plugin-support.h"
+
+MaskShare &MaskShare::instance()
+{
+	static MaskShare share;
+	return share;
+}
+
+void MaskShare::join(const void *member, const void *parent, const std::string &key, int position)
+{
+	const std::string id = parent && !key.empty() ? std::to_string((uintptr_t)parent) + "|" + key : std::string();
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto current = members_.find(member);
+	if (current != members_.end()) {
+		if (current->second.group == id) {
+			if (current->second.position != position) {
+				// Filters reordered
+				current->second.position = position;
+				electProducer(id, groups_[id]);
+			}
+			return;
+		}
+		const std::string left = current->second.group;
+		members_.erase(current);
+		auto group = groups_.find(left);
+		if (group != groups_.end()) {
+			if (--group->second.members == 0) {
+				groups_.erase(group);
+			} else if (group->second.producer == member) {
+				electProducer(left, group->second);
+			}
+		}
+	}
+	if (id.empty()) {
+		return;
+	}
+
+	Member &joined = members_[member];
+	joined.group = id;
+	joined.position = position;
+	Group &group = groups_[id];
+	group.members++;
+	electProducer(id, group);
+	obs_log(LOG_INFO, "Mask sharing: %s the mask (%d filters on the source)",
+		group.producer == member ? "producing" : "consuming", group.members);
+}
+
+void MaskShare::electProducer(const std::string &id, Group &group)
+{
+	const void *upstream = nullptr;
+	int upstreamPosition = 0;
+	for (const auto &entry : members_) {
+		if (entry.second.group == id && (!upstream || entry.second.position < upstreamPosition)) {
+			upstream = entry.first;
+			upstreamPosition = entry.second.position;
+		}
+	}
+	if (upstream != group.producer) {
+		group.producer = upstream;
+		group.producerSince = 0;
+		group.mask = nullptr;
+	}
+}
+
+bool MaskShare::producing(const void *member, uint64_t now, uint64_t staleBefore)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto current = members_.find(member);
+	if (current == members_.end()) {
+		return true;
+	}
+	Group &group = groups_[current->second.group];
+	if (group.producer == member) {
+		if (group.producerSince == 0) {
+			group.producerSince = now;
+		}
+		return true;
+	}
+
+	// The producer left: the first member to ask takes over. Otherwise only a
+	// consumer that is rendering does: while the source isn't shown nobody
+	// publishes, and nobody needs to.
+	const bool rendering = current->second.lastRendered >= staleBefore;
+	const bool stale = group.frameTime < staleBefore && group.producerSince < staleBefore;
+	if (!group.producer || (rendering && stale)) {
+		group.producer = member;
+		group.producerSince = now;
+		group.mask = nullptr;
+		obs_log(LOG_INFO, "Mask sharing: taking over producing the mask");
+		return true;
+	}
+	return false;
+}
+
+void MaskShare::publish(const void *member, gs_texture_t *mask, uint64_t frameTime, uint32_t width, uint32_t height)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto current = members_.find(member);
+	if (current == members_.end()) {
+		return;
+	}
+	Group &group = groups_[current->second.group];
+	if (group.producer != member) {
+		return;
+	}
+	group.mask = mask;
+	group.frameTime = frameTime;
+	group.width = width;
+	group.height = height;
+}
+
+gs_texture_t *MaskShare::latest(const void *member, uint64_t frameTime, uint64_t notBefore, uint32_t width,
+				uint32_t height)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto current = members_.find(member);
+	if (current == members_.end()) {
+		return nullptr;
+	}
+	current->second.lastRendered = frameTime;
+	const Group &group = groups_[current->second.group];
+	if (group.producer == member || !group.mask || group.frameTime < notBefore || group.width != width ||
+	    group.height != height) {
+		return nullptr;
+	}
+	return group.mask;
+}
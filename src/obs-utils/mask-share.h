@@ -0,0 +1,75 @@
+#ifndef MASK_SHARE_H
+#define MASK_SHARE_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <obs-module.h>
+
+// Masks shared between the background filters of one source. Filters on the
+// same parent source with the same key (the settings that decide the mask)
+// form a group: the upstream-most one in the parent's filter chain produces,
+// i.e. captures, infers and publishes the mask texture it renders with, tagged
+// with the frame time. It sees the source before the others have masked it.
+// The others consume that texture instead of capturing and inferring the same
+// frame again.
+//
+// A producer that leaves (destroyed, disabled, settings changed) is replaced by
+// the next upstream member; one that stops publishing while a consumer still
+// renders is replaced by that consumer.
+// Textures are published and read on the graphics thread only; a producer
+// publishes again (or leaves) before it destroys the texture it published.
+class MaskShare {
+public:
+	static MaskShare &instance();
+
+	// Put member, at position in the parent's filter chain (0 = applied to the
+	// source first), into the group of the filters on parent with key, leaving
+	// the one it was in. An empty key or no parent only leaves.
+	void join(const void *member, const void *parent, const std::string &key, int position);
+	void leave(const void *member) { join(member, nullptr, std::string(), 0); }
+
+	// Whether member infers its own mask: it produces for its group, or is in
+	// none. A consumer takes over from a producer that left, and, if it rendered
+	// since staleBefore, from one that published nothing since then.
+	bool producing(const void *member, uint64_t now, uint64_t staleBefore);
+
+	// Producer: the mask it renders the width x height frame of frameTime with
+	// (nullptr: none). Ignored for consumers and filters in no group.
+	void publish(const void *member, gs_texture_t *mask, uint64_t frameTime, uint32_t width, uint32_t height);
+
+	// Consumer: the producer's latest mask for a width x height frame, if it
+	// was published at or after notBefore; nullptr otherwise
+	gs_texture_t *latest(const void *member, uint64_t frameTime, uint64_t notBefore, uint32_t width,
+			     uint32_t height);
+
+private:
+	MaskShare() = default;
+
+	struct Group {
+		const void *producer = nullptr;
+		uint64_t producerSince = 0; // frame time the producer took over (0: not seen yet)
+		gs_texture_t *mask = nullptr;
+		uint64_t frameTime = 0;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		int members = 0;
+	};
+
+	struct Member {
+		std::string group;
+		int position = 0;          // in the parent's filter chain
+		uint64_t lastRendered = 0; // frame time of the last latest() call
+	};
+
+	// Make the upstream-most member of group id its producer
+	void electProducer(const std::string &id, Group &group);
+
+	std::mutex mutex_;
+	std::map<std::string, Group> groups_;
+	std::map<const void *, Member> members_;
+};
+
+#endif /* MASK_SHARE_H */
@@ -2,6 +2,42 @@
 
 #include <obs-module.h>
 
+#include "plugin-support.h"
+
+/**
+  * @brief Copy the texrender texture into the device-resident input frame
+  *
+  * Uses CUDA-GL interop so the frame never touches host memory.
+  *
+  * @param tf  The filter data
+  * @param width  The width of the texrender texture
+  * @param height  The height of the texrender texture
+  * @return true  if successful
+  * @return false if interop is unavailable or the copy failed
+*/
+static bool copyTexrenderToDevice(filter_data *tf, uint32_t width, uint32_t height, const FrameTag &tag)
+{
+	// The frame is allocated on the GPU that renders the texture
+	CudaDeviceScope device(renderCudaDevice());
+	gs_texture_t *tex = gs_texrender_get_texture(tf->texrender);
+	if (!tf->inputInterop.registerTexture(tex, width, height, CudaGLTexture::Access::READ_ONLY)) {
+		return false;
+	}
+
+	InputFrame &frame = tf->inputFrames.back();
+	if (!ensureDeviceFrame(frame.device, (int)width, (int)height)) {
+		return false;
+	}
+	frame.device.rgba = true;
+	frame.onDevice = true;
+	frame.tag = tag;
+	if (!tf->inputInterop.copyToDevice(frame.device.data, frame.device.pitch, (size_t)width * 4, height)) {
+		return false;
+	}
+	tf->inputFrames.publish();
+	return true;
+}
+
 /**
   * @brief Get RGBA from the stage surface
   *
@@ -40,31 +76,89 @@ bool getRGBAFromStageSurface(filter_data *tf, uint32_t &width, uint32_t &height)
 	obs_source_video_render(target);
 	gs_blend_state_pop();
 	gs_texrender_end(tf->texrender);
+	if (tf->skipCapture) {
+		return true;
+	}
 
-	if (tf->stagesurface) {
-		uint32_t stagesurf_width = gs_stagesurface_get_width(tf->stagesurface);
-		uint32_t stagesurf_height = gs_stagesurface_get_height(tf->stagesurface);
-		if (stagesurf_width != width || stagesurf_height != height) {
-			gs_stagesurface_destroy(tf->stagesurface);
-			tf->stagesurface = nullptr;
+	// The upstream render above belongs to the source, not to this filter
+	StageTimer timer(tf->stats, PipelineStats::STAGE_READBACK);
+
+	FrameTag tag;
+	tag.sequence = tf->captureSequence.fetch_add(1) + 1;
+	tag.timestamp = obs_get_video_frame_time();
+
+	// A frame the scheduler won't infer needs no copy. Tick sees it as the
+	// next frame (interop) or once it comes due in the stage surface ring.
+	if (tf->enableGpuInterop) {
+		if (tf->gateReadback && !tf->scheduler.runsAfter(1)) {
+			tf->readbackSkips.fetch_add(1);
+			return true;
 		}
+		if (copyTexrenderToDevice(tf, width, height, tag)) {
+			return true;
+		}
+		obs_log(LOG_WARNING, "CUDA-GL interop input failed, falling back to stage surface readback");
+		tf->enableGpuInterop = false;
+		tf->inputInterop.unregister();
 	}
-	if (!tf->stagesurface) {
-		tf->stagesurface = gs_stagesurface_create(width, height, GS_BGRA);
-	}
-	gs_stage_texture(tf->stagesurface, gs_texrender_get_texture(tf->texrender));
-	uint8_t *video_data;
-	uint32_t linesize;
-	if (!gs_stagesurface_map(tf->stagesurface, &video_data, &linesize)) {
-		return false;
+
+	// The frame comes due latency() renders later; tick sees latency() frames before it
+	const bool stage = !tf->gateReadback || tf->scheduler.runsAfter(tf->stageRing.latency() + 1);
+	StageSurfaceRing::Mapped mapped;
+	switch (tf->stageRing.push(gs_texrender_get_texture(tf->texrender), width, height, stage, tag, mapped)) {
+	case StageSurfaceRing::Due::FRAME: {
+		// Create a temporary Mat that wraps the mapped pointer
+		cv::Mat temp(mapped.height, mapped.width, CV_8UC4, mapped.data, mapped.linesize);
+		tf->inputFrames.back().copyFrom(temp);
+		tf->inputFrames.back().tag = mapped.tag;
+		tf->inputFrames.publish();
+		tf->stageRing.unmap();
+		break;
 	}
-	{
-		std::lock_guard<std::mutex> lock(tf->inputBGRALock);
-		// Create a temporary Mat that wraps the video_data pointer
-		cv::Mat temp(height, width, CV_8UC4, video_data, linesize);
-		// copyTo reuses existing buffer if dimensions match (avoids allocation per frame)
-		temp.copyTo(tf->inputBGRA);
+	case StageSurfaceRing::Due::SKIPPED:
+		tf->readbackSkips.fetch_add(1);
+		break;
+	case StageSurfaceRing::Due::NONE:
+		break;
 	}
-	gs_stagesurface_unmap(tf->stagesurface);
 	return true;
 }
+
+const InputFrame &localInputFrame(filter_data *tf, const InputFrame &input)
+{
+	if (!input.onDevice || input.device.device == tf->deviceId) {
+		return input;
+	}
+	// Peer copy to the current (tf's) device
+	if (!tf->peerInput.copyFrom(input)) {
+		obs_log(LOG_WARNING, "Failed to copy the input frame from GPU %d to GPU %d", input.device.device,
+			tf->deviceId);
+		tf->peerInput.onDevice = false;
+		tf->peerInput.bgra.release();
+	}
+	return tf->peerInput;
+}
+
+void logDevicePlacement(filter_data *tf)
+{
+	const int renderDevice = renderCudaDevice();
+	if (tf->deviceId == renderDevice) {
+		obs_log(LOG_INFO, "Inference on GPU %d (%s), the render GPU", tf->deviceId, tf->gpuInfo.name.c_str());
+		return;
+	}
+	const bool peer = enablePeerAccess(tf->deviceId, renderDevice) && enablePeerAccess(renderDevice, tf->deviceId);
+	obs_log(LOG_INFO, "Inference on GPU %d (%s), frames from render GPU %d %s", tf->deviceId,
+		tf->gpuInfo.name.c_str(), renderDevice, peer ? "peer-to-peer" : "staged through host memory");
+}
+
+void addGpuDeviceProperty(obs_properties_t *props)
+{
+	obs_property_t *p = obs_properties_add_list(props, "gpu_device", obs_module_text("GpuDevice"),
+						    OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(p, obs_module_text("GpuDeviceAuto"), GPU_DEVICE_AUTO);
+	for (const GpuInfo &gpu : listGpus()) {
+		const std::string name = std::to_string(gpu.deviceId) + ": " + gpu.name + " (" +
+					 std::to_string(gpu.totalMemoryMB) + " MB)";
+		obs_property_list_add_int(p, name.c_str(), gpu.deviceId);
+	}
+}
@@ -5,4 +5,15 @@
 
 bool getRGBAFromStageSurface(filter_data *tf, uint32_t &width, uint32_t &height);
 
+// The input frame on tf's device: a device frame captured on another GPU (the
+// render GPU) is copied into tf->peerInput. video_tick only.
+const InputFrame &localInputFrame(filter_data *tf, const InputFrame &input);
+
+// Log where tf runs relative to the render GPU and enable peer access between
+// the two (after tf moved to another device)
+void logDevicePlacement(filter_data *tf);
+
+// The "gpu_device" list property: auto, then every CUDA device
+void addGpuDeviceProperty(obs_properties_t *props);
+
 #endif /* OBS_UTILS_H */
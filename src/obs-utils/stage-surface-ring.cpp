@@ -0,0 +1,68 @@
+#include "stage-surface-ring.h"
+
+StageSurfaceRing::Due StageSurfaceRing::push(gs_texture_t *texture, uint32_t width, uint32_t height, bool stage,
+					     const FrameTag &tag, Mapped &mapped)
+{
+	unmap();
+
+	Entry &current = entries_[next_];
+	current.pending = true;
+	current.staged = stage;
+	current.tag = tag;
+	if (stage) {
+		if (current.surface && (current.width != width || current.height != height)) {
+			gs_stagesurface_destroy(current.surface);
+			current.surface = nullptr;
+		}
+		if (!current.surface) {
+			current.surface = gs_stagesurface_create(width, height, GS_BGRA);
+			current.width = width;
+			current.height = height;
+		}
+		if (current.surface) {
+			gs_stage_texture(current.surface, texture);
+		} else {
+			current.staged = false;
+		}
+	}
+
+	// The oldest entry comes due: the one pushed depth - 1 renders ago (with a
+	// depth of 1, the one just pushed)
+	next_ = (next_ + 1) % depth_;
+	Entry &due = entries_[next_];
+	if (!due.pending) {
+		return Due::NONE;
+	}
+	due.pending = false;
+	if (!due.staged) {
+		return Due::SKIPPED;
+	}
+	if (!gs_stagesurface_map(due.surface, &mapped.data, &mapped.linesize)) {
+		return Due::NONE;
+	}
+	mapped_ = (int)(&due - entries_);
+	mapped.width = due.width;
+	mapped.height = due.height;
+	mapped.tag = due.tag;
+	return Due::FRAME;
+}
+
+void StageSurfaceRing::unmap()
+{
+	if (mapped_ >= 0) {
+		gs_stagesurface_unmap(entries_[mapped_].surface);
+		mapped_ = -1;
+	}
+}
+
+void StageSurfaceRing::release()
+{
+	unmap();
+	for (Entry &entry : entries_) {
+		if (entry.surface) {
+			gs_stagesurface_destroy(entry.surface);
+		}
+		entry = Entry();
+	}
+	next_ = 0;
+}
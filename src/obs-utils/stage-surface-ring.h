@@ -0,0 +1,70 @@
+#ifndef STAGE_SURFACE_RING_H
+#define STAGE_SURFACE_RING_H
+
+#include <cstdint>
+
+#include <obs-module.h>
+
+#include "ort-utils/frame-tag.h"
+
+// Readback of the filter input through a ring of stage surfaces.
+// Each frame is staged into one surface and mapped depth - 1 renders later,
+// when the GPU copy has long finished, so gs_stagesurface_map() doesn't wait
+// for it (a depth of 1 stages and maps the same frame: the synchronous readback).
+//
+// A frame the caller doesn't need isn't staged, but still takes its turn in the
+// ring as a placeholder: frames and placeholders come due in render order.
+// Graphics thread only; release() before destruction.
+class StageSurfaceRing {
+public:
+	static constexpr int kMaxDepth = 3;
+
+	enum class Due {
+		NONE,    // nothing came due (ring still filling, or the map failed)
+		FRAME,   // a staged frame is mapped
+		SKIPPED, // a frame pushed without staging came due
+	};
+
+	// A mapped frame, valid until unmap()
+	struct Mapped {
+		uint8_t *data = nullptr;
+		uint32_t linesize = 0;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		FrameTag tag; // as pushed
+	};
+
+	// Inline: filters that never render (the headless bench) construct one without linking the ring
+	explicit StageSurfaceRing(int depth = 2) : depth_(depth < 1 ? 1 : (depth > kMaxDepth ? kMaxDepth : depth)) {}
+	// Renders between staging a frame and mapping it
+	int latency() const { return depth_ - 1; }
+
+	StageSurfaceRing(const StageSurfaceRing &) = delete;
+	StageSurfaceRing &operator=(const StageSurfaceRing &) = delete;
+
+	// Stage texture (width x height, GS_BGRA) unless !stage, then map the entry
+	// that came due (FRAME: into mapped)
+	Due push(gs_texture_t *texture, uint32_t width, uint32_t height, bool stage, const FrameTag &tag,
+		 Mapped &mapped);
+	void unmap();
+
+	// Destroy the surfaces and drop the frames in flight
+	void release();
+
+private:
+	struct Entry {
+		gs_stagesurf_t *surface = nullptr;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		bool pending = false; // pushed, not yet due
+		bool staged = false;  // pushed with a staged frame
+		FrameTag tag;
+	};
+
+	Entry entries_[kMaxDepth];
+	int depth_;
+	int next_ = 0;
+	int mapped_ = -1;
+};
+
+#endif /* STAGE_SURFACE_RING_H */
@@ -3,9 +3,14 @@
 
 #include <onnxruntime_cxx_api.h>
 
+#include "cuda-device-buffer.h"
+
+class SharedEngine;
+
 struct ORTModelData {
-	std::unique_ptr<Ort::Session> session;
-	std::unique_ptr<Ort::Env> env;
+	std::shared_ptr<Ort::Session> session;
+	// Set when session is shared with other filter instances (see shared-engine.h)
+	std::shared_ptr<SharedEngine> sharedEngine;
 	std::vector<Ort::AllocatedStringPtr> inputNames;
 	std::vector<Ort::AllocatedStringPtr> outputNames;
 	std::vector<Ort::Value> inputTensor;
@@ -14,6 +19,31 @@ struct ORTModelData {
 	std::vector<std::vector<int64_t>> outputDims;
 	std::vector<std::vector<float>> outputTensorValues;
 	std::vector<std::vector<float>> inputTensorValues;
+
+	// IoBinding mode: device memory backing inputTensor/outputTensor, bound to
+	// the session once. Inputs the model keeps on the host have an empty buffer.
+	// The host vectors above stay allocated for extra scalar inputs and as the
+	// download target of output 0.
+	std::vector<CudaDeviceBuffer> inputDeviceBuffers;
+	std::vector<CudaDeviceBuffer> outputDeviceBuffers;
+	std::unique_ptr<Ort::IoBinding> ioBinding;
+	// Indexed by recurrentParity: the recurrent buffer swap alternates between
+	// two sets of bound addresses, each replayed as its own ORT CUDA graph
+	Ort::RunOptions ioBindingRunOptions[2] = {Ort::RunOptions{nullptr}, Ort::RunOptions{nullptr}};
+	int recurrentParity = 0;
+
+	// FP16 model variants bind half-precision tensors: preprocessing writes
+	// input 0 as FP16 (halfInput), and output 0 is bound to halfOutput and
+	// converted into outputDeviceBuffers[0] after each run, so every consumer
+	// of the output keeps reading floats
+	bool halfInput = false;
+	CudaDeviceBuffer halfOutput;
+
+	// Tiled inference: whether the session accepts a batch of inputs ([N, ...]
+	// input and output), and the device batch tensors, grown on demand
+	bool dynamicBatch = false;
+	CudaDeviceBuffer tileInputBuffer;
+	CudaDeviceBuffer tileOutputBuffer;
 };
 
 #endif /* ORTMODELDATA_H */
@@ -1,33 +1,106 @@
 #include "async-inference-queue.h"
 
+#include <algorithm>
+#include <string>
+
 #include <obs-module.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 #include "profiler.h"
 #include "plugin-support.h"
 
+// Nice value of low-priority workers: below the OBS video, audio and encoder
+// threads, which run at the default, so they take the CPU first
+static constexpr int kLowPriorityNice = 10;
+
+// Apply a worker policy to the calling thread. Failures leave the thread as it
+// is: the queue runs either way.
+static void applyWorkerPolicy(const AsyncInferenceQueue::WorkerPolicy &policy)
+{
+	if (policy.priority == SchedulingPriority::LOW) {
+		// Linux nice values are per thread (the tid is a PRIO_PROCESS id)
+		const id_t tid = (id_t)syscall(SYS_gettid);
+		if (setpriority(PRIO_PROCESS, tid, kLowPriorityNice) != 0) {
+			obs_log(LOG_WARNING, "Unable to lower the inference worker priority");
+		}
+	}
+	if (!policy.cpus.empty()) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (int cpu : policy.cpus) {
+			if (cpu >= 0 && cpu < CPU_SETSIZE) {
+				CPU_SET(cpu, &set);
+			}
+		}
+		if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+			obs_log(LOG_WARNING, "Unable to pin the inference worker to the configured CPUs");
+		}
+	}
+}
+
 AsyncInferenceQueue::~AsyncInferenceQueue()
 {
 	stop();
 }
 
-void AsyncInferenceQueue::start(InferenceFunc func, BufferingMode mode)
+void AsyncInferenceQueue::start(InferenceFunc func, BufferingMode mode, int device)
+{
+	std::vector<StageFunc> stages;
+	stages.push_back([func = std::move(func)](Slot &slot, int) {
+		NVTX_RANGE_COLOR("async_inference_worker", NVTX_COLOR_INFERENCE);
+		return func(slot.frame, slot.output);
+	});
+	startStages(std::move(stages), mode, device);
+}
+
+void AsyncInferenceQueue::start(PipelineStages stages, BufferingMode mode, int device)
+{
+	std::vector<StageFunc> stageFuncs;
+	stageFuncs.push_back([func = std::move(stages.preprocess)](Slot &slot, int index) {
+		NVTX_RANGE_COLOR("async_preprocess_stage", NVTX_COLOR_PREPROCESS);
+		return func(slot.frame, index);
+	});
+	stageFuncs.push_back([func = std::move(stages.infer)](Slot &, int index) {
+		NVTX_RANGE_COLOR("async_inference_stage", NVTX_COLOR_INFERENCE);
+		return func(index);
+	});
+	stageFuncs.push_back([func = std::move(stages.postprocess)](Slot &slot, int index) {
+		NVTX_RANGE_COLOR("async_postprocess_stage", NVTX_COLOR_POSTPROCESS);
+		return func(slot.frame, index, slot.output);
+	});
+	startStages(std::move(stageFuncs), mode, device);
+}
+
+void AsyncInferenceQueue::startStages(std::vector<StageFunc> stages, BufferingMode mode, int device)
 {
 	if (running_.load()) {
 		stop();
 	}
 
-	inferenceFunc_ = std::move(func);
+	stages_ = std::move(stages);
 	bufferingMode_ = mode;
-	running_.store(true);
-	hasNewInput_ = false;
-	hasOutput_ = false;
+	device_ = device;
+	slotCount_ = std::min(slotCount(mode), kMaxSlots);
+	for (auto &slot : slots_) {
+		slot.state.store(SLOT_FREE);
+	}
+	writeIndex_ = 0;
 	framesProcessed_.store(0);
 	framesDropped_.store(0);
+	running_.store(true);
 
-	workerThread_ = std::thread(&AsyncInferenceQueue::workerLoop, this);
+	for (size_t i = 0; i < stages_.size(); i++) {
+		workerThreads_.emplace_back(&AsyncInferenceQueue::stageLoop, this, i);
+	}
 
-	obs_log(LOG_INFO, "Async inference started (%s buffering)",
-		mode == BufferingMode::TRIPLE ? "triple" : "double");
+	obs_log(LOG_INFO, "Async inference started (%s buffering, %d slots, %d stages, GPU %d, %s priority, %s)",
+		mode == BufferingMode::TRIPLE ? "triple" : "double", slotCount_, (int)stages_.size(), device,
+		schedulingPriorityName(workerPolicy_.priority),
+		workerPolicy_.cpus.empty() ? "any CPU" : (std::to_string(workerPolicy_.cpus.size()) + " CPUs").c_str());
 }
 
 void AsyncInferenceQueue::stop()
@@ -37,82 +110,111 @@ void AsyncInferenceQueue::stop()
 	}
 
 	running_.store(false);
-	inputCv_.notify_all();
+	notifyStages();
 
-	if (workerThread_.joinable()) {
-		workerThread_.join();
+	for (auto &thread : workerThreads_) {
+		if (thread.joinable()) {
+			thread.join();
+		}
 	}
+	workerThreads_.clear();
 
 	obs_log(LOG_INFO, "Async inference stopped (processed: %llu, dropped: %llu)",
 		(unsigned long long)framesProcessed_.load(), (unsigned long long)framesDropped_.load());
 }
 
-void AsyncInferenceQueue::pushFrame(const cv::Mat &frameBGRA)
+void AsyncInferenceQueue::notifyStages()
 {
-	NVTX_RANGE_COLOR("async_push_frame", NVTX_COLOR_MEMCOPY);
+	// Taking the mutex orders the notify after a waiter's predicate check
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex_);
+	}
+	wakeCv_.notify_all();
+}
 
-	std::lock_guard<std::mutex> lock(inputMutex_);
+void AsyncInferenceQueue::pushFrame(const InputFrame &frame, const cv::Rect &roi, bool partialRoi)
+{
+	NVTX_RANGE_COLOR("async_push_frame", NVTX_COLOR_MEMCOPY);
 
-	if (hasNewInput_) {
-		// Previous frame wasn't consumed yet — drop it
+	Slot *slot = &slots_[writeIndex_];
+	int expected = SLOT_FREE;
+	if (!slot->state.compare_exchange_strong(expected, SLOT_WRITING, std::memory_order_acquire)) {
+		// Ring is full — replace the newest frame if the first stage hasn't picked it up yet
+		slot = &slots_[(writeIndex_ + slotCount_ - 1) % slotCount_];
+		expected = SLOT_QUEUED;
 		framesDropped_.fetch_add(1);
+		if (!slot->state.compare_exchange_strong(expected, SLOT_WRITING, std::memory_order_acquire)) {
+			return;
+		}
+	} else {
+		writeIndex_ = (writeIndex_ + 1) % slotCount_;
 	}
 
-	frameBGRA.copyTo(inputBuffer_);
-	hasNewInput_ = true;
-	inputCv_.notify_one();
+	slot->failed = !slot->frame.copyFrom(frame);
+	slot->frame.roi = roi;
+	slot->frame.partialRoi = partialRoi;
+	slot->state.store(SLOT_QUEUED, std::memory_order_release);
+	notifyStages();
 }
 
-bool AsyncInferenceQueue::getLatestMask(cv::Mat &mask)
+bool AsyncInferenceQueue::getLatestMask(cv::Mat &mask, FrameTag *tag)
 {
-	std::lock_guard<std::mutex> lock(outputMutex_);
-	if (!hasOutput_ || outputBuffer_.empty()) {
+	if (!results_.acquire() || results_.front().mask.empty()) {
 		return false;
 	}
-	// Swap instead of copy — caller gets the buffer, we release it
-	cv::swap(outputBuffer_, mask);
-	hasOutput_ = false;
+	// Swap instead of copy — caller gets the buffer, its old one is recycled
+	cv::swap(results_.front().mask, mask);
+	if (tag) {
+		*tag = results_.front().tag;
+	}
 	return true;
 }
 
-void AsyncInferenceQueue::workerLoop()
+void AsyncInferenceQueue::stageLoop(size_t stage)
 {
-	cv::Mat localInput;
-	cv::Mat localOutput;
+	CudaDeviceScope device(device_);
+	applyWorkerPolicy(workerPolicy_);
+	const int waitState = SLOT_QUEUED + (int)stage;
+	const bool lastStage = stage + 1 == stages_.size();
+	int index = 0;
 
 	while (running_.load()) {
-		// Wait for new input
-		{
-			std::unique_lock<std::mutex> lock(inputMutex_);
-			inputCv_.wait(lock, [this] { return hasNewInput_ || !running_.load(); });
-
-			if (!running_.load()) {
-				break;
-			}
-
-			// Swap input buffer into local — avoids 8.3MB copy,
-			// lock is held so pushFrame can't race
-			cv::swap(inputBuffer_, localInput);
-			hasNewInput_ = false;
-		}
-
-		if (localInput.empty()) {
+		Slot &slot = slots_[index];
+
+		// Wait for the previous stage (or the producer) to hand over the slot, then
+		// claim it so the producer can no longer replace the frame
+		int expected = waitState;
+		if (!slot.state.compare_exchange_strong(expected, waitState + SLOT_BUSY, std::memory_order_acquire)) {
+			std::unique_lock<std::mutex> lock(wakeMutex_);
+			wakeCv_.wait(lock, [&] {
+				return slot.state.load(std::memory_order_acquire) == waitState || !running_.load();
+			});
 			continue;
 		}
 
-		// Run inference
-		try {
-			NVTX_RANGE_COLOR("async_inference_worker", NVTX_COLOR_INFERENCE);
+		if (!slot.failed) {
+			try {
+				slot.failed = !stages_[stage](slot, index);
+			} catch (const std::exception &e) {
+				obs_log(LOG_ERROR, "Async inference error: %s", e.what());
+				slot.failed = true;
+			}
+		}
 
-			if (inferenceFunc_ && inferenceFunc_(localInput, localOutput)) {
+		if (lastStage) {
+			if (!slot.failed && !slot.output.empty()) {
 				// Publish result
-				std::lock_guard<std::mutex> lock(outputMutex_);
-				cv::swap(localOutput, outputBuffer_);
-				hasOutput_ = true;
+				cv::swap(slot.output, results_.back().mask);
+				results_.back().tag = slot.frame.tag;
+				results_.publish();
 				framesProcessed_.fetch_add(1);
 			}
-		} catch (const std::exception &e) {
-			obs_log(LOG_ERROR, "Async inference error: %s", e.what());
+			slot.state.store(SLOT_FREE, std::memory_order_release);
+		} else {
+			slot.state.store(waitState + 1, std::memory_order_release);
 		}
+		notifyStages();
+
+		index = (index + 1) % slotCount_;
 	}
 }
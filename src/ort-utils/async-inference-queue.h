@@ -7,57 +7,132 @@
 #include <mutex>
 #include <opencv2/core.hpp>
 #include <thread>
+#include <vector>
 
 #include "gpu-info.h"
+#include "input-frame.h"
+#include "triple-buffer.h"
 
 // Thread-safe async inference queue with configurable buffering.
-// video_tick() pushes frames, a worker thread processes them,
-// video_render() pulls the latest completed mask.
+// video_tick() pushes frames into a ring of preallocated slots (2 for double,
+// 3 for triple buffering), worker threads process them, and video_tick() pulls
+// the latest completed mask from a lock-free triple buffer.
+//
+// With pipeline stages, each stage (upload/preprocess, inference,
+// download/postprocess) runs on its own thread and walks the ring in order, so
+// frame N+1 is preprocessed while frame N is inferred. Slots are handed from
+// stage to stage through an atomic state; the threads only block when idle.
 class AsyncInferenceQueue {
 public:
-	using InferenceFunc = std::function<bool(const cv::Mat &inputBGRA, cv::Mat &outputMask)>;
+	using InferenceFunc = std::function<bool(const InputFrame &input, cv::Mat &outputMask)>;
+
+	// Stage callbacks, called with the ring slot index. Each stage is called
+	// from a single thread; different stages run concurrently on different slots.
+	struct PipelineStages {
+		std::function<bool(const InputFrame &input, int slot)> preprocess;
+		std::function<bool(int slot)> infer;
+		std::function<bool(const InputFrame &input, int slot, cv::Mat &outputMask)> postprocess;
+	};
+
+	// OS scheduling of the worker threads, applied as they start
+	struct WorkerPolicy {
+		SchedulingPriority priority = SchedulingPriority::NORMAL;
+		std::vector<int> cpus; // CPUs the workers may run on, empty = any
+
+		bool operator==(const WorkerPolicy &other) const
+		{
+			return priority == other.priority && cpus == other.cpus;
+		}
+		bool operator!=(const WorkerPolicy &other) const { return !(*this == other); }
+	};
 
 	AsyncInferenceQueue() = default;
 	~AsyncInferenceQueue();
 
-	// Start the worker thread with the given inference function and buffering mode.
-	void start(InferenceFunc func, BufferingMode mode = BufferingMode::DOUBLE);
+	// Policy of the workers the next start() creates
+	void setWorkerPolicy(const WorkerPolicy &policy) { workerPolicy_ = policy; }
 
-	// Stop the worker thread and clean up.
+	// Start a single worker thread running the whole inference function per frame.
+	// The workers run with device as their current CUDA device.
+	void start(InferenceFunc func, BufferingMode mode = BufferingMode::DOUBLE, int device = 0);
+
+	// Start one worker thread per pipeline stage.
+	void start(PipelineStages stages, BufferingMode mode = BufferingMode::DOUBLE, int device = 0);
+
+	// Stop the worker threads and clean up.
 	void stop();
 
-	// Push a new frame for processing. Non-blocking; drops frame if queue is full.
-	void pushFrame(const cv::Mat &frameBGRA);
+	// Push a new frame for processing (host frames are copied into the slot's
+	// pinned buffer, device frames device-to-device). Non-blocking; when the ring
+	// is full the newest queued (not yet started) frame is replaced and counted
+	// as dropped. roi is the region the workers run inference on (stored in the
+	// slot frame's roi; empty = whole frame), partialRoi is stored with it.
+	void pushFrame(const InputFrame &frame, const cv::Rect &roi = cv::Rect(), bool partialRoi = false);
 
-	// Get the latest completed output mask. Returns false if no mask is available.
-	bool getLatestMask(cv::Mat &mask);
+	// Get the latest completed output mask and the tag of the frame it was
+	// inferred on. Returns false if no new mask is available. Single consumer
+	// (video_tick).
+	bool getLatestMask(cv::Mat &mask, FrameTag *tag = nullptr);
 
-	// Check if the worker is running.
+	// Check if the workers are running.
 	bool isRunning() const { return running_.load(); }
 
-	// Get frame processing stats.
+	// Number of ring slots for a buffering mode.
+	static int slotCount(BufferingMode mode) { return (int)mode; }
+	static constexpr int kMaxSlots = (int)BufferingMode::TRIPLE;
+
+	// Get frame processing stats. Dropped frames are genuine overruns: frames
+	// replaced in a full ring before any stage started on them.
 	uint64_t framesProcessed() const { return framesProcessed_.load(); }
 	uint64_t framesDropped() const { return framesDropped_.load(); }
 
 private:
-	void workerLoop();
-
-	InferenceFunc inferenceFunc_;
+	// Slot states: a slot waiting for stage k is in state SLOT_QUEUED + k and
+	// SLOT_QUEUED + k + SLOT_BUSY while stage k works on it
+	enum SlotState : int {
+		SLOT_FREE = 0,
+		SLOT_WRITING = -1,
+		SLOT_QUEUED = 1,
+		SLOT_BUSY = 100,
+	};
+
+	struct Slot {
+		std::atomic<int> state{SLOT_FREE};
+		InputFrame frame; // preallocated, reused between frames
+		cv::Mat output;
+		bool failed = false;
+	};
+
+	using StageFunc = std::function<bool(Slot &slot, int index)>;
+
+	void startStages(std::vector<StageFunc> stages, BufferingMode mode, int device);
+	void stageLoop(size_t stage);
+
+	void notifyStages();
+
+	std::vector<StageFunc> stages_;
 	BufferingMode bufferingMode_ = BufferingMode::DOUBLE;
+	int device_ = 0;
+	WorkerPolicy workerPolicy_;
 
-	std::thread workerThread_;
+	std::vector<std::thread> workerThreads_;
 	std::atomic<bool> running_{false};
 
-	// Input buffer: latest frame submitted by video_tick
-	cv::Mat inputBuffer_;
-	std::mutex inputMutex_;
-	std::condition_variable inputCv_;
-	bool hasNewInput_ = false;
-
-	// Output buffer: latest completed mask
-	cv::Mat outputBuffer_;
-	std::mutex outputMutex_;
-	bool hasOutput_ = false;
+	// Ring of preallocated frame slots (fixed storage, only slotCount_ in use)
+	Slot slots_[kMaxSlots];
+	int slotCount_ = kMaxSlots;
+	int writeIndex_ = 0; // producer (video_tick) only
+
+	// Parking for idle stage threads; slot handoff itself is lock-free
+	std::mutex wakeMutex_;
+	std::condition_variable wakeCv_;
+
+	// Latest completed mask and its frame's tag: last stage → video_tick
+	struct Result {
+		cv::Mat mask;
+		FrameTag tag;
+	};
+	TripleBuffer<Result> results_;
 
 	// Stats
 	std::atomic<uint64_t> framesProcessed_{0};
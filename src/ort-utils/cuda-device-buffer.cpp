@@ -0,0 +1,47 @@
+#include "cuda-device-buffer.h"
+
+#include <cuda_runtime.h>
+
+bool CudaDeviceBuffer::allocate(size_t bytes)
+{
+	reset();
+	if (cudaMalloc(&ptr_, bytes) != cudaSuccess) {
+		ptr_ = nullptr;
+		return false;
+	}
+	cudaMemset(ptr_, 0, bytes);
+	bytes_ = bytes;
+	return true;
+}
+
+void CudaDeviceBuffer::reset()
+{
+	if (ptr_) {
+		cudaFree(ptr_);
+		ptr_ = nullptr;
+	}
+	bytes_ = 0;
+}
+
+bool CudaHostBuffer::ensure(size_t bytes)
+{
+	if (ptr_ && bytes <= bytes_) {
+		return true;
+	}
+	reset();
+	if (cudaHostAlloc(&ptr_, bytes, cudaHostAllocDefault) != cudaSuccess) {
+		ptr_ = nullptr;
+		return false;
+	}
+	bytes_ = bytes;
+	return true;
+}
+
+void CudaHostBuffer::reset()
+{
+	if (ptr_) {
+		cudaFreeHost(ptr_);
+		ptr_ = nullptr;
+	}
+	bytes_ = 0;
+}
@@ -0,0 +1,76 @@
+#ifndef CUDA_DEVICE_BUFFER_H
+#define CUDA_DEVICE_BUFFER_H
+
+#include <cstddef>
+
+// Owning, move-only handle to a linear cudaMalloc allocation.
+// Used for tensors that are bound to an ORT session through IoBinding.
+class CudaDeviceBuffer {
+public:
+	CudaDeviceBuffer() = default;
+	~CudaDeviceBuffer() { reset(); }
+
+	CudaDeviceBuffer(const CudaDeviceBuffer &) = delete;
+	CudaDeviceBuffer &operator=(const CudaDeviceBuffer &) = delete;
+
+	CudaDeviceBuffer(CudaDeviceBuffer &&other) noexcept : ptr_(other.ptr_), bytes_(other.bytes_)
+	{
+		other.ptr_ = nullptr;
+		other.bytes_ = 0;
+	}
+
+	CudaDeviceBuffer &operator=(CudaDeviceBuffer &&other) noexcept
+	{
+		if (this != &other) {
+			reset();
+			ptr_ = other.ptr_;
+			bytes_ = other.bytes_;
+			other.ptr_ = nullptr;
+			other.bytes_ = 0;
+		}
+		return *this;
+	}
+
+	// Allocate (zero-initialized). Returns false on allocation failure.
+	bool allocate(size_t bytes);
+
+	// Free the allocation.
+	void reset();
+
+	void *data() const { return ptr_; }
+	size_t size() const { return bytes_; }
+	bool empty() const { return ptr_ == nullptr; }
+
+	template<typename T> T *as() const { return static_cast<T *>(ptr_); }
+
+private:
+	void *ptr_ = nullptr;
+	size_t bytes_ = 0;
+};
+
+// Owning, move-only handle to page-locked host memory (cudaHostAlloc).
+// Lets host↔device copies run asynchronously on a stream.
+class CudaHostBuffer {
+public:
+	CudaHostBuffer() = default;
+	~CudaHostBuffer() { reset(); }
+
+	CudaHostBuffer(const CudaHostBuffer &) = delete;
+	CudaHostBuffer &operator=(const CudaHostBuffer &) = delete;
+
+	// Grow to at least bytes (contents are not preserved). Returns false on allocation failure.
+	bool ensure(size_t bytes);
+
+	void reset();
+
+	void *data() const { return ptr_; }
+	size_t size() const { return bytes_; }
+
+	template<typename T> T *as() const { return static_cast<T *>(ptr_); }
+
+private:
+	void *ptr_ = nullptr;
+	size_t bytes_ = 0;
+};
+
+#endif /* CUDA_DEVICE_BUFFER_H */
@@ -0,0 +1,162 @@
+#include "cuda-gl-interop.h"
+
+#include <algorithm>
+
+#include <cuda_runtime.h>
+#include <cuda_gl_interop.h>
+
+#include "gpu-info.h"
+#include "plugin-support.h"
+
+int renderCudaDevice()
+{
+	static const int device = [] {
+		unsigned int count = 0;
+		int devices[1] = {0};
+		if (gs_get_device_type() != GS_DEVICE_OPENGL ||
+		    cudaGLGetDevices(&count, devices, 1, cudaGLDeviceListAll) != cudaSuccess || count == 0) {
+			cudaGetLastError();
+			return 0;
+		}
+		obs_log(LOG_INFO, "OBS renders on CUDA device %d", devices[0]);
+		return devices[0];
+	}();
+	return device;
+}
+
+CudaGLTexture::~CudaGLTexture()
+{
+	unregister();
+}
+
+bool CudaGLTexture::registerTexture(gs_texture_t *texture, uint32_t width, uint32_t height, Access access)
+{
+	if (!texture || gs_get_device_type() != GS_DEVICE_OPENGL) {
+		return false;
+	}
+
+	// On the OpenGL backend gs_texture_get_obj() points at the GLuint texture name
+	const unsigned int glTexture = *static_cast<const GLuint *>(gs_texture_get_obj(texture));
+
+	if (resource_ && glTexture == glTexture_ && width == width_ && height == height_) {
+		return true;
+	}
+
+	unregister();
+	device_ = renderCudaDevice();
+	CudaDeviceScope scope(device_);
+
+	const unsigned int flags = (access == Access::READ_ONLY) ? cudaGraphicsRegisterFlagsReadOnly
+								  : cudaGraphicsRegisterFlagsWriteDiscard;
+	cudaError_t err = cudaGraphicsGLRegisterImage(&resource_, glTexture, GL_TEXTURE_2D, flags);
+	if (err != cudaSuccess) {
+		obs_log(LOG_WARNING, "cudaGraphicsGLRegisterImage failed: %s", cudaGetErrorString(err));
+		resource_ = nullptr;
+		return false;
+	}
+
+	glTexture_ = glTexture;
+	width_ = width;
+	height_ = height;
+	obs_log(LOG_INFO, "Registered GL texture %u (%ux%u) with CUDA", glTexture_, width_, height_);
+	return true;
+}
+
+void CudaGLTexture::unregister()
+{
+	if (resource_) {
+		CudaDeviceScope scope(device_);
+		cudaGraphicsUnregisterResource(resource_);
+		resource_ = nullptr;
+	}
+	glTexture_ = 0;
+	width_ = 0;
+	height_ = 0;
+}
+
+bool CudaGLTexture::copyToDevice(void *dst, size_t dstPitch, size_t widthBytes, size_t height)
+{
+	if (!resource_) {
+		return false;
+	}
+	CudaDeviceScope scope(device_);
+
+	// Mapping orders the copy after all GL work already issued on the texture
+	cudaError_t err = cudaGraphicsMapResources(1, &resource_, 0);
+	if (err != cudaSuccess) {
+		obs_log(LOG_WARNING, "cudaGraphicsMapResources failed: %s", cudaGetErrorString(err));
+		return false;
+	}
+
+	cudaArray_t array = nullptr;
+	err = cudaGraphicsSubResourceGetMappedArray(&array, resource_, 0, 0);
+	if (err == cudaSuccess) {
+		err = cudaMemcpy2DFromArray(dst, dstPitch, array, 0, 0, widthBytes, height, cudaMemcpyDeviceToDevice);
+	}
+
+	cudaGraphicsUnmapResources(1, &resource_, 0);
+
+	if (err != cudaSuccess) {
+		obs_log(LOG_WARNING, "CUDA-GL texture read failed: %s", cudaGetErrorString(err));
+		return false;
+	}
+	return true;
+}
+
+// Copy a pitched buffer of another device into an array of arrayDevice. The
+// extent of an array copy is counted in array elements, not bytes.
+static cudaError_t copyPeerToArray(cudaArray_t array, int arrayDevice, const void *src, size_t srcPitch,
+				   int srcDevice, size_t widthBytes, size_t height)
+{
+	cudaChannelFormatDesc desc;
+	cudaExtent extent;
+	unsigned int flags = 0;
+	cudaError_t err = cudaArrayGetInfo(&desc, &extent, &flags, array);
+	if (err != cudaSuccess) {
+		return err;
+	}
+	const size_t elementBytes = (size_t)(desc.x + desc.y + desc.z + desc.w) / 8;
+
+	cudaMemcpy3DPeerParms params = {};
+	params.srcPtr = make_cudaPitchedPtr(const_cast<void *>(src), srcPitch, widthBytes, height);
+	params.srcDevice = srcDevice;
+	params.dstArray = array;
+	params.dstDevice = arrayDevice;
+	params.extent = make_cudaExtent(widthBytes / std::max<size_t>(elementBytes, 1), height, 1);
+	return cudaMemcpy3DPeer(&params);
+}
+
+bool CudaGLTexture::copyFromDevice(const void *src, size_t srcPitch, size_t widthBytes, size_t height,
+				   int srcDevice)
+{
+	if (!resource_) {
+		return false;
+	}
+	CudaDeviceScope scope(device_);
+
+	cudaError_t err = cudaGraphicsMapResources(1, &resource_, 0);
+	if (err != cudaSuccess) {
+		obs_log(LOG_WARNING, "cudaGraphicsMapResources failed: %s", cudaGetErrorString(err));
+		return false;
+	}
+
+	cudaArray_t array = nullptr;
+	err = cudaGraphicsSubResourceGetMappedArray(&array, resource_, 0, 0);
+	if (err == cudaSuccess) {
+		if (srcDevice == device_) {
+			err = cudaMemcpy2DToArray(array, 0, 0, src, srcPitch, widthBytes, height,
+						  cudaMemcpyDeviceToDevice);
+		} else {
+			err = copyPeerToArray(array, device_, src, srcPitch, srcDevice, widthBytes, height);
+		}
+	}
+
+	// Unmapping orders subsequent GL sampling after the copy
+	cudaGraphicsUnmapResources(1, &resource_, 0);
+
+	if (err != cudaSuccess) {
+		obs_log(LOG_WARNING, "CUDA-GL texture write failed: %s", cudaGetErrorString(err));
+		return false;
+	}
+	return true;
+}
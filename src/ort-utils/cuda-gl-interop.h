@@ -0,0 +1,66 @@
+#ifndef CUDA_GL_INTEROP_H
+#define CUDA_GL_INTEROP_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <obs-module.h>
+
+struct cudaGraphicsResource;
+
+// CUDA registration of an OBS (OpenGL) texture.
+// Lets CUDA copy texture contents device-to-device instead of going through
+// a stage surface and host memory. All methods must be called on the graphics
+// thread with the OBS graphics context current (i.e. inside video_render or
+// between obs_enter_graphics/obs_leave_graphics).
+//
+// Note: OBS stores GS_BGRA textures as GL_RGBA8, so bytes copied out of a
+// registered texture are in RGBA order.
+//
+// The texture lives on the render device (renderCudaDevice()); the methods make
+// it current themselves, so they can be called from any device scope.
+class CudaGLTexture {
+public:
+	enum class Access {
+		READ_ONLY,     // CUDA only reads (e.g. texrender input)
+		WRITE_DISCARD, // CUDA overwrites the whole texture (e.g. alpha mask)
+	};
+
+	CudaGLTexture() = default;
+	~CudaGLTexture();
+
+	CudaGLTexture(const CudaGLTexture &) = delete;
+	CudaGLTexture &operator=(const CudaGLTexture &) = delete;
+
+	// Register the texture with CUDA. Re-registers if the underlying GL texture
+	// or its size changed since the last call. Returns false if the graphics
+	// backend is not OpenGL or registration fails.
+	bool registerTexture(gs_texture_t *texture, uint32_t width, uint32_t height, Access access);
+
+	// Release the CUDA registration.
+	void unregister();
+
+	bool isRegistered() const { return resource_ != nullptr; }
+
+	// Copy the texture contents into a pitched device buffer (widthBytes x height).
+	bool copyToDevice(void *dst, size_t dstPitch, size_t widthBytes, size_t height);
+
+	// Copy a pitched device buffer on srcDevice into the texture (widthBytes x
+	// height). A buffer on another device than the render device is copied peer
+	// to peer.
+	bool copyFromDevice(const void *src, size_t srcPitch, size_t widthBytes, size_t height, int srcDevice);
+
+private:
+	cudaGraphicsResource *resource_ = nullptr;
+	int device_ = 0;
+	unsigned int glTexture_ = 0;
+	uint32_t width_ = 0;
+	uint32_t height_ = 0;
+};
+
+// CUDA device of the OBS OpenGL context (0 if it can't be determined, e.g. on
+// other graphics backends). Detected once: the first call must come from the
+// graphics thread with the context current.
+int renderCudaDevice();
+
+#endif /* CUDA_GL_INTEROP_H */
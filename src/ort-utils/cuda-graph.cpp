@@ -0,0 +1,47 @@
+#include "cuda-graph.h"
+
+#include <cuda_runtime.h>
+
+#include <algorithm>
+
+#include <obs-module.h>
+
+#include "plugin-support.h"
+
+bool CudaGraphSlot::launch(std::initializer_list<int64_t> key, CUstream_st *stream,
+			   const std::function<void()> &record)
+{
+	if (!exec_ || !std::equal(key.begin(), key.end(), key_.begin(), key_.end())) {
+		reset();
+
+		cudaError_t err = cudaStreamBeginCapture(stream, cudaStreamCaptureModeThreadLocal);
+		if (err != cudaSuccess) {
+			obs_log(LOG_WARNING, "cudaStreamBeginCapture failed: %s", cudaGetErrorString(err));
+			return false;
+		}
+		record();
+		cudaGraph_t graph = nullptr;
+		err = cudaStreamEndCapture(stream, &graph);
+		if (err == cudaSuccess) {
+			err = cudaGraphInstantiateWithFlags(&exec_, graph, 0);
+			cudaGraphDestroy(graph);
+		}
+		if (err != cudaSuccess) {
+			obs_log(LOG_WARNING, "CUDA graph capture failed: %s", cudaGetErrorString(err));
+			exec_ = nullptr;
+			return false;
+		}
+		key_.assign(key.begin(), key.end());
+	}
+
+	return cudaGraphLaunch(exec_, stream) == cudaSuccess;
+}
+
+void CudaGraphSlot::reset()
+{
+	if (exec_) {
+		cudaGraphExecDestroy(exec_);
+		exec_ = nullptr;
+	}
+	key_.clear();
+}
@@ -0,0 +1,50 @@
+#ifndef CUDA_GRAPH_H
+#define CUDA_GRAPH_H
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <vector>
+
+struct CUstream_st;
+struct CUgraphExec_st;
+
+// One captured CUDA graph, replayed with cudaGraphLaunch.
+// The caller describes everything baked into the recorded launches (device
+// pointers, sizes, parameters) as a key; a different key re-captures, e.g.
+// when the source resolution changes. Allocations and host-synchronous calls
+// must happen before launch(), outside the recorded work.
+class CudaGraphSlot {
+public:
+	CudaGraphSlot() = default;
+	~CudaGraphSlot() { reset(); }
+
+	CudaGraphSlot(const CudaGraphSlot &) = delete;
+	CudaGraphSlot &operator=(const CudaGraphSlot &) = delete;
+
+	// Replay the graph captured for key, capturing record() on stream first if
+	// needed. Returns false if capture or launch failed (nothing was queued).
+	bool launch(std::initializer_list<int64_t> key, CUstream_st *stream, const std::function<void()> &record);
+
+	void reset();
+
+private:
+	CUgraphExec_st *exec_ = nullptr;
+	std::vector<int64_t> key_;
+};
+
+// Key helpers
+inline int64_t graphKey(const void *ptr)
+{
+	return (int64_t)(uintptr_t)ptr;
+}
+
+inline int64_t graphKey(float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+#endif /* CUDA_GRAPH_H */
@@ -0,0 +1,85 @@
+#include "cuda-image-postprocess.h"
+#include "gpu-info.h"
+
+#include <cuda_runtime.h>
+
+// 3-channel float model output → RGBA uint8 (rounded like cv::Mat::convertTo, opaque alpha).
+// Channels keep their order: the host path's BGR2RGBA conversion uploaded as GS_BGRA
+// lands in the same GL_RGBA8 texels.
+__global__ void outputToRGBA(const float *__restrict__ src, int width, int height, bool planar, float scale,
+			     uint8_t *__restrict__ dst, size_t dstPitch)
+{
+	int x = blockIdx.x * blockDim.x + threadIdx.x;
+	int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if (x >= width || y >= height)
+		return;
+
+	const size_t plane = (size_t)width * height;
+	const size_t pixel = (size_t)y * width + x;
+	uint8_t rgb[3];
+	for (int c = 0; c < 3; c++) {
+		float v = planar ? src[c * plane + pixel] : src[pixel * 3 + c];
+		rgb[c] = (uint8_t)__float2int_rn(fminf(fmaxf(v * scale, 0.0f), 255.0f));
+	}
+	reinterpret_cast<uchar4 *>(dst + y * dstPitch)[x] = make_uchar4(rgb[0], rgb[1], rgb[2], 255);
+}
+
+CudaImagePostprocessor::~CudaImagePostprocessor()
+{
+	freeBuffers();
+}
+
+bool CudaImagePostprocessor::ensureImage(DeviceImage &image, int width, int height)
+{
+	const int device = currentGpuDevice();
+	if (image.data && image.width == width && image.height == height && image.device == device) {
+		return true;
+	}
+	if (image.data) {
+		CudaDeviceScope scope(image.device);
+		cudaFree(image.data);
+		image = DeviceImage();
+	}
+
+	void *data = nullptr;
+	size_t pitch = 0;
+	if (cudaMallocPitch(&data, &pitch, (size_t)width * 4, (size_t)height) != cudaSuccess) {
+		return false;
+	}
+	image.data = static_cast<uint8_t *>(data);
+	image.pitch = pitch;
+	image.width = width;
+	image.height = height;
+	image.device = device;
+	return true;
+}
+
+void CudaImagePostprocessor::freeBuffers()
+{
+	for (int i = 0; i < TripleBuffer<DeviceImage>::size(); i++) {
+		DeviceImage &image = buffers_.buffer(i);
+		if (image.data) {
+			CudaDeviceScope scope(image.device);
+			cudaFree(image.data);
+		}
+		image = DeviceImage();
+	}
+}
+
+bool CudaImagePostprocessor::process(const float *image, int width, int height, const ImagePostprocessParams &params,
+				     CUstream_st *stream)
+{
+	DeviceImage &back = buffers_.back();
+	if (!image || !ensureImage(back, width, height)) {
+		return false;
+	}
+
+	dim3 block(16, 16);
+	dim3 grid((width + block.x - 1) / block.x, (height + block.y - 1) / block.y);
+	outputToRGBA<<<grid, block, 0, stream>>>(image, width, height, params.planar, params.scale, back.data,
+						 back.pitch);
+
+	// The back buffer is complete before publish()
+	return cudaStreamSynchronize(stream) == cudaSuccess;
+}
@@ -0,0 +1,65 @@
+#ifndef CUDA_IMAGE_POSTPROCESS_H
+#define CUDA_IMAGE_POSTPROCESS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "triple-buffer.h"
+
+struct CUstream_st;
+
+// Layout and range of the 3-channel float image an image-to-image model (e.g.
+// the enhance models) writes to output 0.
+struct ImagePostprocessParams {
+	bool planar = false;  // CHW (BCHW models) instead of interleaved HWC
+	float scale = 255.0f; // factor to the [0,255] range
+};
+
+// 4-channel uint8 image resident in device memory (pitched), in RGBA byte
+// order: the layout of a GS_BGRA texture (GL_RGBA8) written via CUDA-GL interop.
+struct DeviceImage {
+	uint8_t *data = nullptr;
+	size_t pitch = 0;
+	int width = 0;
+	int height = 0;
+	int device = 0; // CUDA device the memory lives on
+
+	bool empty() const { return data == nullptr || width == 0 || height == 0; }
+};
+
+// CUDA output postprocessor of the enhance filter.
+// Converts the model output left in device memory by the IoBinding path into
+// an RGBA image and keeps it in a triple-buffered device image that
+// video_render copies straight into a persistent interop texture.
+class CudaImagePostprocessor {
+public:
+	CudaImagePostprocessor() = default;
+	~CudaImagePostprocessor();
+
+	CudaImagePostprocessor(const CudaImagePostprocessor &) = delete;
+	CudaImagePostprocessor &operator=(const CudaImagePostprocessor &) = delete;
+
+	// Convert a width x height model output (device memory, ordered on stream)
+	// into the back buffer and wait for it.
+	bool process(const float *image, int width, int height, const ImagePostprocessParams &params,
+		     CUstream_st *stream);
+
+	// Hand the back buffer over to the reader (lock-free, single producer).
+	void publish() { buffers_.publish(); }
+
+	// Reader side: take the latest published image into front(). Returns whether
+	// a new image was published since the last acquire().
+	bool acquire() { return buffers_.acquire(); }
+
+	// Latest acquired image (empty until the first publish).
+	const DeviceImage &front() const { return buffers_.front(); }
+
+	void freeBuffers();
+
+private:
+	bool ensureImage(DeviceImage &image, int width, int height);
+
+	TripleBuffer<DeviceImage> buffers_;
+};
+
+#endif /* CUDA_IMAGE_POSTPROCESS_H */
@@ -0,0 +1,741 @@
+#include "cuda-mask-postprocess.h"
+#include "gpu-info.h"
+
+#include <cuda_runtime.h>
+#include <algorithm>
+#include <cstdlib>
+
+// Temporal smoothing: history = f * mask + (1 - f) * history (rounded like cv::addWeighted).
+__global__ void blendMask(const uint8_t *__restrict__ mask, size_t maskPitch, uint8_t *__restrict__ history,
+			  size_t historyPitch, int width, int height, float factor)
+{
+	int x = blockIdx.x * blockDim.x + threadIdx.x;
+	int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if (x >= width || y >= height)
+		return;
+
+	float v = mask[y * maskPitch + x] * factor + history[y * historyPitch + x] * (1.0f - factor);
+	history[y * historyPitch + x] = (uint8_t)fminf(fmaxf(v + 0.5f, 0.0f), 255.0f);
+}
+
+// Bilinear mask resize with optional re-binarization (> 128 → 255).
+__global__ void resizeMask(const uint8_t *__restrict__ src, size_t srcPitch, int srcWidth, int srcHeight,
+			   uint8_t *__restrict__ dst, size_t dstPitch, int dstWidth, int dstHeight, float scaleX,
+			   float scaleY, bool binarize)
+{
+	int x = blockIdx.x * blockDim.x + threadIdx.x;
+	int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if (x >= dstWidth || y >= dstHeight)
+		return;
+
+	float srcX = (x + 0.5f) * scaleX - 0.5f;
+	float srcY = (y + 0.5f) * scaleY - 0.5f;
+
+	int x0 = (int)floorf(srcX);
+	int y0 = (int)floorf(srcY);
+	int x1 = min(x0 + 1, srcWidth - 1);
+	int y1 = min(y0 + 1, srcHeight - 1);
+	x0 = max(x0, 0);
+	y0 = max(y0, 0);
+
+	float fx = srcX - floorf(srcX);
+	float fy = srcY - floorf(srcY);
+
+	float v = src[y0 * srcPitch + x0] * (1.0f - fx) * (1.0f - fy) + src[y0 * srcPitch + x1] * fx * (1.0f - fy) +
+		  src[y1 * srcPitch + x0] * (1.0f - fx) * fy + src[y1 * srcPitch + x1] * fx * fy;
+
+	if (binarize) {
+		dst[y * dstPitch + x] = v > 128.0f ? 255 : 0;
+	} else {
+		dst[y * dstPitch + x] = (uint8_t)fminf(v + 0.5f, 255.0f);
+	}
+}
+
+// Separable box blur pass (horizontal when dx = 1, vertical when dy = 1), replicated border.
+__global__ void boxBlurPass(const uint8_t *__restrict__ src, size_t srcPitch, uint8_t *__restrict__ dst,
+			    size_t dstPitch, int width, int height, int radius, int dx, int dy)
+{
+	int x = blockIdx.x * blockDim.x + threadIdx.x;
+	int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if (x >= width || y >= height)
+		return;
+
+	int sum = 0;
+	for (int i = -radius; i <= radius; i++) {
+		int sx = min(max(x + i * dx, 0), width - 1);
+		int sy = min(max(y + i * dy, 0), height - 1);
+		sum += src[sy * srcPitch + sx];
+	}
+	dst[y * dstPitch + x] = (uint8_t)((sum + radius) / (2 * radius + 1));
+}
+
+// Separable erode (min) / dilate (max) pass with a square structuring element.
+__global__ void morphPass(const uint8_t *__restrict__ src, size_t srcPitch, uint8_t *__restrict__ dst,
+			  size_t dstPitch, int width, int height, int radius, int dx, int dy, bool erode)
+{
+	int x = blockIdx.x * blockDim.x + threadIdx.x;
+	int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if (x >= width || y >= height)
+		return;
+
+	int v = erode ? 255 : 0;
+	for (int i = -radius; i <= radius; i++) {
+		int sx = min(max(x + i * dx, 0), width - 1);
+		int sy = min(max(y + i * dy, 0), height - 1);
+		int s = src[sy * srcPitch + sx];
+		v = erode ? min(v, s) : max(v, s);
+	}
+	dst[y * dstPitch + x] = (uint8_t)v;
+}
+
+// Foreground alpha matte [0,1] → uint8 background mask (rounded like cv::Mat::convertTo).
+__global__ void alphaToBackgroundMask(const float *__restrict__ alpha, uint8_t *__restrict__ mask,
+				      size_t maskPitch, int width, int height)
+{
+	int x = blockIdx.x * blockDim.x + threadIdx.x;
+	int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if (x >= width || y >= height)
+		return;
+
+	int a = __float2int_rn(fminf(fmaxf(alpha[y * width + x], 0.0f), 1.0f) * 255.0f);
+	mask[y * maskPitch + x] = (uint8_t)(255 - a);
+}
+
+// Blob filter: connected-component labeling of the binarized mask (union-find
+// with atomicMin, as in Playne & Hawick). Mask pixels (>= 128) are labeled
+// 8-connected and the rest 4-connected, the topology cv::findContours sees.
+// Labels are the linear index of the component root, its top-left pixel.
+__device__ __forceinline__ bool isMaskPixel(const uint8_t *mask, size_t pitch, int x, int y)
+{
+	return mask[y * pitch + x] >= 128;
+}
+
+__device__ int findRoot(const int *labels, int a)
+{
+	while (labels[a] != a) {
+		a = labels[a];
+	}
+	return a;
+}
+
+__device__ void unite(int *labels, int a, int b)
+{
+	bool done = false;
+	while (!done) {
+		a = findRoot(labels, a);
+		b = findRoot(labels, b);
+		if (a < b) {
+			const int old = atomicMin(&labels[b], a);
+			done = old == b;
+			b = old;
+		} else if (b < a) {
+			const int old = atomicMin(&labels[a], b);
+			done = old == a;
+			a = old;
+		} else {
+			done = true;
+		}
+	}
+}
+
+__global__ void labelInit(int *__restrict__ labels, int width, int height)
+{
+	int x = blockIdx.x * blockDim.x + threadIdx.x;
+	int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if (x >= width || y >= height)
+		return;
+
+	labels[y * width + x] = y * width + x;
+}
+
+__global__ void labelMerge(const uint8_t *__restrict__ mask, size_t pitch, int *labels, int width, int height)
+{
+	int x = blockIdx.x * blockDim.x + threadIdx.x;
+	int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if (x >= width || y >= height)
+		return;
+
+	const bool fg = isMaskPixel(mask, pitch, x, y);
+	const int i = y * width + x;
+	if (x > 0 && isMaskPixel(mask, pitch, x - 1, y) == fg) {
+		unite(labels, i, i - 1);
+	}
+	if (y > 0 && isMaskPixel(mask, pitch, x, y - 1) == fg) {
+		unite(labels, i, i - width);
+	}
+	if (fg && y > 0 && x > 0 && isMaskPixel(mask, pitch, x - 1, y - 1)) {
+		unite(labels, i, i - width - 1);
+	}
+	if (fg && y > 0 && x + 1 < width && isMaskPixel(mask, pitch, x + 1, y - 1)) {
+		unite(labels, i, i - width + 1);
+	}
+}
+
+// Flatten the trees and collect per root: pixel count, border contact and the lowest
+// adjacent root of the other class. For a hole that is the blob around it, for
+// a blob the region around it (both have their root above the own root).
+__global__ void labelStats(const uint8_t *__restrict__ mask, size_t pitch, int *labels, int *__restrict__ area,
+			   int *__restrict__ border, int *__restrict__ around, int width, int height)
+{
+	int x = blockIdx.x * blockDim.x + threadIdx.x;
+	int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if (x >= width || y >= height)
+		return;
+
+	const int i = y * width + x;
+	const int root = findRoot(labels, i);
+	labels[i] = root; // roots are final after the merge: safe for concurrent finds
+	atomicAdd(&area[root], 1);
+	if (x == 0 || y == 0 || x == width - 1 || y == height - 1) {
+		border[root] = 1;
+	}
+	const bool fg = isMaskPixel(mask, pitch, x, y);
+	const int dx[4] = {-1, 1, 0, 0};
+	const int dy[4] = {0, 0, -1, 1};
+	for (int k = 0; k < 4; k++) {
+		const int nx = x + dx[k];
+		const int ny = y + dy[k];
+		if (nx >= 0 && ny >= 0 && nx < width && ny < height && isMaskPixel(mask, pitch, nx, ny) != fg) {
+			atomicMin(&around[root], findRoot(labels, ny * width + nx));
+		}
+	}
+}
+
+// Add the pixels of each hole (a region that doesn't touch the border) to the
+// blob around it: the area inside its outer contour
+__global__ void labelHoles(const uint8_t *__restrict__ mask, size_t pitch, const int *__restrict__ labels,
+			   const int *__restrict__ area, const int *__restrict__ border, const int *__restrict__ around,
+			   int *__restrict__ holeArea, int width, int height)
+{
+	int x = blockIdx.x * blockDim.x + threadIdx.x;
+	int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if (x >= width || y >= height)
+		return;
+
+	const int i = y * width + x;
+	if (labels[i] == i && !isMaskPixel(mask, pitch, x, y) && !border[i] && around[i] < width * height) {
+		atomicAdd(&holeArea[around[i]], area[i]);
+	}
+}
+
+// Nesting levels a small blob inside a hole of a large blob is followed up
+static constexpr int kMaxBlobNesting = 4;
+
+// Whether a blob stays: larger than minArea, or inside a hole of a blob that stays
+__device__ bool blobKept(const int *area, const int *holeArea, const int *border, const int *around, int blob,
+			 int pixels, float minArea)
+{
+	for (int level = 0; level < kMaxBlobNesting; level++) {
+		if ((float)(area[blob] + holeArea[blob]) > minArea) {
+			return true;
+		}
+		if (border[blob]) {
+			return false;
+		}
+		const int region = around[blob];
+		if (region >= pixels || border[region] || around[region] >= pixels) {
+			return false;
+		}
+		blob = around[region];
+	}
+	return false;
+}
+
+// Keep the blobs larger than minArea with their holes filled, clear the rest —
+// cv::drawContours of the external contours with contourArea > minArea
+__global__ void labelFilter(uint8_t *mask, size_t pitch, const int *__restrict__ labels, const int *__restrict__ area,
+			    const int *__restrict__ holeArea, const int *__restrict__ border,
+			    const int *__restrict__ around, int width, int height, float minArea)
+{
+	int x = blockIdx.x * blockDim.x + threadIdx.x;
+	int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if (x >= width || y >= height)
+		return;
+
+	const int pixels = width * height;
+	const int root = labels[y * width + x];
+	bool kept;
+	if (isMaskPixel(mask, pitch, x, y)) {
+		kept = blobKept(area, holeArea, border, around, root, pixels, minArea);
+	} else {
+		kept = !border[root] && around[root] < pixels &&
+		       blobKept(area, holeArea, border, around, around[root], pixels, minArea);
+	}
+	mask[y * pitch + x] = kept ? 255 : 0;
+}
+
+// Fast guided filter (He & Sun 2015) for the mask upsampling: the linear
+// coefficients are fitted at mask resolution against the luma of the frame,
+// then upsampled and applied to the full-resolution luma, so mask edges snap
+// to image edges instead of the blocky model grid.
+__device__ __forceinline__ float lumaAt(const uint8_t *frame, size_t pitch, int x, int y, bool rgba)
+{
+	const uchar4 p = reinterpret_cast<const uchar4 *>(frame + y * pitch)[x];
+	const float r = rgba ? p.x : p.z;
+	const float b = rgba ? p.z : p.x;
+	return (0.299f * r + 0.587f * p.y + 0.114f * b) * (1.0f / 255.0f);
+}
+
+// Guide luma averaged over each mask cell, and the mask in [0,1]
+__global__ void guidedDownsample(const uint8_t *__restrict__ frame, size_t framePitch, int frameWidth,
+				 int frameHeight, bool rgba, const uint8_t *__restrict__ mask, size_t maskPitch,
+				 float *__restrict__ guide, float *__restrict__ input, int width, int height)
+{
+	int x = blockIdx.x * blockDim.x + threadIdx.x;
+	int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if (x >= width || y >= height)
+		return;
+
+	const int x0 = x * frameWidth / width;
+	const int y0 = y * frameHeight / height;
+	const int x1 = max((x + 1) * frameWidth / width, x0 + 1);
+	const int y1 = max((y + 1) * frameHeight / height, y0 + 1);
+	float sum = 0.0f;
+	for (int sy = y0; sy < y1; sy++) {
+		for (int sx = x0; sx < x1; sx++) {
+			sum += lumaAt(frame, framePitch, sx, sy, rgba);
+		}
+	}
+	guide[y * width + x] = sum / (float)((x1 - x0) * (y1 - y0));
+	input[y * width + x] = mask[y * maskPitch + x] * (1.0f / 255.0f);
+}
+
+// Per-window linear model q = a * I + b of the mask on the guide
+__global__ void guidedCoefficients(const float *__restrict__ guide, const float *__restrict__ input,
+				   float *__restrict__ a, float *__restrict__ b, int width, int height, int radius,
+				   float eps)
+{
+	int x = blockIdx.x * blockDim.x + threadIdx.x;
+	int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if (x >= width || y >= height)
+		return;
+
+	float sumI = 0.0f, sumP = 0.0f, sumIP = 0.0f, sumII = 0.0f;
+	int count = 0;
+	for (int sy = max(y - radius, 0); sy <= min(y + radius, height - 1); sy++) {
+		for (int sx = max(x - radius, 0); sx <= min(x + radius, width - 1); sx++) {
+			const float i = guide[sy * width + sx];
+			const float p = input[sy * width + sx];
+			sumI += i;
+			sumP += p;
+			sumIP += i * p;
+			sumII += i * i;
+			count++;
+		}
+	}
+	const float meanI = sumI / count;
+	const float meanP = sumP / count;
+	const float varI = sumII / count - meanI * meanI;
+	const float covIP = sumIP / count - meanI * meanP;
+	const float ak = covIP / (varI + eps);
+	a[y * width + x] = ak;
+	b[y * width + x] = meanP - ak * meanI;
+}
+
+// Box mean of the coefficients (every pixel is covered by several windows)
+__global__ void guidedMean(const float *__restrict__ a, const float *__restrict__ b, float *__restrict__ meanA,
+			   float *__restrict__ meanB, int width, int height, int radius)
+{
+	int x = blockIdx.x * blockDim.x + threadIdx.x;
+	int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if (x >= width || y >= height)
+		return;
+
+	float sumA = 0.0f, sumB = 0.0f;
+	int count = 0;
+	for (int sy = max(y - radius, 0); sy <= min(y + radius, height - 1); sy++) {
+		for (int sx = max(x - radius, 0); sx <= min(x + radius, width - 1); sx++) {
+			sumA += a[sy * width + sx];
+			sumB += b[sy * width + sx];
+			count++;
+		}
+	}
+	meanA[y * width + x] = sumA / count;
+	meanB[y * width + x] = sumB / count;
+}
+
+__device__ __forceinline__ float sampleBilinear(const float *src, int width, int height, float srcX, float srcY)
+{
+	int x0 = (int)floorf(srcX);
+	int y0 = (int)floorf(srcY);
+	const float fx = srcX - floorf(srcX);
+	const float fy = srcY - floorf(srcY);
+	const int x1 = min(max(x0 + 1, 0), width - 1);
+	const int y1 = min(max(y0 + 1, 0), height - 1);
+	x0 = min(max(x0, 0), width - 1);
+	y0 = min(max(y0, 0), height - 1);
+	return src[y0 * width + x0] * (1.0f - fx) * (1.0f - fy) + src[y0 * width + x1] * fx * (1.0f - fy) +
+	       src[y1 * width + x0] * (1.0f - fx) * fy + src[y1 * width + x1] * fx * fy;
+}
+
+// Full resolution: bilinear coefficients applied to the frame's own luma
+__global__ void guidedApply(const uint8_t *__restrict__ frame, size_t framePitch, bool rgba,
+			    const float *__restrict__ meanA, const float *__restrict__ meanB, int maskWidth,
+			    int maskHeight, uint8_t *__restrict__ dst, size_t dstPitch, int dstWidth, int dstHeight,
+			    float scaleX, float scaleY)
+{
+	int x = blockIdx.x * blockDim.x + threadIdx.x;
+	int y = blockIdx.y * blockDim.y + threadIdx.y;
+
+	if (x >= dstWidth || y >= dstHeight)
+		return;
+
+	const float srcX = (x + 0.5f) * scaleX - 0.5f;
+	const float srcY = (y + 0.5f) * scaleY - 0.5f;
+	const float a = sampleBilinear(meanA, maskWidth, maskHeight, srcX, srcY);
+	const float b = sampleBilinear(meanB, maskWidth, maskHeight, srcX, srcY);
+	const float q = a * lumaAt(frame, framePitch, x, y, rgba) + b;
+	dst[y * dstPitch + x] = (uint8_t)fminf(fmaxf(q * 255.0f + 0.5f, 0.0f), 255.0f);
+}
+
+static dim3 gridFor(int width, int height, dim3 block)
+{
+	return dim3((width + block.x - 1) / block.x, (height + block.y - 1) / block.y);
+}
+
+// Two-pass separable box blur: src → tmp (horizontal) → dst (vertical).
+static void boxBlur(const DeviceMask &src, DeviceMask &tmp, DeviceMask &dst, int radius, cudaStream_t stream)
+{
+	dim3 block(16, 16);
+	dim3 grid = gridFor(src.width, src.height, block);
+	boxBlurPass<<<grid, block, 0, stream>>>(src.data, src.pitch, tmp.data, tmp.pitch, src.width, src.height, radius,
+						1, 0);
+	boxBlurPass<<<grid, block, 0, stream>>>(tmp.data, tmp.pitch, dst.data, dst.pitch, src.width, src.height, radius,
+						0, 1);
+}
+
+// Two-pass separable morphology: src → tmp (horizontal) → dst (vertical).
+static void morph(const DeviceMask &src, DeviceMask &tmp, DeviceMask &dst, int radius, bool erode,
+		  cudaStream_t stream)
+{
+	dim3 block(16, 16);
+	dim3 grid = gridFor(src.width, src.height, block);
+	morphPass<<<grid, block, 0, stream>>>(src.data, src.pitch, tmp.data, tmp.pitch, src.width, src.height, radius,
+					      1, 0, erode);
+	morphPass<<<grid, block, 0, stream>>>(tmp.data, tmp.pitch, dst.data, dst.pitch, src.width, src.height, radius,
+					      0, 1, erode);
+}
+
+// Blob filter in place on mask (binary, mask resolution). labels holds 5 ints
+// per pixel: parents, areas, border flags, adjacent roots and hole areas.
+static void filterBlobs(DeviceMask &mask, int *labels, float contourFilter, cudaStream_t stream)
+{
+	const int pixels = mask.width * mask.height;
+	int *parents = labels;
+	int *area = labels + pixels;
+	int *border = labels + 2 * pixels;
+	int *around = labels + 3 * pixels;
+	int *holeArea = labels + 4 * pixels;
+	cudaMemsetAsync(area, 0, 2 * (size_t)pixels * sizeof(int), stream);
+	cudaMemsetAsync(around, 0x7f, (size_t)pixels * sizeof(int), stream); // > any root
+	cudaMemsetAsync(holeArea, 0, (size_t)pixels * sizeof(int), stream);
+
+	dim3 block(16, 16);
+	dim3 grid = gridFor(mask.width, mask.height, block);
+	labelInit<<<grid, block, 0, stream>>>(parents, mask.width, mask.height);
+	labelMerge<<<grid, block, 0, stream>>>(mask.data, mask.pitch, parents, mask.width, mask.height);
+	labelStats<<<grid, block, 0, stream>>>(mask.data, mask.pitch, parents, area, border, around, mask.width,
+					       mask.height);
+	labelHoles<<<grid, block, 0, stream>>>(mask.data, mask.pitch, parents, area, border, around, holeArea,
+					       mask.width, mask.height);
+	labelFilter<<<grid, block, 0, stream>>>(mask.data, mask.pitch, parents, area, holeArea, border, around,
+						mask.width, mask.height, contourFilter * (float)pixels);
+}
+
+// Mask → frame resolution with the frame as guide. guided holds 5 floats per mask
+// pixel: guide, input, a, b (reused for the mean of a) and the mean of b.
+static void guidedUpsample(const DeviceMask &mask, const DeviceFrame &guide, float *guided, int radius, float eps,
+			   DeviceMask &dst, cudaStream_t stream)
+{
+	const int pixels = mask.width * mask.height;
+	float *guideLow = guided;
+	float *input = guided + pixels;
+	float *a = guided + 2 * pixels;
+	float *b = guided + 3 * pixels;
+	float *meanB = guided + 4 * pixels;
+	float *meanA = guideLow; // the guide is no longer needed once the coefficients are fitted
+
+	dim3 block(16, 16);
+	dim3 grid = gridFor(mask.width, mask.height, block);
+	guidedDownsample<<<grid, block, 0, stream>>>(guide.data, guide.pitch, guide.width, guide.height, guide.rgba,
+						     mask.data, mask.pitch, guideLow, input, mask.width, mask.height);
+	guidedCoefficients<<<grid, block, 0, stream>>>(guideLow, input, a, b, mask.width, mask.height, radius, eps);
+	guidedMean<<<grid, block, 0, stream>>>(a, b, meanA, meanB, mask.width, mask.height, radius);
+	guidedApply<<<gridFor(dst.width, dst.height, block), block, 0, stream>>>(
+		guide.data, guide.pitch, guide.rgba, meanA, meanB, mask.width, mask.height, dst.data, dst.pitch,
+		dst.width, dst.height, (float)mask.width / (float)dst.width, (float)mask.height / (float)dst.height);
+}
+
+// (Re)allocate a scratch buffer on the current device. Keeps the allocation if
+// it is large enough and on that device.
+static bool ensureScratch(CudaDeviceBuffer &buffer, int &bufferDevice, size_t bytes)
+{
+	const int device = currentGpuDevice();
+	if (!buffer.empty() && buffer.size() >= bytes && bufferDevice == device) {
+		return true;
+	}
+	{
+		CudaDeviceScope scope(bufferDevice);
+		buffer.reset();
+	}
+	bufferDevice = device;
+	return buffer.allocate(bytes);
+}
+
+CudaMaskPostprocessor::~CudaMaskPostprocessor()
+{
+	freeBuffers();
+	if (ownStream_) {
+		cudaStreamDestroy(ownStream_);
+		ownStream_ = nullptr;
+	}
+}
+
+CUstream_st *CudaMaskPostprocessor::stream()
+{
+	if (externalStream_) {
+		return externalStream_;
+	}
+	// Streams belong to a device: make a new one when the filter moved
+	const int device = currentGpuDevice();
+	if (ownStream_ && ownStreamDevice_ != device) {
+		CudaDeviceScope scope(ownStreamDevice_);
+		cudaStreamDestroy(ownStream_);
+		ownStream_ = nullptr;
+	}
+	if (!ownStream_) {
+		cudaStreamCreate(&ownStream_);
+		ownStreamDevice_ = device;
+	}
+	return ownStream_;
+}
+
+bool CudaMaskPostprocessor::ensureMask(DeviceMask &mask, int width, int height)
+{
+	const int device = currentGpuDevice();
+	if (mask.data && mask.width == width && mask.height == height && mask.device == device) {
+		return true;
+	}
+	if (mask.data) {
+		CudaDeviceScope scope(mask.device);
+		cudaFree(mask.data);
+		mask = DeviceMask();
+	}
+
+	void *data = nullptr;
+	size_t pitch = 0;
+	if (cudaMallocPitch(&data, &pitch, (size_t)width, (size_t)height) != cudaSuccess) {
+		return false;
+	}
+	mask.data = static_cast<uint8_t *>(data);
+	mask.pitch = pitch;
+	mask.width = width;
+	mask.height = height;
+	mask.device = device;
+	return true;
+}
+
+void CudaMaskPostprocessor::freeBuffers()
+{
+	for (DeviceMask *mask : {&upload_, &history_, &smooth_, &scratch_, &buffers_.buffer(0), &buffers_.buffer(1),
+				 &buffers_.buffer(2)}) {
+		if (mask->data) {
+			CudaDeviceScope scope(mask->device);
+			cudaFree(mask->data);
+		}
+		*mask = DeviceMask();
+	}
+	{
+		CudaDeviceScope scope(labelDevice_);
+		labels_.reset();
+	}
+	{
+		CudaDeviceScope scope(guidedDevice_);
+		guided_.reset();
+	}
+	freeDeviceFrame(guideUpload_);
+	guide_ = nullptr;
+	hasHistory_ = false;
+	for (CudaGraphSlot &graph : graphs_) {
+		graph.reset();
+	}
+}
+
+bool CudaMaskPostprocessor::uploadGuide(const uint8_t *bgra, int width, int height, size_t step)
+{
+	guide_ = nullptr;
+	if (!bgra || !ensureDeviceFrame(guideUpload_, width, height)) {
+		return false;
+	}
+	guideUpload_.rgba = false;
+	// Ordered before the refinement on the same stream, no sync
+	if (cudaMemcpy2DAsync(guideUpload_.data, guideUpload_.pitch, bgra, step, (size_t)width * 4, (size_t)height,
+			      cudaMemcpyHostToDevice, stream()) != cudaSuccess) {
+		return false;
+	}
+	guide_ = &guideUpload_;
+	return true;
+}
+
+bool CudaMaskPostprocessor::process(const uint8_t *mask, int maskWidth, int maskHeight, size_t maskStep,
+				    int frameWidth, int frameHeight, const MaskPostprocessParams &params)
+{
+	if (!ensureMask(upload_, maskWidth, maskHeight)) {
+		return false;
+	}
+
+	// Model-resolution masks are small (e.g. 256x256 = 64KB)
+	if (cudaMemcpy2DAsync(upload_.data, upload_.pitch, mask, maskStep, (size_t)maskWidth, (size_t)maskHeight,
+			      cudaMemcpyHostToDevice, stream()) != cudaSuccess) {
+		return false;
+	}
+
+	return refine(frameWidth, frameHeight, params);
+}
+
+bool CudaMaskPostprocessor::processAlpha(const float *alpha, int alphaWidth, int alphaHeight, int frameWidth,
+					 int frameHeight, const MaskPostprocessParams &params)
+{
+	if (!alpha || !ensureMask(upload_, alphaWidth, alphaHeight)) {
+		return false;
+	}
+
+	dim3 block(16, 16);
+	alphaToBackgroundMask<<<gridFor(alphaWidth, alphaHeight, block), block, 0, stream()>>>(
+		alpha, upload_.data, upload_.pitch, alphaWidth, alphaHeight);
+
+	return refine(frameWidth, frameHeight, params);
+}
+
+bool CudaMaskPostprocessor::refine(int frameWidth, int frameHeight, const MaskPostprocessParams &params)
+{
+	const int maskWidth = upload_.width;
+	const int maskHeight = upload_.height;
+	const int backIndex = buffers_.backIndex();
+	DeviceMask &back = buffers_.back();
+
+	// Allocate everything up front — the recorded launches below may be graph-captured
+	if (!ensureMask(back, frameWidth, frameHeight) || !ensureMask(scratch_, frameWidth, frameHeight)) {
+		return false;
+	}
+	const bool temporal = params.temporalSmoothFactor > 0.0f && params.temporalSmoothFactor < 1.0f;
+	if (temporal) {
+		if (history_.width != maskWidth || history_.height != maskHeight) {
+			hasHistory_ = false;
+		}
+		if (!ensureMask(history_, maskWidth, maskHeight)) {
+			return false;
+		}
+	}
+	if (params.smoothKernel > 0 && !ensureMask(smooth_, maskWidth, maskHeight)) {
+		return false;
+	}
+	const bool blobs = params.contourFilter > 0.0f && params.contourFilter < 1.0f;
+	if (blobs && !ensureScratch(labels_, labelDevice_, 5 * (size_t)maskWidth * maskHeight * sizeof(int))) {
+		return false;
+	}
+	// The guide is taken for this call only
+	const DeviceFrame *guide = guide_;
+	guide_ = nullptr;
+	const bool guided = params.guidedRadius > 0 && guide && guide->width == frameWidth &&
+			    guide->height == frameHeight && guide->device == currentGpuDevice();
+	if (guided && !ensureScratch(guided_, guidedDevice_, 5 * (size_t)maskWidth * maskHeight * sizeof(float))) {
+		return false;
+	}
+
+	const bool blend = temporal && hasHistory_;
+	cudaStream_t s = stream();
+	dim3 block(16, 16);
+
+	auto record = [&]() {
+		const DeviceMask *current = &upload_;
+
+		// Small blobs off the new mask, before it enters the history (as the CPU path did)
+		if (blobs) {
+			filterBlobs(upload_, labels_.as<int>(), params.contourFilter, s);
+		}
+
+		// Temporal smoothing at mask resolution
+		if (blend) {
+			blendMask<<<gridFor(maskWidth, maskHeight, block), block, 0, s>>>(
+				upload_.data, upload_.pitch, history_.data, history_.pitch, maskWidth, maskHeight,
+				params.temporalSmoothFactor);
+		} else if (temporal) {
+			cudaMemcpy2DAsync(history_.data, history_.pitch, upload_.data, upload_.pitch, (size_t)maskWidth,
+					  (size_t)maskHeight, cudaMemcpyDeviceToDevice, s);
+		}
+		if (temporal) {
+			current = &history_;
+		}
+
+		// Smooth silhouette at mask resolution (the history stays unblurred)
+		if (params.smoothKernel > 0) {
+			boxBlur(*current, smooth_, upload_, params.smoothKernel / 2, s);
+			current = &upload_;
+		}
+
+		// Resize to frame resolution: guided by the frame (soft edges along image
+		// edges), or bilinear, re-binarizing after the smoothing blur
+		if (guided) {
+			guidedUpsample(*current, *guide, guided_.as<float>(), params.guidedRadius, params.guidedEps,
+				       back, s);
+		} else {
+			resizeMask<<<gridFor(frameWidth, frameHeight, block), block, 0, s>>>(
+				current->data, current->pitch, maskWidth, maskHeight, back.data, back.pitch,
+				frameWidth, frameHeight, (float)maskWidth / (float)frameWidth,
+				(float)maskHeight / (float)frameHeight, params.smoothKernel > 0);
+		}
+
+		// Expand (erode the background) or shrink (dilate the background)
+		if (params.expansion != 0) {
+			morph(back, scratch_, back, std::abs(params.expansion), params.expansion > 0, s);
+		}
+
+		// Feather: grow the background then soften the edge
+		if (params.featherKernel > 0) {
+			morph(back, scratch_, back, params.featherKernel / 3, false, s);
+			boxBlur(back, scratch_, back, params.featherKernel / 2, s);
+		}
+	};
+
+	// One graph per back buffer; any change of size, buffers or parameters re-captures.
+	// Guided frames launch directly: the guide moves between input buffers every frame.
+	if (!graphMode_ || guided ||
+	    !graphs_[backIndex].launch({graphKey(upload_.data), (int64_t)upload_.pitch, maskWidth, maskHeight,
+					graphKey(history_.data), (int64_t)history_.pitch, graphKey(smooth_.data),
+					(int64_t)smooth_.pitch, graphKey(scratch_.data), (int64_t)scratch_.pitch,
+					graphKey(back.data), (int64_t)back.pitch, frameWidth, frameHeight, temporal,
+					blend, graphKey(params.temporalSmoothFactor), params.smoothKernel,
+					params.expansion, params.featherKernel, graphKey(labels_.data()),
+					graphKey(blobs ? params.contourFilter : 0.0f)},
+				       s, record)) {
+		record();
+	}
+	hasHistory_ = temporal;
+
+	// The one sync of the frame: the back buffer is complete before publish()
+	return cudaStreamSynchronize(s) == cudaSuccess;
+}
+
+void CudaMaskPostprocessor::setGraphMode(bool enabled)
+{
+	graphMode_ = enabled;
+	if (!enabled) {
+		for (CudaGraphSlot &graph : graphs_) {
+			graph.reset();
+		}
+	}
+}
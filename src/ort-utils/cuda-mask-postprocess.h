@@ -0,0 +1,126 @@
+#ifndef CUDA_MASK_POSTPROCESS_H
+#define CUDA_MASK_POSTPROCESS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "cuda-device-buffer.h"
+#include "cuda-graph.h"
+#include "cuda-preprocess.h"
+#include "triple-buffer.h"
+
+struct CUstream_st;
+
+// Single-channel uint8 mask resident in device memory (pitched).
+struct DeviceMask {
+	uint8_t *data = nullptr;
+	size_t pitch = 0;
+	int width = 0;
+	int height = 0;
+	int device = 0; // CUDA device the memory lives on
+
+	bool empty() const { return data == nullptr || width == 0 || height == 0; }
+};
+
+// Parameters of the background mask refinement chain.
+// Mirrors the CPU postprocessing in background_filter_video_tick().
+struct MaskPostprocessParams {
+	float contourFilter = 0.0f;        // drop blobs up to this fraction of the mask area; <= 0 or >= 1 disables
+	float temporalSmoothFactor = 0.0f; // weight of the new mask; <= 0 or >= 1 disables the blend
+	int smoothKernel = 0;              // box blur size at mask resolution + re-binarize after resize (0 = off)
+	int expansion = 0;                 // > 0 erode, < 0 dilate, in pixels at frame resolution
+	int featherKernel = 0;             // feather box filter size at frame resolution (0 = off)
+	int guidedRadius = 0;              // > 0: guided upsampling (box radius at mask resolution) instead of bilinear
+	float guidedEps = 1e-3f;           // guided filter regularization (guide and mask in [0,1])
+};
+
+// CUDA background mask postprocessor.
+// Takes the model-resolution background mask, applies the blob filter
+// (connected-component labeling), temporal smoothing, smoothing,
+// resize-to-frame (bilinear, or a fast guided filter with the frame as guide),
+// expansion and feathering on the GPU, and keeps
+// the frame-resolution result in a triple-buffered device mask that
+// video_render copies straight into a persistent interop texture.
+class CudaMaskPostprocessor {
+public:
+	CudaMaskPostprocessor() = default;
+	~CudaMaskPostprocessor();
+
+	CudaMaskPostprocessor(const CudaMaskPostprocessor &) = delete;
+	CudaMaskPostprocessor &operator=(const CudaMaskPostprocessor &) = delete;
+
+	// Upload a host uint8 background mask and run the refinement chain into the back buffer.
+	bool process(const uint8_t *mask, int maskWidth, int maskHeight, size_t maskStep, int frameWidth,
+		     int frameHeight, const MaskPostprocessParams &params);
+
+	// Same as process(), but for a [0,1] float foreground alpha matte that is
+	// already in device memory (IoBinding output). The background mask is
+	// 255 - alpha * 255, computed on the device.
+	bool processAlpha(const float *alpha, int alphaWidth, int alphaHeight, int frameWidth, int frameHeight,
+			  const MaskPostprocessParams &params);
+
+	// Guide of the next process() call's guided upsampling: the full-resolution BGRA
+	// frame the mask was inferred from. Device frames must stay valid until then;
+	// host frames are uploaded on the postprocessor's stream. Without a guide (or
+	// with one of another size) the mask is resized bilinearly.
+	void setGuide(const DeviceFrame *frame) { guide_ = frame; }
+	bool uploadGuide(const uint8_t *bgra, int width, int height, size_t step);
+
+	// Hand the back buffer over to the reader (lock-free, single producer).
+	void publish() { buffers_.publish(); }
+
+	// Reader side: take the latest published mask into front(). Returns whether
+	// a new mask was published since the last acquire().
+	bool acquire() { return buffers_.acquire(); }
+
+	// Latest acquired frame-resolution mask (empty until the first publish).
+	const DeviceMask &front() const { return buffers_.front(); }
+
+	// Queue work on an external stream (e.g. the preprocessor/ORT stream, so a
+	// device-resident model output is consumed in stream order) instead of the
+	// postprocessor's own stream. nullptr restores the own stream.
+	void setStream(CUstream_st *stream) { externalStream_ = stream; }
+
+	// Graph mode: record the refinement chain as a CUDA graph per output buffer
+	// and replay it while sizes and parameters are unchanged.
+	void setGraphMode(bool enabled);
+
+	// Drop the temporal history (e.g. after a model change).
+	void resetHistory() { hasHistory_ = false; }
+
+	void freeBuffers();
+
+private:
+	CUstream_st *stream();
+	bool ensureMask(DeviceMask &mask, int width, int height);
+	bool refine(int frameWidth, int frameHeight, const MaskPostprocessParams &params);
+
+	CUstream_st *externalStream_ = nullptr;
+	CUstream_st *ownStream_ = nullptr;
+	int ownStreamDevice_ = -1;
+
+	// Model-resolution working set
+	DeviceMask upload_;
+	DeviceMask history_;
+	DeviceMask smooth_;
+	bool hasHistory_ = false;
+
+	// Blob filter working set: 5 ints per mask pixel (see filterBlobs)
+	CudaDeviceBuffer labels_;
+	int labelDevice_ = -1;
+
+	// Guided upsampling: the guide and 5 floats per mask pixel (see guidedUpsample)
+	const DeviceFrame *guide_ = nullptr;
+	DeviceFrame guideUpload_;
+	CudaDeviceBuffer guided_;
+	int guidedDevice_ = -1;
+
+	// Frame-resolution scratch and triple-buffered output
+	DeviceMask scratch_;
+	TripleBuffer<DeviceMask> buffers_;
+
+	bool graphMode_ = false;
+	CudaGraphSlot graphs_[TripleBuffer<DeviceMask>::size()];
+};
+
+#endif /* CUDA_MASK_POSTPROCESS_H */
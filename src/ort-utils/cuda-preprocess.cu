@@ -1,21 +1,18 @@
 #include "cuda-preprocess.h"
+#include "gpu-info.h"
 
+#include <cuda_fp16.h>
 #include <cuda_runtime.h>
 #include <algorithm>
+#include <cstring>
 
-// Fused BGRA→RGB resize + normalize kernel (HWC output).
-// Each thread processes one output pixel.
-__global__ void preprocessBGRA_HWC(const uint8_t *__restrict__ bgra, int bgraWidth, int bgraHeight, int bgraStep,
-				   float *__restrict__ output, int outWidth, int outHeight, float scaleX, float scaleY,
-				   float meanR, float meanG, float meanB, float invScaleR, float invScaleG,
-				   float invScaleB)
+// Bilinear RGB sample of output pixel (x, y) of a resize by (scaleX, scaleY).
+// Shared by the preprocessing kernels and the motion detector, so both read
+// the frame the same way.
+__device__ __forceinline__ void sampleRGB(const uint8_t *__restrict__ bgra, int bgraWidth, int bgraHeight,
+					  int bgraStep, int x, int y, float scaleX, float scaleY, int rIdx, int bIdx,
+					  float &r, float &g, float &b)
 {
-	int x = blockIdx.x * blockDim.x + threadIdx.x;
-	int y = blockIdx.y * blockDim.y + threadIdx.y;
-
-	if (x >= outWidth || y >= outHeight)
-		return;
-
 	// Bilinear interpolation source coordinates
 	float srcX = (x + 0.5f) * scaleX - 0.5f;
 	float srcY = (y + 0.5f) * scaleY - 0.5f;
@@ -41,23 +38,31 @@ __global__ void preprocessBGRA_HWC(const uint8_t *__restrict__ bgra, int bgraWid
 	float w01 = (1.0f - fx) * fy;
 	float w11 = fx * fy;
 
-	// BGRA layout: B=0, G=1, R=2 → output RGB
-	float r = p00[2] * w00 + p10[2] * w10 + p01[2] * w01 + p11[2] * w11;
-	float g = p00[1] * w00 + p10[1] * w10 + p01[1] * w01 + p11[1] * w11;
-	float b = p00[0] * w00 + p10[0] * w10 + p01[0] * w01 + p11[0] * w11;
+	// BGRA layout: B=0, G=1, R=2 → output RGB (rIdx/bIdx are swapped for RGBA sources)
+	r = p00[rIdx] * w00 + p10[rIdx] * w10 + p01[rIdx] * w01 + p11[rIdx] * w11;
+	g = p00[1] * w00 + p10[1] * w10 + p01[1] * w01 + p11[1] * w11;
+	b = p00[bIdx] * w00 + p10[bIdx] * w10 + p01[bIdx] * w01 + p11[bIdx] * w11;
+}
 
-	// Normalize: (pixel - mean) / scale = (pixel - mean) * invScale
-	int idx = (y * outWidth + x) * 3;
-	output[idx + 0] = (r - meanR) * invScaleR;
-	output[idx + 1] = (g - meanG) * invScaleG;
-	output[idx + 2] = (b - meanB) * invScaleB;
+// Tensor element of a normalized value: FP32, or FP16 for half-precision models
+template<typename T> __device__ __forceinline__ T tensorValue(float v);
+template<> __device__ __forceinline__ float tensorValue<float>(float v)
+{
+	return v;
+}
+template<> __device__ __forceinline__ __half tensorValue<__half>(float v)
+{
+	return __float2half_rn(v);
 }
 
-// Fused BGRA→RGB resize + normalize kernel (CHW output for BCHW models).
-__global__ void preprocessBGRA_CHW(const uint8_t *__restrict__ bgra, int bgraWidth, int bgraHeight, int bgraStep,
-				   float *__restrict__ output, int outWidth, int outHeight, float scaleX, float scaleY,
-				   float meanR, float meanG, float meanB, float invScaleR, float invScaleG,
-				   float invScaleB)
+// Fused BGRA→RGB resize + normalize kernel, instantiated per tensor type,
+// layout (CHW for BCHW models, HWC otherwise) and source channel order, so the
+// channel offsets and output indexing are compile-time constants.
+// Each thread processes one output pixel.
+template<typename T, bool CHW, bool SrcRGBA>
+__global__ void preprocessFrame(const uint8_t *__restrict__ bgra, int bgraWidth, int bgraHeight, int bgraStep,
+				T *__restrict__ output, int outWidth, int outHeight, float scaleX, float scaleY,
+				float meanR, float meanG, float meanB, float invScaleR, float invScaleG, float invScaleB)
 {
 	int x = blockIdx.x * blockDim.x + threadIdx.x;
 	int y = blockIdx.y * blockDim.y + threadIdx.y;
@@ -65,47 +70,176 @@ __global__ void preprocessBGRA_CHW(const uint8_t *__restrict__ bgra, int bgraWid
 	if (x >= outWidth || y >= outHeight)
 		return;
 
-	float srcX = (x + 0.5f) * scaleX - 0.5f;
-	float srcY = (y + 0.5f) * scaleY - 0.5f;
+	float r, g, b;
+	sampleRGB(bgra, bgraWidth, bgraHeight, bgraStep, x, y, scaleX, scaleY, SrcRGBA ? 0 : 2, SrcRGBA ? 2 : 0, r, g,
+		  b);
 
-	int x0 = (int)floorf(srcX);
-	int y0 = (int)floorf(srcY);
-	int x1 = min(x0 + 1, bgraWidth - 1);
-	int y1 = min(y0 + 1, bgraHeight - 1);
-	x0 = max(x0, 0);
-	y0 = max(y0, 0);
+	// Normalize: (pixel - mean) / scale = (pixel - mean) * invScale
+	const int pixel = y * outWidth + x;
+	if constexpr (CHW) {
+		// CHW: output[c * H * W + y * W + x]
+		const int planeSize = outWidth * outHeight;
+		output[pixel] = tensorValue<T>((r - meanR) * invScaleR);
+		output[planeSize + pixel] = tensorValue<T>((g - meanG) * invScaleG);
+		output[2 * planeSize + pixel] = tensorValue<T>((b - meanB) * invScaleB);
+	} else {
+		output[pixel * 3 + 0] = tensorValue<T>((r - meanR) * invScaleR);
+		output[pixel * 3 + 1] = tensorValue<T>((g - meanG) * invScaleG);
+		output[pixel * 3 + 2] = tensorValue<T>((b - meanB) * invScaleB);
+	}
+}
 
-	float fx = srcX - floorf(srcX);
-	float fy = srcY - floorf(srcY);
+// Motion map: one thread per sample of CudaMotionDetector's kSamplesX x kSamplesY
+// grid over the frame, one thread block per motion cell. Each sample's luma is
+// written to current and compared against the reference frame; the block
+// stores how many of its samples changed.
+__global__ void motionCellsBGRA(const uint8_t *__restrict__ bgra, int bgraWidth, int bgraHeight, int bgraStep,
+				float scaleX, float scaleY, int rIdx, int bIdx, const uint8_t *__restrict__ reference,
+				uint8_t *__restrict__ current, float threshold, unsigned int *__restrict__ changedCounts)
+{
+	int x = blockIdx.x * blockDim.x + threadIdx.x;
+	int y = blockIdx.y * blockDim.y + threadIdx.y;
 
-	const uint8_t *p00 = bgra + y0 * bgraStep + x0 * 4;
-	const uint8_t *p10 = bgra + y0 * bgraStep + x1 * 4;
-	const uint8_t *p01 = bgra + y1 * bgraStep + x0 * 4;
-	const uint8_t *p11 = bgra + y1 * bgraStep + x1 * 4;
+	int changed = 0;
+	if (x < CudaMotionDetector::kSamplesX && y < CudaMotionDetector::kSamplesY) {
+		float r, g, b;
+		sampleRGB(bgra, bgraWidth, bgraHeight, bgraStep, x, y, scaleX, scaleY, rIdx, bIdx, r, g, b);
+		float luma = 0.299f * r + 0.587f * g + 0.114f * b;
+		int idx = y * CudaMotionDetector::kSamplesX + x;
+		current[idx] = (uint8_t)(luma + 0.5f);
+		changed = fabsf(luma - (float)reference[idx]) > threshold;
+	}
 
-	float w00 = (1.0f - fx) * (1.0f - fy);
-	float w10 = fx * (1.0f - fy);
-	float w01 = (1.0f - fx) * fy;
-	float w11 = fx * fy;
+	// Every thread of the block reaches the barrier (no early return above)
+	int count = __syncthreads_count(changed);
+	if (threadIdx.x == 0 && threadIdx.y == 0) {
+		changedCounts[blockIdx.y * gridDim.x + blockIdx.x] = (unsigned int)count;
+	}
+}
+
+__global__ void flowLumaBGRA(const uint8_t *__restrict__ bgra, int bgraWidth, int bgraHeight, int bgraStep,
+			     float scaleX, float scaleY, int rIdx, int bIdx, uint8_t *__restrict__ luma)
+{
+	int x = blockIdx.x * blockDim.x + threadIdx.x;
+	int y = blockIdx.y * blockDim.y + threadIdx.y;
+	if (x >= CudaMaskFlow::kSamplesX || y >= CudaMaskFlow::kSamplesY)
+		return;
+	float r, g, b;
+	sampleRGB(bgra, bgraWidth, bgraHeight, bgraStep, x, y, scaleX, scaleY, rIdx, bIdx, r, g, b);
+	luma[y * CudaMaskFlow::kSamplesX + x] = (uint8_t)(0.299f * r + 0.587f * g + 0.114f * b + 0.5f);
+}
+
+// One thread block per flow block, one thread per candidate displacement of the
+// (2 * CudaMaskFlow::kSearchRadius + 1)^2 search window. The block and the
+// window are staged in shared memory; the cheapest candidate wins through an
+// atomicMin over (cost << 10 | candidate).
+__global__ void flowBlockMatch(const uint8_t *__restrict__ current, const uint8_t *__restrict__ reference,
+			       float motionCost, unsigned int flatSad, float *__restrict__ flow)
+{
+	constexpr int kSearch = 2 * CudaMaskFlow::kSearchRadius + 1;
+	constexpr int kWindow = CudaMaskFlow::kBlockSize + 2 * CudaMaskFlow::kSearchRadius;
+	__shared__ uint8_t block[CudaMaskFlow::kBlockSize][CudaMaskFlow::kBlockSize];
+	__shared__ uint8_t window[kWindow][kWindow];
+	__shared__ unsigned int best;
+	__shared__ unsigned int zeroSad;
+
+	const int originX = blockIdx.x * CudaMaskFlow::kBlockSize;
+	const int originY = blockIdx.y * CudaMaskFlow::kBlockSize;
+	const int thread = threadIdx.y * kSearch + threadIdx.x;
+	if (thread == 0) {
+		best = 0xFFFFFFFFu;
+	}
+	if (thread < CudaMaskFlow::kBlockSize * CudaMaskFlow::kBlockSize) {
+		const int bx = thread % CudaMaskFlow::kBlockSize;
+		const int by = thread / CudaMaskFlow::kBlockSize;
+		block[by][bx] = current[(originY + by) * CudaMaskFlow::kSamplesX + originX + bx];
+	}
+	// The window is clamped at the grid edges
+	for (int i = thread; i < kWindow * kWindow; i += kSearch * kSearch) {
+		const int wx = i % kWindow;
+		const int wy = i / kWindow;
+		const int x = min(max(originX + wx - CudaMaskFlow::kSearchRadius, 0), CudaMaskFlow::kSamplesX - 1);
+		const int y = min(max(originY + wy - CudaMaskFlow::kSearchRadius, 0), CudaMaskFlow::kSamplesY - 1);
+		window[wy][wx] = reference[y * CudaMaskFlow::kSamplesX + x];
+	}
+	__syncthreads();
 
-	float r = p00[2] * w00 + p10[2] * w10 + p01[2] * w01 + p11[2] * w11;
-	float g = p00[1] * w00 + p10[1] * w10 + p01[1] * w01 + p11[1] * w11;
-	float b = p00[0] * w00 + p10[0] * w10 + p01[0] * w01 + p11[0] * w11;
+	const int dx = (int)threadIdx.x - CudaMaskFlow::kSearchRadius;
+	const int dy = (int)threadIdx.y - CudaMaskFlow::kSearchRadius;
+	unsigned int sad = 0;
+	for (int y = 0; y < CudaMaskFlow::kBlockSize; y++) {
+		for (int x = 0; x < CudaMaskFlow::kBlockSize; x++) {
+			sad += abs((int)block[y][x] - (int)window[threadIdx.y + y][threadIdx.x + x]);
+		}
+	}
+	if (dx == 0 && dy == 0) {
+		zeroSad = sad;
+	}
+	// Longer vectors cost more, so flat and ambiguous blocks stay put
+	const unsigned int cost = sad + (unsigned int)(motionCost * (abs(dx) + abs(dy)));
+	atomicMin(&best, (min(cost, 0x3FFFFFu) << 10) | (unsigned int)thread);
+	__syncthreads();
 
-	// CHW: output[c * H * W + y * W + x]
-	int planeSize = outWidth * outHeight;
-	output[0 * planeSize + y * outWidth + x] = (r - meanR) * invScaleR;
-	output[1 * planeSize + y * outWidth + x] = (g - meanG) * invScaleG;
-	output[2 * planeSize + y * outWidth + x] = (b - meanB) * invScaleB;
+	if (thread == 0) {
+		const int winner = (int)(best & 0x3FFu);
+		const bool flat = zeroSad <= flatSad;
+		const int index = blockIdx.y * CudaMaskFlow::kBlocksX + blockIdx.x;
+		flow[index * 2] = flat ? 0.0f
+				       : (float)(winner % kSearch - CudaMaskFlow::kSearchRadius) /
+						 CudaMaskFlow::kSamplesX;
+		flow[index * 2 + 1] = flat ? 0.0f
+					   : (float)(winner / kSearch - CudaMaskFlow::kSearchRadius) /
+						     CudaMaskFlow::kSamplesY;
+	}
 }
 
 CudaPreprocessor::~CudaPreprocessor()
 {
 	freeBuffers();
+	for (auto &deviceStreams : streams_) {
+		for (CUstream_st *&stream : deviceStreams) {
+			if (stream) {
+				cudaStreamDestroy(stream);
+				stream = nullptr;
+			}
+		}
+	}
+}
+
+CUstream_st *CudaPreprocessor::stream()
+{
+	return stream(currentGpuDevice());
+}
+
+CUstream_st *CudaPreprocessor::stream(int device)
+{
+	return stream(device, priority_);
+}
+
+CUstream_st *CudaPreprocessor::stream(int device, SchedulingPriority priority)
+{
+	const int level = (int)priority;
+	if (device < 0 || device >= kMaxDevices || level < 0 || level >= kPriorityLevels) {
+		return nullptr;
+	}
+	// A blocking stream: it still orders after legacy default-stream work such
+	// as the CUDA-GL interop copies issued on the render thread
+	CUstream_st *&s = streams_[device][level];
+	if (!s) {
+		CudaDeviceScope scope(device);
+		cudaStreamCreateWithPriority(&s, cudaStreamDefault, cudaStreamPriority(priority));
+	}
+	return s;
 }
 
 void CudaPreprocessor::ensureBuffers(size_t bgraBytes, size_t outputFloats)
 {
+	// The filter moved to another device: reallocate there
+	const int device = currentGpuDevice();
+	if (device != bufferDevice_) {
+		freeBuffers();
+		bufferDevice_ = device;
+	}
 	if (bgraBytes > bgraCapacity_) {
 		if (d_bgra_)
 			cudaFree(d_bgra_);
@@ -122,6 +256,7 @@ void CudaPreprocessor::ensureBuffers(size_t bgraBytes, size_t outputFloats)
 
 void CudaPreprocessor::freeBuffers()
 {
+	CudaDeviceScope scope(bufferDevice_);
 	if (d_bgra_) {
 		cudaFree(d_bgra_);
 		d_bgra_ = nullptr;
@@ -132,42 +267,528 @@ void CudaPreprocessor::freeBuffers()
 	}
 	bgraCapacity_ = 0;
 	outputCapacity_ = 0;
+	stagingBGRA_.reset();
+	graph_.reset();
 }
 
-void CudaPreprocessor::preprocess(const uint8_t *bgraData, int bgraWidth, int bgraHeight, int bgraStep,
-				  float *outputTensor, int outWidth, int outHeight, const PreprocessParams &params)
+template<typename T, bool CHW, bool SrcRGBA>
+static void launchPreprocessInstance(const uint8_t *d_src, int srcWidth, int srcHeight, int srcStep, T *d_dst,
+				     int outWidth, int outHeight, float scaleX, float scaleY,
+				     const PreprocessParams &params, float invScaleR, float invScaleG, float invScaleB,
+				     cudaStream_t s)
 {
-	size_t bgraBytes = (size_t)bgraStep * bgraHeight;
-	size_t outputFloats = (size_t)outWidth * outHeight * 3;
-
-	ensureBuffers(bgraBytes, outputFloats);
+	dim3 block(16, 16);
+	dim3 grid((outWidth + block.x - 1) / block.x, (outHeight + block.y - 1) / block.y);
+	preprocessFrame<T, CHW, SrcRGBA><<<grid, block, 0, s>>>(d_src, srcWidth, srcHeight, srcStep, d_dst, outWidth,
+								outHeight, scaleX, scaleY, params.meanR, params.meanG,
+								params.meanB, invScaleR, invScaleG, invScaleB);
+}
 
-	// Upload BGRA frame to GPU
-	cudaMemcpy(d_bgra_, bgraData, bgraBytes, cudaMemcpyHostToDevice);
+// Pick the kernel instantiation for the model layout and the source channel order
+template<typename T>
+static void launchPreprocessKernel(const uint8_t *d_src, int srcWidth, int srcHeight, int srcStep, bool srcRGBA,
+				   T *d_dst, int outWidth, int outHeight, float scaleX, float scaleY,
+				   const PreprocessParams &params, float invScaleR, float invScaleG, float invScaleB,
+				   cudaStream_t s)
+{
+	auto launch = params.outputCHW ? (srcRGBA ? launchPreprocessInstance<T, true, true>
+						  : launchPreprocessInstance<T, true, false>)
+				       : (srcRGBA ? launchPreprocessInstance<T, false, true>
+						  : launchPreprocessInstance<T, false, false>);
+	launch(d_src, srcWidth, srcHeight, srcStep, d_dst, outWidth, outHeight, scaleX, scaleY, params, invScaleR,
+	       invScaleG, invScaleB, s);
+}
 
+void CudaPreprocessor::launchKernel(const uint8_t *d_src, int srcWidth, int srcHeight, int srcStep, bool srcRGBA,
+				    void *d_dst, int outWidth, int outHeight, const PreprocessParams &params)
+{
 	// Compute resize scale factors
-	float scaleX = (float)bgraWidth / (float)outWidth;
-	float scaleY = (float)bgraHeight / (float)outHeight;
+	float scaleX = (float)srcWidth / (float)outWidth;
+	float scaleY = (float)srcHeight / (float)outHeight;
 
 	// Pre-compute inverse scales for multiplication (faster than division in kernel)
 	float invScaleR = (params.scaleR != 0.0f) ? 1.0f / params.scaleR : 1.0f;
 	float invScaleG = (params.scaleG != 0.0f) ? 1.0f / params.scaleG : 1.0f;
 	float invScaleB = (params.scaleB != 0.0f) ? 1.0f / params.scaleB : 1.0f;
 
-	// Launch kernel
-	dim3 block(16, 16);
-	dim3 grid((outWidth + block.x - 1) / block.x, (outHeight + block.y - 1) / block.y);
+	cudaStream_t s = stream();
+
+	auto record = [&]() {
+		if (params.outputHalf) {
+			launchPreprocessKernel(d_src, srcWidth, srcHeight, srcStep, srcRGBA,
+					       static_cast<__half *>(d_dst), outWidth, outHeight, scaleX, scaleY,
+					       params, invScaleR, invScaleG, invScaleB, s);
+		} else {
+			launchPreprocessKernel(d_src, srcWidth, srcHeight, srcStep, srcRGBA,
+					       static_cast<float *>(d_dst), outWidth, outHeight, scaleX, scaleY,
+					       params, invScaleR, invScaleG, invScaleB, s);
+		}
+	};
+
+	if (graphMode_ &&
+	    graph_.launch({graphKey(d_src), srcWidth, srcHeight, srcStep, srcRGBA, graphKey(d_dst), outWidth, outHeight,
+			   graphKey(params.meanR), graphKey(params.meanG), graphKey(params.meanB),
+			   graphKey(params.scaleR), graphKey(params.scaleG), graphKey(params.scaleB), params.outputCHW,
+			   params.outputHalf},
+			  s, record)) {
+		return;
+	}
+	record();
+}
+
+void CudaPreprocessor::setGraphMode(bool enabled)
+{
+	graphMode_ = enabled;
+	if (!enabled) {
+		graph_.reset();
+	}
+}
+
+void CudaPreprocessor::finishOutput(void *outputTensor, size_t outputFloats, bool outputOnDevice)
+{
+	if (outputOnDevice) {
+		// ORT consumes the bound input on the same stream — no sync here
+		return;
+	}
+
+	// Download result directly to ONNX tensor buffer; ORT reads it on the host
+	cudaMemcpyAsync(outputTensor, d_output_, outputFloats * sizeof(float), cudaMemcpyDeviceToHost, stream());
+	cudaStreamSynchronize(stream());
+}
+
+void CudaPreprocessor::preprocess(const uint8_t *bgraData, int bgraWidth, int bgraHeight, int bgraStep,
+				  void *outputTensor, int outWidth, int outHeight, const PreprocessParams &params,
+				  bool outputOnDevice)
+{
+	// The last row ends at the view's width, not the step (the input may be a crop)
+	size_t bgraBytes = (size_t)bgraStep * (bgraHeight - 1) + (size_t)bgraWidth * 4;
+	size_t outputFloats = (size_t)outWidth * outHeight * 3;
+
+	ensureBuffers(bgraBytes, outputOnDevice ? 0 : outputFloats);
+
+	// Async copies need page-locked memory; stage pageable frames (e.g. async queue slots)
+	const uint8_t *upload = bgraData;
+	cudaPointerAttributes attributes;
+	if (cudaPointerGetAttributes(&attributes, bgraData) != cudaSuccess || attributes.type != cudaMemoryTypeHost) {
+		cudaGetLastError(); // clear the error of a pageable pointer query
+		if (stagingBGRA_.ensure(bgraBytes)) {
+			// The previous upload from the staging buffer must be complete before it is overwritten
+			cudaStreamSynchronize(stream());
+			memcpy(stagingBGRA_.data(), bgraData, bgraBytes);
+			upload = stagingBGRA_.as<uint8_t>();
+		}
+	}
+
+	// Upload BGRA frame to GPU
+	cudaMemcpyAsync(d_bgra_, upload, bgraBytes, cudaMemcpyHostToDevice, stream());
+
+	launchKernel(d_bgra_, bgraWidth, bgraHeight, bgraStep, false, outputOnDevice ? outputTensor : d_output_,
+		     outWidth, outHeight, params);
+
+	finishOutput(outputTensor, outputFloats, outputOnDevice);
+}
+
+void CudaPreprocessor::preprocessDevice(const DeviceFrame &frame, void *outputTensor, int outWidth, int outHeight,
+					const PreprocessParams &params, bool outputOnDevice)
+{
+	size_t outputFloats = (size_t)outWidth * outHeight * 3;
+
+	ensureBuffers(0, outputOnDevice ? 0 : outputFloats);
+
+	launchKernel(frame.data, frame.width, frame.height, (int)frame.pitch, frame.rgba,
+		     outputOnDevice ? outputTensor : d_output_, outWidth, outHeight, params);
 
-	if (params.outputCHW) {
-		preprocessBGRA_CHW<<<grid, block>>>(d_bgra_, bgraWidth, bgraHeight, bgraStep, d_output_, outWidth,
-						    outHeight, scaleX, scaleY, params.meanR, params.meanG, params.meanB,
-						    invScaleR, invScaleG, invScaleB);
+	finishOutput(outputTensor, outputFloats, outputOnDevice);
+}
+
+__global__ void halfToFloat(const __half *__restrict__ src, float *__restrict__ dst, size_t count)
+{
+	size_t i = (size_t)blockIdx.x * blockDim.x + threadIdx.x;
+	if (i < count)
+		dst[i] = __half2float(src[i]);
+}
+
+bool convertHalfToFloat(const void *src, float *dst, size_t count, CUstream_st *stream)
+{
+	if (count == 0) {
+		return true;
+	}
+	const unsigned int block = 256;
+	const unsigned int grid = (unsigned int)((count + block - 1) / block);
+	halfToFloat<<<grid, block, 0, stream>>>(static_cast<const __half *>(src), dst, count);
+	return cudaGetLastError() == cudaSuccess;
+}
+
+bool ensureDeviceFrame(DeviceFrame &frame, int width, int height)
+{
+	const int device = currentGpuDevice();
+	if (frame.data && frame.width == width && frame.height == height && frame.device == device) {
+		return true;
+	}
+
+	freeDeviceFrame(frame);
+
+	void *data = nullptr;
+	size_t pitch = 0;
+	if (cudaMallocPitch(&data, &pitch, (size_t)width * 4, (size_t)height) != cudaSuccess) {
+		return false;
+	}
+
+	frame.data = static_cast<uint8_t *>(data);
+	frame.pitch = pitch;
+	frame.width = width;
+	frame.height = height;
+	frame.device = device;
+	return true;
+}
+
+void freeDeviceFrame(DeviceFrame &frame)
+{
+	if (frame.data) {
+		CudaDeviceScope scope(frame.device);
+		cudaFree(frame.data);
+	}
+	frame.data = nullptr;
+	frame.pitch = 0;
+	frame.width = 0;
+	frame.height = 0;
+}
+
+bool copyDeviceFrame(const DeviceFrame &src, DeviceFrame &dst)
+{
+	if (src.empty() || !ensureDeviceFrame(dst, src.width, src.height)) {
+		return false;
+	}
+	dst.rgba = src.rgba;
+	// Unified addressing: cudaMemcpyDefault resolves the devices of both pointers
+	return cudaMemcpy2D(dst.data, dst.pitch, src.data, src.pitch, (size_t)src.width * 4, (size_t)src.height,
+			    cudaMemcpyDefault) == cudaSuccess;
+}
+
+bool uploadDeviceFrame(const uint8_t *bgraData, int width, int height, size_t bgraStep, DeviceFrame &dst,
+		       CUstream_st *stream)
+{
+	if (!bgraData || !ensureDeviceFrame(dst, width, height)) {
+		return false;
+	}
+	dst.rgba = false;
+	if (cudaMemcpy2DAsync(dst.data, dst.pitch, bgraData, bgraStep, (size_t)width * 4, (size_t)height,
+			      cudaMemcpyHostToDevice, stream) != cudaSuccess) {
+		return false;
+	}
+	return cudaStreamSynchronize(stream) == cudaSuccess;
+}
+
+// Luma difference (0-255) beyond which a sample counts as changed
+static constexpr float kMotionThreshold = 12.0f;
+// Fraction of changed samples beyond which a motion cell counts as changed
+static constexpr float kCellChangedFraction = 0.05f;
+// Fraction of changed cells beyond which the motion is global
+static constexpr float kGlobalMotionFraction = 0.5f;
+
+CudaMotionDetector::~CudaMotionDetector()
+{
+	freeBuffers();
+	if (stream_) {
+		cudaStreamDestroy(stream_);
+		stream_ = nullptr;
+	}
+}
+
+bool CudaMotionDetector::ensureBuffers()
+{
+	// The filter moved to another device: start over there
+	const int device = currentGpuDevice();
+	if (stream_ && device != device_) {
+		CudaDeviceScope scope(device_);
+		freeBuffers();
+		cudaStreamDestroy(stream_);
+		stream_ = nullptr;
+	}
+	device_ = device;
+	if (stream_ && d_reference_) {
+		return true;
+	}
+	if (!stream_ && cudaStreamCreateWithFlags(&stream_, cudaStreamNonBlocking) != cudaSuccess) {
+		stream_ = nullptr;
+		return false;
+	}
+	const size_t samples = (size_t)kSamplesX * kSamplesY;
+	if (cudaMalloc(&d_reference_, samples) != cudaSuccess || cudaMalloc(&d_current_, samples) != cudaSuccess ||
+	    cudaMalloc(&d_changedCounts_, kCells * sizeof(unsigned int)) != cudaSuccess ||
+	    !h_changedCounts_.ensure(kCells * sizeof(unsigned int))) {
+		freeBuffers();
+		return false;
+	}
+	return true;
+}
+
+void CudaMotionDetector::freeBuffers()
+{
+	cudaFree(d_reference_);
+	cudaFree(d_current_);
+	cudaFree(d_changedCounts_);
+	cudaFree(d_upload_);
+	d_reference_ = nullptr;
+	d_current_ = nullptr;
+	d_changedCounts_ = nullptr;
+	d_upload_ = nullptr;
+	uploadCapacity_ = 0;
+	h_changedCounts_.reset();
+	hasReference_ = false;
+}
+
+bool CudaMotionDetector::detect(const DeviceFrame &frame, MotionResult &result)
+{
+	if (frame.empty() || !ensureBuffers()) {
+		return false;
+	}
+	return run(frame.data, frame.width, frame.height, (int)frame.pitch, frame.rgba, frame.width, frame.height,
+		   result);
+}
+
+bool CudaMotionDetector::detect(const uint8_t *bgra, int width, int height, int step, int frameWidth,
+				int frameHeight, MotionResult &result)
+{
+	if (!bgra || width <= 0 || height <= 0 || !ensureBuffers()) {
+		return false;
+	}
+	const size_t bytes = (size_t)width * 4 * height;
+	if (bytes > uploadCapacity_) {
+		cudaFree(d_upload_);
+		d_upload_ = nullptr;
+		uploadCapacity_ = 0;
+		if (cudaMalloc(&d_upload_, bytes) != cudaSuccess) {
+			d_upload_ = nullptr;
+			return false;
+		}
+		uploadCapacity_ = bytes;
+	}
+	cudaMemcpy2DAsync(d_upload_, (size_t)width * 4, bgra, (size_t)step, (size_t)width * 4, (size_t)height,
+			  cudaMemcpyHostToDevice, stream_);
+	return run(d_upload_, width, height, width * 4, false, frameWidth, frameHeight, result);
+}
+
+bool CudaMotionDetector::run(const uint8_t *d_src, int width, int height, int step, bool rgba, int frameWidth,
+			     int frameHeight, MotionResult &result)
+{
+	const float scaleX = (float)width / kSamplesX;
+	const float scaleY = (float)height / kSamplesY;
+	dim3 block(kCellSize, kCellSize);
+	dim3 grid(kCellsX, kCellsY);
+	// Without a reference the counts are meaningless: the frame is reported as global motion below
+	motionCellsBGRA<<<grid, block, 0, stream_>>>(d_src, width, height, step, scaleX, scaleY, rgba ? 0 : 2,
+						     rgba ? 2 : 0, d_reference_, d_current_, kMotionThreshold,
+						     d_changedCounts_);
+	cudaMemcpyAsync(h_changedCounts_.data(), d_changedCounts_, kCells * sizeof(unsigned int),
+			cudaMemcpyDeviceToHost, stream_);
+	if (cudaStreamSynchronize(stream_) != cudaSuccess) {
+		return false;
+	}
+
+	result = MotionResult();
+	if (!hasReference_) {
+		result.motion = MotionClass::GLOBAL;
+		return true;
+	}
+
+	const unsigned int *counts = h_changedCounts_.as<unsigned int>();
+	const unsigned int cellThreshold = (unsigned int)(kCellChangedFraction * kCellSize * kCellSize);
+	int changedCells = 0;
+	int minX = kCellsX, minY = kCellsY, maxX = -1, maxY = -1;
+	for (int cy = 0; cy < kCellsY; cy++) {
+		for (int cx = 0; cx < kCellsX; cx++) {
+			if (counts[cy * kCellsX + cx] > cellThreshold) {
+				changedCells++;
+				minX = std::min(minX, cx);
+				minY = std::min(minY, cy);
+				maxX = std::max(maxX, cx);
+				maxY = std::max(maxY, cy);
+			}
+		}
+	}
+
+	if (changedCells == 0) {
+		result.motion = MotionClass::STATIC;
+	} else if (changedCells > kGlobalMotionFraction * kCells) {
+		result.motion = MotionClass::GLOBAL;
 	} else {
-		preprocessBGRA_HWC<<<grid, block>>>(d_bgra_, bgraWidth, bgraHeight, bgraStep, d_output_, outWidth,
-						    outHeight, scaleX, scaleY, params.meanR, params.meanG, params.meanB,
-						    invScaleR, invScaleG, invScaleB);
+		// Bounding box of the changed cells, in frame pixels
+		result.motion = MotionClass::LOCAL;
+		const float cellWidth = (float)frameWidth / kCellsX;
+		const float cellHeight = (float)frameHeight / kCellsY;
+		result.x = (int)(minX * cellWidth);
+		result.y = (int)(minY * cellHeight);
+		result.width = std::min(frameWidth, (int)((maxX + 1) * cellWidth + 0.5f)) - result.x;
+		result.height = std::min(frameHeight, (int)((maxY + 1) * cellHeight + 0.5f)) - result.y;
+	}
+	return true;
+}
+
+void CudaMotionDetector::commit()
+{
+	if (d_reference_) {
+		std::swap(d_reference_, d_current_);
+		hasReference_ = true;
+	}
+}
+
+// Cost of one sample of displacement, in luma SAD over a block
+static constexpr float kFlowMotionCost = 24.0f;
+// Blocks whose zero-displacement SAD is at most this (1 luma level per sample) don't move
+static constexpr unsigned int kFlowFlatSad = CudaMaskFlow::kBlockSize * CudaMaskFlow::kBlockSize;
+
+CudaMaskFlow::~CudaMaskFlow()
+{
+	freeBuffers();
+	if (stream_) {
+		cudaStreamDestroy(stream_);
+		stream_ = nullptr;
+	}
+}
+
+bool CudaMaskFlow::ensureBuffers()
+{
+	// The filter moved to another device: start over there
+	const int device = currentGpuDevice();
+	if (stream_ && device != device_) {
+		CudaDeviceScope scope(device_);
+		freeBuffers();
+		cudaStreamDestroy(stream_);
+		stream_ = nullptr;
+	}
+	device_ = device;
+	if (stream_ && d_current_) {
+		return true;
+	}
+	if (!stream_ && cudaStreamCreateWithFlags(&stream_, cudaStreamNonBlocking) != cudaSuccess) {
+		stream_ = nullptr;
+		return false;
+	}
+	const size_t samples = (size_t)kSamplesX * kSamplesY;
+	bool allocated = cudaMalloc(&d_current_, samples) == cudaSuccess &&
+			 cudaMalloc(&d_reference_, samples) == cudaSuccess &&
+			 cudaMalloc(&d_flow_, kBlocks * 2 * sizeof(float)) == cudaSuccess &&
+			 h_flow_.ensure(kBlocks * 2 * sizeof(float));
+	for (uint8_t *&pending : d_pending_) {
+		allocated = allocated && cudaMalloc(&pending, samples) == cudaSuccess;
+	}
+	if (!allocated) {
+		freeBuffers();
+		return false;
+	}
+	return true;
+}
+
+void CudaMaskFlow::freeBuffers()
+{
+	cudaFree(d_current_);
+	for (uint8_t *&pending : d_pending_) {
+		cudaFree(pending);
+		pending = nullptr;
+	}
+	cudaFree(d_reference_);
+	cudaFree(d_flow_);
+	cudaFree(d_upload_);
+	d_current_ = nullptr;
+	d_reference_ = nullptr;
+	d_flow_ = nullptr;
+	d_upload_ = nullptr;
+	uploadCapacity_ = 0;
+	h_flow_.reset();
+	hasCurrent_ = false;
+	reset();
+}
+
+bool CudaMaskFlow::sample(const DeviceFrame &frame)
+{
+	if (frame.empty() || !ensureBuffers()) {
+		return false;
+	}
+	return run(frame.data, frame.width, frame.height, (int)frame.pitch, frame.rgba);
+}
+
+bool CudaMaskFlow::sample(const uint8_t *bgra, int width, int height, int step)
+{
+	if (!bgra || width <= 0 || height <= 0 || !ensureBuffers()) {
+		return false;
+	}
+	const size_t bytes = (size_t)width * 4 * height;
+	if (bytes > uploadCapacity_) {
+		cudaFree(d_upload_);
+		d_upload_ = nullptr;
+		uploadCapacity_ = 0;
+		if (cudaMalloc(&d_upload_, bytes) != cudaSuccess) {
+			d_upload_ = nullptr;
+			return false;
+		}
+		uploadCapacity_ = bytes;
+	}
+	cudaMemcpy2DAsync(d_upload_, (size_t)width * 4, bgra, (size_t)step, (size_t)width * 4, (size_t)height,
+			  cudaMemcpyHostToDevice, stream_);
+	return run(d_upload_, width, height, width * 4, false);
+}
+
+bool CudaMaskFlow::run(const uint8_t *d_src, int width, int height, int step, bool rgba)
+{
+	const float scaleX = (float)width / kSamplesX;
+	const float scaleY = (float)height / kSamplesY;
+	dim3 block(16, 16);
+	dim3 grid((kSamplesX + 15) / 16, (kSamplesY + 15) / 16);
+	flowLumaBGRA<<<grid, block, 0, stream_>>>(d_src, width, height, step, scaleX, scaleY, rgba ? 0 : 2,
+						  rgba ? 2 : 0, d_current_);
+	hasCurrent_ = cudaGetLastError() == cudaSuccess;
+	return hasCurrent_;
+}
+
+void CudaMaskFlow::markInferred(uint64_t sequence)
+{
+	if (!hasCurrent_ || sequence == 0) {
+		return;
+	}
+	// The oldest pending frame gives way: its mask was dropped or is long overdue
+	cudaMemcpyAsync(d_pending_[nextPending_], d_current_, (size_t)kSamplesX * kSamplesY,
+			cudaMemcpyDeviceToDevice, stream_);
+	pendingSequence_[nextPending_] = sequence;
+	nextPending_ = (nextPending_ + 1) % kPendingFrames;
+}
+
+void CudaMaskFlow::maskArrived(uint64_t sequence)
+{
+	int match = -1;
+	for (int i = 0; i < kPendingFrames; i++) {
+		const uint64_t pending = pendingSequence_[i];
+		if (pending != 0 && pending <= sequence &&
+		    (match < 0 || pending > pendingSequence_[match])) {
+			match = i;
+		}
 	}
+	if (match < 0) {
+		return;
+	}
+	cudaMemcpyAsync(d_reference_, d_pending_[match], (size_t)kSamplesX * kSamplesY,
+			cudaMemcpyDeviceToDevice, stream_);
+	hasReference_ = true;
+	// Frames before it won't come back any more; it stays for a second mask of the same frame
+	for (uint64_t &pending : pendingSequence_) {
+		if (pending < pendingSequence_[match]) {
+			pending = 0;
+		}
+	}
+}
 
-	// Download result directly to ONNX tensor buffer
-	cudaMemcpy(outputTensor, d_output_, outputFloats * sizeof(float), cudaMemcpyDeviceToHost);
+bool CudaMaskFlow::estimate(float *flow)
+{
+	if (!hasCurrent_ || !hasReference_) {
+		return false;
+	}
+	const int search = 2 * kSearchRadius + 1;
+	flowBlockMatch<<<dim3(kBlocksX, kBlocksY), dim3(search, search), 0, stream_>>>(
+		d_current_, d_reference_, kFlowMotionCost, kFlowFlatSad, d_flow_);
+	cudaMemcpyAsync(h_flow_.data(), d_flow_, kBlocks * 2 * sizeof(float), cudaMemcpyDeviceToHost, stream_);
+	if (cudaStreamSynchronize(stream_) != cudaSuccess) {
+		return false;
+	}
+	memcpy(flow, h_flow_.data(), kBlocks * 2 * sizeof(float));
+	return true;
 }
@@ -4,17 +4,76 @@
 #include <cstddef>
 #include <cstdint>
 
+#include "cuda-device-buffer.h"
+#include "cuda-graph.h"
+#include "gpu-info.h"
+
+struct CUstream_st;
+
 // Per-channel normalization parameters for preprocessing.
 // The kernel computes: output[c] = (pixel_float - mean[c]) / scale[c]
 struct PreprocessParams {
 	float meanR = 0.0f, meanG = 0.0f, meanB = 0.0f;
 	float scaleR = 255.0f, scaleG = 255.0f, scaleB = 255.0f;
-	bool outputCHW = false; // true for BCHW models
+	bool outputCHW = false;  // true for BCHW models
+	bool outputHalf = false; // FP16 tensor (half-precision models, device output only)
 };
 
+// A 4-channel uint8 frame resident in device memory, e.g. copied from the
+// texrender texture via CUDA-GL interop. Channel order is BGRA unless rgba is
+// set (OpenGL stores GS_BGRA textures as RGBA8).
+struct DeviceFrame {
+	uint8_t *data = nullptr;
+	size_t pitch = 0;
+	int width = 0;
+	int height = 0;
+	bool rgba = false;
+	int device = 0; // CUDA device the memory lives on
+
+	bool empty() const { return data == nullptr || width == 0 || height == 0; }
+};
+
+// (Re)allocate a pitched device frame on the current device. Keeps the existing
+// allocation if the size and the device match.
+bool ensureDeviceFrame(DeviceFrame &frame, int width, int height);
+
+// Release a device frame allocated with ensureDeviceFrame.
+void freeDeviceFrame(DeviceFrame &frame);
+
+// Device-to-device copy of a frame into dst on the current device, (re)allocating
+// dst as needed. A frame of another device (e.g. captured on the render device)
+// is copied peer to peer.
+bool copyDeviceFrame(const DeviceFrame &src, DeviceFrame &dst);
+
+// Upload a host BGRA frame (page-locked for an asynchronous copy) into dst,
+// (re)allocating it as needed. Waits for the copy on stream.
+bool uploadDeviceFrame(const uint8_t *bgraData, int width, int height, size_t bgraStep, DeviceFrame &dst,
+		       CUstream_st *stream);
+
+// View of a sub-rectangle of a device frame (no copy). The rectangle must lie
+// inside the frame.
+inline DeviceFrame cropDeviceFrame(const DeviceFrame &frame, int x, int y, int width, int height)
+{
+	DeviceFrame view = frame;
+	view.data = frame.data + (size_t)y * frame.pitch + (size_t)x * 4;
+	view.width = width;
+	view.height = height;
+	return view;
+}
+
 // CUDA-accelerated image preprocessor for ONNX model input.
 // Fuses BGRA→RGB conversion, bilinear resize, float conversion, and
 // normalization into a single GPU kernel launch.
+//
+// All work is queued on the preprocessor's own stream, which is also handed to
+// the ORT CUDA/TensorRT EP (user_compute_stream) so that preprocessing,
+// inference and postprocessing run back to back without intermediate syncs.
+//
+// The preprocessor works on the calling thread's current device. It keeps one
+// stream per device, so a session built for another device gets its stream
+// while the current one still runs; the buffers move on the first call from the
+// new device. Streams are kept per scheduling priority as well: a session
+// built at another priority gets its own stream the same way.
 class CudaPreprocessor {
 public:
 	CudaPreprocessor() = default;
@@ -23,20 +82,212 @@ public:
 	CudaPreprocessor(const CudaPreprocessor &) = delete;
 	CudaPreprocessor &operator=(const CudaPreprocessor &) = delete;
 
-	// Preprocess a BGRA uint8 frame into a float32 RGB normalized tensor.
-	// The output is written directly to outputTensor (CPU memory).
+	// Preprocess a BGRA uint8 frame into a float32 (or, with params.outputHalf,
+	// float16) RGB normalized tensor.
+	// The output is written directly to outputTensor (CPU memory), or, with
+	// outputOnDevice, the kernel writes straight into outputTensor as a device
+	// pointer (an IoBinding-bound input) and nothing is downloaded.
+	// Page-locked input is uploaded asynchronously as is; pageable input is
+	// first copied into a pinned staging buffer. The input may be a view into a
+	// larger frame (bgraStep > 4 * bgraWidth, e.g. a region of interest): only
+	// the rows it covers are uploaded.
 	// GPU buffers are allocated/resized as needed.
-	void preprocess(const uint8_t *bgraData, int bgraWidth, int bgraHeight, int bgraStep, float *outputTensor,
-			int outWidth, int outHeight, const PreprocessParams &params);
+	void preprocess(const uint8_t *bgraData, int bgraWidth, int bgraHeight, int bgraStep, void *outputTensor,
+			int outWidth, int outHeight, const PreprocessParams &params, bool outputOnDevice = false);
+
+	// Preprocess a frame that is already resident in device memory.
+	// Skips the host→device upload; only the normalized tensor is downloaded
+	// (or nothing at all with outputOnDevice).
+	void preprocessDevice(const DeviceFrame &frame, void *outputTensor, int outWidth, int outHeight,
+			      const PreprocessParams &params, bool outputOnDevice = false);
+
+	// The stream of the current device all preprocessing work is queued on
+	// (created on first use). With outputOnDevice the result is only ordered on
+	// this stream, not synchronized — consumers must queue on the same stream.
+	CUstream_st *stream();
+
+	// The stream of a given device (created on that device on first use).
+	CUstream_st *stream(int device);
+
+	// The stream of a given device at a scheduling priority (created on first use)
+	CUstream_st *stream(int device, SchedulingPriority priority);
+
+	// Priority of the streams stream() returns: set along with the session
+	// queued on them, so the preprocessing stays on the session's stream
+	void setPriority(SchedulingPriority priority) { priority_ = priority; }
+	SchedulingPriority priority() const { return priority_; }
+
+	// Graph mode: capture the kernel launch as a CUDA graph and replay it while
+	// source, destination and sizes are unchanged (re-captured otherwise).
+	void setGraphMode(bool enabled);
+
+	// Release the staging and output buffers (reallocated by the next call);
+	// the streams are kept
+	void freeBuffers();
 
 private:
+	void launchKernel(const uint8_t *d_src, int srcWidth, int srcHeight, int srcStep, bool srcRGBA,
+			  void *d_dst, int outWidth, int outHeight, const PreprocessParams &params);
+	void finishOutput(void *outputTensor, size_t outputFloats, bool outputOnDevice);
 	void ensureBuffers(size_t bgraBytes, size_t outputFloats);
-	void freeBuffers();
 
+	static constexpr int kMaxDevices = 16;
+	static constexpr int kPriorityLevels = 3;
+	CUstream_st *streams_[kMaxDevices][kPriorityLevels] = {};
+	SchedulingPriority priority_ = SchedulingPriority::NORMAL;
+	int bufferDevice_ = -1; // device of d_bgra_, d_output_ and graph_
 	uint8_t *d_bgra_ = nullptr;
 	float *d_output_ = nullptr;
 	size_t bgraCapacity_ = 0;
 	size_t outputCapacity_ = 0;
+	CudaHostBuffer stagingBGRA_;
+	bool graphMode_ = false;
+	CudaGraphSlot graph_;
+};
+
+// Convert count FP16 values in device memory to FP32, queued on stream (e.g. the
+// output of a half-precision model for the float consumers).
+bool convertHalfToFloat(const void *src, float *dst, size_t count, CUstream_st *stream);
+
+enum class MotionClass {
+	STATIC, // nothing changed: the previous mask is still valid
+	LOCAL,  // some cells changed: refresh the mask in the changed region
+	GLOBAL, // most of the frame changed (or no reference yet): full update
+};
+
+struct MotionResult {
+	MotionClass motion = MotionClass::GLOBAL;
+	// LOCAL: bounding box of the changed cells, in frame pixels
+	int x = 0;
+	int y = 0;
+	int width = 0;
+	int height = 0;
+};
+
+// GPU frame differencing against a reference frame. A kernel samples the frame
+// with the preprocessing kernels' bilinear read onto a small luma grid and
+// counts the changed samples per cell; only the cell counts are downloaded.
+// The reference is the last committed frame (the last one that was inferred),
+// so slow changes add up instead of slipping under the threshold frame by frame.
+class CudaMotionDetector {
+public:
+	// Motion map geometry: kCellsX x kCellsY cells of kCellSize x kCellSize
+	// luma samples over the whole frame
+	static constexpr int kCellSize = 16;
+	static constexpr int kCellsX = 10;
+	static constexpr int kCellsY = 6;
+	static constexpr int kCells = kCellsX * kCellsY;
+	static constexpr int kSamplesX = kCellsX * kCellSize;
+	static constexpr int kSamplesY = kCellsY * kCellSize;
+
+	CudaMotionDetector() = default;
+	~CudaMotionDetector();
+
+	CudaMotionDetector(const CudaMotionDetector &) = delete;
+	CudaMotionDetector &operator=(const CudaMotionDetector &) = delete;
+
+	// Classify a device frame against the reference. Returns false on CUDA failure.
+	bool detect(const DeviceFrame &frame, MotionResult &result);
+
+	// Same for a host BGRA image (e.g. a thumbnail of a host frame, uploaded
+	// whole); the region is reported in frameWidth x frameHeight pixels.
+	bool detect(const uint8_t *bgra, int width, int height, int step, int frameWidth, int frameHeight,
+		    MotionResult &result);
+
+	// Make the frame of the last detect() the reference.
+	void commit();
+
+	// Forget the reference (the next frame is global motion).
+	void reset() { hasReference_ = false; }
+
+	void freeBuffers();
+
+private:
+	bool ensureBuffers();
+	bool run(const uint8_t *d_src, int width, int height, int step, bool rgba, int frameWidth, int frameHeight,
+		 MotionResult &result);
+
+	CUstream_st *stream_ = nullptr;
+	int device_ = -1; // device of the stream and buffers
+	uint8_t *d_reference_ = nullptr;
+	uint8_t *d_current_ = nullptr;
+	unsigned int *d_changedCounts_ = nullptr;
+	uint8_t *d_upload_ = nullptr;
+	size_t uploadCapacity_ = 0;
+	CudaHostBuffer h_changedCounts_;
+	bool hasReference_ = false;
+};
+
+// GPU block matching between the frame a mask was inferred on (the reference)
+// and the current frame, to warp the mask in between inferences. Frames are
+// sampled onto a luma grid like the motion detector's; each block of the
+// current grid is matched against the reference grid and only the block
+// vectors are downloaded.
+class CudaMaskFlow {
+public:
+	// Mask flow geometry: kBlocksX x kBlocksY blocks of kBlockSize x kBlockSize
+	// luma samples over the whole frame, each searched within kSearchRadius samples
+	static constexpr int kBlockSize = 8;
+	static constexpr int kBlocksX = 40;
+	static constexpr int kBlocksY = 24;
+	static constexpr int kBlocks = kBlocksX * kBlocksY;
+	static constexpr int kSamplesX = kBlocksX * kBlockSize;
+	static constexpr int kSamplesY = kBlocksY * kBlockSize;
+	static constexpr int kSearchRadius = 8;
+
+	CudaMaskFlow() = default;
+	~CudaMaskFlow();
+
+	CudaMaskFlow(const CudaMaskFlow &) = delete;
+	CudaMaskFlow &operator=(const CudaMaskFlow &) = delete;
+
+	// Sample the current frame: a device frame, or a host BGRA image (e.g. a
+	// thumbnail of a host frame, uploaded whole). Returns false on CUDA failure.
+	bool sample(const DeviceFrame &frame);
+	bool sample(const uint8_t *bgra, int width, int height, int step);
+
+	// The current frame (capture sequence) went to inference
+	void markInferred(uint64_t sequence);
+	// The mask of a frame came back: that frame becomes the reference (the
+	// latest marked one before it, if it was marked too long ago)
+	void maskArrived(uint64_t sequence);
+
+	// Backward flow of the current frame, kBlocks (x, y) pairs in row-major
+	// block order, in fractions of the frame: the reference mask at uv + flow is
+	// the mask at uv. Returns false without a reference or on CUDA failure.
+	bool estimate(float *flow);
+
+	// Forget the reference and the frame marked inferred
+	void reset()
+	{
+		for (uint64_t &sequence : pendingSequence_) {
+			sequence = 0;
+		}
+		hasReference_ = false;
+	}
+
+	void freeBuffers();
+
+private:
+	bool ensureBuffers();
+	bool run(const uint8_t *d_src, int width, int height, int step, bool rgba);
+
+	CUstream_st *stream_ = nullptr;
+	int device_ = -1; // device of the stream and buffers
+	// Frames in inference (a queue ring's worth and one being pushed), by sequence
+	static constexpr int kPendingFrames = 4;
+
+	uint8_t *d_current_ = nullptr;
+	uint8_t *d_pending_[kPendingFrames] = {};
+	uint64_t pendingSequence_[kPendingFrames] = {}; // 0: free
+	int nextPending_ = 0;
+	uint8_t *d_reference_ = nullptr;
+	float *d_flow_ = nullptr;
+	uint8_t *d_upload_ = nullptr;
+	size_t uploadCapacity_ = 0;
+	CudaHostBuffer h_flow_;
+	bool hasCurrent_ = false;
+	bool hasReference_ = false;
 };
 
 #endif /* CUDA_PREPROCESS_H */
@@ -0,0 +1,115 @@
+#include "depth-stage.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "FilterData.h"
+#include "ort-session-utils.h"
+#include "plugin-support.h"
+
+void DepthStage::start(filter_data *estimator)
+{
+	stop();
+	lastPushTimestamp_ = 0;
+	result_.release();
+	from_.release();
+	cached_.release();
+	easingStep_ = easingSteps_ = 0;
+
+	// The estimator's session only runs here, so the worker needs no lock
+	queue_.start(
+		[estimator](const InputFrame &input, cv::Mat &depth) -> bool {
+			if (!estimator->model || !estimator->session) {
+				return false;
+			}
+			if (input.onDevice) {
+				return runFilterModelInference(estimator, input.device, depth);
+			}
+			return runFilterModelInference(estimator, input.bgra, depth);
+		},
+		BufferingMode::DOUBLE, estimator->deviceId);
+}
+
+void DepthStage::stop()
+{
+	queue_.stop();
+}
+
+bool DepthStage::pushIfDue(const InputFrame &input, int rate, double framePeriodMs)
+{
+	if (!queue_.isRunning() || input.empty() || rate <= 0) {
+		return false;
+	}
+	// Half a frame of slack, so timestamp jitter doesn't push a due frame a frame late
+	const uint64_t interval = (uint64_t)(1e9 / rate);
+	const uint64_t slack = std::min((uint64_t)(framePeriodMs * 0.5e6), interval);
+	if (lastPushTimestamp_ && input.tag.timestamp + slack < lastPushTimestamp_ + interval) {
+		return false;
+	}
+	queue_.pushFrame(input);
+	lastPushTimestamp_ = input.tag.timestamp;
+	return true;
+}
+
+void DepthStage::update(int rate, double framePeriodMs)
+{
+	if (queue_.getLatestMask(result_)) {
+		easingStep_ = 0;
+		if (cached_.size() == result_.size() && cached_.type() == result_.type()) {
+			// Ease from the map shown now to the new one until the next one is due
+			cached_.copyTo(from_);
+			const double periodMs = 1000.0 / std::max(rate, 1);
+			easingSteps_ = std::max(1, (int)std::lround(periodMs / std::max(framePeriodMs, 1.0)));
+		} else {
+			// First map or a new size: shown as is
+			result_.copyTo(from_);
+			easingSteps_ = 1;
+		}
+	}
+	if (easingStep_ >= easingSteps_) {
+		// At rest on the latest map: render keeps it
+		return;
+	}
+	easingStep_++;
+	const double t = (double)easingStep_ / (double)easingSteps_;
+	cv::addWeighted(from_, 1.0 - t, result_, t, 0.0, cached_);
+	cached_.copyTo(maps_.back());
+	maps_.publish();
+}
+
+gs_texture_t *DepthStage::updateTexture()
+{
+	// The acquired map stays owned by this thread until the next acquire
+	const bool newMap = maps_.acquire();
+	const cv::Mat &map = maps_.front();
+	if (map.empty()) {
+		return nullptr;
+	}
+
+	const uint32_t width = (uint32_t)map.cols;
+	const uint32_t height = (uint32_t)map.rows;
+	bool created = false;
+	if (texture_ && (gs_texture_get_width(texture_) != width || gs_texture_get_height(texture_) != height)) {
+		releaseTexture();
+	}
+	if (!texture_) {
+		texture_ = gs_texture_create(width, height, GS_R8, 1, nullptr, GS_DYNAMIC);
+		if (!texture_) {
+			obs_log(LOG_ERROR, "Failed to create depth texture");
+			return nullptr;
+		}
+		created = true;
+	}
+	if (newMap || created) {
+		gs_texture_set_image(texture_, map.data, (uint32_t)map.step[0], false);
+	}
+	return texture_;
+}
+
+void DepthStage::releaseTexture()
+{
+	if (texture_) {
+		gs_texture_destroy(texture_);
+		texture_ = nullptr;
+	}
+}
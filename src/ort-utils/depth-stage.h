@@ -0,0 +1,70 @@
+#ifndef DEPTH_STAGE_H
+#define DEPTH_STAGE_H
+
+#include <cstdint>
+
+#include <obs-module.h>
+
+#include <opencv2/core.hpp>
+
+#include "async-inference-queue.h"
+#include "input-frame.h"
+#include "triple-buffer.h"
+
+struct filter_data;
+
+// Focal blur depth: a depth model (TCMonoDepth) with its own session, CUDA
+// stream and worker thread, run at a low rate next to the segmentation.
+// video_tick pushes a frame when an update is due and eases the cached depth
+// map from the previous result to the new one over one update period;
+// video_render keeps the cached map in a GS_R8 texture for the blur passes.
+// Depth values are normalized per map: 0 = back, 1 = front.
+class DepthStage {
+public:
+	DepthStage() = default;
+
+	DepthStage(const DepthStage &) = delete;
+	DepthStage &operator=(const DepthStage &) = delete;
+
+	// video_tick: run estimator's session on the worker (on estimator's device).
+	// The session must not change while the worker runs: stop() first.
+	void start(filter_data *estimator);
+	void stop();
+	bool running() const { return queue_.isRunning(); }
+
+	// Worker thread policy of the next start()
+	void setWorkerPolicy(const AsyncInferenceQueue::WorkerPolicy &policy) { queue_.setWorkerPolicy(policy); }
+
+	// video_tick: hand input to the worker when it is due at rate updates per
+	// second (by the frame timestamps). Returns whether it was pushed.
+	bool pushIfDue(const InputFrame &input, int rate, double framePeriodMs);
+
+	// video_tick: take a finished depth map and publish the next step of the
+	// cached map's easing toward it
+	void update(int rate, double framePeriodMs);
+
+	// video_render: the cached depth map in the persistent GS_R8 texture,
+	// reallocated only on size change (nullptr until the first depth map)
+	gs_texture_t *updateTexture();
+
+	// Release the texture (graphics context)
+	void releaseTexture();
+
+private:
+	AsyncInferenceQueue queue_;
+
+	// video_tick only
+	uint64_t lastPushTimestamp_ = 0; // frame time of the last push (0: none since start)
+	cv::Mat result_;                 // latest depth map taken from the queue
+	cv::Mat from_;                   // cached map when result_ arrived, start of the easing
+	cv::Mat cached_;                 // map published last
+	int easingStep_ = 0;
+	int easingSteps_ = 0;
+
+	// Cached maps: video_tick (producer) → video_render (consumer)
+	TripleBuffer<cv::Mat> maps_;
+
+	gs_texture_t *texture_ = nullptr;
+};
+
+#endif /* DEPTH_STAGE_H */
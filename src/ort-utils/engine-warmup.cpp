@@ -0,0 +1,261 @@
+#include "engine-warmup.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <obs-module.h>
+
+#include <opencv2/core.hpp>
+
+#include "FilterData.h"
+#include "consts.h"
+#include "models/ModelFactory.h"
+#include "ort-session-utils.h"
+#include "plugin-support.h"
+
+// Engines kept in the manifest (most recently built first)
+static constexpr size_t kMaxManifestEntries = 8;
+
+// Inference runs on a blank frame after the build: the first runs allocate the
+// arena and tune kernels, which would otherwise land on the first real frames
+static constexpr int kWarmupRuns = 3;
+
+// How long the warm sessions are held for the filters to pick them up
+static constexpr std::chrono::seconds kHoldTime(120);
+
+namespace {
+
+struct ManifestEntry {
+	std::string modelSelection;
+	PrecisionMode precision = PrecisionMode::FP32;
+	int device = 0;
+	int width = 0;
+	int height = 0;
+	int resolution = INFERENCE_RESOLUTION_SOURCE;
+
+	bool operator==(const ManifestEntry &other) const
+	{
+		return modelSelection == other.modelSelection && precision == other.precision &&
+		       device == other.device && width == other.width && height == other.height &&
+		       resolution == other.resolution;
+	}
+};
+
+struct WarmupFilter : public filter_data {
+	std::string key;
+	int width = 0;
+	int height = 0;
+};
+
+std::mutex manifestMutex;
+
+std::mutex warmupMutex;
+std::condition_variable warmupCondition;
+bool warmupStopping = false;
+std::thread warmupThread;
+
+// createOrtSession on the warmup thread must not reorder the manifest
+thread_local bool onWarmupThread = false;
+
+} // namespace
+
+static std::filesystem::path manifestPath()
+{
+	return std::filesystem::path(getPluginCachePath()) / "warmup-engines.txt";
+}
+
+// One engine per line: model \t fp32|fp16|int8 \t width \t height [\t device [\t resolution]]
+// (manifests written before multi-GPU support have no device column: device 0,
+// those before the inference resolution setting no resolution column: the source)
+static std::vector<ManifestEntry> readManifest()
+{
+	std::vector<ManifestEntry> entries;
+	std::ifstream file(manifestPath());
+	std::string line;
+	while (std::getline(file, line) && entries.size() < kMaxManifestEntries) {
+		std::istringstream fields(line);
+		ManifestEntry entry;
+		std::string precision, width, height, device, resolution;
+		if (!std::getline(fields, entry.modelSelection, '\t') || !std::getline(fields, precision, '\t') ||
+		    !std::getline(fields, width, '\t') || !std::getline(fields, height, '\t')) {
+			continue;
+		}
+		if (std::getline(fields, device, '\t')) {
+			entry.device = std::atoi(device.c_str());
+		}
+		if (std::getline(fields, resolution, '\t')) {
+			entry.resolution = std::atoi(resolution.c_str());
+		}
+		if (!parsePrecisionMode(precision, entry.precision)) {
+			continue;
+		}
+		entry.width = std::atoi(width.c_str());
+		entry.height = std::atoi(height.c_str());
+		if (!entry.modelSelection.empty() && entry.width > 0 && entry.height > 0 && entry.device >= 0) {
+			entries.push_back(entry);
+		}
+	}
+	return entries;
+}
+
+void recordWarmupEngine(const std::string &modelSelection, PrecisionMode precision, int device, int width,
+			int height, int resolution)
+{
+	if (onWarmupThread || width <= 0 || height <= 0) {
+		return;
+	}
+	const ManifestEntry entry{modelSelection, precision, device, width, height, resolution};
+
+	try {
+		std::lock_guard<std::mutex> lock(manifestMutex);
+		std::vector<ManifestEntry> entries = readManifest();
+		if (!entries.empty() && entries.front() == entry) {
+			return;
+		}
+		entries.erase(std::remove(entries.begin(), entries.end(), entry), entries.end());
+		entries.insert(entries.begin(), entry);
+		entries.resize(std::min(entries.size(), kMaxManifestEntries));
+
+		std::ofstream file(manifestPath(), std::ios::trunc);
+		for (const ManifestEntry &e : entries) {
+			file << e.modelSelection << '\t' << precisionModeName(e.precision) << '\t' << e.width << '\t'
+			     << e.height << '\t' << e.device << '\t' << e.resolution << '\n';
+		}
+	} catch (const std::exception &e) {
+		obs_log(LOG_WARNING, "Failed to update the engine warmup manifest: %s", e.what());
+	}
+}
+
+static bool warmupStopRequested()
+{
+	std::lock_guard<std::mutex> lock(warmupMutex);
+	return warmupStopping;
+}
+
+static bool warmUp(WarmupFilter *tf)
+{
+	CudaDeviceScope device(tf->deviceId);
+	if (createOrtSession(tf) != OBS_BGREMOVAL_ORT_SESSION_SUCCESS) {
+		return false;
+	}
+	const cv::Mat frame = cv::Mat::zeros(tf->height, tf->width, CV_8UC4);
+	try {
+		for (int i = 0; i < kWarmupRuns; i++) {
+			cv::Mat output;
+			if (!runFilterModelInference(tf, frame, output)) {
+				return false;
+			}
+		}
+	} catch (const std::exception &e) {
+		obs_log(LOG_WARNING, "Engine warmup inference failed: %s", e.what());
+		return false;
+	}
+	return true;
+}
+
+static void runWarmup(std::vector<std::unique_ptr<WarmupFilter>> filters)
+{
+	onWarmupThread = true;
+	std::vector<std::unique_ptr<WarmupFilter>> warm;
+
+	for (auto &tf : filters) {
+		if (warmupStopRequested()) {
+			break;
+		}
+		const auto start = std::chrono::steady_clock::now();
+		const bool ok = warmUp(tf.get());
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		if (ok) {
+			obs_log(LOG_INFO, "Engine warmup: %s %dx%d (%s, GPU %d) ready in %.1f s",
+				tf->modelSelection.c_str(), tf->width, tf->height, tf->precision.c_str(), tf->deviceId,
+				elapsed.count());
+			warm.push_back(std::move(tf));
+		} else {
+			obs_log(LOG_WARNING, "Engine warmup: failed to build %s %dx%d", tf->modelSelection.c_str(),
+				tf->width, tf->height);
+		}
+	}
+
+	std::unique_lock<std::mutex> lock(warmupMutex);
+	warmupCondition.wait_for(lock, kHoldTime, [] { return warmupStopping; });
+	lock.unlock();
+
+	// Sessions no filter picked up are released here
+	warm.clear();
+	filters.clear();
+}
+
+void engine_warmup_start(void)
+{
+	std::vector<ManifestEntry> entries;
+	{
+		std::lock_guard<std::mutex> lock(manifestMutex);
+		entries = readManifest();
+	}
+	if (entries.empty()) {
+		return;
+	}
+
+	// A filter asking for an engine being built waits for it in the shared engine
+	// registry (on its session builder thread) instead of building it a second time
+	std::vector<std::unique_ptr<WarmupFilter>> filters;
+	std::vector<std::string> keys;
+	for (const ManifestEntry &entry : entries) {
+		// The GPU may be gone since the engine was recorded
+		GpuInfo gpuInfo;
+		if (!detectGpu(gpuInfo, entry.device)) {
+			continue;
+		}
+		auto tf = std::make_unique<WarmupFilter>();
+		tf->source = nullptr;
+		tf->texrender = nullptr;
+		tf->modelSelection = entry.modelSelection;
+		tf->model.reset(createModel(entry.modelSelection));
+		tf->useGPU = USEGPU_TENSORRT;
+		tf->numThreads = 1;
+		tf->gpuInfo = gpuInfo;
+		tf->deviceId = entry.device;
+		tf->precision = precisionModeName(entry.precision);
+		tf->inferenceResolution = entry.resolution;
+		tf->model->setSourceSize(entry.width, entry.height, entry.resolution);
+		tf->width = entry.width;
+		tf->height = entry.height;
+
+		tf->key = sharedSessionKey(tf.get());
+		if (tf->key.empty() || std::find(keys.begin(), keys.end(), tf->key) != keys.end()) {
+			continue;
+		}
+		keys.push_back(tf->key);
+		filters.push_back(std::move(tf));
+	}
+	if (filters.empty()) {
+		return;
+	}
+
+	obs_log(LOG_INFO, "Engine warmup: building %zu TensorRT engine(s) in the background", filters.size());
+	{
+		std::lock_guard<std::mutex> lock(warmupMutex);
+		warmupStopping = false;
+	}
+	warmupThread = std::thread(runWarmup, std::move(filters));
+}
+
+void engine_warmup_stop(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(warmupMutex);
+		warmupStopping = true;
+	}
+	warmupCondition.notify_all();
+	if (warmupThread.joinable()) {
+		warmupThread.join();
+	}
+}
@@ -0,0 +1,29 @@
+#ifndef ENGINE_WARMUP_H
+#define ENGINE_WARMUP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Build the TensorRT engines of the warmup manifest on a background thread
+// (module load, after ort_env_init) and stop it (module unload, before
+// ort_env_release; waits for an engine build in progress).
+void engine_warmup_start(void);
+void engine_warmup_stop(void);
+
+#ifdef __cplusplus
+}
+
+#include <string>
+
+#include "gpu-info.h"
+
+// Remember a TensorRT session built by a filter, so the next warmup builds it
+// before any filter asks for it (on the CUDA device it was built for). The
+// manifest keeps the most recent engines. width x height is the source the
+// model was sized for at the inference resolution.
+void recordWarmupEngine(const std::string &modelSelection, PrecisionMode precision, int device, int width,
+			int height, int resolution);
+#endif
+
+#endif /* ENGINE_WARMUP_H */
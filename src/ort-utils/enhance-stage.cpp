@@ -0,0 +1,116 @@
+#include "enhance-stage.h"
+
+#include <opencv2/imgproc.hpp>
+
+#include "FilterData.h"
+#include "ort-session-utils.h"
+#include "plugin-support.h"
+
+// GPU output path: run the model with the output left on the device and
+// convert it to the RGBA output image in CUDA
+template<typename Frame> bool EnhanceStage::processOnDevice(filter_data *tf, const Frame &frameBGRA)
+{
+	DeviceTensorView image;
+	if (!runImageModelInferenceOnDevice(tf, frameBGRA, image)) {
+		return false;
+	}
+
+	StageTimer timer(tf->scheduler, InferenceScheduler::STAGE_POSTPROCESS);
+	if (!imagePostprocessor_.process(image.data, image.width, image.height, tf->model->getImagePostprocessParams(),
+					 tf->cudaPreprocessor.stream())) {
+		obs_log(LOG_WARNING, "GPU enhance output failed, falling back to CPU");
+		enableGpuOutput_ = false;
+		return false;
+	}
+	imagePostprocessor_.publish();
+	return true;
+}
+
+template<typename Frame> bool EnhanceStage::processFrame(filter_data *tf, const Frame &frameBGRA)
+{
+	if (!tf->model || !tf->session) {
+		return false;
+	}
+	if (enableGpuOutput_ && tf->ioBinding && processOnDevice(tf, frameBGRA)) {
+		return true;
+	}
+
+	cv::Mat outputImage;
+	if (!runFilterModelInference(tf, frameBGRA, outputImage)) {
+		return false;
+	}
+	cv::cvtColor(outputImage, hostFrames_.back(), cv::COLOR_BGR2RGBA);
+	hostFrames_.publish();
+	return true;
+}
+
+bool EnhanceStage::process(filter_data *tf, const cv::Mat &imageBGRA)
+{
+	return processFrame(tf, imageBGRA);
+}
+
+bool EnhanceStage::process(filter_data *tf, const DeviceFrame &frameBGRA)
+{
+	return processFrame(tf, frameBGRA);
+}
+
+gs_texture_t *EnhanceStage::updateTexture(PipelineStats &stats)
+{
+	// Take the latest published frames; the acquired buffers stay owned by this thread
+	const bool newGpuImage = imagePostprocessor_.acquire();
+	const bool newHostImage = hostFrames_.acquire();
+	const DeviceImage &gpuImage = imagePostprocessor_.front();
+	const cv::Mat &hostImage = hostFrames_.front();
+
+	const bool useGpuImage = enableGpuOutput_ && !gpuImage.empty();
+	if (!useGpuImage && hostImage.empty()) {
+		return nullptr;
+	}
+
+	const uint32_t width = useGpuImage ? (uint32_t)gpuImage.width : (uint32_t)hostImage.cols;
+	const uint32_t height = useGpuImage ? (uint32_t)gpuImage.height : (uint32_t)hostImage.rows;
+
+	bool created = false;
+	if (texture_ && (gs_texture_get_width(texture_) != width || gs_texture_get_height(texture_) != height)) {
+		releaseTexture();
+	}
+	if (!texture_) {
+		texture_ = gs_texture_create(width, height, GS_BGRA, 1, nullptr, GS_DYNAMIC);
+		if (!texture_) {
+			obs_log(LOG_ERROR, "Failed to create output texture");
+			return nullptr;
+		}
+		created = true;
+	}
+
+	// Re-upload when switching between the GPU and the host output path
+	const bool refresh = created || useGpuImage != textureFromGpu_;
+	textureFromGpu_ = useGpuImage;
+
+	if (useGpuImage) {
+		if (newGpuImage || refresh) {
+			StageTimer timer(stats, PipelineStats::STAGE_UPLOAD);
+			if (!interop_.registerTexture(texture_, width, height, CudaGLTexture::Access::WRITE_DISCARD) ||
+			    !interop_.copyFromDevice(gpuImage.data, gpuImage.pitch, (size_t)width * 4, height,
+						     gpuImage.device)) {
+				obs_log(LOG_WARNING, "CUDA-GL output upload failed, falling back to CPU output");
+				enableGpuOutput_ = false;
+				interop_.unregister();
+			}
+		}
+	} else if (newHostImage || refresh) {
+		StageTimer timer(stats, PipelineStats::STAGE_UPLOAD);
+		gs_texture_set_image(texture_, hostImage.data, (uint32_t)hostImage.step[0], false);
+	}
+
+	return texture_;
+}
+
+void EnhanceStage::releaseTexture()
+{
+	interop_.unregister();
+	if (texture_) {
+		gs_texture_destroy(texture_);
+		texture_ = nullptr;
+	}
+}
@@ -0,0 +1,59 @@
+#ifndef ENHANCE_STAGE_H
+#define ENHANCE_STAGE_H
+
+#include <atomic>
+
+#include <obs-module.h>
+
+#include <opencv2/core.hpp>
+
+#include "cuda-gl-interop.h"
+#include "cuda-image-postprocess.h"
+#include "cuda-preprocess.h"
+#include "pipeline-stats.h"
+#include "triple-buffer.h"
+
+struct filter_data;
+
+// Enhance Portrait output: runs an image-to-image model (the enhance models) on
+// the inference worker and hands the RGBA result to video_render, as a device
+// image with the GPU output path (IoBinding: CUDA conversion of the device
+// model output, CUDA-GL copy into the texture) or as a host frame otherwise.
+// Used by the Enhance Portrait filter and the background filter's fused
+// enhancement.
+class EnhanceStage {
+public:
+	EnhanceStage() = default;
+
+	EnhanceStage(const EnhanceStage &) = delete;
+	EnhanceStage &operator=(const EnhanceStage &) = delete;
+
+	// Worker: enhance a frame with tf's session and model and publish the
+	// result. The caller holds tf's model lock. Single producer.
+	bool process(filter_data *tf, const cv::Mat &imageBGRA);
+	bool process(filter_data *tf, const DeviceFrame &frameBGRA);
+
+	// video_render: the latest enhanced frame in the persistent GS_BGRA texture,
+	// reallocated only on size change (nullptr until the first frame)
+	gs_texture_t *updateTexture(PipelineStats &stats);
+
+	// Release the texture (graphics context)
+	void releaseTexture();
+
+private:
+	template<typename Frame> bool processFrame(filter_data *tf, const Frame &frameBGRA);
+	template<typename Frame> bool processOnDevice(filter_data *tf, const Frame &frameBGRA);
+
+	// Cleared for good when a GPU step fails (host path from then on)
+	std::atomic<bool> enableGpuOutput_{true};
+	CudaImagePostprocessor imagePostprocessor_;
+
+	// Host output path: worker (producer) → video_render (consumer)
+	TripleBuffer<cv::Mat> hostFrames_;
+
+	gs_texture_t *texture_ = nullptr;
+	CudaGLTexture interop_;
+	bool textureFromGpu_ = false;
+};
+
+#endif /* ENHANCE_STAGE_H */
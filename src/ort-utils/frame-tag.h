@@ -0,0 +1,14 @@
+#ifndef FRAME_TAG_H
+#define FRAME_TAG_H
+
+#include <cstdint>
+
+// Capture order and time of a source frame. video_render tags every frame it
+// captures; the tag travels with the frame through the async queue and comes
+// back with the mask inferred on it.
+struct FrameTag {
+	uint64_t sequence = 0;  // capture counter of the filter (0: untagged)
+	uint64_t timestamp = 0; // OBS video frame time (obs_get_video_frame_time), ns
+};
+
+#endif /* FRAME_TAG_H */
@@ -1,26 +1,16 @@
 #include "gpu-info.h"
 
+#include <algorithm>
 #include <cuda_runtime.h>
+#include <dlfcn.h>
 #include <obs-module.h>
 #include "plugin-support.h"
+#include "consts.h"
 
-bool detectGpu(GpuInfo &info)
+// Fill info from the properties of a present device
+static void readGpuInfo(GpuInfo &info, int device, const cudaDeviceProp &props)
 {
-	int deviceCount = 0;
-	cudaError_t err = cudaGetDeviceCount(&deviceCount);
-	if (err != cudaSuccess || deviceCount == 0) {
-		obs_log(LOG_WARNING, "No CUDA-capable GPU detected: %s", cudaGetErrorString(err));
-		return false;
-	}
-
-	cudaDeviceProp props;
-	err = cudaGetDeviceProperties(&props, 0);
-	if (err != cudaSuccess) {
-		obs_log(LOG_ERROR, "Failed to get GPU properties: %s", cudaGetErrorString(err));
-		return false;
-	}
-
-	info.deviceId = 0;
+	info.deviceId = device;
 	info.name = props.name;
 	info.computeCapabilityMajor = props.major;
 	info.computeCapabilityMinor = props.minor;
@@ -45,13 +35,176 @@ bool detectGpu(GpuInfo &info)
 		info.defaultBuffering = BufferingMode::DOUBLE;
 		info.defaultPrecision = PrecisionMode::FP32;
 	}
+}
 
-	obs_log(LOG_INFO, "GPU detected: %s (sm_%d, %zuMB, %s)", info.name.c_str(), sm, info.totalMemoryMB,
-		gpuArchitectureName(info.architecture));
+bool detectGpu(GpuInfo &info, int device)
+{
+	int deviceCount = 0;
+	cudaError_t err = cudaGetDeviceCount(&deviceCount);
+	if (err != cudaSuccess || deviceCount == 0) {
+		obs_log(LOG_WARNING, "No CUDA-capable GPU detected: %s", cudaGetErrorString(err));
+		return false;
+	}
+	if (device < 0 || device >= deviceCount) {
+		obs_log(LOG_WARNING, "No CUDA device %d (%d present)", device, deviceCount);
+		return false;
+	}
+
+	cudaDeviceProp props;
+	err = cudaGetDeviceProperties(&props, device);
+	if (err != cudaSuccess) {
+		obs_log(LOG_ERROR, "Failed to get GPU properties: %s", cudaGetErrorString(err));
+		return false;
+	}
+	readGpuInfo(info, device, props);
+
+	obs_log(LOG_INFO, "GPU %d detected: %s (sm_%d%d, %zuMB, %s)", device, info.name.c_str(), props.major,
+		props.minor, info.totalMemoryMB, gpuArchitectureName(info.architecture));
 
 	return true;
 }
 
+std::vector<GpuInfo> listGpus()
+{
+	std::vector<GpuInfo> gpus;
+	int deviceCount = 0;
+	if (cudaGetDeviceCount(&deviceCount) != cudaSuccess) {
+		cudaGetLastError();
+		return gpus;
+	}
+	for (int device = 0; device < deviceCount; device++) {
+		cudaDeviceProp props;
+		if (cudaGetDeviceProperties(&props, device) == cudaSuccess) {
+			GpuInfo info;
+			readGpuInfo(info, device, props);
+			gpus.push_back(info);
+		}
+	}
+	return gpus;
+}
+
+// The NVML subset used here (nvml.h is not part of the CUDA runtime headers)
+namespace {
+struct NvmlUtilization {
+	unsigned int gpu;
+	unsigned int memory;
+};
+struct NvmlMemory {
+	unsigned long long total;
+	unsigned long long free;
+	unsigned long long used;
+};
+using NvmlDevice = struct NvmlDeviceOpaque *;
+} // namespace
+
+int leastLoadedGpu()
+{
+	const std::vector<GpuInfo> gpus = listGpus();
+	if (gpus.size() < 2) {
+		return 0;
+	}
+	void *nvml = dlopen("libnvidia-ml.so.1", RTLD_LAZY | RTLD_LOCAL);
+	if (!nvml) {
+		obs_log(LOG_WARNING, "NVML not available, using GPU 0");
+		return 0;
+	}
+	auto init = reinterpret_cast<int (*)()>(dlsym(nvml, "nvmlInit_v2"));
+	auto shutdown = reinterpret_cast<int (*)()>(dlsym(nvml, "nvmlShutdown"));
+	auto byPciBusId = reinterpret_cast<int (*)(const char *, NvmlDevice *)>(
+		dlsym(nvml, "nvmlDeviceGetHandleByPciBusId_v2"));
+	auto utilizationRates =
+		reinterpret_cast<int (*)(NvmlDevice, NvmlUtilization *)>(dlsym(nvml, "nvmlDeviceGetUtilizationRates"));
+	auto memoryInfo = reinterpret_cast<int (*)(NvmlDevice, NvmlMemory *)>(dlsym(nvml, "nvmlDeviceGetMemoryInfo"));
+
+	int best = 0;
+	if (init && shutdown && byPciBusId && utilizationRates && memoryInfo && init() == 0) {
+		unsigned int bestUtilization = 101;
+		unsigned long long bestFree = 0;
+		for (const GpuInfo &gpu : gpus) {
+			// NVML enumerates in PCI order, CUDA fastest first: match them by bus id
+			char busId[32];
+			NvmlDevice handle = nullptr;
+			NvmlUtilization utilization = {};
+			NvmlMemory memory = {};
+			if (cudaDeviceGetPCIBusId(busId, sizeof(busId), gpu.deviceId) != cudaSuccess ||
+			    byPciBusId(busId, &handle) != 0 || utilizationRates(handle, &utilization) != 0 ||
+			    memoryInfo(handle, &memory) != 0) {
+				continue;
+			}
+			if (utilization.gpu < bestUtilization ||
+			    (utilization.gpu == bestUtilization && memory.free > bestFree)) {
+				best = gpu.deviceId;
+				bestUtilization = utilization.gpu;
+				bestFree = memory.free;
+			}
+		}
+		shutdown();
+		obs_log(LOG_INFO, "Least loaded GPU: %d (%u%% utilization, %llu MB free)", best, bestUtilization,
+			bestFree / (1024 * 1024));
+	}
+	dlclose(nvml);
+	return best;
+}
+
+int resolveGpuDevice(int setting)
+{
+	if (setting == GPU_DEVICE_AUTO) {
+		return leastLoadedGpu();
+	}
+	int deviceCount = 0;
+	if (cudaGetDeviceCount(&deviceCount) != cudaSuccess || setting < 0 || setting >= deviceCount) {
+		cudaGetLastError();
+		return 0;
+	}
+	return setting;
+}
+
+int currentGpuDevice()
+{
+	int device = 0;
+	cudaGetDevice(&device);
+	return device;
+}
+
+bool enablePeerAccess(int device, int peer)
+{
+	if (device == peer) {
+		return true;
+	}
+	int canAccess = 0;
+	if (cudaDeviceCanAccessPeer(&canAccess, device, peer) != cudaSuccess || !canAccess) {
+		return false;
+	}
+	CudaDeviceScope scope(device);
+	const cudaError_t err = cudaDeviceEnablePeerAccess(peer, 0);
+	if (err == cudaErrorPeerAccessAlreadyEnabled) {
+		cudaGetLastError();
+		return true;
+	}
+	return err == cudaSuccess;
+}
+
+CudaDeviceScope::CudaDeviceScope(int device)
+{
+	if (device < 0 || cudaGetDevice(&previous_) != cudaSuccess) {
+		previous_ = -1;
+		return;
+	}
+	if (previous_ == device) {
+		previous_ = -1;
+	} else if (cudaSetDevice(device) != cudaSuccess) {
+		cudaGetLastError();
+		previous_ = -1;
+	}
+}
+
+CudaDeviceScope::~CudaDeviceScope()
+{
+	if (previous_ >= 0) {
+		cudaSetDevice(previous_);
+	}
+}
+
 const char *gpuArchitectureName(GpuArchitecture arch)
 {
 	switch (arch) {
@@ -65,3 +218,69 @@ const char *gpuArchitectureName(GpuArchitecture arch)
 		return "Unknown";
 	}
 }
+
+const char *precisionModeName(PrecisionMode mode)
+{
+	switch (mode) {
+	case PrecisionMode::FP16:
+		return PRECISION_FP16;
+	case PrecisionMode::INT8:
+		return PRECISION_INT8;
+	default:
+		return PRECISION_FP32;
+	}
+}
+
+bool parsePrecisionMode(const std::string &name, PrecisionMode &mode)
+{
+	for (PrecisionMode candidate : {PrecisionMode::FP32, PrecisionMode::FP16, PrecisionMode::INT8}) {
+		if (name == precisionModeName(candidate)) {
+			mode = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+const char *schedulingPriorityName(SchedulingPriority priority)
+{
+	switch (priority) {
+	case SchedulingPriority::HIGH:
+		return SCHEDULING_PRIORITY_HIGH;
+	case SchedulingPriority::LOW:
+		return SCHEDULING_PRIORITY_LOW;
+	default:
+		return SCHEDULING_PRIORITY_NORMAL;
+	}
+}
+
+bool parseSchedulingPriority(const std::string &name, SchedulingPriority &priority)
+{
+	for (SchedulingPriority candidate :
+	     {SchedulingPriority::HIGH, SchedulingPriority::NORMAL, SchedulingPriority::LOW}) {
+		if (name == schedulingPriorityName(candidate)) {
+			priority = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+int cudaStreamPriority(SchedulingPriority priority)
+{
+	// Lower numbers are greater priorities: greatest <= 0 <= least
+	int least = 0;
+	int greatest = 0;
+	if (cudaDeviceGetStreamPriorityRange(&least, &greatest) != cudaSuccess) {
+		cudaGetLastError();
+		return 0;
+	}
+	switch (priority) {
+	case SchedulingPriority::HIGH:
+		return greatest;
+	case SchedulingPriority::LOW:
+		return least;
+	default:
+		return std::min(std::max(0, greatest), least);
+	}
+}
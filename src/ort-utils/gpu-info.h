@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
 
 enum class GpuArchitecture {
 	UNKNOWN = 0,
@@ -19,6 +20,16 @@ enum class BufferingMode {
 enum class PrecisionMode {
 	FP32 = 0, // Default for Turing
 	FP16 = 1, // Default for Ampere/Ada
+	INT8 = 2, // TensorRT only: needs a calibration table or a quantized (QDQ) model
+};
+
+// How inference competes with the rest of the machine (scheduling_priority
+// setting): the priority of the CUDA streams sessions run on and the OS
+// priority of the inference worker threads
+enum class SchedulingPriority {
+	HIGH = 0,   // Greatest stream priority, default thread priority
+	NORMAL = 1, // CUDA and OS defaults
+	LOW = 2,    // Least stream priority, worker threads below the OBS threads
 };
 
 struct GpuInfo {
@@ -32,11 +43,68 @@ struct GpuInfo {
 	PrecisionMode defaultPrecision = PrecisionMode::FP32;
 };
 
-// Detect the first NVIDIA GPU and return its info.
-// Returns false if no NVIDIA GPU is found.
-bool detectGpu(GpuInfo &info);
+// Detect the NVIDIA GPU with the given CUDA device index and return its info.
+// Returns false if there is no such GPU.
+bool detectGpu(GpuInfo &info, int device = 0);
+
+// Info of every CUDA device, in device order, without logging (e.g. the device
+// list of the filter properties). Empty if no NVIDIA GPU is found.
+std::vector<GpuInfo> listGpus();
+
+// The CUDA device with the lowest GPU utilization right now, by NVML (loaded at
+// runtime, it ships with the driver); most free memory breaks ties. 0 if NVML
+// is unavailable.
+int leastLoadedGpu();
+
+// CUDA device of a device setting: an index, or GPU_DEVICE_AUTO for the least
+// loaded GPU. Devices that are not present fall back to device 0.
+int resolveGpuDevice(int setting);
+
+// The calling thread's current CUDA device.
+int currentGpuDevice();
+
+// Let device access peer's memory directly (NVLink or PCIe peer-to-peer), so
+// copies between them don't go through host memory. Returns false if the two
+// can't be peers: copies between them are then staged by the driver.
+bool enablePeerAccess(int device, int peer);
+
+// Make a CUDA device current on the calling thread for the lifetime of the
+// scope and restore the previous one afterwards. Every thread that runs a
+// filter's CUDA work (video_tick, the inference workers, the session builder)
+// enters the filter's device first, so its streams, buffers and session live
+// there. A negative device leaves the current one.
+class CudaDeviceScope {
+public:
+	explicit CudaDeviceScope(int device);
+	~CudaDeviceScope();
+
+	CudaDeviceScope(const CudaDeviceScope &) = delete;
+	CudaDeviceScope &operator=(const CudaDeviceScope &) = delete;
+
+private:
+	int previous_ = -1;
+};
 
 // Get a human-readable string for the GPU architecture.
 const char *gpuArchitectureName(GpuArchitecture arch);
 
+// Name of a precision mode as used by the precision setting, the engine cache
+// and the warmup manifest ("fp32", "fp16", "int8").
+const char *precisionModeName(PrecisionMode mode);
+
+// Parse a precision name. Returns false for anything else (e.g. "auto").
+bool parsePrecisionMode(const std::string &name, PrecisionMode &mode);
+
+// Name of a scheduling priority as used by the scheduling_priority setting
+// ("high", "normal", "low").
+const char *schedulingPriorityName(SchedulingPriority priority);
+
+// Parse a scheduling priority name. Returns false for anything else.
+bool parseSchedulingPriority(const std::string &name, SchedulingPriority &priority);
+
+// CUDA stream priority of a scheduling priority on the current device. The
+// default (normal) priority is the least one on current GPUs, so low only
+// differs from normal where the driver's range says so.
+int cudaStreamPriority(SchedulingPriority priority);
+
 #endif /* GPU_INFO_H */
@@ -0,0 +1,166 @@
+#include "inference-pipeline.h"
+
+#include <algorithm>
+
+#include <cuda_runtime.h>
+
+#include "FilterData.h"
+#include "ort-session-utils.h"
+#include "plugin-support.h"
+#include "profiler.h"
+
+InferencePipeline::~InferencePipeline()
+{
+	release();
+	if (downloadStream_) {
+		cudaStreamDestroy(downloadStream_);
+		downloadStream_ = nullptr;
+	}
+}
+
+bool InferencePipeline::init(filter_data *tf, int slotCount)
+{
+	release();
+
+	if (!tf->ioBinding || !tf->model || tf->inputTensorValues.empty() || tf->outputTensorValues.empty()) {
+		return false;
+	}
+
+	// The queue is stopped: the download stream can be replaced for another priority
+	preprocessor_.setPriority(tf->schedulingPriority);
+	if (downloadStream_ && downloadPriority_ != tf->schedulingPriority) {
+		cudaStreamDestroy(downloadStream_);
+		downloadStream_ = nullptr;
+	}
+	if (!downloadStream_ &&
+	    cudaStreamCreateWithPriority(&downloadStream_, cudaStreamNonBlocking,
+					 cudaStreamPriority(tf->schedulingPriority)) != cudaSuccess) {
+		obs_log(LOG_WARNING, "Unable to create the inference pipeline download stream");
+		downloadStream_ = nullptr;
+		return false;
+	}
+	downloadPriority_ = tf->schedulingPriority;
+
+	// FP16 models: the slots hold the half-precision input of the bound tensor
+	const size_t inputBytes = tf->inputTensorValues[0].size() * (tf->halfInput ? sizeof(uint16_t) : sizeof(float));
+	const size_t outputBytes = tf->outputTensorValues[0].size() * sizeof(float);
+
+	slots_.reset(new Slot[slotCount]);
+	slotCount_ = slotCount;
+	for (int i = 0; i < slotCount_; i++) {
+		Slot &slot = slots_[i];
+		if (!slot.input.allocate(inputBytes) || !slot.output.allocate(outputBytes) ||
+		    cudaEventCreateWithFlags(&slot.preprocessed, cudaEventDisableTiming) != cudaSuccess ||
+		    cudaEventCreateWithFlags(&slot.inferred, cudaEventDisableTiming) != cudaSuccess) {
+			obs_log(LOG_WARNING, "Unable to allocate inference pipeline slot %d", i);
+			release();
+			return false;
+		}
+		slot.hostOutput.resize(tf->outputTensorValues.size());
+		slot.hostOutput[0].resize(tf->outputTensorValues[0].size());
+	}
+
+	obs_log(LOG_INFO, "Inference pipeline: %d slots, %d KB input, %d KB output per slot", slotCount_,
+		(int)(inputBytes / 1024), (int)(outputBytes / 1024));
+	return true;
+}
+
+void InferencePipeline::release()
+{
+	for (int i = 0; i < slotCount_; i++) {
+		if (slots_[i].preprocessed) {
+			cudaEventDestroy(slots_[i].preprocessed);
+		}
+		if (slots_[i].inferred) {
+			cudaEventDestroy(slots_[i].inferred);
+		}
+	}
+	slots_.reset();
+	slotCount_ = 0;
+}
+
+bool InferencePipeline::preprocess(filter_data *tf, const InputFrame &frame, int slot)
+{
+	if (slot >= slotCount_ || frame.empty()) {
+		return false;
+	}
+
+	uint32_t inputWidth, inputHeight;
+	tf->model->getNetworkInputSize(tf->inputDims, inputWidth, inputHeight);
+
+	TRACE_GPU_RANGE("pipeline_preprocess", NVTX_COLOR_PREPROCESS, preprocessor_.stream());
+	StageTimer timer(tf->scheduler, InferenceScheduler::STAGE_PREPROCESS);
+	Slot &s = slots_[slot];
+	PreprocessParams params = tf->model->getPreprocessParams();
+	params.outputHalf = tf->halfInput;
+	if (frame.onDevice) {
+		preprocessor_.preprocessDevice(frame.roiDevice(), s.input.data(), inputWidth, inputHeight, params, true);
+	} else {
+		const cv::Mat bgra = frame.roiBGRA();
+		preprocessor_.preprocess(bgra.data, bgra.cols, bgra.rows, (int)bgra.step[0], s.input.data(), inputWidth,
+					 inputHeight, params, true);
+	}
+	return cudaEventRecord(s.preprocessed, preprocessor_.stream()) == cudaSuccess;
+}
+
+bool InferencePipeline::infer(filter_data *tf, int slot)
+{
+	if (slot >= slotCount_ || !tf->session || !tf->model) {
+		return false;
+	}
+
+	Slot &s = slots_[slot];
+	const size_t inputBytes = tf->inputTensorValues[0].size() * (tf->halfInput ? sizeof(uint16_t) : sizeof(float));
+	if (inputBytes != s.input.size()) {
+		return false;
+	}
+
+	if (tf->ioBinding) {
+		// Queue behind stage 1 on the ORT stream; the bound input keeps its address
+		cudaStream_t stream = tf->cudaPreprocessor.stream();
+		cudaStreamWaitEvent(stream, s.preprocessed, 0);
+		cudaMemcpyAsync(tf->inputDeviceBuffers[0].data(), s.input.data(), s.input.size(),
+				cudaMemcpyDeviceToDevice, stream);
+		if (!runBoundModelInference(tf)) {
+			return false;
+		}
+		cudaMemcpyAsync(s.output.data(), tf->outputDeviceBuffers[0].data(), s.output.size(),
+				cudaMemcpyDeviceToDevice, stream);
+		s.outputOnHost = false;
+		return cudaEventRecord(s.inferred, stream) == cudaSuccess;
+	}
+
+	// The session fell back to host tensors (e.g. failed rebind after a TensorRT fallback)
+	if (cudaEventSynchronize(s.preprocessed) != cudaSuccess ||
+	    cudaMemcpy(tf->inputTensorValues[0].data(), s.input.data(), s.input.size(), cudaMemcpyDeviceToHost) !=
+		    cudaSuccess) {
+		return false;
+	}
+	if (!runBoundModelInference(tf)) {
+		return false;
+	}
+	std::copy(tf->outputTensorValues[0].begin(), tf->outputTensorValues[0].end(), s.hostOutput[0].begin());
+	s.outputOnHost = true;
+	return true;
+}
+
+bool InferencePipeline::download(filter_data *tf, int slot, cv::Mat &output)
+{
+	if (slot >= slotCount_) {
+		return false;
+	}
+
+	StageTimer timer(tf->scheduler, InferenceScheduler::STAGE_POSTPROCESS);
+	Slot &s = slots_[slot];
+	if (!s.outputOnHost) {
+		TRACE_GPU_RANGE("pipeline_download", NVTX_COLOR_MEMCOPY, downloadStream_);
+		cudaStreamWaitEvent(downloadStream_, s.inferred, 0);
+		cudaMemcpyAsync(s.hostOutput[0].data(), s.output.data(), s.output.size(), cudaMemcpyDeviceToHost,
+				downloadStream_);
+		if (cudaStreamSynchronize(downloadStream_) != cudaSuccess) {
+			return false;
+		}
+	}
+
+	return networkOutputToMask(tf, s.hostOutput, output);
+}
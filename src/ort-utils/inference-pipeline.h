@@ -0,0 +1,67 @@
+#ifndef INFERENCE_PIPELINE_H
+#define INFERENCE_PIPELINE_H
+
+#include <memory>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "cuda-device-buffer.h"
+#include "cuda-preprocess.h"
+#include "input-frame.h"
+
+struct filter_data;
+struct CUstream_st;
+struct CUevent_st;
+
+// Per-slot GPU state behind the pipelined AsyncInferenceQueue stages.
+//
+// Stage 1 preprocesses a ring slot's frame into the slot's device tensor on the
+// pipeline's own stream. Stage 2 copies it into the session's bound input, runs
+// inference on the ORT stream (tf->cudaPreprocessor.stream()) and copies output
+// 0 into the slot. Stage 3 downloads it on a third stream. The stages are
+// ordered with CUDA events, so frame N+1 is uploaded while frame N is inferred
+// and frame N-1 is downloaded. The session's bound buffers keep fixed addresses
+// (CUDA graph mode stays valid). All three streams have the session's
+// scheduling priority.
+class InferencePipeline {
+public:
+	InferencePipeline() = default;
+	~InferencePipeline();
+
+	InferencePipeline(const InferencePipeline &) = delete;
+	InferencePipeline &operator=(const InferencePipeline &) = delete;
+
+	// Allocate the slot tensors for tf's current session. Only used with
+	// IoBinding; returns false otherwise or if an allocation fails.
+	bool init(filter_data *tf, int slotCount);
+	void release();
+
+	// Stage 1: preprocess the slot's host or device frame (its roi, if set) into the slot tensor.
+	bool preprocess(filter_data *tf, const InputFrame &frame, int slot);
+
+	// Stage 2: run inference on the slot tensor. Caller holds tf->modelMutex.
+	bool infer(filter_data *tf, int slot);
+
+	// Stage 3: download output 0 and postprocess it like runFilterModelInference.
+	bool download(filter_data *tf, int slot, cv::Mat &output);
+
+private:
+	struct Slot {
+		CudaDeviceBuffer input;
+		CudaDeviceBuffer output;
+		std::vector<std::vector<float>> hostOutput; // only [0] is used
+		bool outputOnHost = false;                  // session fell back to host tensors
+		CUevent_st *preprocessed = nullptr;
+		CUevent_st *inferred = nullptr;
+	};
+
+	std::unique_ptr<Slot[]> slots_;
+	int slotCount_ = 0;
+
+	CudaPreprocessor preprocessor_;
+	CUstream_st *downloadStream_ = nullptr;
+	SchedulingPriority downloadPriority_ = SchedulingPriority::NORMAL; // of downloadStream_
+};
+
+#endif /* INFERENCE_PIPELINE_H */
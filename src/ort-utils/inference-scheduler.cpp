@@ -0,0 +1,163 @@
+#include "inference-scheduler.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Weight of a new measurement in the smoothed stage latency
+static constexpr double kLatencySmoothing = 0.1;
+
+// Fraction of the frame period that inference may take per inferred frame.
+// The sync path blocks video_tick, the async path shares the GPU with
+// rendering, NVENC and whatever else runs on it.
+static constexpr double kSyncBudget = 0.5;
+static constexpr double kAsyncBudget = 0.8;
+
+static constexpr int kMaxInterval = 8;
+
+// The duty-cycle cap may space inferences further apart than kMaxInterval
+static constexpr int kMaxBudgetInterval = 60;
+
+// Frames between two interval decreases (catching up is gradual, backing off is not)
+static constexpr int kRecoverFrames = 30;
+
+// Sync-path models move to the async queue when inference takes more than
+// kAsyncEnter frame periods for kAsyncVotes frames in a row, and back below kAsyncLeave
+static constexpr double kAsyncEnter = 0.5;
+static constexpr double kAsyncLeave = 0.3;
+static constexpr int kAsyncVotes = 15;
+
+static constexpr PipelineStats::Stage kStatsStages[InferenceScheduler::STAGE_COUNT] = {
+	PipelineStats::STAGE_PREPROCESS,
+	PipelineStats::STAGE_INFERENCE,
+	PipelineStats::STAGE_POSTPROCESS,
+	PipelineStats::STAGE_MASK,
+};
+
+void InferenceScheduler::record(Stage stage, double ms)
+{
+	// Each stage is timed on one thread at a time; a lost update only delays the average
+	const double previous = latency_[stage].load(std::memory_order_relaxed);
+	const double next = previous > 0.0 ? previous + kLatencySmoothing * (ms - previous) : ms;
+	latency_[stage].store(next, std::memory_order_relaxed);
+	if (stats_) {
+		stats_->record(kStatsStages[stage], ms);
+	}
+}
+
+double InferenceScheduler::frameLatencyMs() const
+{
+	double total = 0.0;
+	for (int i = 0; i < STAGE_COUNT; i++) {
+		total += latency_[i].load(std::memory_order_relaxed);
+	}
+	return total;
+}
+
+void InferenceScheduler::reset()
+{
+	for (auto &latency : latency_) {
+		latency.store(0.0, std::memory_order_relaxed);
+	}
+	interval_ = minInterval_;
+	frameCount_ = 0;
+	framesSinceChange_ = 0;
+	laggedFramesValid_ = false;
+	runPending_ = false;
+	preferAsync_ = false;
+	asyncVotes_ = 0;
+	predictedInterval_.store(interval_, std::memory_order_relaxed);
+	framesUntilRun_.store(interval_, std::memory_order_relaxed);
+}
+
+void InferenceScheduler::updateAsyncPreference(double latency, double framePeriodMs)
+{
+	const bool vote = preferAsync_ ? latency > kAsyncLeave * framePeriodMs : latency > kAsyncEnter * framePeriodMs;
+	if (vote == preferAsync_) {
+		asyncVotes_ = 0;
+	} else if (++asyncVotes_ >= kAsyncVotes) {
+		preferAsync_ = vote;
+		asyncVotes_ = 0;
+	}
+}
+
+int InferenceScheduler::budgetInterval(double latency, double framePeriodMs) const
+{
+	if (gpuBudget_ <= 0 || latency <= 0.0 || framePeriodMs <= 0.0) {
+		return 1;
+	}
+	// Every interval-th frame is inferred: latency * (1000 / framePeriodMs) / interval ms per second
+	const double interval = std::ceil(latency * 1000.0 / (framePeriodMs * gpuBudget_));
+	return (int)std::min(std::max(interval, 1.0), (double)kMaxBudgetInterval);
+}
+
+bool InferenceScheduler::advance(double framePeriodMs, uint32_t laggedFrames)
+{
+	const bool lagged = laggedFramesValid_ && laggedFrames != laggedFrames_;
+	laggedFrames_ = laggedFrames;
+	laggedFramesValid_ = true;
+
+	const double latency = frameLatencyMs();
+	if (!enabled_ || framePeriodMs <= 0.0) {
+		interval_ = std::max(minInterval_, budgetInterval(latency, framePeriodMs));
+		preferAsync_ = false;
+	} else {
+		if (syncPath_) {
+			updateAsyncPreference(latency, framePeriodMs);
+		}
+
+		// Smallest interval at which the inferred frames fit the budget
+		const double budget = (syncPath_ && !preferAsync_ ? kSyncBudget : kAsyncBudget) * framePeriodMs;
+		int target = std::max(minInterval_, (int)std::ceil(latency / budget));
+		if (lagged) {
+			// OBS missed a frame: back off further than the latency alone asks for
+			target = std::max(target, interval_ + 1);
+		}
+		target = std::min(target, std::max(kMaxInterval, minInterval_));
+		target = std::max(target, budgetInterval(latency, framePeriodMs));
+
+		framesSinceChange_++;
+		if (target > interval_) {
+			interval_ = target;
+			framesSinceChange_ = 0;
+		} else if (target < interval_ && framesSinceChange_ >= kRecoverFrames) {
+			interval_--;
+			framesSinceChange_ = 0;
+		}
+	}
+
+	if (++frameCount_ >= interval_) {
+		frameCount_ = 0;
+		return true;
+	}
+	return false;
+}
+
+void InferenceScheduler::publishPrediction()
+{
+	predictedInterval_.store(interval_, std::memory_order_relaxed);
+	framesUntilRun_.store(runPending_ ? 1 : interval_ - frameCount_, std::memory_order_relaxed);
+}
+
+bool InferenceScheduler::shouldRun(double framePeriodMs, uint32_t laggedFrames)
+{
+	const bool run = advance(framePeriodMs, laggedFrames) || runPending_;
+	runPending_ = false;
+	publishPrediction();
+	return run;
+}
+
+void InferenceScheduler::skipFrame(double framePeriodMs, uint32_t laggedFrames)
+{
+	if (advance(framePeriodMs, laggedFrames)) {
+		runPending_ = true;
+	}
+	publishPrediction();
+}
+
+bool InferenceScheduler::runsAfter(int frames) const
+{
+	const int interval = predictedInterval_.load(std::memory_order_relaxed);
+	const int untilRun = framesUntilRun_.load(std::memory_order_relaxed);
+	// Frames untilRun, untilRun + interval, ... run
+	return frames >= untilRun && (frames - untilRun) % interval == 0;
+}
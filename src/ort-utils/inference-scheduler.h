@@ -0,0 +1,149 @@
+#ifndef INFERENCE_SCHEDULER_H
+#define INFERENCE_SCHEDULER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "pipeline-stats.h"
+
+// Latency-driven inference scheduler.
+//
+// The profiled pipeline sections (the NVTX ranges) also time themselves into
+// the scheduler with StageTimer. Stages queued asynchronously on a CUDA stream
+// only cost their launch time, so the GPU time shows up in the stage that
+// synchronizes (the output download); the sum of all stages is the latency of
+// one inferred frame. Samples are forwarded to the attached PipelineStats.
+//
+// Once per new frame, video_tick asks shouldRun(): the inference interval
+// grows at once when the measured latency no longer fits the OBS frame budget
+// or OBS reports lagged frames, and shrinks back one frame at a time while
+// there is headroom. For models that run in video_tick (RVM), preferAsync()
+// reports when the latency blocks tick for too long, so the filter switches
+// them to the async queue until the latency drops again.
+//
+// The render thread asks runsAfter() whether a frame it captures now will be
+// inferred, and skips the readback of the frames that won't. Tick reports
+// those with skipFrame(), so the count of frames stays the same.
+class InferenceScheduler {
+public:
+	enum Stage {
+		STAGE_PREPROCESS = 0, // upload + preprocessing kernel
+		STAGE_INFERENCE,      // ORT Run
+		STAGE_POSTPROCESS,    // output download + conversion to a mask
+		STAGE_MASK,           // mask refinement (CPU or GPU)
+		STAGE_COUNT,
+	};
+
+	// Record a stage duration. Thread-safe: stages are timed on the worker,
+	// pipeline and tick threads.
+	void record(Stage stage, double ms);
+
+	// Also record all samples into stats (set once, before any stage runs)
+	void setStats(PipelineStats *stats) { stats_ = stats; }
+
+	// Smoothed stage latency in milliseconds (0 until measured)
+	double latencyMs(Stage stage) const { return latency_[stage].load(std::memory_order_relaxed); }
+	double frameLatencyMs() const;
+
+	// Tick thread only
+	void setEnabled(bool enabled) { enabled_ = enabled; }
+	bool enabled() const { return enabled_; }
+	// The user's "mask every X frames" setting: the interval never drops below it
+	void setMinInterval(int frames) { minInterval_ = frames < 1 ? 1 : frames; }
+	// Whether the model runs synchronously in video_tick (tighter budget)
+	void setSyncPath(bool sync) { syncPath_ = sync; }
+	// Inference duty-cycle cap: at most msPerSecond of measured frame latency per
+	// second of video (0 = no cap). Applies with the adaptive interval off as well.
+	void setGpuBudget(int msPerSecond) { gpuBudget_ = msPerSecond < 0 ? 0 : msPerSecond; }
+	int gpuBudget() const { return gpuBudget_; }
+	void reset();
+
+	// Tick thread, once per new frame: whether to run inference on it.
+	// framePeriodMs is the OBS frame interval, laggedFrames obs_get_lagged_frames().
+	bool shouldRun(double framePeriodMs, uint32_t laggedFrames);
+	// Tick thread, once per frame whose readback the render thread skipped. If
+	// it would have run (a mispredicted skip), the next new frame runs.
+	void skipFrame(double framePeriodMs, uint32_t laggedFrames);
+
+	// Any thread: whether the frames-th frame from now that shouldRun() or
+	// skipFrame() sees (1 = the next one) will run at the current interval
+	bool runsAfter(int frames) const;
+
+	// Sync-path models: whether to run on the async queue for now
+	bool preferAsync() const { return preferAsync_; }
+
+	// Current inference interval in frames
+	int interval() const { return interval_; }
+
+private:
+	// Advance the frame count; whether the frame is due at the current interval
+	bool advance(double framePeriodMs, uint32_t laggedFrames);
+	// Store the interval and frames until the next run for runsAfter()
+	void publishPrediction();
+	void updateAsyncPreference(double latency, double framePeriodMs);
+	// Smallest interval that keeps inference within the duty-cycle cap
+	int budgetInterval(double latency, double framePeriodMs) const;
+
+	std::atomic<double> latency_[STAGE_COUNT] = {};
+	PipelineStats *stats_ = nullptr;
+
+	bool enabled_ = true;
+	bool syncPath_ = false;
+	int minInterval_ = 1;
+	int gpuBudget_ = 0;
+
+	int interval_ = 1;
+	int frameCount_ = 0;
+	int framesSinceChange_ = 0;
+	uint32_t laggedFrames_ = 0;
+	bool laggedFramesValid_ = false;
+	bool runPending_ = false;
+
+	// Read by runsAfter() on the render thread
+	std::atomic<int> predictedInterval_{1};
+	std::atomic<int> framesUntilRun_{1};
+
+	bool preferAsync_ = false;
+	int asyncVotes_ = 0;
+};
+
+// Times a scope into a scheduler stage, or straight into a pipeline stats
+// stage for the sections the scheduler doesn't measure (readback, texture
+// upload, blur). Steady clock, host side.
+class StageTimer {
+public:
+	StageTimer(InferenceScheduler &scheduler, InferenceScheduler::Stage stage)
+		: scheduler_(&scheduler),
+		  schedulerStage_(stage),
+		  start_(std::chrono::steady_clock::now())
+	{
+	}
+	StageTimer(PipelineStats &stats, PipelineStats::Stage stage)
+		: stats_(&stats),
+		  statsStage_(stage),
+		  start_(std::chrono::steady_clock::now())
+	{
+	}
+	~StageTimer()
+	{
+		const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start_;
+		if (scheduler_) {
+			scheduler_->record(schedulerStage_, elapsed.count());
+		} else {
+			stats_->record(statsStage_, elapsed.count());
+		}
+	}
+
+	StageTimer(const StageTimer &) = delete;
+	StageTimer &operator=(const StageTimer &) = delete;
+
+private:
+	InferenceScheduler *scheduler_ = nullptr;
+	InferenceScheduler::Stage schedulerStage_ = InferenceScheduler::Stage();
+	PipelineStats *stats_ = nullptr;
+	PipelineStats::Stage statsStage_ = PipelineStats::Stage();
+	std::chrono::steady_clock::time_point start_;
+};
+
+#endif /* INFERENCE_SCHEDULER_H */
@@ -0,0 +1,25 @@
+#include "input-frame.h"
+
+void InputFrame::copyFrom(const cv::Mat &src)
+{
+	// Keep bgra in pinned memory (falls back to a regular Mat if the allocation fails)
+	if (bgra.data != pinned.data() || bgra.size() != src.size() || bgra.type() != src.type()) {
+		if (pinned.ensure(src.total() * src.elemSize())) {
+			bgra = cv::Mat(src.rows, src.cols, src.type(), pinned.data());
+		}
+	}
+	// copyTo reuses the existing buffer if dimensions match (avoids allocation per frame)
+	src.copyTo(bgra);
+	onDevice = false;
+}
+
+bool InputFrame::copyFrom(const InputFrame &src)
+{
+	tag = src.tag;
+	if (src.onDevice) {
+		onDevice = true;
+		return copyDeviceFrame(src.device, device);
+	}
+	copyFrom(src.bgra);
+	return true;
+}
@@ -0,0 +1,47 @@
+#ifndef INPUT_FRAME_H
+#define INPUT_FRAME_H
+
+#include <opencv2/core.hpp>
+
+#include "cuda-device-buffer.h"
+#include "cuda-preprocess.h"
+#include "frame-tag.h"
+
+// One captured source frame: either BGRA in host memory (stage surface
+// readback) or in device memory (CUDA-GL interop). Frames are handed between
+// threads in TripleBuffer and AsyncInferenceQueue slots, so every instance keeps
+// its own (reused) allocations.
+struct InputFrame {
+	cv::Mat bgra;          // host frame, a header over pinned unless the allocation failed
+	CudaHostBuffer pinned; // page-locked storage, so the preprocessor can upload it asynchronously
+	DeviceFrame device;    // device frame (onDevice)
+	bool onDevice = false;
+	cv::Rect roi;            // region to run inference on (empty = whole frame), set per queued frame
+	bool partialRoi = false; // the roi mask refreshes part of the previous mask (motion-aware updates)
+	FrameTag tag;            // set by video_render, copied with the frame
+
+	InputFrame() = default;
+	~InputFrame() { freeDeviceFrame(device); }
+
+	InputFrame(const InputFrame &) = delete;
+	InputFrame &operator=(const InputFrame &) = delete;
+
+	bool empty() const { return onDevice ? device.empty() : bgra.empty(); }
+	cv::Size size() const { return onDevice ? cv::Size(device.width, device.height) : bgra.size(); }
+
+	// The region of interest as a view into bgra / device (the whole frame without a roi)
+	cv::Mat roiBGRA() const { return roi.empty() ? bgra : bgra(roi); }
+	DeviceFrame roiDevice() const
+	{
+		return roi.empty() ? device : cropDeviceFrame(device, roi.x, roi.y, roi.width, roi.height);
+	}
+
+	// Copy a host frame into the pinned storage (reused while the size matches).
+	void copyFrom(const cv::Mat &src);
+
+	// Copy another frame (and its tag), device-to-device for device frames.
+	// Returns false on CUDA failure.
+	bool copyFrom(const InputFrame &src);
+};
+
+#endif /* INPUT_FRAME_H */
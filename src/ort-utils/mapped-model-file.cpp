@@ -0,0 +1,79 @@
+#include "mapped-model-file.h"
+
+#include <cstring>
+#include <map>
+#include <mutex>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// FNV-1a with 8-byte steps: one pass over a model at memory speed
+static uint64_t hashBytes(const uint8_t *data, size_t size)
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+	constexpr uint64_t prime = 0x100000001b3ull;
+	size_t i = 0;
+	for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, data + i, sizeof(word));
+		hash = (hash ^ word) * prime;
+	}
+	for (; i < size; i++) {
+		hash = (hash ^ data[i]) * prime;
+	}
+	return hash ^ size;
+}
+
+static int64_t modifiedTime(const struct stat &info)
+{
+	return (int64_t)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+}
+
+MappedModelFile::~MappedModelFile()
+{
+	if (data_) {
+		munmap(data_, size_);
+	}
+}
+
+std::shared_ptr<const MappedModelFile> mapModelFile(const std::string &path)
+{
+	static std::mutex mutex;
+	static std::map<std::string, std::weak_ptr<const MappedModelFile>> mappings;
+
+	const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return nullptr;
+	}
+	struct stat info = {};
+	if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+		close(fd);
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	std::weak_ptr<const MappedModelFile> &entry = mappings[path];
+	std::shared_ptr<const MappedModelFile> mapped = entry.lock();
+	if (mapped && mapped->size() == (size_t)info.st_size && mapped->modified_ == modifiedTime(info)) {
+		close(fd);
+		return mapped;
+	}
+
+	void *data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		return nullptr;
+	}
+	// Read front to back once for the hash, and again by ORT's parser right after
+	madvise(data, (size_t)info.st_size, MADV_SEQUENTIAL);
+
+	std::shared_ptr<MappedModelFile> file(new MappedModelFile());
+	file->data_ = data;
+	file->size_ = (size_t)info.st_size;
+	file->modified_ = modifiedTime(info);
+	file->hash_ = hashBytes(static_cast<const uint8_t *>(data), file->size_);
+	entry = file;
+	return file;
+}
@@ -0,0 +1,41 @@
+#ifndef MAPPED_MODEL_FILE_H
+#define MAPPED_MODEL_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// A model file mapped read-only into memory. Sessions are created from the
+// mapping, so the instances building sessions of one model share its pages
+// instead of each reading the file into a buffer of its own.
+class MappedModelFile {
+public:
+	~MappedModelFile();
+
+	MappedModelFile(const MappedModelFile &) = delete;
+	MappedModelFile &operator=(const MappedModelFile &) = delete;
+
+	const void *data() const { return data_; }
+	size_t size() const { return size_; }
+
+	// Content hash (64-bit FNV-1a over the file's words), the model's identity
+	// in the optimized model cache
+	uint64_t hash() const { return hash_; }
+
+private:
+	friend std::shared_ptr<const MappedModelFile> mapModelFile(const std::string &path);
+	MappedModelFile() = default;
+
+	void *data_ = nullptr;
+	size_t size_ = 0;
+	uint64_t hash_ = 0;
+	int64_t modified_ = 0; // mtime the mapping was made at (ns)
+};
+
+// The mapping of the file at path, shared while any caller holds it. A file
+// changed since it was mapped is mapped again. nullptr if the file can't be
+// opened or mapped (or is empty).
+std::shared_ptr<const MappedModelFile> mapModelFile(const std::string &path);
+
+#endif /* MAPPED_MODEL_FILE_H */
@@ -0,0 +1,67 @@
+#include "ort-env.h"
+
+#include <memory>
+
+#include <obs-module.h>
+
+#include "plugin-support.h"
+
+static std::unique_ptr<Ort::Env> ortEnv;
+static bool cudaArenaRegistered = false;
+
+// Device 0 CUDA arena shared by all sessions. Chunks are sized as requested
+// instead of rounded up to the next power of two, so a scene with many filters
+// does not pay for arena growth in every session. Sessions on other devices
+// (gpu_device setting) keep their own EP arena.
+static void registerCudaArena()
+{
+	try {
+		Ort::MemoryInfo cudaMemoryInfo("Cuda", OrtAllocatorType::OrtArenaAllocator, 0,
+					       OrtMemType::OrtMemTypeDefault);
+		Ort::ArenaCfg arenaCfg(0, 1, -1, -1); // no limit, kSameAsRequested, default chunk sizes
+		ortEnv->CreateAndRegisterAllocatorV2("CUDAExecutionProvider", cudaMemoryInfo, {}, arenaCfg);
+		cudaArenaRegistered = true;
+		obs_log(LOG_INFO, "Registered shared CUDA arena allocator");
+	} catch (const std::exception &e) {
+		// Sessions fall back to their own EP arena
+		obs_log(LOG_WARNING, "Shared CUDA arena unavailable: %s", e.what());
+	}
+}
+
+void ort_env_init(void)
+{
+	if (ortEnv) {
+		return;
+	}
+	try {
+		// GPU sessions run few CPU kernels: one global pool instead of a pool per session
+		Ort::ThreadingOptions threadingOptions;
+		threadingOptions.SetGlobalSpinControl(0);
+		ortEnv = std::make_unique<Ort::Env>(threadingOptions, OrtLoggingLevel::ORT_LOGGING_LEVEL_ERROR,
+						    "obs-backgroundremoval");
+	} catch (const std::exception &e) {
+		obs_log(LOG_ERROR, "Unable to create ONNX Runtime environment: %s", e.what());
+		ortEnv.reset();
+		return;
+	}
+	registerCudaArena();
+}
+
+void ort_env_release(void)
+{
+	cudaArenaRegistered = false;
+	ortEnv.reset();
+}
+
+Ort::Env *getOrtEnv()
+{
+	return ortEnv.get();
+}
+
+void applyOrtEnvSessionOptions(Ort::SessionOptions &sessionOptions)
+{
+	sessionOptions.DisablePerSessionThreads();
+	if (cudaArenaRegistered) {
+		sessionOptions.AddConfigEntry("session.use_env_allocators", "1");
+	}
+}
@@ -0,0 +1,27 @@
+#ifndef ORT_ENV_H
+#define ORT_ENV_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Create the process-wide ORT environment (module load) and release it (module
+// unload, after all filters are destroyed).
+void ort_env_init(void);
+void ort_env_release(void);
+
+#ifdef __cplusplus
+}
+
+#include <onnxruntime_cxx_api.h>
+
+// The process-wide environment: one logger, one set of global thread pools and
+// one CUDA arena for every session. nullptr if ort_env_init() failed.
+Ort::Env *getOrtEnv();
+
+// Session options common to all sessions created in the shared environment
+// (global thread pools, env-registered CUDA arena when available).
+void applyOrtEnvSessionOptions(Ort::SessionOptions &sessionOptions);
+#endif
+
+#endif /* ORT_ENV_H */
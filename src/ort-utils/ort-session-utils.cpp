@@ -1,112 +1,501 @@
 #include <onnxruntime_cxx_api.h>
+#include <cuda_runtime.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstring>
 #include <filesystem>
+#include <functional>
+#include <map>
+#include <mutex>
+
+#include <dlfcn.h>
+#include <unistd.h>
 
 #include <obs-module.h>
 
+#include <opencv2/imgproc.hpp>
+
 #include "ort-session-utils.h"
 #include "consts.h"
 #include "plugin-support.h"
+#include "ort-env.h"
 #include "profiler.h"
+#include "shared-engine.h"
+#include "engine-warmup.h"
+#include "mapped-model-file.h"
+#include "session-cache.h"
 
-static std::string getTrtCachePath()
+std::string getPluginCachePath()
 {
 	// Use a user-writable cache directory — the model data dir (/usr/share/...)
 	// is root-owned and not writable by the plugin at runtime.
 	const char *cacheHome = std::getenv("XDG_CACHE_HOME");
 	std::filesystem::path cacheDir;
 	if (cacheHome && cacheHome[0] != '\0') {
-		cacheDir = std::filesystem::path(cacheHome) / "obs-backgroundremoval" / "trt-cache";
+		cacheDir = std::filesystem::path(cacheHome) / "obs-backgroundremoval";
 	} else {
 		const char *home = std::getenv("HOME");
 		if (home) {
-			cacheDir = std::filesystem::path(home) / ".cache" / "obs-backgroundremoval" / "trt-cache";
+			cacheDir = std::filesystem::path(home) / ".cache" / "obs-backgroundremoval";
 		} else {
-			cacheDir = std::filesystem::path("/tmp") / "obs-backgroundremoval-trt-cache";
+			cacheDir = std::filesystem::path("/tmp") / "obs-backgroundremoval-cache";
 		}
 	}
 	std::filesystem::create_directories(cacheDir);
 	return cacheDir.string();
 }
 
-int createOrtSession(filter_data *tf)
+// TensorRT library version (MAJOR * 10000 + MINOR * 100 + PATCH for TensorRT 10),
+// 0 if libnvinfer can't be loaded. The EP loads it anyway, so this costs nothing.
+static int tensorRtVersion()
 {
-	if (tf->model.get() == nullptr) {
-		obs_log(LOG_ERROR, "Model object is not initialized");
-		return OBS_BGREMOVAL_ORT_SESSION_ERROR_INVALID_MODEL;
+	for (const char *library : {"libnvinfer.so.10", "libnvinfer.so"}) {
+		void *handle = dlopen(library, RTLD_LAZY | RTLD_LOCAL);
+		if (!handle) {
+			continue;
+		}
+		auto getVersion = reinterpret_cast<int32_t (*)()>(dlsym(handle, "getInferLibVersion"));
+		const int version = getVersion ? getVersion() : 0;
+		dlclose(handle);
+		if (version > 0) {
+			return version;
+		}
 	}
+	return 0;
+}
 
-	Ort::SessionOptions sessionOptions;
+// Engines and timing caches are only valid for one GPU, driver, ORT and TensorRT
+// version. Each combination gets its own directory, so an update builds fresh
+// engines (at the next warmup) instead of ORT rejecting stale ones on the first frame.
+static std::string trtCacheKey(int device)
+{
+	int driverVersion = 0;
+	cudaDeviceProp prop = {};
+	cudaDriverGetVersion(&driverVersion);
+	if (cudaGetDeviceProperties(&prop, device) != cudaSuccess) {
+		snprintf(prop.name, sizeof(prop.name), "unknown");
+	}
+
+	std::string gpuName = prop.name;
+	for (char &c : gpuName) {
+		if (!std::isalnum((unsigned char)c)) {
+			c = '_';
+		}
+	}
+	return gpuName + "-sm" + std::to_string(prop.major) + std::to_string(prop.minor) + "-cuda" +
+	       std::to_string(driverVersion) + "-ort" + Ort::GetVersionString() + "-trt" +
+	       std::to_string(tensorRtVersion());
+}
+
+// Cache directory <cache>/<kind>/<trtCacheKey> of a GPU: different GPUs in one
+// machine get different directories
+static std::string getDeviceCachePath(const char *kind, int device)
+{
+	static std::mutex mutex;
+	static std::map<int, std::string> keys;
+	std::string key;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = keys.find(device);
+		if (it == keys.end()) {
+			it = keys.emplace(device, trtCacheKey(device)).first;
+		}
+		key = it->second;
+	}
+	const std::filesystem::path cacheDir = std::filesystem::path(getPluginCachePath()) / kind / key;
+	std::filesystem::create_directories(cacheDir);
+	return cacheDir.string();
+}
 
+static std::string getTrtCachePath(int device)
+{
+	return getDeviceCachePath("trt-cache", device);
+}
+
+// Graphs ORT optimized for the CUDA EP (ORT_ENABLE_ALL), by model content. The
+// directory key covers the ORT version, so an update optimizes afresh.
+static std::string getOptimizedModelPath(const filter_data *tf, const MappedModelFile &model)
+{
+	char hash[32];
+	snprintf(hash, sizeof(hash), "_%016llx.onnx", (unsigned long long)model.hash());
+	const std::string name = std::filesystem::path(tf->modelFilepath).stem().string() + hash;
+	return (std::filesystem::path(getDeviceCachePath("ort-cache", tf->deviceId)) / name).string();
+}
+
+// Create a session of tf's model from its memory mapping. With cacheOptimized
+// the graph ORT optimized for the same model, GPU and ORT version is loaded as
+// is, without optimizing again, and written when there is none yet. Only CUDA
+// sessions are cached: TensorRT subgraphs become compiled nodes ORT can't
+// save (the engine cache covers those).
+static std::shared_ptr<Ort::Session> createModelSession(Ort::Env &env, const filter_data *tf,
+							 Ort::SessionOptions &sessionOptions, bool cacheOptimized)
+{
+	const std::shared_ptr<const MappedModelFile> model = mapModelFile(tf->modelFilepath);
+	if (!model) {
+		return std::make_shared<Ort::Session>(env, tf->modelFilepath.c_str(), sessionOptions);
+	}
+	// A model from memory has no path: external initializers are found next to the file
+	const std::string modelDir = std::filesystem::path(tf->modelFilepath).parent_path().string();
+	sessionOptions.AddConfigEntry("session.model_external_initializers_file_folder_path", modelDir.c_str());
+	if (!cacheOptimized) {
+		return std::make_shared<Ort::Session>(env, model->data(), model->size(), sessionOptions);
+	}
+
+	const std::string cachePath = getOptimizedModelPath(tf, *model);
+	if (const std::shared_ptr<const MappedModelFile> cached = mapModelFile(cachePath)) {
+		try {
+			sessionOptions.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_DISABLE_ALL);
+			auto session = std::make_shared<Ort::Session>(env, cached->data(), cached->size(),
+								      sessionOptions);
+			obs_log(LOG_INFO, "Loaded the optimized model %s", cachePath.c_str());
+			return session;
+		} catch (const std::exception &e) {
+			obs_log(LOG_WARNING, "Cached optimized model %s failed to load (%s), optimizing again",
+				cachePath.c_str(), e.what());
+			std::error_code error;
+			std::filesystem::remove(cachePath, error);
+			sessionOptions.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
+		}
+	}
+
+	// Written under a name of its own and renamed once complete, so no other
+	// build (thread or process) maps a partial file
+	static std::atomic<int> writes{0};
+	const std::string partialPath = cachePath + "." + std::to_string(getpid()) + "-" +
+					std::to_string(writes.fetch_add(1)) + ".tmp";
+	sessionOptions.SetOptimizedModelFilePath(partialPath.c_str());
+	std::shared_ptr<Ort::Session> session;
+	std::error_code error;
+	try {
+		session = std::make_shared<Ort::Session>(env, model->data(), model->size(), sessionOptions);
+	} catch (...) {
+		std::filesystem::remove(partialPath, error);
+		throw;
+	}
+	std::filesystem::rename(partialPath, cachePath, error);
+	if (error) {
+		obs_log(LOG_WARNING, "Unable to cache the optimized model %s: %s", cachePath.c_str(),
+			error.message().c_str());
+		std::filesystem::remove(partialPath, error);
+	} else {
+		obs_log(LOG_INFO, "Cached the optimized model as %s", cachePath.c_str());
+	}
+	return session;
+}
+
+std::string int8CalibrationTablePath(const std::string &modelSelection)
+{
+	const std::string table = std::filesystem::path(modelSelection).stem().string() + ".cache";
+	return (std::filesystem::path(getPluginCachePath()) / "calibration" / table).string();
+}
+
+static bool hasInt8CalibrationTable(const std::string &modelSelection)
+{
+	std::error_code error;
+	return std::filesystem::is_regular_file(int8CalibrationTablePath(modelSelection), error);
+}
+
+PrecisionMode sessionPrecision(const filter_data *tf)
+{
+	PrecisionMode precision = tf->gpuInfo.defaultPrecision;
+	parsePrecisionMode(tf->precision, precision);
+	// INT8 needs TensorRT and the activation ranges of a calibration table; FP16 is the next best
+	if (precision == PrecisionMode::INT8 &&
+	    (tf->useGPU != USEGPU_TENSORRT || !hasInt8CalibrationTable(tf->modelSelection))) {
+		return PrecisionMode::FP16;
+	}
+	return precision;
+}
+
+// ORT names cached engines after the model graph only, so engines of the same
+// model for other profile shapes or precision would overwrite each other. An
+// INT8 engine also depends on the calibration table it was built with.
+static std::string trtEngineCachePrefix(const std::string &modelSelection, const std::string &profileShapes,
+					PrecisionMode precision)
+{
+	const std::string model = std::filesystem::path(modelSelection).stem().string();
+	std::string variant = profileShapes + "|" + precisionModeName(precision);
+	if (precision == PrecisionMode::INT8) {
+		std::error_code error;
+		const auto modified = std::filesystem::last_write_time(int8CalibrationTablePath(modelSelection), error);
+		variant += "|" + std::to_string(modified.time_since_epoch().count());
+	}
+	const size_t hash = std::hash<std::string>()(variant);
+	char suffix[32];
+	snprintf(suffix, sizeof(suffix), "_%016zx", hash);
+	return model + suffix;
+}
+
+// FP16-converted variant of a model, installed next to it:
+// models/x_fp32.onnx or models/x.onnx → models/x_fp16.onnx
+static std::string fp16ModelVariant(const std::string &modelSelection)
+{
+	const std::filesystem::path path(modelSelection);
+	std::string stem = path.stem().string();
+	const std::string fp32Suffix = "_fp32";
+	if (stem.size() > fp32Suffix.size() &&
+	    stem.compare(stem.size() - fp32Suffix.size(), fp32Suffix.size(), fp32Suffix) == 0) {
+		stem.resize(stem.size() - fp32Suffix.size());
+	}
+	return (path.parent_path() / (stem + "_fp16" + path.extension().string())).generic_string();
+}
+
+// CUDA EP (V2 options) running on the preprocessor's stream, so preprocessing,
+// inference and postprocessing are queued back to back on one stream. Shared
+// sessions pass the stream of their priority, no stream (ORT's own) at normal.
+static void appendCudaExecutionProvider(filter_data *tf, Ort::SessionOptions &sessionOptions, CUstream_st *stream)
+{
+	const auto &api = Ort::GetApi();
+	OrtCUDAProviderOptionsV2 *cudaOpts = nullptr;
+	Ort::ThrowOnError(api.CreateCUDAProviderOptions(&cudaOpts));
+
+	const std::string deviceId = std::to_string(tf->deviceId);
+	std::vector<const char *> keys = {"device_id", "enable_cuda_graph"};
+	std::vector<const char *> values = {deviceId.c_str(), tf->useCudaGraph ? "1" : "0"};
+
+	OrtStatus *status = api.UpdateCUDAProviderOptions(cudaOpts, keys.data(), values.data(), keys.size());
+	if (status == nullptr && stream) {
+		status = api.UpdateCUDAProviderOptionsWithValue(cudaOpts, "user_compute_stream", stream);
+	}
+	if (status == nullptr) {
+		status = api.SessionOptionsAppendExecutionProvider_CUDA_V2(sessionOptions, cudaOpts);
+	}
+	api.ReleaseCUDAProviderOptions(cudaOpts);
+	Ort::ThrowOnError(status);
+}
+
+static Ort::SessionOptions createBaseSessionOptions()
+{
+	Ort::SessionOptions sessionOptions;
 	sessionOptions.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
 	sessionOptions.DisableMemPattern();
 	sessionOptions.SetExecutionMode(ExecutionMode::ORT_SEQUENTIAL);
+	applyOrtEnvSessionOptions(sessionOptions);
+	return sessionOptions;
+}
 
-	char *modelFilepath_rawPtr = obs_module_file(tf->modelSelection.c_str());
+static bool isHalfTensor(const Ort::TypeInfo &typeInfo)
+{
+	return typeInfo.GetTensorTypeAndShapeInfo().GetElementType() == ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16;
+}
 
-	if (modelFilepath_rawPtr == nullptr) {
-		obs_log(LOG_ERROR, "Unable to get model filename %s from plugin.", tf->modelSelection.c_str());
-		return OBS_BGREMOVAL_ORT_SESSION_ERROR_FILE_NOT_FOUND;
+// Whether the session has half-precision inputs or outputs (FP16 model variants)
+static bool hasHalfTensors(const filter_data *tf)
+{
+	for (size_t i = 0; i < tf->session->GetInputCount(); i++) {
+		if (isHalfTensor(tf->session->GetInputTypeInfo(i))) {
+			return true;
+		}
+	}
+	for (size_t i = 0; i < tf->session->GetOutputCount(); i++) {
+		if (isHalfTensor(tf->session->GetOutputTypeInfo(i))) {
+			return true;
+		}
 	}
+	return false;
+}
 
-	std::string modelFilepath_s(modelFilepath_rawPtr);
+// Whether the session input or output called name is half-precision
+static bool isHalfTensor(const filter_data *tf, const char *name, bool input)
+{
+	Ort::AllocatorWithDefaultOptions allocator;
+	const size_t count = input ? tf->session->GetInputCount() : tf->session->GetOutputCount();
+	for (size_t i = 0; i < count; i++) {
+		const auto tensorName = input ? tf->session->GetInputNameAllocated(i, allocator)
+					      : tf->session->GetOutputNameAllocated(i, allocator);
+		if (strcmp(tensorName.get(), name) == 0) {
+			return isHalfTensor(input ? tf->session->GetInputTypeInfo(i)
+						  : tf->session->GetOutputTypeInfo(i));
+		}
+	}
+	return false;
+}
 
-	tf->modelFilepath = std::string(modelFilepath_rawPtr);
+// CUDA tensor over a device buffer of count elements, FP32 or FP16
+static Ort::Value createDeviceTensor(const Ort::MemoryInfo &memoryInfo, const CudaDeviceBuffer &buffer, size_t count,
+				     const std::vector<int64_t> &dims, bool half)
+{
+	const size_t bytes = count * (half ? sizeof(uint16_t) : sizeof(float));
+	const ONNXTensorElementDataType type = half ? ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT16
+						    : ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT;
+	return Ort::Value::CreateTensor(memoryInfo, buffer.data(), bytes, dims.data(), dims.size(), type);
+}
 
-	bfree(modelFilepath_rawPtr);
+// Replace the host tensors with CUDA tensors of the same shape (IoBinding mode).
+// Inputs the model keeps on the host stay bound to inputTensorValues.
+// Half-precision tensors of FP16 models get FP16 buffers; output 0 is bound to
+// halfOutput and converted into the float outputDeviceBuffers[0] after each run.
+static bool allocateDeviceTensors(filter_data *tf)
+{
+	Ort::MemoryInfo cudaMemoryInfo("Cuda", OrtAllocatorType::OrtDeviceAllocator, tf->deviceId,
+				       OrtMemType::OrtMemTypeDefault);
+
+	tf->inputDeviceBuffers.resize(tf->inputDims.size());
+	tf->outputDeviceBuffers.resize(tf->outputDims.size());
+
+	for (size_t i = 0; i < tf->inputDims.size(); i++) {
+		const bool half = isHalfTensor(tf, tf->inputNames[i].get(), true);
+		if (tf->model->keepInputOnHost(i)) {
+			if (half) {
+				// Written as floats by setExtraTensorInputs()
+				obs_log(LOG_WARNING, "Host input %d of an FP16 model must be FP32", (int)i);
+				return false;
+			}
+			continue;
+		}
+		const size_t count = tf->inputTensorValues[i].size();
+		if (!tf->inputDeviceBuffers[i].allocate(count * (half ? sizeof(uint16_t) : sizeof(float)))) {
+			obs_log(LOG_WARNING, "Unable to allocate %d values of device memory for input %d", (int)count,
+				(int)i);
+			return false;
+		}
+		tf->inputTensor[i] =
+			createDeviceTensor(cudaMemoryInfo, tf->inputDeviceBuffers[i], count, tf->inputDims[i], half);
+		if (i == 0) {
+			tf->halfInput = half;
+		}
+	}
+
+	for (size_t i = 0; i < tf->outputDims.size(); i++) {
+		const bool half = isHalfTensor(tf, tf->outputNames[i].get(), false);
+		const size_t count = tf->outputTensorValues[i].size();
+		// Output 0 is read as floats: its FP16 tensor is converted into the float buffer
+		const bool convert = half && i == 0;
+		const size_t bytes = count * (half && !convert ? sizeof(uint16_t) : sizeof(float));
+		if (!tf->outputDeviceBuffers[i].allocate(bytes) ||
+		    (convert && !tf->halfOutput.allocate(count * sizeof(uint16_t)))) {
+			obs_log(LOG_WARNING, "Unable to allocate %d values of device memory for output %d", (int)count,
+				(int)i);
+			return false;
+		}
+		const CudaDeviceBuffer &bound = convert ? tf->halfOutput : tf->outputDeviceBuffers[i];
+		tf->outputTensor[i] = createDeviceTensor(cudaMemoryInfo, bound, count, tf->outputDims[i], half);
+	}
+
+	return true;
+}
+
+// Create a session for tf's model with the given execution provider (TensorRT
+// with CUDA fallback, or CUDA). Returns nullptr on failure.
+static std::shared_ptr<Ort::Session> buildSession(filter_data *tf, const std::string &useGPU, CUstream_st *stream)
+{
+	Ort::Env *env = getOrtEnv();
+	if (!env) {
+		obs_log(LOG_ERROR, "ONNX Runtime environment is not initialized");
+		return nullptr;
+	}
+	Ort::SessionOptions sessionOptions = createBaseSessionOptions();
 
 	try {
-		if (tf->useGPU == USEGPU_TENSORRT) {
-			// TensorRT V2 API with FP16, engine caching, and CUDA fallback
+		if (useGPU == USEGPU_TENSORRT) {
+			// TensorRT V2 API with FP16/INT8, engine caching, and CUDA fallback
 			try {
-				std::string cachePath = getTrtCachePath();
-				bool useFP16 = (tf->gpuInfo.defaultPrecision == PrecisionMode::FP16);
+				std::string cachePath = getTrtCachePath(tf->deviceId);
+				PrecisionMode precision = sessionPrecision(tf);
+				// INT8 builds keep FP16 enabled for the layers TensorRT can't run in INT8
+				bool useFP16 = precision != PrecisionMode::FP32;
+				bool useINT8 = precision == PrecisionMode::INT8;
+
+				if (tf->precision == PRECISION_INT8 && !useINT8) {
+					obs_log(LOG_WARNING, "TensorRT: no INT8 calibration table at %s, building FP16",
+						int8CalibrationTablePath(tf->modelSelection).c_str());
+				}
 
-				obs_log(LOG_INFO, "TensorRT: cache=%s, FP16=%s", cachePath.c_str(),
-					useFP16 ? "yes" : "no");
+				// Get model-specific TRT optimization profile shapes. The cached
+				// engine is named after the profile range, so it serves every
+				// inference resolution of the source.
+				const std::string profileShapes = tf->model->getTrtProfileShapes();
+				const std::string minShapes = tf->model->getTrtProfileMinShapes();
+				const std::string maxShapes = tf->model->getTrtProfileMaxShapes();
+				const bool fixedShapes = minShapes == profileShapes && maxShapes == profileShapes;
+				const std::string profileRange = fixedShapes ? profileShapes : minShapes + "|" + maxShapes;
+				std::string cachePrefix = trtEngineCachePrefix(tf->modelSelection, profileRange, precision);
+
+				// ORT reads the calibration table from the engine cache directory
+				std::string calibrationTable = cachePrefix + ".calibration";
+				if (useINT8) {
+					std::error_code error;
+					std::filesystem::copy_file(int8CalibrationTablePath(tf->modelSelection),
+								   std::filesystem::path(cachePath) / calibrationTable,
+								   std::filesystem::copy_options::overwrite_existing, error);
+					if (error) {
+						obs_log(LOG_WARNING,
+							"TensorRT: unable to copy the INT8 calibration table (%s), building FP16",
+							error.message().c_str());
+						precision = PrecisionMode::FP16;
+						useINT8 = false;
+						cachePrefix = trtEngineCachePrefix(tf->modelSelection, profileRange, precision);
+					}
+				}
+				obs_log(LOG_INFO, "TensorRT: cache=%s, precision=%s", cachePath.c_str(),
+					precisionModeName(precision));
 
 				const auto &api = Ort::GetApi();
 				OrtTensorRTProviderOptionsV2 *trtOpts = nullptr;
 				Ort::ThrowOnError(api.CreateTensorRTProviderOptions(&trtOpts));
 
-				// Get model-specific TRT optimization profile shapes
-				std::string profileShapes = tf->model->getTrtProfileShapes();
-
 				std::vector<const char *> keys = {
 					"device_id",
 					"trt_max_workspace_size",
 					"trt_fp16_enable",
 					"trt_engine_cache_enable",
 					"trt_engine_cache_path",
+					"trt_engine_cache_prefix",
 					"trt_timing_cache_enable",
 					"trt_timing_cache_path",
 					"trt_builder_optimization_level",
+					"trt_cuda_graph_enable",
 				};
 				std::string fp16Str = useFP16 ? "1" : "0";
+				const std::string deviceId = std::to_string(tf->deviceId);
+				const std::string workspaceSize = std::to_string(tf->trtWorkspaceBytes);
 				std::vector<const char *> values = {
-					"0",
-					"2147483648",
+					deviceId.c_str(),
+					workspaceSize.c_str(),
 					fp16Str.c_str(),
 					"1",
 					cachePath.c_str(),
+					cachePrefix.c_str(),
 					"1",
 					cachePath.c_str(),
 					"3",
+					tf->useCudaGraph ? "1" : "0",
 				};
 
-				// Provide explicit optimization profiles so TRT knows
-				// the exact shapes for all dynamic inputs (min=opt=max).
+				if (useINT8) {
+					keys.push_back("trt_int8_enable");
+					values.push_back("1");
+					keys.push_back("trt_int8_calibration_table_name");
+					values.push_back(calibrationTable.c_str());
+					keys.push_back("trt_int8_use_native_calibration_table");
+					values.push_back("1");
+				}
+
+				// Provide explicit optimization profiles so TRT knows the
+				// shapes of all dynamic inputs: tuned for the current
+				// size (opt), valid for the range of the source
 				if (!profileShapes.empty()) {
 					obs_log(LOG_INFO, "TensorRT profile shapes: %s", profileShapes.c_str());
+					if (!fixedShapes) {
+						obs_log(LOG_INFO, "TensorRT profile range: %s - %s", minShapes.c_str(),
+							maxShapes.c_str());
+					}
 					keys.push_back("trt_profile_min_shapes");
-					values.push_back(profileShapes.c_str());
+					values.push_back(minShapes.c_str());
 					keys.push_back("trt_profile_max_shapes");
-					values.push_back(profileShapes.c_str());
+					values.push_back(maxShapes.c_str());
 					keys.push_back("trt_profile_opt_shapes");
 					values.push_back(profileShapes.c_str());
 				}
 
 				Ort::ThrowOnError(api.UpdateTensorRTProviderOptions(trtOpts, keys.data(), values.data(),
 										    keys.size()));
+				if (stream) {
+					Ort::ThrowOnError(api.UpdateTensorRTProviderOptionsWithValue(
+						trtOpts, "user_compute_stream", stream));
+				}
 				Ort::ThrowOnError(
 					api.SessionOptionsAppendExecutionProvider_TensorRT_V2(sessionOptions, trtOpts));
 				api.ReleaseTensorRTProviderOptions(trtOpts);
@@ -115,38 +504,151 @@ int createOrtSession(filter_data *tf)
 				obs_log(LOG_WARNING, "TensorRT EP failed: %s. Falling back to CUDA.", e.what());
 			}
 			// Always add CUDA as fallback (handles ops TensorRT doesn't support)
-			Ort::ThrowOnError(OrtSessionOptionsAppendExecutionProvider_CUDA(sessionOptions, 0));
+			appendCudaExecutionProvider(tf, sessionOptions, stream);
 		} else {
 			// CUDA execution provider
-			Ort::ThrowOnError(OrtSessionOptionsAppendExecutionProvider_CUDA(sessionOptions, 0));
+			appendCudaExecutionProvider(tf, sessionOptions, stream);
 		}
-		tf->session.reset(new Ort::Session(*tf->env, tf->modelFilepath.c_str(), sessionOptions));
+		return createModelSession(*env, tf, sessionOptions, useGPU != USEGPU_TENSORRT);
 	} catch (const std::exception &e) {
-		if (tf->useGPU == USEGPU_TENSORRT) {
+		if (useGPU == USEGPU_TENSORRT) {
 			// TRT can fail during session init (e.g. missing shape info on
 			// intermediate nodes). Retry with CUDA-only so the filter still works.
 			obs_log(LOG_WARNING, "TensorRT session failed: %s", e.what());
 			obs_log(LOG_WARNING, "Retrying with CUDA-only execution provider.");
 			try {
-				Ort::SessionOptions cudaOptions;
-				cudaOptions.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
-				cudaOptions.DisableMemPattern();
-				cudaOptions.SetExecutionMode(ExecutionMode::ORT_SEQUENTIAL);
-				Ort::ThrowOnError(OrtSessionOptionsAppendExecutionProvider_CUDA(cudaOptions, 0));
-				tf->session.reset(new Ort::Session(*tf->env, tf->modelFilepath.c_str(), cudaOptions));
+				Ort::SessionOptions cudaOptions = createBaseSessionOptions();
+				appendCudaExecutionProvider(tf, cudaOptions, stream);
+				auto session = createModelSession(*env, tf, cudaOptions, true);
 				obs_log(LOG_INFO, "CUDA fallback session created successfully");
+				return session;
 			} catch (const std::exception &e2) {
 				obs_log(LOG_ERROR, "CUDA fallback also failed: %s", e2.what());
-				return OBS_BGREMOVAL_ORT_SESSION_ERROR_STARTUP;
+				return nullptr;
 			}
 		} else {
 			obs_log(LOG_ERROR, "%s", e.what());
-			return OBS_BGREMOVAL_ORT_SESSION_ERROR_STARTUP;
+			return nullptr;
+		}
+	}
+}
+
+static SharedEngineKey sharedEngineKey(const filter_data *tf, const std::string &useGPU)
+{
+	SharedEngineKey key;
+	key.modelPath = tf->modelFilepath;
+	key.executionProvider = useGPU;
+	key.deviceId = tf->deviceId;
+	key.priority = tf->schedulingPriority;
+	if (useGPU == USEGPU_TENSORRT) {
+		key.precision = precisionModeName(sessionPrecision(tf));
+		// e.g. RVM instances on sources of different sizes need their own engines
+		key.trtProfileShapes = tf->model->getTrtProfileShapes();
+	}
+	return key;
+}
+
+static bool resolveModelFilepath(filter_data *tf)
+{
+	// CUDA runs FP16 with the model's FP16 variant, whose half-precision tensors need IoBinding
+	if (tf->useGPU == USEGPU_CUDA && tf->useIoBinding && sessionPrecision(tf) == PrecisionMode::FP16) {
+		const std::string variant = fp16ModelVariant(tf->modelSelection);
+		char *variantPath = obs_module_file(variant.c_str());
+		if (variantPath != nullptr) {
+			tf->modelFilepath = std::string(variantPath);
+			bfree(variantPath);
+			return true;
 		}
+		obs_log(LOG_INFO, "No FP16 variant %s installed, running %s in FP32", variant.c_str(),
+			tf->modelSelection.c_str());
+	}
+
+	char *modelFilepath_rawPtr = obs_module_file(tf->modelSelection.c_str());
+
+	if (modelFilepath_rawPtr == nullptr) {
+		obs_log(LOG_ERROR, "Unable to get model filename %s from plugin.", tf->modelSelection.c_str());
+		return false;
+	}
+
+	tf->modelFilepath = std::string(modelFilepath_rawPtr);
+
+	bfree(modelFilepath_rawPtr);
+	return true;
+}
+
+std::string sharedSessionKey(filter_data *tf)
+{
+	if (!tf->model || !tf->useSharedEngine || tf->useCudaGraph || !resolveModelFilepath(tf)) {
+		return std::string();
+	}
+	return sharedEngineKey(tf, tf->useGPU).str();
+}
+
+int prepareOrtSession(filter_data *tf, PreparedSession &prepared, CUstream_st *stream)
+{
+	if (tf->model.get() == nullptr) {
+		obs_log(LOG_ERROR, "Model object is not initialized");
+		return OBS_BGREMOVAL_ORT_SESSION_ERROR_INVALID_MODEL;
+	}
+
+	if (!resolveModelFilepath(tf)) {
+		return OBS_BGREMOVAL_ORT_SESSION_ERROR_FILE_NOT_FOUND;
+	}
+
+	if (tf->useSharedEngine && !tf->useCudaGraph) {
+		// Graph mode captures per-instance addresses, so those sessions stay private.
+		// The key holds the priority: a shared session runs on that priority's stream.
+		prepared.sharedEngine = acquireSharedEngine(sharedEngineKey(tf, tf->useGPU), [tf] {
+			return buildSession(tf, tf->useGPU, sharedSessionStream(tf->deviceId, tf->schedulingPriority));
+		});
+		prepared.session = prepared.sharedEngine ? prepared.sharedEngine->session() : nullptr;
+	} else {
+		prepared.sharedEngine.reset();
+		prepared.session = buildSession(tf, tf->useGPU, stream);
+	}
+	return prepared.session ? OBS_BGREMOVAL_ORT_SESSION_SUCCESS : OBS_BGREMOVAL_ORT_SESSION_ERROR_STARTUP;
+}
+
+int createOrtSession(filter_data *tf)
+{
+	// The binding refers to the session it was created for
+	tf->ioBinding.reset();
+
+	PreparedSession prepared;
+	const int result = prepareOrtSession(tf, prepared, tf->cudaPreprocessor.stream());
+	if (result != OBS_BGREMOVAL_ORT_SESSION_SUCCESS) {
+		return result;
+	}
+	return createOrtSession(tf, prepared);
+}
+
+int createOrtSession(filter_data *tf, PreparedSession &prepared)
+{
+	if (tf->model.get() == nullptr) {
+		obs_log(LOG_ERROR, "Model object is not initialized");
+		return OBS_BGREMOVAL_ORT_SESSION_ERROR_INVALID_MODEL;
+	}
+
+	tf->ioBinding.reset();
+	tf->sharedEngine = std::move(prepared.sharedEngine);
+	tf->session = std::move(prepared.session);
+	if (!tf->session) {
+		return OBS_BGREMOVAL_ORT_SESSION_ERROR_STARTUP;
 	}
 
 	Ort::AllocatorWithDefaultOptions allocator;
 
+	// Checked on the model's own shapes: populateInputOutputShapes() fixes dynamic dimensions
+	tf->dynamicBatch = false;
+	if (tf->session->GetInputCount() == 1 && tf->session->GetOutputCount() == 1) {
+		const auto inputShape = tf->session->GetInputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+		const auto outputShape = tf->session->GetOutputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+		tf->dynamicBatch = !inputShape.empty() && inputShape[0] == -1 && !outputShape.empty() &&
+				   outputShape[0] == -1;
+	}
+	tf->tileInputBuffer.reset();
+	tf->tileOutputBuffer.reset();
+
 	tf->model->populateInputOutputNames(tf->session, tf->inputNames, tf->outputNames);
 
 	if (!tf->model->populateInputOutputShapes(tf->session, tf->inputDims, tf->outputDims)) {
@@ -173,45 +675,308 @@ int createOrtSession(filter_data *tf)
 	tf->model->allocateTensorBuffers(tf->inputDims, tf->outputDims, tf->outputTensorValues, tf->inputTensorValues,
 					 tf->inputTensor, tf->outputTensor);
 
+	tf->inputDeviceBuffers.clear();
+	tf->outputDeviceBuffers.clear();
+	tf->halfInput = false;
+	tf->halfOutput.reset();
+	if (tf->useIoBinding) {
+		if (allocateDeviceTensors(tf) && bindDeviceTensors(tf)) {
+			obs_log(LOG_INFO, "IoBinding enabled: %d inputs, %d outputs in CUDA memory%s",
+				(int)tf->inputNames.size(), (int)tf->outputNames.size(),
+				tf->halfInput ? " (FP16 input)" : "");
+		} else {
+			obs_log(LOG_WARNING, "IoBinding setup failed, using host tensors");
+			tf->inputDeviceBuffers.clear();
+			tf->outputDeviceBuffers.clear();
+			tf->halfInput = false;
+			tf->halfOutput.reset();
+			tf->model->allocateTensorBuffers(tf->inputDims, tf->outputDims, tf->outputTensorValues,
+							 tf->inputTensorValues, tf->inputTensor, tf->outputTensor);
+		}
+	}
+	if (!tf->ioBinding && hasHalfTensors(tf)) {
+		// The host tensors are float
+		obs_log(LOG_ERROR, "Half-precision model %s needs IoBinding", tf->modelFilepath.c_str());
+		return OBS_BGREMOVAL_ORT_SESSION_ERROR_INVALID_INPUT_OUTPUT;
+	}
+
+	if (tf->useGPU == USEGPU_TENSORRT && tf->sharedEngine) {
+		// Only shared sessions can be handed over from the warmup. Models
+		// sized for the source are recorded with it, the others with their input.
+		if (tf->model->sourceWidth() > 0 && tf->model->sourceHeight() > 0) {
+			recordWarmupEngine(tf->modelSelection, sessionPrecision(tf), tf->deviceId,
+					   tf->model->sourceWidth(), tf->model->sourceHeight(),
+					   tf->model->inferenceResolution());
+		} else {
+			uint32_t inputWidth = 0, inputHeight = 0;
+			tf->model->getNetworkInputSize(tf->inputDims, inputWidth, inputHeight);
+			recordWarmupEngine(tf->modelSelection, sessionPrecision(tf), tf->deviceId, (int)inputWidth,
+					   (int)inputHeight, INFERENCE_RESOLUTION_SOURCE);
+		}
+	}
+
 	return OBS_BGREMOVAL_ORT_SESSION_SUCCESS;
 }
 
-bool runFilterModelInference(filter_data *tf, const cv::Mat &imageBGRA, cv::Mat &output)
+bool suspendOrtSession(filter_data *tf)
 {
-	if (tf->session.get() == nullptr) {
+	if (!tf->session) {
 		return false;
 	}
-	if (tf->model.get() == nullptr) {
+	PreparedSession prepared;
+	prepared.session = std::move(tf->session);
+	prepared.sharedEngine = std::move(tf->sharedEngine);
+	tf->ioBinding.reset();
+	tf->inputTensor.clear();
+	tf->outputTensor.clear();
+	tf->inputDeviceBuffers.clear();
+	tf->outputDeviceBuffers.clear();
+	tf->halfOutput.reset();
+	tf->tileInputBuffer.reset();
+	tf->tileOutputBuffer.reset();
+	tf->inputTensorValues.clear();
+	tf->outputTensorValues.clear();
+	if (!tf->useCudaGraph) {
+		SuspendedSessionCache::instance().store(tf, std::move(prepared), tf->modelSelection);
+	}
+	return true;
+}
+
+int resumeOrtSession(filter_data *tf)
+{
+	PreparedSession prepared;
+	if (!SuspendedSessionCache::instance().take(tf, prepared)) {
+		return OBS_BGREMOVAL_ORT_SESSION_ERROR_STARTUP;
+	}
+	return createOrtSession(tf, prepared);
+}
+
+bool bindDeviceTensors(filter_data *tf)
+{
+	tf->ioBinding.reset();
+	if (!tf->session || tf->inputDeviceBuffers.empty()) {
+		return false;
+	}
+
+	try {
+		tf->ioBinding = std::make_unique<Ort::IoBinding>(*tf->session);
+		for (size_t i = 0; i < tf->inputNames.size(); i++) {
+			tf->ioBinding->BindInput(tf->inputNames[i].get(), tf->inputTensor[i]);
+		}
+		for (size_t i = 0; i < tf->outputNames.size(); i++) {
+			tf->ioBinding->BindOutput(tf->outputNames[i].get(), tf->outputTensor[i]);
+		}
+
+		// Outputs are consumed in stream order (download or device postprocessing),
+		// so Run() does not need to wait for the GPU. A shared session runs on
+		// ORT's own stream and must finish before the instance reads its outputs.
+		for (int i = 0; i < 2; i++) {
+			tf->ioBindingRunOptions[i] = Ort::RunOptions();
+			if (!tf->sharedEngine) {
+				tf->ioBindingRunOptions[i].AddConfigEntry("disable_synchronize_execution_providers",
+									  "1");
+			}
+			if (tf->useCudaGraph) {
+				tf->ioBindingRunOptions[i].AddConfigEntry("gpu_graph_id", i == 0 ? "0" : "1");
+			}
+		}
+		tf->recurrentParity = 0;
+	} catch (const std::exception &e) {
+		obs_log(LOG_WARNING, "IoBinding failed: %s", e.what());
+		tf->ioBinding.reset();
 		return false;
 	}
+	return true;
+}
 
+// Write the normalized input tensor into target (device or host memory)
+static bool preprocessInput(filter_data *tf, const cv::Mat &imageBGRA, void *target, bool onDevice)
+{
 	uint32_t inputWidth, inputHeight;
 	tf->model->getNetworkInputSize(tf->inputDims, inputWidth, inputHeight);
+	PreprocessParams params = tf->model->getPreprocessParams();
+	params.outputHalf = onDevice && tf->halfInput;
 
 	// CUDA-accelerated preprocessing: BGRA→RGB + resize + normalize + optional CHW
 	// Writes directly to ONNX tensor buffer, replacing cvtColor/resize/convertTo/prepareInput/loadInput
-	{
-		NVTX_RANGE_COLOR("cuda_preprocess", NVTX_COLOR_PREPROCESS);
-		PreprocessParams params = tf->model->getPreprocessParams();
-		tf->cudaPreprocessor.preprocess(imageBGRA.data, imageBGRA.cols, imageBGRA.rows, (int)imageBGRA.step[0],
-						tf->inputTensorValues[0].data(), inputWidth, inputHeight, params);
+	TRACE_GPU_RANGE("cuda_preprocess", NVTX_COLOR_PREPROCESS, tf->cudaPreprocessor.stream());
+	tf->cudaPreprocessor.preprocess(imageBGRA.data, imageBGRA.cols, imageBGRA.rows, (int)imageBGRA.step[0], target,
+					inputWidth, inputHeight, params, onDevice);
+	return true;
+}
+
+static bool preprocessInput(filter_data *tf, const DeviceFrame &frameBGRA, void *target, bool onDevice)
+{
+	if (frameBGRA.empty()) {
+		return false;
 	}
 
+	uint32_t inputWidth, inputHeight;
+	tf->model->getNetworkInputSize(tf->inputDims, inputWidth, inputHeight);
+	PreprocessParams params = tf->model->getPreprocessParams();
+	params.outputHalf = onDevice && tf->halfInput;
+
+	// Frame is already on the GPU (CUDA-GL interop) — no host→device upload
+	TRACE_GPU_RANGE("cuda_preprocess", NVTX_COLOR_PREPROCESS, tf->cudaPreprocessor.stream());
+	tf->cudaPreprocessor.preprocessDevice(frameBGRA, target, inputWidth, inputHeight, params, onDevice);
+	return true;
+}
+
+// Write input 0: straight into the bound device buffer in IoBinding mode,
+// otherwise into the host tensor.
+template<typename Frame> static bool preprocessInput(filter_data *tf, const Frame &imageBGRA)
+{
+	StageTimer timer(tf->scheduler, InferenceScheduler::STAGE_PREPROCESS);
+	const bool onDevice = tf->ioBinding != nullptr;
+	void *target = onDevice ? tf->inputDeviceBuffers[0].data() : tf->inputTensorValues[0].data();
+	return preprocessInput(tf, imageBGRA, target, onDevice);
+}
+
+// Run the session on the current contents of the input tensors
+static bool runSession(filter_data *tf)
+{
 	// Set model-specific extra tensor inputs (e.g., RVM downsample flag)
 	tf->model->setExtraTensorInputs(tf->inputTensorValues);
 
 	// Run network inference
-	{
-		NVTX_RANGE_COLOR("model_inference", NVTX_COLOR_INFERENCE);
+	TRACE_GPU_RANGE("model_inference", NVTX_COLOR_INFERENCE, tf->cudaPreprocessor.stream());
+	StageTimer timer(tf->scheduler, InferenceScheduler::STAGE_INFERENCE);
+	if (tf->sharedEngine) {
+		// The shared session runs on ORT's stream: the input must be complete first
+		cudaStreamSynchronize(tf->cudaPreprocessor.stream());
+		if (tf->sharedEngine->batchable(tf)) {
+			return tf->sharedEngine->runBatched(tf);
+		}
+	}
+	if (tf->ioBinding) {
+		try {
+			tf->model->runNetworkInference(tf->session, *tf->ioBinding,
+						       tf->ioBindingRunOptions[tf->recurrentParity]);
+		} catch (const Ort::Exception &e) {
+			if (!tf->useCudaGraph) {
+				throw;
+			}
+			// e.g. a node that can't be captured (host sync, CPU fallback)
+			obs_log(LOG_WARNING, "CUDA graph inference failed: %s", e.what());
+			tf->cudaGraphFailed = true;
+			return false;
+		}
+		// FP16 model: output 0 is consumed as floats
+		if (!tf->halfOutput.empty() &&
+		    !convertHalfToFloat(tf->halfOutput.data(), tf->outputDeviceBuffers[0].as<float>(),
+					tf->outputTensorValues[0].size(), tf->cudaPreprocessor.stream())) {
+			return false;
+		}
+	} else {
 		tf->model->runNetworkInference(tf->session, tf->inputNames, tf->outputNames, tf->inputTensor,
 					       tf->outputTensor);
 	}
+	return true;
+}
 
-	// Get output
-	cv::Mat outputImage = tf->model->getNetworkOutput(tf->outputDims, tf->outputTensorValues);
+template<typename Frame> static bool preprocessAndRun(filter_data *tf, const Frame &imageBGRA)
+{
+	if (tf->session.get() == nullptr) {
+		return false;
+	}
+	if (tf->model.get() == nullptr) {
+		return false;
+	}
+	if (!preprocessInput(tf, imageBGRA)) {
+		return false;
+	}
+	return runSession(tf);
+}
+
+// Feed recurrent outputs back as the next frame's inputs
+static void handOverRecurrentState(filter_data *tf)
+{
+	const auto &pairs = tf->model->recurrentStatePairs();
+	if (pairs.empty()) {
+		// Assign output to input in some models that have temporal information
+		tf->model->assignOutputToInput(tf->outputTensorValues, tf->inputTensorValues);
+		return;
+	}
+
+	// Ping-pong: the buffer just written as output becomes the next input.
+	// Each Ort::Value moves together with the buffer it wraps, so no state is copied.
+	for (const auto &[input, output] : pairs) {
+		std::swap(tf->inputTensor[input], tf->outputTensor[output]);
+		if (tf->ioBinding) {
+			std::swap(tf->inputDeviceBuffers[input], tf->outputDeviceBuffers[output]);
+			tf->ioBinding->BindInput(tf->inputNames[input].get(), tf->inputTensor[input]);
+			tf->ioBinding->BindOutput(tf->outputNames[output].get(), tf->outputTensor[output]);
+		} else {
+			std::swap(tf->inputTensorValues[input], tf->outputTensorValues[output]);
+		}
+	}
+	tf->recurrentParity ^= 1;
+}
+
+static bool postprocessNetworkOutput(filter_data *tf, cv::Mat &output)
+{
+	StageTimer timer(tf->scheduler, InferenceScheduler::STAGE_POSTPROCESS);
+
+	// IoBinding: only the first output is needed on the host. This is the
+	// frame's single sync point — everything before it was queued on one stream.
+	if (tf->ioBinding) {
+		NVTX_RANGE_COLOR("download_output", NVTX_COLOR_POSTPROCESS);
+		cudaStream_t stream = tf->cudaPreprocessor.stream();
+		cudaMemcpyAsync(tf->outputTensorValues[0].data(), tf->outputDeviceBuffers[0].data(),
+				tf->outputDeviceBuffers[0].size(), cudaMemcpyDeviceToHost, stream);
+		if (cudaStreamSynchronize(stream) != cudaSuccess) {
+			return false;
+		}
+	}
+
+	// Output 0 is never part of the recurrent state, so it survives the hand-over
+	handOverRecurrentState(tf);
 
-	// Assign output to input in some models that have temporal information
-	tf->model->assignOutputToInput(tf->outputTensorValues, tf->inputTensorValues);
+	return networkOutputToMask(tf, tf->outputTensorValues, output);
+}
+
+template<typename Frame>
+static bool runOnDevice(filter_data *tf, const Frame &imageBGRA, DeviceTensorView &output, int channels = 1)
+{
+	if (!tf->ioBinding || !tf->model) {
+		return false;
+	}
+
+	// Header over the host buffer, only to read the output geometry
+	const cv::Mat outputHeader = tf->model->getNetworkOutput(tf->outputDims, tf->outputTensorValues);
+	if (outputHeader.channels() != channels) {
+		return false;
+	}
+
+	if (!preprocessAndRun(tf, imageBGRA)) {
+		return false;
+	}
+
+	output.data = tf->outputDeviceBuffers[0].as<float>();
+	output.width = outputHeader.cols;
+	output.height = outputHeader.rows;
+	output.channels = channels;
+
+	handOverRecurrentState(tf);
+	return true;
+}
+
+bool runBoundModelInference(filter_data *tf)
+{
+	if (!tf->session || !tf->model) {
+		return false;
+	}
+	if (!runSession(tf)) {
+		return false;
+	}
+	handOverRecurrentState(tf);
+	return true;
+}
+
+bool networkOutputToMask(filter_data *tf, std::vector<std::vector<float>> &outputValues, cv::Mat &output)
+{
+	// Get output
+	cv::Mat outputImage = tf->model->getNetworkOutput(tf->outputDims, outputValues);
 
 	// Post-process output
 	{
@@ -224,3 +989,259 @@ bool runFilterModelInference(filter_data *tf, const cv::Mat &imageBGRA, cv::Mat
 
 	return true;
 }
+
+// Tiled inference: tiles overlap by this fraction of their size, and a frame
+// is split into at most kMaxTilesPerAxis tiles per axis (tiles grow beyond the
+// model input size when more would be needed, e.g. 8K)
+static constexpr double kTileOverlap = 0.125;
+static constexpr int kMaxTilesPerAxis = 3;
+
+static cv::Size frameSizeOf(const cv::Mat &imageBGRA)
+{
+	return imageBGRA.size();
+}
+
+static cv::Size frameSizeOf(const DeviceFrame &frameBGRA)
+{
+	return cv::Size(frameBGRA.width, frameBGRA.height);
+}
+
+static cv::Mat tileView(const cv::Mat &imageBGRA, const cv::Rect &tile)
+{
+	return imageBGRA(tile);
+}
+
+static DeviceFrame tileView(const DeviceFrame &frameBGRA, const cv::Rect &tile)
+{
+	return cropDeviceFrame(frameBGRA, tile.x, tile.y, tile.width, tile.height);
+}
+
+// Tile positions along one axis: as few tiles of the native (model input) size
+// as cover the length with the overlap, spread evenly from edge to edge
+static std::vector<std::pair<int, int>> tileAxis(int length, int native)
+{
+	const double tiles = std::ceil(((double)length / native - kTileOverlap) / (1.0 - kTileOverlap));
+	const int count = std::clamp((int)tiles, 1, kMaxTilesPerAxis);
+	const int size = std::min(length, (int)std::ceil(length / (count - (count - 1) * kTileOverlap)));
+
+	std::vector<std::pair<int, int>> axis;
+	for (int i = 0; i < count; i++) {
+		const int offset = count == 1 ? 0 : (int)std::lround((double)i * (length - size) / (count - 1));
+		axis.emplace_back(offset, size);
+	}
+	return axis;
+}
+
+static std::vector<cv::Rect> tileGrid(const cv::Size &frameSize, uint32_t inputWidth, uint32_t inputHeight)
+{
+	std::vector<cv::Rect> tiles;
+	for (const auto &[y, height] : tileAxis(frameSize.height, (int)inputHeight)) {
+		for (const auto &[x, width] : tileAxis(frameSize.width, (int)inputWidth)) {
+			tiles.emplace_back(x, y, width, height);
+		}
+	}
+	return tiles;
+}
+
+// All tiles in one Run: each tile is preprocessed into its slice of a [N, ...]
+// device input, and the outputs are downloaded one tile at a time
+template<typename Frame>
+static bool runTilesBatched(filter_data *tf, const Frame &imageBGRA, const std::vector<cv::Rect> &tiles,
+			    std::vector<cv::Mat> &tileOutputs)
+{
+	const size_t n = tiles.size();
+	const size_t inputCount = tf->inputTensorValues[0].size();
+	const size_t outputCount = tf->outputTensorValues[0].size();
+	if ((tf->tileInputBuffer.size() < n * inputCount * sizeof(float) &&
+	     !tf->tileInputBuffer.allocate(n * inputCount * sizeof(float))) ||
+	    (tf->tileOutputBuffer.size() < n * outputCount * sizeof(float) &&
+	     !tf->tileOutputBuffer.allocate(n * outputCount * sizeof(float)))) {
+		obs_log(LOG_WARNING, "Unable to allocate tile tensors for %d tiles", (int)n);
+		return false;
+	}
+
+	for (size_t i = 0; i < n; i++) {
+		float *target = tf->tileInputBuffer.as<float>() + i * inputCount;
+		if (!preprocessInput(tf, tileView(imageBGRA, tiles[i]), target, true)) {
+			return false;
+		}
+	}
+
+	cudaStream_t stream = tf->cudaPreprocessor.stream();
+	if (tf->sharedEngine) {
+		// The shared session runs on ORT's stream: the input must be complete first
+		cudaStreamSynchronize(stream);
+	}
+
+	std::vector<int64_t> inputDims = tf->inputDims[0];
+	std::vector<int64_t> outputDims = tf->outputDims[0];
+	inputDims[0] = (int64_t)n;
+	outputDims[0] = (int64_t)n;
+
+	{
+		NVTX_RANGE_COLOR("tiled_inference", NVTX_COLOR_INFERENCE);
+		Ort::MemoryInfo cudaMemoryInfo("Cuda", OrtAllocatorType::OrtDeviceAllocator, tf->deviceId,
+					       OrtMemType::OrtMemTypeDefault);
+		Ort::Value input = Ort::Value::CreateTensor<float>(cudaMemoryInfo, tf->tileInputBuffer.as<float>(),
+								   n * inputCount, inputDims.data(), inputDims.size());
+		Ort::Value output = Ort::Value::CreateTensor<float>(cudaMemoryInfo, tf->tileOutputBuffer.as<float>(),
+								    n * outputCount, outputDims.data(),
+								    outputDims.size());
+		const char *inputName = tf->inputNames[0].get();
+		const char *outputName = tf->outputNames[0].get();
+		tf->session->Run(Ort::RunOptions{nullptr}, &inputName, &input, 1, &outputName, &output, 1);
+	}
+
+	tileOutputs.resize(n);
+	for (size_t i = 0; i < n; i++) {
+		NVTX_RANGE_COLOR("download_output", NVTX_COLOR_POSTPROCESS);
+		cudaMemcpyAsync(tf->outputTensorValues[0].data(), tf->tileOutputBuffer.as<float>() + i * outputCount,
+				outputCount * sizeof(float), cudaMemcpyDeviceToHost, stream);
+		if (cudaStreamSynchronize(stream) != cudaSuccess ||
+		    !networkOutputToMask(tf, tf->outputTensorValues, tileOutputs[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Stitch the tile outputs into one mask. Neighbouring tiles are cross-faded
+// over their overlap with linear weights, so no seam is visible. The stitched
+// mask keeps the model's output resolution per source pixel (at most the frame size).
+static void blendTiles(const cv::Size &frameSize, const std::vector<cv::Rect> &tiles,
+		       const std::vector<cv::Mat> &tileOutputs, cv::Mat &output)
+{
+	const double scale = std::min(1.0, (double)tileOutputs[0].cols / tiles[0].width);
+	const cv::Size size((int)std::lround(frameSize.width * scale), (int)std::lround(frameSize.height * scale));
+	auto scaled = [scale](int v) { return (int)std::lround(v * scale); };
+
+	std::vector<cv::Rect> rects;
+	for (const cv::Rect &tile : tiles) {
+		cv::Rect rect(scaled(tile.x), scaled(tile.y), 0, 0);
+		rect.width = std::min(size.width, scaled(tile.x + tile.width)) - rect.x;
+		rect.height = std::min(size.height, scaled(tile.y + tile.height)) - rect.y;
+		rects.push_back(rect);
+	}
+
+	// 1 inside the tile, ramping down towards each edge another tile overlaps
+	auto ramp = [](int length, int before, int after) {
+		cv::Mat weights(1, length, CV_32F);
+		for (int i = 0; i < length; i++) {
+			float w = 1.0f;
+			if (before > 0) {
+				w = std::min(w, (i + 0.5f) / before);
+			}
+			if (after > 0) {
+				w = std::min(w, (length - i - 0.5f) / after);
+			}
+			weights.at<float>(i) = w;
+		}
+		return weights;
+	};
+
+	cv::Mat sum(size, CV_32F, cv::Scalar(0));
+	cv::Mat weightSum(size, CV_32F, cv::Scalar(0));
+	for (size_t i = 0; i < rects.size(); i++) {
+		const cv::Rect &r = rects[i];
+		int left = 0, right = 0, top = 0, bottom = 0;
+		for (const cv::Rect &other : rects) {
+			if (other == r) {
+				continue;
+			}
+			if (other.y == r.y) {
+				if (other.x < r.x && other.br().x > r.x) {
+					left = std::max(left, other.br().x - r.x);
+				} else if (other.x > r.x && other.x < r.br().x) {
+					right = std::max(right, r.br().x - other.x);
+				}
+			}
+			if (other.x == r.x) {
+				if (other.y < r.y && other.br().y > r.y) {
+					top = std::max(top, other.br().y - r.y);
+				} else if (other.y > r.y && other.y < r.br().y) {
+					bottom = std::max(bottom, r.br().y - other.y);
+				}
+			}
+		}
+		const cv::Mat weights = ramp(r.height, top, bottom).t() * ramp(r.width, left, right);
+
+		cv::Mat tile;
+		cv::resize(tileOutputs[i], tile, r.size(), 0, 0, cv::INTER_LINEAR);
+		tile.convertTo(tile, CV_32F);
+		cv::Mat sumRegion = sum(r);
+		cv::Mat weightRegion = weightSum(r);
+		sumRegion += tile.mul(weights);
+		weightRegion += weights;
+	}
+
+	cv::Mat blended = sum / weightSum;
+	blended.convertTo(output, CV_8U);
+}
+
+template<typename Frame>
+static bool runTiledInference(filter_data *tf, const Frame &imageBGRA, const std::vector<cv::Rect> &tiles,
+			      cv::Mat &output)
+{
+	std::vector<cv::Mat> tileOutputs;
+	if (tf->ioBinding && tf->dynamicBatch && !tf->halfInput) {
+		if (!runTilesBatched(tf, imageBGRA, tiles, tileOutputs)) {
+			return false;
+		}
+	} else {
+		// Fixed batch size: one Run per tile through the regular path
+		tileOutputs.resize(tiles.size());
+		for (size_t i = 0; i < tiles.size(); i++) {
+			if (!preprocessAndRun(tf, tileView(imageBGRA, tiles[i])) ||
+			    !postprocessNetworkOutput(tf, tileOutputs[i])) {
+				return false;
+			}
+		}
+	}
+
+	NVTX_RANGE_COLOR("blend_tiles", NVTX_COLOR_POSTPROCESS);
+	blendTiles(frameSizeOf(imageBGRA), tiles, tileOutputs, output);
+	return true;
+}
+
+template<typename Frame> static bool runModelInference(filter_data *tf, const Frame &imageBGRA, cv::Mat &output)
+{
+	if (tf->useTiledInference && tf->session && tf->model && tf->model->supportsTiling()) {
+		uint32_t inputWidth, inputHeight;
+		tf->model->getNetworkInputSize(tf->inputDims, inputWidth, inputHeight);
+		const std::vector<cv::Rect> tiles = tileGrid(frameSizeOf(imageBGRA), inputWidth, inputHeight);
+		if (tiles.size() > 1) {
+			return runTiledInference(tf, imageBGRA, tiles, output);
+		}
+	}
+	return preprocessAndRun(tf, imageBGRA) && postprocessNetworkOutput(tf, output);
+}
+
+bool runFilterModelInference(filter_data *tf, const cv::Mat &imageBGRA, cv::Mat &output)
+{
+	return runModelInference(tf, imageBGRA, output);
+}
+
+bool runFilterModelInference(filter_data *tf, const DeviceFrame &frameBGRA, cv::Mat &output)
+{
+	return runModelInference(tf, frameBGRA, output);
+}
+
+bool runFilterModelInferenceOnDevice(filter_data *tf, const cv::Mat &imageBGRA, DeviceTensorView &output)
+{
+	return runOnDevice(tf, imageBGRA, output);
+}
+
+bool runFilterModelInferenceOnDevice(filter_data *tf, const DeviceFrame &frameBGRA, DeviceTensorView &output)
+{
+	return runOnDevice(tf, frameBGRA, output);
+}
+
+bool runImageModelInferenceOnDevice(filter_data *tf, const cv::Mat &imageBGRA, DeviceTensorView &output)
+{
+	return runOnDevice(tf, imageBGRA, output, 3);
+}
+
+bool runImageModelInferenceOnDevice(filter_data *tf, const DeviceFrame &frameBGRA, DeviceTensorView &output)
+{
+	return runOnDevice(tf, frameBGRA, output, 3);
+}
@@ -1,6 +1,9 @@
 #ifndef ORT_SESSION_UTILS_H
 #define ORT_SESSION_UTILS_H
 
+#include <memory>
+#include <string>
+
 #include <opencv2/core/types.hpp>
 
 #include "FilterData.h"
@@ -11,8 +14,88 @@
 #define OBS_BGREMOVAL_ORT_SESSION_ERROR_STARTUP 5
 #define OBS_BGREMOVAL_ORT_SESSION_SUCCESS 0
 
+// Float tensor left in device memory by the IoBinding path (interleaved or
+// planar channels, as the model writes them).
+struct DeviceTensorView {
+	const float *data = nullptr;
+	int width = 0;
+	int height = 0;
+	int channels = 1;
+};
+
 int createOrtSession(filter_data *tf);
 
+// A session built for a filter's settings but not set up for it yet: the
+// shared engine, or a private session running on the filter's stream.
+struct PreparedSession {
+	std::shared_ptr<Ort::Session> session;
+	std::shared_ptr<SharedEngine> sharedEngine;
+};
+
+// The expensive half of createOrtSession (model load, TensorRT engine build),
+// for building on another thread while the filter keeps its current session.
+// tf carries the settings and the model; private sessions run on stream.
+int prepareOrtSession(filter_data *tf, PreparedSession &prepared, CUstream_st *stream);
+
+// The cheap half: take over prepared (built for tf's settings and model) and
+// allocate tf's tensors. Returns OBS_BGREMOVAL_ORT_SESSION_SUCCESS.
+int createOrtSession(filter_data *tf, PreparedSession &prepared);
+
+// Suspend tf's session: park it in the SuspendedSessionCache and release the
+// tensors, device buffers and IoBinding. Returns whether tf had a session.
+// Sessions replayed as CUDA graphs are released too, since their captured graphs
+// hold the addresses of the buffers released here.
+bool suspendOrtSession(filter_data *tf);
+
+// Set the parked session up for tf again (createOrtSession). Returns
+// OBS_BGREMOVAL_ORT_SESSION_ERROR_STARTUP if the cache released it meanwhile,
+// in which case the session has to be rebuilt.
+int resumeOrtSession(filter_data *tf);
+
+// Key of the shared session createOrtSession would use for tf (empty when the
+// session would be private: graph mode, sharing off, or an unknown model file)
+std::string sharedSessionKey(filter_data *tf);
+
+// User cache directory of the plugin (created on demand)
+std::string getPluginCachePath();
+
+// Precision tf's session is built with: tf->precision, PRECISION_AUTO being the
+// GPU's default. INT8 falls back to FP16 without TensorRT or a calibration table.
+PrecisionMode sessionPrecision(const filter_data *tf);
+
+// TensorRT calibration cache (native format) an INT8 build of a model reads:
+// calibration/<model>.cache in the plugin cache directory
+std::string int8CalibrationTablePath(const std::string &modelSelection);
+
+// (Re)create tf->ioBinding for the current session from the device tensors
+// allocated by createOrtSession (e.g. after the session was rebuilt).
+bool bindDeviceTensors(filter_data *tf);
+
 bool runFilterModelInference(filter_data *tf, const cv::Mat &imageBGRA, cv::Mat &output);
 
+// Zero-copy variant: the input frame is already resident in device memory.
+bool runFilterModelInference(filter_data *tf, const DeviceFrame &frameBGRA, cv::Mat &output);
+
+// IoBinding only: run inference for a single-channel model (e.g. the RVM alpha
+// matte) and leave output 0 in device memory instead of downloading it. The raw
+// [0,1] output is valid until the next inference and ordered on
+// tf->cudaPreprocessor.stream() (not synchronized); postprocessOutput() is skipped.
+bool runFilterModelInferenceOnDevice(filter_data *tf, const cv::Mat &imageBGRA, DeviceTensorView &output);
+bool runFilterModelInferenceOnDevice(filter_data *tf, const DeviceFrame &frameBGRA, DeviceTensorView &output);
+
+// IoBinding only: the same for an image-to-image model (the enhance models):
+// output 0 is a 3-channel float image laid out as getImagePostprocessParams() says.
+bool runImageModelInferenceOnDevice(filter_data *tf, const cv::Mat &imageBGRA, DeviceTensorView &output);
+bool runImageModelInferenceOnDevice(filter_data *tf, const DeviceFrame &frameBGRA, DeviceTensorView &output);
+
+// Pipelined inference (see InferencePipeline): run the session on whatever is
+// already in input 0 (the bound device buffer in IoBinding mode, the host tensor
+// otherwise) and hand over the recurrent state. IoBinding runs are queued on
+// tf->cudaPreprocessor.stream() and not synchronized.
+bool runBoundModelInference(filter_data *tf);
+
+// Turn a host copy of the network outputs (only output 0 is read) into the
+// CV_8U [0,255] model output returned by runFilterModelInference.
+bool networkOutputToMask(filter_data *tf, std::vector<std::vector<float>> &outputValues, cv::Mat &output);
+
 #endif /* ORT_SESSION_UTILS_H */
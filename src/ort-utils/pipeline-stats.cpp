@@ -0,0 +1,151 @@
+#include "pipeline-stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+
+#include <obs-module.h>
+
+#include "plugin-support.h"
+
+// Seconds between two stats log entries (and the length of a window)
+static constexpr int kLogIntervalSeconds = 60;
+
+// Buckets per octave of latency
+static constexpr double kBucketsPerOctave = 4.0;
+
+static int64_t steadyNowNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		       std::chrono::steady_clock::now().time_since_epoch())
+		.count();
+}
+
+const char *PipelineStats::stageName(Stage stage)
+{
+	switch (stage) {
+	case STAGE_READBACK:
+		return "Readback";
+	case STAGE_PREPROCESS:
+		return "Preprocess";
+	case STAGE_INFERENCE:
+		return "Inference";
+	case STAGE_POSTPROCESS:
+		return "Postprocess";
+	case STAGE_MASK:
+		return "Mask";
+	case STAGE_UPLOAD:
+		return "Texture upload";
+	case STAGE_BLUR:
+		return "Blur";
+	case STAGE_MASK_AGE:
+		return "Mask age";
+	default:
+		return "?";
+	}
+}
+
+void PipelineStats::record(Stage stage, double ms)
+{
+	const double us = std::max(ms * 1000.0, 0.0);
+	const int bucket = us < 1.0 ? 0 : std::min(kBuckets - 1, (int)(std::log2(us) * kBucketsPerOctave));
+	const uint64_t sampleUs = (uint64_t)us;
+
+	Histogram &histogram = stages_[stage];
+	histogram.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+	histogram.count.fetch_add(1, std::memory_order_relaxed);
+	histogram.totalUs.fetch_add(sampleUs, std::memory_order_relaxed);
+	uint64_t previousMax = histogram.maxUs.load(std::memory_order_relaxed);
+	while (sampleUs > previousMax &&
+	       !histogram.maxUs.compare_exchange_weak(previousMax, sampleUs, std::memory_order_relaxed)) {
+	}
+}
+
+void PipelineStats::reset()
+{
+	for (Histogram &histogram : stages_) {
+		for (auto &bucket : histogram.buckets) {
+			bucket.store(0, std::memory_order_relaxed);
+		}
+		histogram.count.store(0, std::memory_order_relaxed);
+		histogram.totalUs.store(0, std::memory_order_relaxed);
+		histogram.maxUs.store(0, std::memory_order_relaxed);
+	}
+	frames_.store(0, std::memory_order_relaxed);
+	dropped_.store(0, std::memory_order_relaxed);
+	windowStart_.store(steadyNowNs(), std::memory_order_relaxed);
+}
+
+double PipelineStats::percentileMs(const uint64_t *buckets, uint64_t count, double q)
+{
+	const uint64_t rank = std::max<uint64_t>(1, (uint64_t)std::ceil(q * (double)count));
+	uint64_t seen = 0;
+	for (int i = 0; i < kBuckets; i++) {
+		seen += buckets[i];
+		if (seen >= rank) {
+			return std::exp2((i + 1) / kBucketsPerOctave) / 1000.0;
+		}
+	}
+	return std::exp2(kBuckets / kBucketsPerOctave) / 1000.0;
+}
+
+PipelineStats::StageSummary PipelineStats::stageSummary(Stage stage) const
+{
+	const Histogram &histogram = stages_[stage];
+	uint64_t buckets[kBuckets];
+	StageSummary result;
+	for (int i = 0; i < kBuckets; i++) {
+		buckets[i] = histogram.buckets[i].load(std::memory_order_relaxed);
+		result.count += buckets[i];
+	}
+	if (result.count == 0) {
+		return result;
+	}
+	const uint64_t samples = std::max<uint64_t>(1, histogram.count.load(std::memory_order_relaxed));
+	result.meanMs = (double)histogram.totalUs.load(std::memory_order_relaxed) / 1000.0 / samples;
+	result.maxMs = (double)histogram.maxUs.load(std::memory_order_relaxed) / 1000.0;
+	// Bucket bounds overshoot the largest sample in the top bucket
+	result.p50Ms = std::min(percentileMs(buckets, result.count, 0.5), result.maxMs);
+	result.p99Ms = std::min(percentileMs(buckets, result.count, 0.99), result.maxMs);
+	return result;
+}
+
+std::string PipelineStats::summary() const
+{
+	const double seconds = (double)(steadyNowNs() - windowStart_.load(std::memory_order_relaxed)) / 1e9;
+	const uint64_t frames = frames_.load(std::memory_order_relaxed);
+	const uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+
+	std::ostringstream out;
+	char line[160];
+	snprintf(line, sizeof(line), "Last %.0f s: %.1f inferred fps, %llu dropped", seconds,
+		 seconds > 0.0 ? (double)frames / seconds : 0.0, (unsigned long long)dropped);
+	out << line;
+
+	for (int stage = 0; stage < STAGE_COUNT; stage++) {
+		const StageSummary latency = stageSummary((Stage)stage);
+		if (latency.count == 0) {
+			continue;
+		}
+		snprintf(line, sizeof(line), "\n%s: mean %.2f ms, p50 %.2f ms, p99 %.2f ms, max %.2f ms (%llu)",
+			 stageName((Stage)stage), latency.meanMs, latency.p50Ms, latency.p99Ms, latency.maxMs,
+			 (unsigned long long)latency.count);
+		out << line;
+	}
+	return out.str();
+}
+
+void PipelineStats::logIfDue(const char *name)
+{
+	const int64_t elapsed = steadyNowNs() - windowStart_.load(std::memory_order_relaxed);
+	if (elapsed < (int64_t)kLogIntervalSeconds * 1000000000) {
+		return;
+	}
+	std::istringstream lines(summary());
+	std::string line;
+	while (std::getline(lines, line)) {
+		obs_log(LOG_INFO, "[%s] %s", name, line.c_str());
+	}
+	reset();
+}
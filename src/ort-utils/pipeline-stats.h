@@ -0,0 +1,83 @@
+#ifndef PIPELINE_STATS_H
+#define PIPELINE_STATS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Always-on pipeline telemetry: a lock-free latency histogram per stage plus
+// inferred and dropped frame counters.
+//
+// Stages record from the render, tick, worker and pipeline threads at once;
+// each sample is a few relaxed atomic increments. Histogram buckets are a
+// quarter octave wide (1 us to ~1 s), so percentiles are within 19 %.
+// Render-side stages (readback, texture upload, blur) measure the time spent
+// issuing the work on the graphics thread, not the GPU time behind it.
+//
+// The counters cover a window that video_tick restarts after logging a summary
+// (logIfDue), so both the log and the properties show recent behaviour.
+class PipelineStats {
+public:
+	enum Stage {
+		STAGE_READBACK = 0, // source render + stage surface map or CUDA-GL copy
+		STAGE_PREPROCESS,   // upload + preprocessing kernel
+		STAGE_INFERENCE,    // ORT Run
+		STAGE_POSTPROCESS,  // output download + conversion to a mask
+		STAGE_MASK,         // mask refinement (CPU or GPU)
+		STAGE_UPLOAD,       // mask / output texture update
+		STAGE_BLUR,         // background blur passes
+		STAGE_MASK_AGE,     // capture of the inferred frame → its mask taken by video_tick, in ms
+		STAGE_COUNT,
+	};
+
+	PipelineStats() { reset(); }
+
+	// Thread-safe
+	void record(Stage stage, double ms);
+	void countFrame() { frames_.fetch_add(1, std::memory_order_relaxed); }
+	void countDropped(uint64_t frames) { dropped_.fetch_add(frames, std::memory_order_relaxed); }
+
+	struct StageSummary {
+		uint64_t count = 0;
+		double meanMs = 0.0;
+		double p50Ms = 0.0;
+		double p99Ms = 0.0;
+		double maxMs = 0.0;
+	};
+
+	// Latency distribution of a stage in the current window
+	StageSummary stageSummary(Stage stage) const;
+
+	// Human-readable summary of the current window (one line per measured stage)
+	std::string summary() const;
+
+	// Start a new window
+	void reset();
+
+	// video_tick only: log the summary under the filter name and start a new
+	// window once the log interval has passed
+	void logIfDue(const char *name);
+
+	static const char *stageName(Stage stage);
+
+private:
+	static constexpr int kBuckets = 80;
+
+	struct Histogram {
+		std::atomic<uint64_t> buckets[kBuckets];
+		std::atomic<uint64_t> count;
+		std::atomic<uint64_t> totalUs;
+		std::atomic<uint64_t> maxUs;
+	};
+
+	// Upper bound of the samples up to the fraction q of the histogram, in ms
+	static double percentileMs(const uint64_t *buckets, uint64_t count, double q);
+
+	Histogram stages_[STAGE_COUNT];
+	std::atomic<uint64_t> frames_;
+	std::atomic<uint64_t> dropped_;
+	std::atomic<int64_t> windowStart_; // steady clock, ns
+};
+
+#endif /* PIPELINE_STATS_H */
@@ -1,6 +1,8 @@
 #ifndef PROFILER_H
 #define PROFILER_H
 
+#include "trace-recorder.h"
+
 #ifdef ENABLE_NVTX_PROFILING
 #include <nvtx3/nvToolsExt.h>
 
@@ -34,29 +36,36 @@ public:
 	NvtxColorRange &operator=(const NvtxColorRange &) = delete;
 };
 
-#define NVTX_RANGE(name) NvtxRange _nvtx_##__LINE__(name)
-#define NVTX_RANGE_COLOR(name, color) NvtxColorRange _nvtx_c_##__LINE__(name, color)
+#endif // ENABLE_NVTX_PROFILING
 
-// Predefined colors for pipeline stages
-#define NVTX_COLOR_TICK 0xFF00FF00     // Green: video_tick
-#define NVTX_COLOR_RENDER 0xFF0000FF   // Blue: video_render
+// Predefined colors for pipeline stages (the trace categories without NVTX)
+#define NVTX_COLOR_TICK 0xFF00FF00        // Green: video_tick
+#define NVTX_COLOR_RENDER 0xFF0000FF      // Blue: video_render
 #define NVTX_COLOR_PREPROCESS 0xFFFF8000  // Orange: preprocessing
 #define NVTX_COLOR_INFERENCE 0xFFFF0000   // Red: inference
 #define NVTX_COLOR_POSTPROCESS 0xFFFF00FF // Magenta: postprocessing
-#define NVTX_COLOR_MEMCOPY 0xFFFFFF00    // Yellow: memory copies
-
-#else
+#define NVTX_COLOR_MEMCOPY 0xFFFFFF00     // Yellow: memory copies
 
-// No-op when profiling is disabled
-#define NVTX_RANGE(name)
-#define NVTX_RANGE_COLOR(name, color)
-#define NVTX_COLOR_TICK 0
-#define NVTX_COLOR_RENDER 0
-#define NVTX_COLOR_PREPROCESS 0
-#define NVTX_COLOR_INFERENCE 0
-#define NVTX_COLOR_POSTPROCESS 0
-#define NVTX_COLOR_MEMCOPY 0
+#define PROFILER_CONCAT_(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_(a, b)
 
-#endif // ENABLE_NVTX_PROFILING
+// Ranges are NVTX ranges in ENABLE_NVTX_PROFILING builds, and recorded by the
+// built-in TraceRecorder in all builds while trace recording is on.
+// TRACE_GPU_RANGE also times the work the scope queues on stream.
+#ifdef ENABLE_NVTX_PROFILING
+#define NVTX_RANGE(name)                                 \
+	NvtxRange PROFILER_CONCAT(_nvtx_, __LINE__)(name); \
+	TraceScope PROFILER_CONCAT(_trace_, __LINE__)(name, 0)
+#define NVTX_RANGE_COLOR(name, color)                                 \
+	NvtxColorRange PROFILER_CONCAT(_nvtx_c_, __LINE__)(name, color); \
+	TraceScope PROFILER_CONCAT(_trace_, __LINE__)(name, color)
+#define TRACE_GPU_RANGE(name, color, stream)                          \
+	NvtxColorRange PROFILER_CONCAT(_nvtx_c_, __LINE__)(name, color); \
+	TraceGpuScope PROFILER_CONCAT(_trace_, __LINE__)(name, color, stream)
+#else
+#define NVTX_RANGE(name) TraceScope PROFILER_CONCAT(_trace_, __LINE__)(name, 0)
+#define NVTX_RANGE_COLOR(name, color) TraceScope PROFILER_CONCAT(_trace_, __LINE__)(name, color)
+#define TRACE_GPU_RANGE(name, color, stream) TraceGpuScope PROFILER_CONCAT(_trace_, __LINE__)(name, color, stream)
+#endif
 
 #endif /* PROFILER_H */
@@ -0,0 +1,39 @@
+#include "scratch-arena.h"
+
+#include <cassert>
+
+void ScratchArena::adopt(Buffer &buffer)
+{
+	if (buffer.view.datastart && buffer.view.datastart != buffer.storage.datastart) {
+		buffer.storage = buffer.view;
+		allocations_.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+cv::Mat &ScratchArena::get(int index, cv::Size size, int type)
+{
+	assert(index >= 0 && index < kMaxBuffers);
+	Buffer &buffer = buffers_[index];
+	adopt(buffer);
+	if (buffer.view.size() == size && buffer.view.type() == type && buffer.view.isContinuous()) {
+		return buffer.view;
+	}
+
+	const size_t bytes = (size_t)size.area() * CV_ELEM_SIZE(type);
+	const size_t capacity = (size_t)(buffer.storage.dataend - buffer.storage.datastart);
+	if (bytes > capacity) {
+		buffer.view.release();
+		buffer.storage.create(1, (int)bytes, CV_8UC1);
+		allocations_.fetch_add(1, std::memory_order_relaxed);
+	}
+	buffer.view = cv::Mat(size, type, buffer.storage.data);
+	return buffer.view;
+}
+
+cv::Mat &ScratchArena::get(int index)
+{
+	assert(index >= 0 && index < kMaxBuffers);
+	Buffer &buffer = buffers_[index];
+	adopt(buffer);
+	return buffer.view;
+}
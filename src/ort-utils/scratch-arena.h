@@ -0,0 +1,49 @@
+#ifndef SCRATCH_ARENA_H
+#define SCRATCH_ARENA_H
+
+#include <atomic>
+#include <cstdint>
+
+#include <opencv2/core.hpp>
+
+// Named, size-stable host buffers of a filter's per-frame pipeline. Every
+// buffer is a persistent cv::Mat header over storage that only grows, so once
+// the frame and model sizes have been seen, writing the pipeline's temporaries
+// into the arena allocates nothing.
+//
+// Buffers are indexed by an enum of the owner. A buffer belongs to one thread
+// (or one lock); only the allocation counter is shared.
+class ScratchArena {
+public:
+	static constexpr int kMaxBuffers = 16;
+
+	ScratchArena() = default;
+
+	ScratchArena(const ScratchArena &) = delete;
+	ScratchArena &operator=(const ScratchArena &) = delete;
+
+	// The buffer shaped size x type, reallocated only if its storage is too small
+	cv::Mat &get(int buffer, cv::Size size, int type);
+
+	// The buffer as last shaped, as the output of an OpenCV call that sizes it
+	// itself. Reallocated by that call when the shape differs; the new memory
+	// becomes the buffer's storage on the next access.
+	cv::Mat &get(int buffer);
+
+	// Storage allocations since construction (debug counter: constant after warmup)
+	uint64_t allocations() const { return allocations_.load(std::memory_order_relaxed); }
+
+private:
+	struct Buffer {
+		cv::Mat storage; // owns the memory
+		cv::Mat view;    // header over storage with the current shape
+	};
+
+	// Take over memory an OpenCV call allocated into the view
+	void adopt(Buffer &buffer);
+
+	Buffer buffers_[kMaxBuffers];
+	std::atomic<uint64_t> allocations_{0};
+};
+
+#endif /* SCRATCH_ARENA_H */
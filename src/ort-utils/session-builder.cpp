@@ -0,0 +1,422 @@
+#include "session-builder.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <vector>
+
+#include <obs-module.h>
+
+#include "FilterData.h"
+#include "gpu-info.h"
+#include "models/ModelFactory.h"
+#include "ort-session-utils.h"
+#include "plugin-support.h"
+#include "session-cache.h"
+#include "vram-budget.h"
+
+struct SessionBuilder::Build {
+	filter_data filter; // settings and model of the build (never runs)
+	CUstream_st *stream = nullptr;
+	int sourceWidth = 0;
+	int sourceHeight = 0;
+	int result = OBS_BGREMOVAL_ORT_SESSION_ERROR_STARTUP;
+	PreparedSession prepared;
+	std::string budgetDecision; // what the VRAM budget changed, empty if nothing
+};
+
+// VRAM budget: OBS, the encoder and other applications keep this much of the
+// GPU free (MB, at least, or a tenth of the card)
+static constexpr size_t kVramHeadroomMB = 512;
+// TensorRT workspace range the budget sizes into the free memory (MB)
+static constexpr size_t kMinTrtWorkspaceMB = 256;
+static constexpr size_t kMaxTrtWorkspaceMB = 2048;
+// Session memory besides weights and activations (ORT arena slack, EP state)
+static constexpr size_t kSessionOverheadMB = 128;
+
+// Smaller model of the same kind to step down to under memory pressure (empty: none)
+static std::string smallerModel(const std::string &model)
+{
+	if (model == MODEL_RMBG || model == MODEL_RVM) {
+		return MODEL_PPHUMANSEG;
+	}
+	if (model == MODEL_SELFIE_MULTICLASS) {
+		return MODEL_SELFIE;
+	}
+	if (model == MODEL_PPHUMANSEG) {
+		return MODEL_MEDIAPIPE;
+	}
+	return std::string();
+}
+
+// Next lower inference resolution of the same kind (percentage or short edge), 0: none
+static int lowerResolution(int resolution)
+{
+	const bool edge = resolution > INFERENCE_RESOLUTION_SOURCE;
+	int lower = 0;
+	for (int candidate : INFERENCE_RESOLUTIONS) {
+		if ((candidate > INFERENCE_RESOLUTION_SOURCE) == edge && candidate < resolution && candidate > lower) {
+			lower = candidate;
+		}
+	}
+	return lower;
+}
+
+// Key of a session's measured footprint: everything that changes its size
+static std::string footprintKey(const filter_data &filter)
+{
+	const cv::Size input = filter.model->dynamicInputSize();
+	return filter.modelSelection + "|" + filter.useGPU + "|" + precisionModeName(sessionPrecision(&filter)) + "|" +
+	       std::to_string(input.width) + "x" + std::to_string(input.height);
+}
+
+// Device memory the session of filter needs (MB): the footprint measured for
+// the same model, provider, precision and input size, else an estimate from
+// the model file (weights) and the input size (activations)
+static size_t estimateSessionMB(const filter_data &filter)
+{
+	const size_t measured = VramBudget::instance().footprintMB(footprintKey(filter));
+	if (measured > 0) {
+		return measured;
+	}
+	const bool half = sessionPrecision(&filter) != PrecisionMode::FP32;
+	size_t modelBytes = 0;
+	if (char *path = obs_module_file(filter.modelSelection.c_str())) {
+		std::error_code error;
+		modelBytes = (size_t)std::filesystem::file_size(path, error);
+		if (error) {
+			modelBytes = 0;
+		}
+		bfree(path);
+	}
+	// Fixed-size models are small; 256x256 stands in for their (not yet known) input
+	const cv::Size input = filter.model->dynamicInputSize();
+	const size_t pixels = input.empty() ? (size_t)256 * 256 : (size_t)input.area();
+	// About 64 float channels of activations live per input pixel
+	const size_t activationBytes = pixels * 64 * sizeof(float);
+	return ((modelBytes + activationBytes) >> (half ? 21 : 20)) + kSessionOverheadMB;
+}
+
+static std::string resolutionName(int resolution)
+{
+	return resolution > INFERENCE_RESOLUTION_SOURCE ? std::to_string(resolution) + "p"
+							: std::to_string(resolution) + "%";
+}
+
+static std::string modelName(const std::string &model)
+{
+	return std::filesystem::path(model).stem().string();
+}
+
+// Step the build down to use less memory, mildest step first: FP16 TensorRT
+// engines, a lower inference resolution, a smaller model. Appends the change
+// and returns false when there is no step left.
+static bool stepDownBuild(filter_data &filter, std::vector<std::string> &changes)
+{
+	// TensorRT builds FP16 engines from the same model
+	if (filter.useGPU == USEGPU_TENSORRT && sessionPrecision(&filter) == PrecisionMode::FP32) {
+		filter.precision = PRECISION_FP16;
+		changes.push_back("FP16 instead of FP32");
+		return true;
+	}
+	const int sourceWidth = filter.model->sourceWidth();
+	const int sourceHeight = filter.model->sourceHeight();
+	const int lower = lowerResolution(filter.inferenceResolution);
+	if (!filter.model->dynamicInputSize().empty() && sourceWidth > 0 && lower > 0) {
+		changes.push_back("inference resolution " + resolutionName(lower) + " instead of " +
+				  resolutionName(filter.inferenceResolution));
+		filter.inferenceResolution = lower;
+		filter.model->setSourceSize(sourceWidth, sourceHeight, lower);
+		return true;
+	}
+	const std::string smaller = smallerModel(filter.modelSelection);
+	if (!smaller.empty()) {
+		changes.push_back(modelName(smaller) + " instead of " + modelName(filter.modelSelection));
+		filter.modelSelection = smaller;
+		filter.model.reset(createModel(smaller));
+		if (sourceWidth > 0 && sourceHeight > 0) {
+			filter.model->setSourceSize(sourceWidth, sourceHeight, filter.inferenceResolution);
+		}
+		return true;
+	}
+	return false;
+}
+
+// Fit the build into the free memory of its device: size the TensorRT
+// workspace into what the session leaves, and step the build down while even
+// the smallest workspace doesn't fit. Returns the decision for the filter
+// properties (empty when the build is as requested).
+static std::string planVramBudget(filter_data &filter)
+{
+	size_t freeMB = 0;
+	size_t totalMB = 0;
+	if (!queryVram(filter.deviceId, freeMB, totalMB)) {
+		return std::string();
+	}
+	totalMB = std::max(totalMB, filter.gpuInfo.totalMemoryMB);
+	const size_t headroomMB = std::max(kVramHeadroomMB, totalMB / 10);
+	size_t availableMB = freeMB > headroomMB ? freeMB - headroomMB : 0;
+	const bool tensorRt = filter.useGPU == USEGPU_TENSORRT;
+	const size_t minWorkspaceMB = tensorRt ? kMinTrtWorkspaceMB : 0;
+
+	std::vector<std::string> changes;
+	size_t needMB = estimateSessionMB(filter);
+	// The sessions parked by suspended filters go before the build steps down
+	int released = 0;
+	while (needMB + minWorkspaceMB > availableMB && SuspendedSessionCache::instance().evictOldest()) {
+		released++;
+		size_t ignoredMB = 0;
+		if (queryVram(filter.deviceId, freeMB, ignoredMB)) {
+			availableMB = freeMB > headroomMB ? freeMB - headroomMB : 0;
+		}
+	}
+	if (released > 0) {
+		changes.push_back(std::to_string(released) + " suspended session(s) released");
+	}
+	while (needMB + minWorkspaceMB > availableMB && stepDownBuild(filter, changes)) {
+		needMB = estimateSessionMB(filter);
+	}
+
+	size_t workspaceMB = kMaxTrtWorkspaceMB;
+	if (tensorRt) {
+		workspaceMB = std::clamp(availableMB > needMB ? availableMB - needMB : 0, kMinTrtWorkspaceMB,
+					 kMaxTrtWorkspaceMB);
+		filter.trtWorkspaceBytes = workspaceMB << 20;
+	}
+	if (changes.empty() && workspaceMB == kMaxTrtWorkspaceMB) {
+		return std::string();
+	}
+
+	std::string decision = std::to_string(freeMB) + " of " + std::to_string(totalMB) + " MB VRAM free";
+	if (needMB + minWorkspaceMB > availableMB) {
+		decision += " (needs about " + std::to_string(needMB) + " MB)";
+	}
+	for (const std::string &change : changes) {
+		decision += "; " + change;
+	}
+	if (workspaceMB != kMaxTrtWorkspaceMB) {
+		decision += "; TensorRT workspace " + std::to_string(workspaceMB) + " MB";
+	}
+	return decision;
+}
+
+SessionSettings SessionSettings::of(const filter_data *tf)
+{
+	SessionSettings settings;
+	settings.modelSelection = tf->modelSelection;
+	settings.useGPU = tf->useGPU;
+	settings.numThreads = tf->numThreads;
+	settings.useIoBinding = tf->useIoBinding;
+	settings.useCudaGraph = tf->useCudaGraph;
+	settings.useSharedEngine = tf->useSharedEngine;
+	settings.precision = tf->precision;
+	settings.inferenceResolution = tf->inferenceResolution;
+	settings.gpuDevice = tf->gpuDevice;
+	settings.deviceId = tf->deviceId;
+	settings.schedulingPriority = tf->schedulingPriority;
+	return settings;
+}
+
+void SessionSettings::resolveDevice(const SessionSettings &previous)
+{
+	if (gpuDevice == GPU_DEVICE_AUTO && previous.gpuDevice == GPU_DEVICE_AUTO) {
+		deviceId = previous.deviceId;
+		return;
+	}
+	deviceId = resolveGpuDevice(gpuDevice);
+}
+
+static void applySettings(filter_data *tf, const SessionSettings &settings)
+{
+	tf->modelSelection = settings.modelSelection;
+	tf->useGPU = settings.useGPU;
+	tf->numThreads = settings.numThreads;
+	tf->useIoBinding = settings.useIoBinding;
+	tf->useCudaGraph = settings.useCudaGraph;
+	tf->useSharedEngine = settings.useSharedEngine;
+	tf->precision = settings.precision;
+	tf->inferenceResolution = settings.inferenceResolution;
+	tf->gpuDevice = settings.gpuDevice;
+	tf->deviceId = settings.deviceId;
+	tf->schedulingPriority = settings.schedulingPriority;
+	tf->cudaPreprocessor.setPriority(settings.schedulingPriority);
+}
+
+SessionBuilder::SessionBuilder() = default;
+
+SessionBuilder::~SessionBuilder()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+		queued_.reset();
+	}
+	condition_.notify_all();
+	// A build in progress can't be interrupted: it runs on the filter's stream
+	if (thread_.joinable()) {
+		thread_.join();
+	}
+}
+
+void SessionBuilder::request(filter_data *tf, const SessionSettings &settings, int sourceWidth, int sourceHeight)
+{
+	auto build = std::make_unique<Build>();
+	build->filter.source = nullptr;
+	build->filter.texrender = nullptr;
+	applySettings(&build->filter, settings);
+	// The engine is built for the target GPU's architecture
+	if (settings.deviceId != tf->gpuInfo.deviceId) {
+		detectGpu(build->filter.gpuInfo, settings.deviceId);
+	} else {
+		build->filter.gpuInfo = tf->gpuInfo;
+	}
+	build->filter.model.reset(createModel(settings.modelSelection));
+	if (build->filter.useCudaGraph && build->filter.model->hasHostInputs()) {
+		obs_log(LOG_INFO, "The %s model keeps inputs on the host, CUDA graph mode is disabled",
+			settings.modelSelection.c_str());
+		build->filter.useCudaGraph = false;
+	}
+	if (sourceWidth > 0 && sourceHeight > 0) {
+		build->filter.model->setSourceSize(sourceWidth, sourceHeight, settings.inferenceResolution);
+	}
+	build->stream = tf->cudaPreprocessor.stream(settings.deviceId, settings.schedulingPriority);
+	build->sourceWidth = sourceWidth;
+	build->sourceHeight = sourceHeight;
+
+	std::unique_ptr<Build> superseded;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		superseded = std::move(finished_);
+		queued_ = std::move(build);
+		failed_ = false;
+		if (!thread_.joinable()) {
+			thread_ = std::thread(&SessionBuilder::run, this);
+		}
+	}
+	condition_.notify_all();
+}
+
+bool SessionBuilder::busy()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return queued_ || building_ || finished_;
+}
+
+bool SessionBuilder::ready()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return finished_ != nullptr;
+}
+
+int SessionBuilder::adopt(filter_data *tf)
+{
+	std::unique_ptr<Build> build;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		build = std::move(finished_);
+	}
+	if (!build) {
+		return OBS_BGREMOVAL_ORT_SESSION_ERROR_STARTUP;
+	}
+	if (build->result != OBS_BGREMOVAL_ORT_SESSION_SUCCESS) {
+		obs_log(LOG_ERROR, "Failed to create the %s session (error %d), keeping the current one",
+			build->filter.modelSelection.c_str(), build->result);
+		std::lock_guard<std::mutex> lock(mutex_);
+		failed_ = true;
+		return build->result;
+	}
+
+	applySettings(tf, SessionSettings::of(&build->filter));
+	tf->gpuInfo = build->filter.gpuInfo;
+	tf->trtWorkspaceBytes = build->filter.trtWorkspaceBytes;
+	tf->modelFilepath = build->filter.modelFilepath;
+	tf->model = std::move(build->filter.model);
+	sourceWidth_ = build->sourceWidth;
+	sourceHeight_ = build->sourceHeight;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		budgetDecision_ = build->budgetDecision;
+	}
+
+	CudaDeviceScope device(tf->deviceId);
+	const int result = createOrtSession(tf, build->prepared);
+	if (result != OBS_BGREMOVAL_ORT_SESSION_SUCCESS) {
+		obs_log(LOG_ERROR, "Failed to set up the %s session (error %d)", tf->modelSelection.c_str(), result);
+		tf->ioBinding.reset();
+		tf->session.reset();
+		tf->sharedEngine.reset();
+		tf->model.reset();
+		std::lock_guard<std::mutex> lock(mutex_);
+		failed_ = true;
+	}
+	return result;
+}
+
+bool SessionBuilder::failed()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return failed_;
+}
+
+std::string SessionBuilder::budgetDecision()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return budgetDecision_;
+}
+
+void SessionBuilder::run()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (true) {
+		condition_.wait(lock, [this] { return stopping_ || queued_; });
+		if (stopping_) {
+			return;
+		}
+		std::unique_ptr<Build> build = std::move(queued_);
+		building_ = true;
+		lock.unlock();
+
+		{
+			filter_data &filter = build->filter;
+			CudaDeviceScope device(filter.deviceId);
+			build->budgetDecision = planVramBudget(filter);
+			if (!build->budgetDecision.empty()) {
+				obs_log(LOG_INFO, "VRAM budget of the %s session: %s", filter.modelSelection.c_str(),
+					build->budgetDecision.c_str());
+			}
+			// Measured for the budget of later builds of the same session
+			auto prepare = [&build, &filter] {
+				const VramBudget::Measurement measurement =
+					VramBudget::instance().beginBuild(filter.deviceId);
+				build->prepared = PreparedSession();
+				build->result = prepareOrtSession(&filter, build->prepared, build->stream);
+				VramBudget::instance().endBuild(measurement, footprintKey(filter),
+								build->result == OBS_BGREMOVAL_ORT_SESSION_SUCCESS);
+			};
+			prepare();
+
+			// A failed build (usually out of memory) steps down before the filter gives up
+			std::vector<std::string> changes;
+			while (build->result == OBS_BGREMOVAL_ORT_SESSION_ERROR_STARTUP &&
+			       stepDownBuild(filter, changes)) {
+				obs_log(LOG_WARNING, "The session build failed, retrying with %s",
+					changes.back().c_str());
+				prepare();
+			}
+			for (const std::string &change : changes) {
+				build->budgetDecision += (build->budgetDecision.empty() ? "" : "; ") + change +
+							 " (after a failed build)";
+			}
+		}
+
+		lock.lock();
+		building_ = false;
+		if (!queued_ && !stopping_) {
+			finished_ = std::move(build);
+			continue;
+		}
+		// Superseded: release the session outside the lock
+		lock.unlock();
+		build.reset();
+		lock.lock();
+	}
+}
@@ -0,0 +1,117 @@
+#ifndef SESSION_BUILDER_H
+#define SESSION_BUILDER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "consts.h"
+#include "gpu-info.h"
+
+struct filter_data;
+
+// The filter settings a session is built for (the fields createOrtSession reads)
+struct SessionSettings {
+	std::string modelSelection;
+	std::string useGPU;
+	uint32_t numThreads = 1;
+	bool useIoBinding = true;
+	bool useCudaGraph = false;
+	bool useSharedEngine = true;
+	std::string precision = PRECISION_AUTO;
+	int inferenceResolution = INFERENCE_RESOLUTION_SOURCE;
+	int gpuDevice = 0; // the gpu_device setting: a CUDA device index or GPU_DEVICE_AUTO
+	int deviceId = 0;  // the CUDA device it resolved to
+	SchedulingPriority schedulingPriority = SchedulingPriority::NORMAL; // of the session's stream
+
+	bool operator==(const SessionSettings &other) const
+	{
+		return modelSelection == other.modelSelection && useGPU == other.useGPU &&
+		       numThreads == other.numThreads && useIoBinding == other.useIoBinding &&
+		       useCudaGraph == other.useCudaGraph && useSharedEngine == other.useSharedEngine &&
+		       precision == other.precision && inferenceResolution == other.inferenceResolution &&
+		       gpuDevice == other.gpuDevice && deviceId == other.deviceId &&
+		       schedulingPriority == other.schedulingPriority;
+	}
+	bool operator!=(const SessionSettings &other) const { return !(*this == other); }
+
+	// Resolve gpuDevice into deviceId. Auto picks the least loaded GPU when it
+	// is selected and then stays there (previous: the settings requested before),
+	// so a load change never moves the filter by itself.
+	void resolveDevice(const SessionSettings &previous);
+
+	// The settings tf's current session was created with
+	static SessionSettings of(const filter_data *tf);
+};
+
+// Builds a filter's next session on a background thread (model or execution
+// provider changes, runtime fallbacks), so neither the UI thread nor
+// video_tick waits for a model load or TensorRT engine build. The filter keeps
+// inferring with its current session and swaps to the new one with adopt()
+// once ready() reports it built; adopt() only allocates the tensors.
+//
+// A newer request supersedes an older one: a build in progress finishes, but
+// its session is dropped.
+class SessionBuilder {
+public:
+	SessionBuilder();
+	~SessionBuilder();
+
+	SessionBuilder(const SessionBuilder &) = delete;
+	SessionBuilder &operator=(const SessionBuilder &) = delete;
+
+	// Build a session for settings with tf's GPU info, the model sized for a
+	// sourceWidth x sourceHeight source (0 = unknown) at the settings' inference
+	// resolution. Private sessions run on
+	// tf's CUDA stream, so tf must outlive the builder.
+	void request(filter_data *tf, const SessionSettings &settings, int sourceWidth, int sourceHeight);
+
+	// A build is queued, running, or finished but not adopted yet
+	bool busy();
+
+	// A build finished (successfully or not) and waits for adopt()
+	bool ready();
+
+	// Swap tf to the finished build: its settings, model and session. The
+	// caller holds tf's model lock and has stopped everything that runs tf's
+	// session off that lock. A failed build leaves tf untouched. Returns
+	// OBS_BGREMOVAL_ORT_SESSION_SUCCESS, or the error of the build.
+	int adopt(filter_data *tf);
+
+	// The last adopted build failed and nothing was requested since: the
+	// settings it was built for aren't in effect, so the filter requests them
+	// again on its next settings update (any thread)
+	bool failed();
+
+	// Source size of the last adopted build
+	int sourceWidth() const { return sourceWidth_; }
+	int sourceHeight() const { return sourceHeight_; }
+
+	// What the VRAM budget changed about the last adopted build (smaller model,
+	// precision, inference resolution, TensorRT workspace), empty if nothing.
+	// For the filter properties (any thread).
+	std::string budgetDecision();
+
+private:
+	struct Build;
+
+	void run();
+
+	std::mutex mutex_;
+	std::condition_variable condition_;
+	std::thread thread_;
+	bool stopping_ = false;
+	bool building_ = false;
+	std::unique_ptr<Build> queued_;
+	std::unique_ptr<Build> finished_;
+	bool failed_ = false;
+
+	int sourceWidth_ = 0;
+	int sourceHeight_ = 0;
+	std::string budgetDecision_;
+};
+
+#endif /* SESSION_BUILDER_H */
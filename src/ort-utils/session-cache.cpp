@@ -0,0 +1,64 @@
+#include "session-cache.h"
+
+#include "plugin-support.h"
+
+SuspendedSessionCache &SuspendedSessionCache::instance()
+{
+	static SuspendedSessionCache cache;
+	return cache;
+}
+
+void SuspendedSessionCache::store(const void *owner, PreparedSession prepared, const std::string &name)
+{
+	// Replaced and evicted sessions are destroyed outside the lock
+	std::list<Entry> released;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+			if (it->owner == owner) {
+				released.splice(released.end(), entries_, it);
+				break;
+			}
+		}
+		entries_.push_back(Entry{owner, std::move(prepared), name});
+		while (entries_.size() > kMaxSessions) {
+			obs_log(LOG_INFO, "Suspended session cache full, releasing the %s session",
+				entries_.front().name.c_str());
+			released.splice(released.end(), entries_, entries_.begin());
+		}
+	}
+}
+
+bool SuspendedSessionCache::take(const void *owner, PreparedSession &prepared)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+		if (it->owner == owner) {
+			prepared = std::move(it->prepared);
+			entries_.erase(it);
+			return true;
+		}
+	}
+	return false;
+}
+
+void SuspendedSessionCache::drop(const void *owner)
+{
+	PreparedSession released;
+	take(owner, released);
+}
+
+bool SuspendedSessionCache::evictOldest()
+{
+	std::list<Entry> released;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (entries_.empty()) {
+			return false;
+		}
+		obs_log(LOG_INFO, "Releasing the suspended %s session for a session build",
+			entries_.front().name.c_str());
+		released.splice(released.end(), entries_, entries_.begin());
+	}
+	return true;
+}
@@ -0,0 +1,49 @@
+#ifndef SESSION_CACHE_H
+#define SESSION_CACHE_H
+
+#include <list>
+#include <mutex>
+#include <string>
+
+#include "ort-session-utils.h"
+
+// Sessions of filters whose source went inactive. A suspended filter releases
+// its tensors, buffers and workers but parks its session here, so activating
+// the source again only reallocates and binds the tensors instead of loading
+// the model and rebuilding the engine.
+//
+// The least recently suspended sessions are released first: when more than
+// kMaxSessions are parked, and when a session build needs their memory.
+class SuspendedSessionCache {
+public:
+	static SuspendedSessionCache &instance();
+
+	static constexpr size_t kMaxSessions = 4;
+
+	// Park owner's session (replacing the one it parked before)
+	void store(const void *owner, PreparedSession prepared, const std::string &name);
+
+	// Take owner's session back. Returns false if it was released meanwhile.
+	bool take(const void *owner, PreparedSession &prepared);
+
+	// Release owner's session, if parked. Called before the owner's stream is
+	// destroyed: a private session runs on it.
+	void drop(const void *owner);
+
+	// Release the least recently parked session. Returns false if none is.
+	bool evictOldest();
+
+private:
+	SuspendedSessionCache() = default;
+
+	struct Entry {
+		const void *owner = nullptr;
+		PreparedSession prepared;
+		std::string name;
+	};
+
+	std::mutex mutex_;
+	std::list<Entry> entries_; // oldest first
+};
+
+#endif /* SESSION_CACHE_H */
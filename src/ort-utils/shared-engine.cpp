@@ -0,0 +1,207 @@
+#include "shared-engine.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+
+#include <cuda_runtime.h>
+
+#include <obs-module.h>
+
+#include "FilterData.h"
+#include "consts.h"
+#include "plugin-support.h"
+#include "profiler.h"
+
+// Upper bound of instances combined into one Run
+static constexpr size_t kMaxBatch = 8;
+
+SharedEngine::SharedEngine(std::shared_ptr<Ort::Session> session, bool allowBatching) : session_(std::move(session))
+{
+	if (!allowBatching || session_->GetInputCount() != 1 || session_->GetOutputCount() != 1) {
+		return;
+	}
+	const auto inputShape = session_->GetInputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+	const auto outputShape = session_->GetOutputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+	dynamicBatch_ = !inputShape.empty() && inputShape[0] == -1 && !outputShape.empty() && outputShape[0] == -1;
+}
+
+SharedEngine::~SharedEngine()
+{
+	batchInput_.reset();
+	batchOutput_.reset();
+	if (stream_) {
+		cudaStreamDestroy(stream_);
+		stream_ = nullptr;
+	}
+}
+
+CUstream_st *SharedEngine::stream()
+{
+	if (!stream_ && cudaStreamCreateWithFlags(&stream_, cudaStreamNonBlocking) != cudaSuccess) {
+		stream_ = nullptr;
+	}
+	return stream_;
+}
+
+bool SharedEngine::batchable(const filter_data *tf) const
+{
+	return dynamicBatch_ && tf->ioBinding && tf->inputNames.size() == 1 && tf->outputNames.size() == 1 &&
+	       !tf->inputDeviceBuffers.empty() && !tf->inputDeviceBuffers[0].empty() &&
+	       !tf->halfInput && tf->model->recurrentStatePairs().empty();
+}
+
+bool SharedEngine::runBatched(filter_data *tf)
+{
+	Request request{tf};
+	{
+		std::lock_guard<std::mutex> lock(pendingMutex_);
+		pending_.push_back(&request);
+	}
+
+	// Whoever holds the session runs everything that is pending by then
+	std::lock_guard<std::mutex> runLock(runMutex_);
+	while (!request.done) {
+		std::vector<Request *> batch;
+		{
+			std::lock_guard<std::mutex> lock(pendingMutex_);
+			const size_t count = std::min(pending_.size(), kMaxBatch);
+			batch.assign(pending_.begin(), pending_.begin() + count);
+			pending_.erase(pending_.begin(), pending_.begin() + count);
+		}
+		const bool ok = executeBatch(batch);
+		for (Request *r : batch) {
+			r->ok = ok;
+			r->done = true;
+		}
+	}
+	return request.ok;
+}
+
+bool SharedEngine::executeBatch(const std::vector<Request *> &batch)
+{
+	filter_data *lead = batch[0]->tf;
+	const size_t inputBytes = lead->inputDeviceBuffers[0].size();
+	const size_t outputBytes = lead->outputDeviceBuffers[0].size();
+
+	bool sameShape = true;
+	for (const Request *r : batch) {
+		sameShape = sameShape && r->tf->inputDeviceBuffers[0].size() == inputBytes &&
+			    r->tf->outputDeviceBuffers[0].size() == outputBytes;
+	}
+
+	try {
+		if (batch.size() == 1 || !sameShape) {
+			for (const Request *r : batch) {
+				r->tf->model->runNetworkInference(session_, *r->tf->ioBinding,
+								  r->tf->ioBindingRunOptions[r->tf->recurrentParity]);
+			}
+			return true;
+		}
+
+		NVTX_RANGE_COLOR("batched_inference", NVTX_COLOR_INFERENCE);
+		const size_t n = batch.size();
+		if ((batchInput_.size() < n * inputBytes && !batchInput_.allocate(n * inputBytes)) ||
+		    (batchOutput_.size() < n * outputBytes && !batchOutput_.allocate(n * outputBytes))) {
+			obs_log(LOG_WARNING, "Unable to allocate batch tensors for %d instances", (int)n);
+			return false;
+		}
+
+		// Gather: callers synchronized their streams, so the inputs are complete
+		cudaStream_t s = stream();
+		for (size_t i = 0; i < n; i++) {
+			const void *src = batch[i]->tf->inputDeviceBuffers[0].data();
+			cudaMemcpyAsync(batchInput_.as<uint8_t>() + i * inputBytes, src, inputBytes,
+					cudaMemcpyDeviceToDevice, s);
+		}
+		if (cudaStreamSynchronize(s) != cudaSuccess) {
+			return false;
+		}
+
+		std::vector<int64_t> inputDims = lead->inputDims[0];
+		std::vector<int64_t> outputDims = lead->outputDims[0];
+		inputDims[0] = (int64_t)n;
+		outputDims[0] = (int64_t)n;
+
+		Ort::MemoryInfo cudaMemoryInfo("Cuda", OrtAllocatorType::OrtDeviceAllocator, lead->deviceId,
+					       OrtMemType::OrtMemTypeDefault);
+		Ort::Value input = Ort::Value::CreateTensor<float>(cudaMemoryInfo, batchInput_.as<float>(),
+								   n * inputBytes / sizeof(float), inputDims.data(),
+								   inputDims.size());
+		Ort::Value output = Ort::Value::CreateTensor<float>(cudaMemoryInfo, batchOutput_.as<float>(),
+								    n * outputBytes / sizeof(float), outputDims.data(),
+								    outputDims.size());
+		const char *inputName = lead->inputNames[0].get();
+		const char *outputName = lead->outputNames[0].get();
+		session_->Run(Ort::RunOptions{nullptr}, &inputName, &input, 1, &outputName, &output, 1);
+
+		// Scatter back into each instance's bound output
+		for (size_t i = 0; i < n; i++) {
+			void *dst = batch[i]->tf->outputDeviceBuffers[0].data();
+			cudaMemcpyAsync(dst, batchOutput_.as<uint8_t>() + i * outputBytes, outputBytes,
+					cudaMemcpyDeviceToDevice, s);
+		}
+		return cudaStreamSynchronize(s) == cudaSuccess;
+	} catch (const std::exception &e) {
+		obs_log(LOG_ERROR, "Shared engine inference failed: %s", e.what());
+		return false;
+	}
+}
+
+CUstream_st *sharedSessionStream(int device, SchedulingPriority priority)
+{
+	if (priority == SchedulingPriority::NORMAL) {
+		return nullptr;
+	}
+	static std::mutex streamsMutex;
+	static std::map<std::pair<int, SchedulingPriority>, CUstream_st *> streams;
+
+	std::lock_guard<std::mutex> lock(streamsMutex);
+	CUstream_st *&s = streams[{device, priority}];
+	if (!s) {
+		CudaDeviceScope scope(device);
+		if (cudaStreamCreateWithPriority(&s, cudaStreamDefault, cudaStreamPriority(priority)) != cudaSuccess) {
+			s = nullptr;
+		}
+	}
+	return s;
+}
+
+std::shared_ptr<SharedEngine> acquireSharedEngine(const SharedEngineKey &key,
+						  const std::function<std::shared_ptr<Ort::Session>()> &create)
+{
+	struct RegistryEntry {
+		std::mutex createMutex; // held while creating, so instances loading the same model build it once
+		std::weak_ptr<SharedEngine> engine;
+	};
+	static std::mutex registryMutex;
+	static std::map<std::string, std::shared_ptr<RegistryEntry>> registry;
+
+	// A TensorRT build of one key (e.g. by the engine warmup) doesn't block the others
+	std::shared_ptr<RegistryEntry> slot;
+	{
+		std::lock_guard<std::mutex> registryLock(registryMutex);
+		std::shared_ptr<RegistryEntry> &found = registry[key.str()];
+		if (!found) {
+			found = std::make_shared<RegistryEntry>();
+		}
+		slot = found;
+	}
+
+	std::lock_guard<std::mutex> lock(slot->createMutex);
+	std::weak_ptr<SharedEngine> &entry = slot->engine;
+	if (std::shared_ptr<SharedEngine> engine = entry.lock()) {
+		obs_log(LOG_INFO, "Sharing ORT session %s (%ld users)", key.str().c_str(), entry.use_count());
+		return engine;
+	}
+
+	std::shared_ptr<Ort::Session> session = create();
+	if (!session) {
+		return nullptr;
+	}
+	// TensorRT engines are built for fixed profile shapes, so only CUDA sessions are batched
+	auto engine = std::make_shared<SharedEngine>(std::move(session), key.executionProvider != USEGPU_TENSORRT);
+	entry = engine;
+	obs_log(LOG_INFO, "Created shared ORT session %s", key.str().c_str());
+	return engine;
+}
@@ -0,0 +1,100 @@
+#ifndef SHARED_ENGINE_H
+#define SHARED_ENGINE_H
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <onnxruntime_cxx_api.h>
+
+#include "cuda-device-buffer.h"
+#include "gpu-info.h"
+
+struct filter_data;
+struct CUstream_st;
+
+// Identifies a session that filter instances can share.
+struct SharedEngineKey {
+	std::string modelPath;
+	std::string executionProvider; // USEGPU_CUDA / USEGPU_TENSORRT
+	std::string precision;         // TensorRT build precision (precisionModeName), empty for CUDA
+	std::string trtProfileShapes;  // TensorRT engines are built for these fixed shapes
+	int deviceId = 0;              // CUDA device the session runs on
+	SchedulingPriority priority = SchedulingPriority::NORMAL; // of the stream the session runs on
+
+	std::string str() const
+	{
+		const std::string stream = priority == SchedulingPriority::NORMAL
+						   ? std::string()
+						   : std::string("|") + schedulingPriorityName(priority);
+		return modelPath + "|" + executionProvider + (precision.empty() ? "" : "|" + precision) +
+		       (trtProfileShapes.empty() ? "" : "|" + trtProfileShapes) + "|gpu" + std::to_string(deviceId) +
+		       stream;
+	}
+};
+
+// One ORT session (weights, TensorRT engine, CUDA arena) shared by every filter
+// instance that uses the same model, execution provider and precision. Each
+// instance keeps its own tensors, IoBinding and recurrent state.
+//
+// A shared session synchronizes at the end of each Run, because its callers
+// queue pre/postprocessing on different streams. At the normal priority it
+// runs on ORT's own stream, at another one on sharedSessionStream().
+//
+// Models with a dynamic batch dimension, a single input/output and no recurrent
+// state are batched across instances: concurrent run() calls are combined by
+// whichever caller gets the session first, which concatenates the inputs into a
+// [N, ...] tensor, runs once and scatters the outputs back.
+class SharedEngine {
+public:
+	SharedEngine(std::shared_ptr<Ort::Session> session, bool allowBatching);
+	~SharedEngine();
+
+	SharedEngine(const SharedEngine &) = delete;
+	SharedEngine &operator=(const SharedEngine &) = delete;
+
+	const std::shared_ptr<Ort::Session> &session() const { return session_; }
+
+	// Whether run() batches tf's inference with other instances.
+	bool batchable(const filter_data *tf) const;
+
+	// Run tf's bound device tensors (IoBinding), batched with concurrent
+	// requests. Returns when tf's outputs are complete.
+	bool runBatched(filter_data *tf);
+
+private:
+	struct Request {
+		filter_data *tf;
+		bool done = false;
+		bool ok = false;
+	};
+
+	bool executeBatch(const std::vector<Request *> &batch);
+	CUstream_st *stream();
+
+	std::shared_ptr<Ort::Session> session_;
+	bool dynamicBatch_ = false;
+
+	std::mutex pendingMutex_;
+	std::vector<Request *> pending_;
+	std::mutex runMutex_; // held by the caller executing a batch
+
+	// Batch tensors, grown on demand (guarded by runMutex_)
+	CudaDeviceBuffer batchInput_;
+	CudaDeviceBuffer batchOutput_;
+	CUstream_st *stream_ = nullptr;
+};
+
+// Stream of device at priority for the shared sessions of that priority
+// (created on first use and kept for the process lifetime, as sessions of the
+// registry may outlive their engine). nullptr at the normal priority.
+CUstream_st *sharedSessionStream(int device, SchedulingPriority priority);
+
+// Process-wide registry: return the engine for key, creating the session with
+// create() if no instance holds it yet. Returns nullptr if create() fails.
+std::shared_ptr<SharedEngine> acquireSharedEngine(const SharedEngineKey &key,
+						  const std::function<std::shared_ptr<Ort::Session>()> &create);
+
+#endif /* SHARED_ENGINE_H */
@@ -0,0 +1,203 @@
+#include "simd-kernels.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SIMD_KERNELS_AVX2 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(SIMD_KERNELS_AVX2) && (defined(__GNUC__) || defined(__clang__))
+#define AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define AVX2_TARGET
+#endif
+
+static void interleavedToPlanarScalar(const float *src, float *dst, int begin, int pixels, int channels)
+{
+	for (int c = 0; c < channels; c++) {
+		float *plane = dst + (size_t)c * pixels;
+		for (int i = begin; i < pixels; i++) {
+			plane[i] = src[(size_t)i * channels + c];
+		}
+	}
+}
+
+static void planarToInterleavedScalar(const float *src, float *dst, int begin, int pixels, int channels)
+{
+	for (int c = 0; c < channels; c++) {
+		const float *plane = src + (size_t)c * pixels;
+		for (int i = begin; i < pixels; i++) {
+			dst[(size_t)i * channels + c] = plane[i];
+		}
+	}
+}
+
+static void foregroundClassMaskScalar(const float *scores, float *mask, int begin, int pixels, int classes)
+{
+	for (int i = begin; i < pixels; i++) {
+		const float *pixel = scores + (size_t)i * classes;
+		float maxValue = 0.0f;
+		int maxIndex = 0;
+		for (int c = 0; c < classes; c++) {
+			if (pixel[c] > maxValue) {
+				maxValue = pixel[c];
+				maxIndex = c;
+			}
+		}
+		mask[i] = maxIndex > 0 ? maxValue : 0.0f;
+	}
+}
+
+#ifdef SIMD_KERNELS_AVX2
+
+static bool detectAvx2()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) {
+		return false;
+	}
+	__cpuid(info, 1);
+	const bool osxsave = (info[2] & (1 << 27)) != 0;
+	const bool avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+		return false;
+	}
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+static bool hasAvx2()
+{
+	static const bool avx2 = detectAvx2();
+	return avx2;
+}
+
+// 8 pixels per iteration. The 24 interleaved values are regrouped into 128-bit
+// lanes of 4 pixels (pixels 0-3 low, 4-7 high), then every lane is
+// deinterleaved with blends and an in-lane permute: with the lane holding
+// A = x0 y0 z0 x1, B = y1 z1 x2 y2, C = z2 x3 y3 z3, each plane takes its values
+// from A, B and C at fixed positions.
+AVX2_TARGET static int interleavedToPlanar3Avx2(const float *src, float *dst, int pixels)
+{
+	float *x = dst;
+	float *y = dst + pixels;
+	float *z = dst + 2 * (size_t)pixels;
+	int i = 0;
+	for (; i + 8 <= pixels; i += 8) {
+		const float *p = src + (size_t)i * 3;
+		const __m256 r0 = _mm256_loadu_ps(p);
+		const __m256 r1 = _mm256_loadu_ps(p + 8);
+		const __m256 r2 = _mm256_loadu_ps(p + 16);
+		const __m256 a = _mm256_permute2f128_ps(r0, r1, 0x30);
+		const __m256 b = _mm256_permute2f128_ps(r0, r2, 0x21);
+		const __m256 c = _mm256_permute2f128_ps(r1, r2, 0x30);
+
+		const __m256 tx = _mm256_blend_ps(_mm256_blend_ps(a, b, 0x44), c, 0x22); // x0 x3 x2 x1
+		const __m256 ty = _mm256_blend_ps(_mm256_blend_ps(a, b, 0x99), c, 0x44); // y1 y0 y3 y2
+		const __m256 tz = _mm256_blend_ps(_mm256_blend_ps(a, b, 0x22), c, 0x99); // z2 z1 z0 z3
+		_mm256_storeu_ps(x + i, _mm256_permute_ps(tx, _MM_SHUFFLE(1, 2, 3, 0)));
+		_mm256_storeu_ps(y + i, _mm256_permute_ps(ty, _MM_SHUFFLE(2, 3, 0, 1)));
+		_mm256_storeu_ps(z + i, _mm256_permute_ps(tz, _MM_SHUFFLE(3, 0, 1, 2)));
+	}
+	return i;
+}
+
+// Inverse of interleavedToPlanar3Avx2 (the in-lane permutes are their own inverse)
+AVX2_TARGET static int planarToInterleaved3Avx2(const float *src, float *dst, int pixels)
+{
+	const float *x = src;
+	const float *y = src + pixels;
+	const float *z = src + 2 * (size_t)pixels;
+	int i = 0;
+	for (; i + 8 <= pixels; i += 8) {
+		const __m256 tx = _mm256_permute_ps(_mm256_loadu_ps(x + i), _MM_SHUFFLE(1, 2, 3, 0));
+		const __m256 ty = _mm256_permute_ps(_mm256_loadu_ps(y + i), _MM_SHUFFLE(2, 3, 0, 1));
+		const __m256 tz = _mm256_permute_ps(_mm256_loadu_ps(z + i), _MM_SHUFFLE(3, 0, 1, 2));
+		const __m256 a = _mm256_blend_ps(_mm256_blend_ps(tx, ty, 0x22), tz, 0x44);
+		const __m256 b = _mm256_blend_ps(_mm256_blend_ps(ty, tz, 0x22), tx, 0x44);
+		const __m256 c = _mm256_blend_ps(_mm256_blend_ps(tz, tx, 0x22), ty, 0x44);
+
+		float *p = dst + (size_t)i * 3;
+		_mm256_storeu_ps(p, _mm256_permute2f128_ps(a, b, 0x20));
+		_mm256_storeu_ps(p + 8, _mm256_permute2f128_ps(c, a, 0x30));
+		_mm256_storeu_ps(p + 16, _mm256_permute2f128_ps(b, c, 0x31));
+	}
+	return i;
+}
+
+// 8 pixels per iteration, one gather per class. Same comparison order as the
+// scalar loop, so ties and non-positive scores resolve identically.
+AVX2_TARGET static int foregroundClassMaskAvx2(const float *scores, float *mask, int pixels, int classes)
+{
+	const __m256i offsets =
+		_mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(classes));
+	int i = 0;
+	for (; i + 8 <= pixels; i += 8) {
+		const float *p = scores + (size_t)i * classes;
+		__m256 maxValue = _mm256_setzero_ps();
+		__m256 foreground = _mm256_setzero_ps(); // all bits set where a foreground class leads
+		for (int c = 0; c < classes; c++) {
+			const __m256 value = _mm256_i32gather_ps(p + c, offsets, 4);
+			const __m256 greater = _mm256_cmp_ps(value, maxValue, _CMP_GT_OQ);
+			maxValue = _mm256_blendv_ps(maxValue, value, greater);
+			// Background comes first, so only later classes can take the lead
+			if (c > 0) {
+				foreground = _mm256_or_ps(foreground, greater);
+			}
+		}
+		_mm256_storeu_ps(mask + i, _mm256_and_ps(maxValue, foreground));
+	}
+	return i;
+}
+
+#endif
+
+void interleavedToPlanar(const float *src, float *dst, int pixels, int channels)
+{
+	if (channels == 1) {
+		memcpy(dst, src, (size_t)pixels * sizeof(float));
+		return;
+	}
+	int begin = 0;
+#ifdef SIMD_KERNELS_AVX2
+	if (channels == 3 && hasAvx2()) {
+		begin = interleavedToPlanar3Avx2(src, dst, pixels);
+	}
+#endif
+	interleavedToPlanarScalar(src, dst, begin, pixels, channels);
+}
+
+void planarToInterleaved(const float *src, float *dst, int pixels, int channels)
+{
+	if (channels == 1) {
+		memcpy(dst, src, (size_t)pixels * sizeof(float));
+		return;
+	}
+	int begin = 0;
+#ifdef SIMD_KERNELS_AVX2
+	if (channels == 3 && hasAvx2()) {
+		begin = planarToInterleaved3Avx2(src, dst, pixels);
+	}
+#endif
+	planarToInterleavedScalar(src, dst, begin, pixels, channels);
+}
+
+void foregroundClassMask(const float *scores, float *mask, int pixels, int classes)
+{
+	int begin = 0;
+#ifdef SIMD_KERNELS_AVX2
+	if (classes > 0 && hasAvx2()) {
+		begin = foregroundClassMaskAvx2(scores, mask, pixels, classes);
+	}
+#endif
+	foregroundClassMaskScalar(scores, mask, begin, pixels, classes);
+}
@@ -0,0 +1,19 @@
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+// CPU kernels of the host pre/postprocessing fallbacks. AVX2 when the CPU has
+// it (checked once at runtime), scalar otherwise. Callers own the buffers: the
+// kernels never allocate, and src and dst must not overlap.
+
+// HWC → CHW: pixels interleaved values of channels each into channels planes
+void interleavedToPlanar(const float *src, float *dst, int pixels, int channels);
+
+// CHW → HWC: channels planes of pixels values into interleaved pixels
+void planarToInterleaved(const float *src, float *dst, int pixels, int channels);
+
+// Class argmax of interleaved per-pixel class scores (class 0 = background),
+// fused with the foreground mask: the winning score where a foreground class
+// wins, 0 where the background wins or no score is above 0
+void foregroundClassMask(const float *scores, float *mask, int pixels, int classes);
+
+#endif /* SIMD_KERNELS_H */
@@ -0,0 +1,383 @@
+#include "trace-recorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#include <cuda_runtime.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "gpu-info.h"
+#include "plugin-support.h"
+#include "profiler.h"
+
+// Events kept per thread: about 10 s of a busy pipeline stage at 60 fps
+static constexpr uint64_t kRingEvents = 16384;
+// Beyond this many rings, threads that exited hand theirs to new threads
+static constexpr size_t kMaxRings = 64;
+// GPU ranges a thread waits on at most; more aren't recorded until they finish
+static constexpr size_t kMaxPendingGpu = 64;
+
+struct TraceRecorder::Ring {
+	std::unique_ptr<Event[]> events{new Event[kRingEvents]};
+	std::atomic<uint64_t> head{0}; // events written, event i in slot i % kRingEvents
+	std::atomic<bool> retired{false};
+	int tid = 0;
+	std::string name;
+};
+
+namespace {
+
+struct PendingGpu {
+	const char *name;
+	uint32_t color;
+	CUstream_st *stream;
+	cudaEvent_t start;
+	cudaEvent_t end;
+	int device;
+	uint64_t generation;
+};
+
+// The calling thread's ring, and the CUDA events of its GPU ranges
+struct ThreadTrace {
+	std::shared_ptr<TraceRecorder::Ring> ring;
+	std::vector<cudaEvent_t> freeEvents;
+	std::vector<PendingGpu> pending;
+
+	~ThreadTrace()
+	{
+		if (ring) {
+			ring->retired = true;
+		}
+		for (const PendingGpu &range : pending) {
+			cudaEventDestroy(range.start);
+			cudaEventDestroy(range.end);
+		}
+		for (cudaEvent_t event : freeEvents) {
+			cudaEventDestroy(event);
+		}
+	}
+
+	cudaEvent_t takeEvent()
+	{
+		if (!freeEvents.empty()) {
+			cudaEvent_t event = freeEvents.back();
+			freeEvents.pop_back();
+			return event;
+		}
+		cudaEvent_t event = nullptr;
+		if (cudaEventCreate(&event) != cudaSuccess) {
+			cudaGetLastError();
+			return nullptr;
+		}
+		return event;
+	}
+};
+
+thread_local ThreadTrace threadTrace;
+
+const char *categoryName(uint32_t color)
+{
+	switch (color) {
+	case NVTX_COLOR_TICK:
+		return "tick";
+	case NVTX_COLOR_RENDER:
+		return "render";
+	case NVTX_COLOR_PREPROCESS:
+		return "preprocess";
+	case NVTX_COLOR_INFERENCE:
+		return "inference";
+	case NVTX_COLOR_POSTPROCESS:
+		return "postprocess";
+	case NVTX_COLOR_MEMCOPY:
+		return "memcopy";
+	default:
+		return "other";
+	}
+}
+
+// Thread names come from pthread_getname_np: keep them valid JSON strings
+std::string jsonSafe(const std::string &text)
+{
+	std::string safe = text;
+	for (char &c : safe) {
+		if (c == '"' || c == '\\' || (unsigned char)c < 0x20) {
+			c = '_';
+		}
+	}
+	return safe;
+}
+
+} // namespace
+
+TraceRecorder &TraceRecorder::instance()
+{
+	static TraceRecorder recorder;
+	return recorder;
+}
+
+uint64_t TraceRecorder::now()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		       std::chrono::steady_clock::now().time_since_epoch())
+		.count();
+}
+
+void TraceRecorder::acquire()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (users_++ == 0) {
+		// GPU ranges are placed by anchors of this recording only
+		generation_++;
+		recording_ = true;
+		obs_log(LOG_INFO, "Trace recording started");
+	}
+}
+
+void TraceRecorder::release()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (users_ > 0 && --users_ == 0) {
+		recording_ = false;
+		obs_log(LOG_INFO, "Trace recording stopped");
+	}
+}
+
+std::shared_ptr<TraceRecorder::Ring> TraceRecorder::registerThread()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	std::shared_ptr<Ring> ring;
+	if (rings_.size() >= kMaxRings) {
+		for (const std::shared_ptr<Ring> &candidate : rings_) {
+			if (candidate->retired) {
+				ring = candidate;
+				break;
+			}
+		}
+	}
+	if (!ring) {
+		// Past kMaxRings only while that many threads are alive
+		ring = std::make_shared<Ring>();
+		rings_.push_back(ring);
+	}
+	ring->head = 0;
+	ring->retired = false;
+	ring->tid = (int)syscall(SYS_gettid);
+	char name[16] = {};
+	if (pthread_getname_np(pthread_self(), name, sizeof(name)) != 0 || !name[0]) {
+		snprintf(name, sizeof(name), "thread %d", ring->tid);
+	}
+	ring->name = name;
+	return ring;
+}
+
+void TraceRecorder::push(const Event &event)
+{
+	ThreadTrace &thread = threadTrace;
+	if (!thread.ring) {
+		thread.ring = registerThread();
+	}
+	Ring &ring = *thread.ring;
+	const uint64_t head = ring.head.load(std::memory_order_relaxed);
+	ring.events[head % kRingEvents] = event;
+	ring.head.store(head + 1, std::memory_order_release);
+}
+
+void TraceRecorder::record(const char *name, uint32_t color, uint64_t beginNs, uint64_t endNs)
+{
+	Event event;
+	event.name = name;
+	event.beginNs = beginNs;
+	event.durationNs = endNs > beginNs ? endNs - beginNs : 0;
+	event.color = color;
+	push(event);
+}
+
+bool TraceRecorder::anchor(int device, CUstream_st *stream)
+{
+	const uint64_t generation = generation_;
+	std::lock_guard<std::mutex> lock(gpuMutex_);
+	Anchor &anchor = anchors_[device];
+	if (anchor.event && anchor.generation == generation) {
+		return true;
+	}
+	if (!anchor.event && cudaEventCreate(&anchor.event) != cudaSuccess) {
+		cudaGetLastError();
+		anchor.event = nullptr;
+		return false;
+	}
+	// Waits once per recording and device for the work queued on stream so far
+	if (cudaEventRecord(anchor.event, stream) != cudaSuccess || cudaEventSynchronize(anchor.event) != cudaSuccess) {
+		cudaGetLastError();
+		return false;
+	}
+	anchor.cpuNs = now();
+	anchor.generation = generation;
+	return true;
+}
+
+void TraceRecorder::beginGpu(CUstream_st *stream, CUevent_st *&start)
+{
+	start = nullptr;
+	resolveGpu();
+	ThreadTrace &thread = threadTrace;
+	int device = 0;
+	if (thread.pending.size() >= kMaxPendingGpu || cudaGetDevice(&device) != cudaSuccess ||
+	    !anchor(device, stream)) {
+		cudaGetLastError();
+		return;
+	}
+	cudaEvent_t event = thread.takeEvent();
+	if (!event) {
+		return;
+	}
+	if (cudaEventRecord(event, stream) != cudaSuccess) {
+		cudaGetLastError();
+		thread.freeEvents.push_back(event);
+		return;
+	}
+	start = event;
+}
+
+void TraceRecorder::endGpu(const char *name, uint32_t color, CUstream_st *stream, CUevent_st *start)
+{
+	ThreadTrace &thread = threadTrace;
+	cudaEvent_t end = thread.takeEvent();
+	int device = 0;
+	if (!end || cudaGetDevice(&device) != cudaSuccess || cudaEventRecord(end, stream) != cudaSuccess) {
+		cudaGetLastError();
+		thread.freeEvents.push_back(start);
+		if (end) {
+			thread.freeEvents.push_back(end);
+		}
+		return;
+	}
+	thread.pending.push_back(PendingGpu{name, color, stream, start, end, device, generation_.load()});
+}
+
+void TraceRecorder::resolveGpu()
+{
+	ThreadTrace &thread = threadTrace;
+	for (auto it = thread.pending.begin(); it != thread.pending.end();) {
+		CudaDeviceScope scope(it->device);
+		const cudaError_t status = cudaEventQuery(it->end);
+		if (status == cudaErrorNotReady) {
+			++it;
+			continue;
+		}
+		float sinceAnchorMs = 0.0f;
+		float durationMs = 0.0f;
+		Event event;
+		bool placed = false;
+		if (status == cudaSuccess) {
+			std::lock_guard<std::mutex> lock(gpuMutex_);
+			auto anchor = anchors_.find(it->device);
+			if (anchor != anchors_.end() && anchor->second.generation == it->generation &&
+			    cudaEventElapsedTime(&sinceAnchorMs, anchor->second.event, it->start) == cudaSuccess &&
+			    cudaEventElapsedTime(&durationMs, it->start, it->end) == cudaSuccess) {
+				auto track = gpuTracks_.find(it->stream);
+				if (track == gpuTracks_.end()) {
+					track = gpuTracks_.emplace(it->stream, (int)gpuTrackDevices_.size()).first;
+					gpuTrackDevices_.push_back(it->device);
+				}
+				event.name = it->name;
+				event.beginNs = anchor->second.cpuNs +
+						(uint64_t)std::max(0.0, (double)sinceAnchorMs * 1e6);
+				event.durationNs = (uint64_t)std::max(0.0, (double)durationMs * 1e6);
+				event.color = it->color;
+				event.gpuTrack = track->second;
+				placed = true;
+			}
+		}
+		cudaGetLastError();
+		if (placed) {
+			push(event);
+		}
+		thread.freeEvents.push_back(it->start);
+		thread.freeEvents.push_back(it->end);
+		it = thread.pending.erase(it);
+	}
+}
+
+int TraceRecorder::write(const std::string &path, double seconds)
+{
+	resolveGpu();
+	const uint64_t end = now();
+	const uint64_t window = (uint64_t)(std::max(0.0, seconds) * 1e9);
+	const uint64_t cutoff = end > window ? end - window : 0;
+
+	struct Track {
+		int tid;
+		std::string name;
+	};
+	std::vector<Track> threads;
+	std::vector<std::pair<int, Event>> events; // tid of the thread, event
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		for (const std::shared_ptr<Ring> &ring : rings_) {
+			const uint64_t head = ring->head.load(std::memory_order_acquire);
+			const uint64_t first = head > kRingEvents ? head - kRingEvents : 0;
+			const size_t copied = events.size();
+			for (uint64_t i = first; i < head; i++) {
+				events.emplace_back(ring->tid, ring->events[i % kRingEvents]);
+			}
+			// The thread went on writing: the oldest slots may hold newer events now
+			const uint64_t after = ring->head.load(std::memory_order_acquire);
+			const uint64_t valid = after > kRingEvents ? after - kRingEvents : 0;
+			if (valid > first) {
+				events.erase(events.begin() + copied,
+					     events.begin() + copied + (size_t)std::min(valid - first, head - first));
+			}
+			threads.push_back(Track{ring->tid, jsonSafe(ring->name)});
+		}
+	}
+	std::vector<int> gpuTrackDevices;
+	{
+		std::lock_guard<std::mutex> lock(gpuMutex_);
+		gpuTrackDevices = gpuTrackDevices_;
+	}
+
+	FILE *file = fopen(path.c_str(), "w");
+	if (!file) {
+		return -1;
+	}
+	// CPU threads are process 1, the GPU streams process 2
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+		      "\"args\":{\"name\":\"obs-backgroundremoval\"}},\n");
+	fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,\"args\":{\"name\":\"GPU\"}}");
+	for (const Track &thread : threads) {
+		fprintf(file,
+			",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+			"\"args\":{\"name\":\"%s\"}}",
+			thread.tid, thread.name.c_str());
+	}
+	for (size_t i = 0; i < gpuTrackDevices.size(); i++) {
+		fprintf(file,
+			",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":2,\"tid\":%d,"
+			"\"args\":{\"name\":\"GPU %d stream %d\"}}",
+			(int)i + 1, gpuTrackDevices[i], (int)i + 1);
+	}
+	int written = 0;
+	for (const auto &entry : events) {
+		const Event &event = entry.second;
+		if (!event.name || event.beginNs + event.durationNs < cutoff) {
+			continue;
+		}
+		const bool gpu = event.gpuTrack >= 0;
+		fprintf(file,
+			",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+			"\"pid\":%d,\"tid\":%d}",
+			event.name, categoryName(event.color), (double)event.beginNs / 1000.0,
+			(double)event.durationNs / 1000.0, gpu ? 2 : 1, gpu ? event.gpuTrack + 1 : entry.first);
+		written++;
+	}
+	fprintf(file, "\n]}\n");
+	const bool failed = ferror(file) != 0;
+	if (fclose(file) != 0 || failed) {
+		return -1;
+	}
+	return written;
+}
@@ -0,0 +1,144 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct CUstream_st;
+struct CUevent_st;
+
+// Built-in trace capture for machines without Nsight. While recording is on,
+// every NVTX_RANGE_COLOR scope (profiler.h) is recorded as a complete event
+// into a ring buffer of its thread, and TRACE_GPU_RANGE scopes also time their
+// work on a CUDA stream with a pair of events. write() exports the last seconds
+// of all threads as Chrome trace event JSON (ui.perfetto.dev, chrome://tracing).
+//
+// Each thread writes only its own ring, without locks. write() copies the rings
+// while they are written and drops the events overwritten during the copy.
+class TraceRecorder {
+public:
+	static TraceRecorder &instance();
+
+	// Recording is on while at least one filter asks for it
+	void acquire();
+	void release();
+	static bool recording() { return recording_.load(std::memory_order_relaxed); }
+
+	// Steady clock in ns, the time base of all events
+	static uint64_t now();
+
+	// A CPU range of the calling thread (name is a string literal)
+	void record(const char *name, uint32_t color, uint64_t beginNs, uint64_t endNs);
+
+	// A GPU range of the calling thread on stream: beginGpu records the start
+	// event (null while not recording or if CUDA fails), endGpu the end event.
+	// The range goes to the GPU track of the stream once the calling thread
+	// sees it finished, at its next GPU range.
+	void beginGpu(CUstream_st *stream, CUevent_st *&start);
+	void endGpu(const char *name, uint32_t color, CUstream_st *stream, CUevent_st *start);
+
+	// Write the events of the last seconds to path. Returns the number of
+	// events written, -1 if path can't be written.
+	int write(const std::string &path, double seconds);
+
+	struct Event {
+		const char *name = nullptr;
+		uint64_t beginNs = 0;
+		uint64_t durationNs = 0;
+		uint32_t color = 0;
+		int gpuTrack = -1; // GPU track of the stream, -1: the track of the thread
+	};
+	struct Ring;
+
+private:
+	TraceRecorder() = default;
+
+	void push(const Event &event);
+	std::shared_ptr<Ring> registerThread();
+	bool anchor(int device, CUstream_st *stream);
+	void resolveGpu();
+
+	static inline std::atomic<bool> recording_{false};
+
+	std::mutex mutex_; // rings_, users_, generation_
+	std::vector<std::shared_ptr<Ring>> rings_;
+	int users_ = 0;
+	std::atomic<uint64_t> generation_{0}; // recordings started
+
+	// The GPU ranges of a device are placed by an event recorded and
+	// synchronized once per recording, at a known steady clock time
+	struct Anchor {
+		CUevent_st *event = nullptr;
+		uint64_t cpuNs = 0;
+		uint64_t generation = 0;
+	};
+	std::mutex gpuMutex_; // anchors_, gpuTracks_
+	std::map<int, Anchor> anchors_;
+	std::map<CUstream_st *, int> gpuTracks_;
+	std::vector<int> gpuTrackDevices_;
+};
+
+// RAII CPU range, recorded if recording was on when it began
+class TraceScope {
+public:
+	TraceScope(const char *name, uint32_t color)
+		: name_(name),
+		  color_(color),
+		  beginNs_(TraceRecorder::recording() ? TraceRecorder::now() : 0)
+	{
+	}
+	~TraceScope()
+	{
+		if (beginNs_) {
+			TraceRecorder::instance().record(name_, color_, beginNs_, TraceRecorder::now());
+		}
+	}
+
+	TraceScope(const TraceScope &) = delete;
+	TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+	const char *name_;
+	uint32_t color_;
+	uint64_t beginNs_;
+};
+
+// RAII range of the work the scope queues on stream: the CPU time of the
+// launches on the thread's track, the GPU time between two stream events on
+// the stream's track
+class TraceGpuScope {
+public:
+	TraceGpuScope(const char *name, uint32_t color, CUstream_st *stream)
+		: cpu_(name, color),
+		  name_(name),
+		  color_(color),
+		  stream_(stream)
+	{
+		if (TraceRecorder::recording()) {
+			TraceRecorder::instance().beginGpu(stream_, start_);
+		}
+	}
+	~TraceGpuScope()
+	{
+		if (start_) {
+			TraceRecorder::instance().endGpu(name_, color_, stream_, start_);
+		}
+	}
+
+	TraceGpuScope(const TraceGpuScope &) = delete;
+	TraceGpuScope &operator=(const TraceGpuScope &) = delete;
+
+private:
+	TraceScope cpu_;
+	const char *name_;
+	uint32_t color_;
+	CUstream_st *stream_;
+	CUevent_st *start_ = nullptr;
+};
+
+#endif /* TRACE_RECORDER_H */
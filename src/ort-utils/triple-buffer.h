@@ -0,0 +1,63 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single-producer/single-consumer triple buffer.
+//
+// The producer fills back() and publish()es it, which atomically swaps it with
+// the shared middle buffer. The consumer calls acquire() to swap a freshly
+// published middle buffer into front(). Each buffer is owned by exactly one side
+// at a time and neither side ever waits; the consumer always sees the latest
+// published value, and a value it never acquired is overwritten by the next
+// publish (reported, so callers can count overruns).
+//
+// Buffers are recycled, so T keeps its allocation between frames (e.g. a
+// cv::Mat reused with copyTo).
+template<typename T> class TripleBuffer {
+public:
+	// Producer side
+	T &back() { return buffers_[back_]; }
+	int backIndex() const { return back_; }
+
+	// Hand back() over to the consumer. Returns true if the previously published
+	// value was never acquired (an overrun).
+	bool publish()
+	{
+		const uint8_t previous = middle_.exchange(back_ | kFresh, std::memory_order_acq_rel);
+		back_ = previous & kIndexMask;
+		return (previous & kFresh) != 0;
+	}
+
+	// Consumer side: take the latest published value, if any. front() stays
+	// valid (and owned by the consumer) until the next successful acquire().
+	bool acquire()
+	{
+		if ((middle_.load(std::memory_order_relaxed) & kFresh) == 0) {
+			return false;
+		}
+		const uint8_t previous = middle_.exchange(front_, std::memory_order_acq_rel);
+		front_ = previous & kIndexMask;
+		return true;
+	}
+
+	T &front() { return buffers_[front_]; }
+	const T &front() const { return buffers_[front_]; }
+
+	// Direct access to all buffers, only while neither side is active
+	// (e.g. to release resources).
+	T &buffer(int index) { return buffers_[index]; }
+	static constexpr int size() { return 3; }
+
+private:
+	static constexpr uint8_t kIndexMask = 0x3;
+	static constexpr uint8_t kFresh = 0x4;
+
+	T buffers_[3];
+	std::atomic<uint8_t> middle_{1};
+	uint8_t back_ = 0;  // producer only
+	uint8_t front_ = 2; // consumer only
+};
+
+#endif /* TRIPLE_BUFFER_H */
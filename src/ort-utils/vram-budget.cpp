@@ -0,0 +1,68 @@
+#include "vram-budget.h"
+
+#include <cuda_runtime.h>
+
+#include "gpu-info.h"
+
+// Smaller differences are allocator noise, or a shared session that was reused
+static constexpr size_t kMinFootprintMB = 16;
+
+bool queryVram(int device, size_t &freeMB, size_t &totalMB)
+{
+	CudaDeviceScope scope(device);
+	size_t freeBytes = 0;
+	size_t totalBytes = 0;
+	if (cudaMemGetInfo(&freeBytes, &totalBytes) != cudaSuccess) {
+		cudaGetLastError();
+		return false;
+	}
+	freeMB = freeBytes >> 20;
+	totalMB = totalBytes >> 20;
+	return true;
+}
+
+VramBudget &VramBudget::instance()
+{
+	static VramBudget budget;
+	return budget;
+}
+
+VramBudget::Measurement VramBudget::beginBuild(int device)
+{
+	Measurement measurement;
+	measurement.device = device;
+	size_t totalMB = 0;
+	measurement.valid = queryVram(device, measurement.freeBeforeMB, totalMB);
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	DeviceBuilds &builds = builds_[device];
+	builds.active++;
+	builds.starts++;
+	measurement.starts = builds.starts;
+	measurement.alone = builds.active == 1;
+	return measurement;
+}
+
+void VramBudget::endBuild(const Measurement &measurement, const std::string &key, bool succeeded)
+{
+	size_t freeAfterMB = 0;
+	size_t totalMB = 0;
+	const bool valid = measurement.valid && queryVram(measurement.device, freeAfterMB, totalMB);
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	DeviceBuilds &builds = builds_[measurement.device];
+	builds.active--;
+	// Another build started (or was running) while this one ran: its allocations are in the difference
+	const bool alone = measurement.alone && builds.starts == measurement.starts;
+	if (!valid || !alone || !succeeded || freeAfterMB + kMinFootprintMB > measurement.freeBeforeMB) {
+		return;
+	}
+	footprints_[key] = measurement.freeBeforeMB - freeAfterMB;
+}
+
+size_t VramBudget::footprintMB(const std::string &key)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto it = footprints_.find(key);
+	return it == footprints_.end() ? 0 : it->second;
+}
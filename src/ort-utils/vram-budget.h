@@ -0,0 +1,53 @@
+#ifndef VRAM_BUDGET_H
+#define VRAM_BUDGET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+// Free and total memory of a CUDA device right now, in MB. Returns false if
+// the device can't be queried.
+bool queryVram(int device, size_t &freeMB, size_t &totalMB);
+
+// Process-wide record of what sessions cost on the GPU: the device memory a
+// session build took, by session key. Only builds that had their device to
+// themselves are measured, so the concurrent builds of a scene collection
+// load don't count each other's allocations.
+class VramBudget {
+public:
+	static VramBudget &instance();
+
+	// A session build in progress on a device (beginBuild → endBuild)
+	struct Measurement {
+		int device = 0;
+		size_t freeBeforeMB = 0;
+		uint64_t starts = 0; // builds started on the device, this one included
+		bool alone = false;
+		bool valid = false;
+	};
+
+	Measurement beginBuild(int device);
+
+	// Record the memory the build took as key's footprint, when it succeeded
+	// and no other build on the device overlapped it
+	void endBuild(const Measurement &measurement, const std::string &key, bool succeeded);
+
+	// MB the last measured build of key took, 0 if none was measured
+	size_t footprintMB(const std::string &key);
+
+private:
+	VramBudget() = default;
+
+	struct DeviceBuilds {
+		int active = 0;
+		uint64_t starts = 0;
+	};
+
+	std::mutex mutex_;
+	std::map<int, DeviceBuilds> builds_;
+	std::map<std::string, size_t> footprints_;
+};
+
+#endif /* VRAM_BUDGET_H */
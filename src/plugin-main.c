@@ -20,6 +20,8 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 
 #include "plugin-support.h"
 
+#include "ort-utils/engine-warmup.h"
+#include "ort-utils/ort-env.h"
 #include "update-checker/update-checker.h"
 
 OBS_DECLARE_MODULE()
@@ -35,6 +37,8 @@ extern struct obs_source_info enhance_filter_info;
 
 bool obs_module_load(void)
 {
+	ort_env_init();
+	engine_warmup_start();
 	obs_register_source(&background_removal_filter_info);
 	obs_register_source(&enhance_filter_info);
 	obs_log(LOG_INFO, "Plugin loaded successfully (version %s)", PLUGIN_VERSION);
@@ -46,5 +50,7 @@ bool obs_module_load(void)
 
 void obs_module_unload()
 {
+	engine_warmup_stop();
+	ort_env_release();
 	obs_log(LOG_INFO, "plugin unloaded");
 }